@@ -0,0 +1,649 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file cell-preview-cache.c
+ * @brief CellPreviewCache GObject Class
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup CellPreviewCache
+ * @{
+ */
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include <gds-render/cell-selector/cell-preview-cache.h>
+#include <gds-render/output-renderers/layout-painter.h>
+
+/** @brief Maximum count of previews held in memory */
+#define CELL_PREVIEW_CACHE_MAX_SURFACES (2048)
+
+/** @brief Empty border around the cell in a preview in pixels */
+#define CELL_PREVIEW_CACHE_MARGIN (1.0)
+
+/** @brief Maximum size of the on-disk cache in bytes. The least recently used previews are removed on startup */
+#define CELL_PREVIEW_CACHE_DISK_LIMIT (64 * 1024 * 1024)
+
+/** @brief Age in seconds after which temporary files of aborted writes are removed */
+#define CELL_PREVIEW_CACHE_TEMP_MAX_AGE (3600)
+
+/**
+ * @brief Preview file found while pruning the on-disk cache
+ */
+struct cell_preview_disk_entry {
+	char *path; /**< @brief Path of the file */
+	goffset size; /**< @brief Size in bytes */
+	gint64 mtime; /**< @brief Time of the last use */
+};
+
+/**
+ * @brief A preview rendered in the background
+ *
+ * The job is passed back to the main context after rendering, even if it has been skipped.
+ * The reference to the cache is therefore always dropped in the main context.
+ */
+struct cell_preview_job {
+	CellPreviewCache *cache; /**< @brief Cache. Referenced */
+	struct gds_cell *cell; /**< @brief Cell to render */
+	guint generation; /**< @brief Generation of the cache when the job was created */
+	guint64 sequence; /**< @brief Creation order. Newer jobs are processed first */
+	LayerSettings *settings; /**< @brief Layers to render. Referenced */
+	char *settings_key; /**< @brief Hash of @ref cell_preview_job::settings */
+	GCancellable *cancellable; /**< @brief Cancellable of the generation. Referenced */
+	char *key; /**< @brief Content key of the preview. Set by the worker */
+	cairo_surface_t *surface; /**< @brief Rendered preview. Set by the worker */
+};
+
+struct _CellPreviewCache {
+	/* Inheritance */
+	GObject parent;
+
+	/* Custom elements */
+	unsigned int size; /**< @brief Width and height of the previews */
+	char *disk_cache_dir; /**< @brief Directory of the on-disk cache. NULL if not available */
+	GMainContext *main_context; /**< @brief Context the cache is used from */
+	GThreadPool *pool; /**< @brief Worker threads */
+	LayerSettings *settings; /**< @brief Current layer settings or NULL */
+	char *settings_key; /**< @brief Hash of @ref _CellPreviewCache::settings */
+	GHashTable *pending; /**< @brief Set of cells currently rendered */
+	GHashTable *cell_keys; /**< @brief Maps cells to the content keys of their previews */
+	GHashTable *surfaces; /**< @brief Maps content keys to preview surfaces */
+	GQueue *surface_order; /**< @brief Content keys in @ref _CellPreviewCache::surfaces in insertion order */
+	guint64 sequence; /**< @brief Sequence number of the next job */
+	GCancellable *cancellable; /**< @brief Cancellable of the current generation */
+
+	/* Shared with the worker threads */
+	GMutex lock; /**< @brief Protects the fields below */
+	GCond idle_cond; /**< @brief Signalled when @ref _CellPreviewCache::active_jobs drops to zero */
+	guint generation; /**< @brief Incremented when the previously looked up cells become invalid */
+	guint active_jobs; /**< @brief Jobs currently accessing a cell */
+	GHashTable *digests; /**< @brief Maps cells to the hex SHA-256 digest of their contents including sub-cells */
+};
+
+G_DEFINE_TYPE(CellPreviewCache, cell_preview_cache, G_TYPE_OBJECT)
+
+enum cell_preview_cache_signal_ids {PREVIEW_READY = 0, CELL_PREVIEW_CACHE_SIGNAL_COUNT};
+static guint cell_preview_cache_signals[CELL_PREVIEW_CACHE_SIGNAL_COUNT];
+
+static void cell_preview_job_free(gpointer data)
+{
+	struct cell_preview_job *job = (struct cell_preview_job *)data;
+
+	if (job->surface)
+		cairo_surface_destroy(job->surface);
+	g_free(job->key);
+	g_free(job->settings_key);
+	g_object_unref(job->settings);
+	g_object_unref(job->cancellable);
+	g_object_unref(job->cache);
+	g_free(job);
+}
+
+/**
+ * @brief Get the content digest of a cell
+ *
+ * The digest covers the graphics of the cell and, recursively, all its cell instances.
+ * Two cells with identical contents get the same digest, even if they are located in different libraries or files.
+ *
+ * @param cache Preview cache
+ * @param cell Cell. Must not be affected by a reference loop
+ * @return Digest. Valid until the next cell_preview_cache_clear()
+ */
+static const char *cell_preview_cache_cell_digest(CellPreviewCache *cache, struct gds_cell *cell)
+{
+	GChecksum *checksum;
+	GList *list;
+	GList *vertex_list;
+	struct gds_graphics *gfx;
+	struct gds_cell_instance *instance;
+	struct gds_point *vertex;
+	const char *child_digest;
+	char *digest;
+	char *existing;
+
+	g_mutex_lock(&cache->lock);
+	existing = (char *)g_hash_table_lookup(cache->digests, cell);
+	g_mutex_unlock(&cache->lock);
+	if (existing)
+		return existing;
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+
+	for (list = cell->graphic_objs; list != NULL; list = list->next) {
+		gfx = (struct gds_graphics *)list->data;
+		g_checksum_update(checksum, (const guchar *)&gfx->gfx_type, sizeof(gfx->gfx_type));
+		g_checksum_update(checksum, (const guchar *)&gfx->layer, sizeof(gfx->layer));
+		g_checksum_update(checksum, (const guchar *)&gfx->datatype, sizeof(gfx->datatype));
+		g_checksum_update(checksum, (const guchar *)&gfx->width_absolute, sizeof(gfx->width_absolute));
+		g_checksum_update(checksum, (const guchar *)&gfx->path_render_type, sizeof(gfx->path_render_type));
+		for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+			vertex = (struct gds_point *)vertex_list->data;
+			g_checksum_update(checksum, (const guchar *)vertex, sizeof(*vertex));
+		}
+		/* Separator between graphics */
+		g_checksum_update(checksum, (const guchar *)"G", 1);
+	}
+
+	for (list = cell->child_cells; list != NULL; list = list->next) {
+		instance = (struct gds_cell_instance *)list->data;
+		if (!instance->cell_ref)
+			continue;
+
+		child_digest = cell_preview_cache_cell_digest(cache, instance->cell_ref);
+		g_checksum_update(checksum, (const guchar *)child_digest, -1);
+		g_checksum_update(checksum, (const guchar *)&instance->origin, sizeof(instance->origin));
+		g_checksum_update(checksum, (const guchar *)&instance->flipped, sizeof(instance->flipped));
+		g_checksum_update(checksum, (const guchar *)&instance->angle, sizeof(instance->angle));
+		g_checksum_update(checksum, (const guchar *)&instance->magnification, sizeof(instance->magnification));
+	}
+
+	digest = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+
+	/* Another worker might have been faster */
+	g_mutex_lock(&cache->lock);
+	existing = (char *)g_hash_table_lookup(cache->digests, cell);
+	if (existing) {
+		g_free(digest);
+		digest = existing;
+	} else {
+		g_hash_table_insert(cache->digests, cell, digest);
+	}
+	g_mutex_unlock(&cache->lock);
+
+	return digest;
+}
+
+/**
+ * @brief Render the preview of a job's cell
+ * @param cache Preview cache
+ * @param job Job
+ * @return Preview surface or NULL if cancelled
+ */
+static cairo_surface_t *cell_preview_cache_render(CellPreviewCache *cache, struct cell_preview_job *job)
+{
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	struct layout_painter *painter;
+	const union bounding_box *box;
+	double extent;
+	double scale;
+	int ret = 0;
+
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, (int)cache->size, (int)cache->size);
+	cr = cairo_create(surface);
+
+	painter = layout_painter_new(job->cell, job->settings);
+	box = layout_painter_get_bounding_box(painter);
+	if (!bounding_box_is_empty(box)) {
+		extent = MAX(box->vectors.upper_right.x - box->vectors.lower_left.x,
+			     box->vectors.upper_right.y - box->vectors.lower_left.y);
+		scale = extent > 0.0 ? ((double)cache->size - 2 * CELL_PREVIEW_CACHE_MARGIN) / extent : 1.0;
+
+		/* Center the cell. GDS coordinates have the y axis pointing up */
+		cairo_translate(cr, (double)cache->size / 2.0, (double)cache->size / 2.0);
+		cairo_scale(cr, scale, -scale);
+		cairo_translate(cr, -(box->vectors.lower_left.x + box->vectors.upper_right.x) / 2.0,
+				-(box->vectors.lower_left.y + box->vectors.upper_right.y) / 2.0);
+
+		ret = layout_painter_paint(painter, cr, cache->size, cache->size,
+					   LAYOUT_PAINTER_DEFAULT_LOD_THRESHOLD, job->cancellable);
+	}
+	layout_painter_unref(painter);
+	cairo_destroy(cr);
+
+	if (ret) {
+		cairo_surface_destroy(surface);
+		surface = NULL;
+	}
+
+	return surface;
+}
+
+/**
+ * @brief Store a rendered preview in the disk cache
+ *
+ * The preview is written to a temporary file first. Concurrent readers never see a partial file.
+ *
+ * @param path Path of the preview
+ * @param surface Preview
+ */
+static void cell_preview_cache_write_disk(const char *path, cairo_surface_t *surface)
+{
+	char *temp_path;
+
+	temp_path = g_strdup_printf("%s.%p.tmp", path, (void *)g_thread_self());
+	if (cairo_surface_write_to_png(surface, temp_path) == CAIRO_STATUS_SUCCESS)
+		(void)g_rename(temp_path, path);
+	else
+		(void)g_unlink(temp_path);
+	g_free(temp_path);
+}
+
+static void cell_preview_disk_entry_free(gpointer data)
+{
+	struct cell_preview_disk_entry *entry = (struct cell_preview_disk_entry *)data;
+
+	g_free(entry->path);
+	g_free(entry);
+}
+
+/**
+ * @brief Least recently used previews first
+ */
+static gint cell_preview_disk_entry_compare(gconstpointer a, gconstpointer b)
+{
+	const struct cell_preview_disk_entry *entry_a = (const struct cell_preview_disk_entry *)a;
+	const struct cell_preview_disk_entry *entry_b = (const struct cell_preview_disk_entry *)b;
+
+	if (entry_a->mtime < entry_b->mtime)
+		return -1;
+	if (entry_a->mtime > entry_b->mtime)
+		return 1;
+	return 0;
+}
+
+/**
+ * @brief Limit the size of the on-disk cache
+ *
+ * Runs in its own thread. Stale temporary files are removed. If the previews exceed @ref CELL_PREVIEW_CACHE_DISK_LIMIT,
+ * the least recently used ones are removed. Loading a preview updates its modification time.
+ * A preview removed while a worker reads it is simply rendered again.
+ *
+ * @param data Cache directory. Freed by this function
+ * @return NULL
+ */
+static gpointer cell_preview_cache_prune_disk(gpointer data)
+{
+	char *dir_path = (char *)data;
+	GDir *dir;
+	const char *name;
+	GStatBuf stat_buf;
+	GList *entries = NULL;
+	GList *iter;
+	struct cell_preview_disk_entry *entry;
+	char *path;
+	goffset total_size = 0;
+	gint64 now;
+
+	dir = g_dir_open(dir_path, 0, NULL);
+	if (!dir)
+		goto ret_free_dir_path;
+
+	now = g_get_real_time() / G_USEC_PER_SEC;
+
+	while ((name = g_dir_read_name(dir)) != NULL) {
+		path = g_build_filename(dir_path, name, NULL);
+		if (g_stat(path, &stat_buf)) {
+			g_free(path);
+			continue;
+		}
+
+		if (g_str_has_suffix(name, ".tmp")) {
+			if (now - (gint64)stat_buf.st_mtime > CELL_PREVIEW_CACHE_TEMP_MAX_AGE)
+				(void)g_unlink(path);
+			g_free(path);
+		} else if (g_str_has_suffix(name, ".png")) {
+			entry = g_new(struct cell_preview_disk_entry, 1);
+			entry->path = path;
+			entry->size = (goffset)stat_buf.st_size;
+			entry->mtime = (gint64)stat_buf.st_mtime;
+			entries = g_list_prepend(entries, entry);
+			total_size += entry->size;
+		} else {
+			g_free(path);
+		}
+	}
+	g_dir_close(dir);
+
+	if (total_size > CELL_PREVIEW_CACHE_DISK_LIMIT) {
+		entries = g_list_sort(entries, cell_preview_disk_entry_compare);
+		for (iter = entries; iter && total_size > CELL_PREVIEW_CACHE_DISK_LIMIT; iter = g_list_next(iter)) {
+			entry = (struct cell_preview_disk_entry *)iter->data;
+			if (!g_unlink(entry->path))
+				total_size -= entry->size;
+		}
+	}
+
+	g_list_free_full(entries, cell_preview_disk_entry_free);
+
+ret_free_dir_path:
+	g_free(dir_path);
+	return NULL;
+}
+
+static gboolean cell_preview_job_dispatch(gpointer data)
+{
+	struct cell_preview_job *job = (struct cell_preview_job *)data;
+	CellPreviewCache *cache = job->cache;
+	char *key;
+
+	/* Cell has been forgotten in the meantime */
+	if (!cache->pending || job->generation != cache->generation)
+		return G_SOURCE_REMOVE;
+
+	g_hash_table_remove(cache->pending, job->cell);
+
+	if (!job->key || !job->surface)
+		return G_SOURCE_REMOVE;
+
+	g_hash_table_insert(cache->cell_keys, job->cell, g_strdup(job->key));
+
+	if (!g_hash_table_contains(cache->surfaces, job->key)) {
+		key = g_strdup(job->key);
+		g_hash_table_insert(cache->surfaces, key, job->surface);
+		job->surface = NULL;
+		g_queue_push_tail(cache->surface_order, key);
+
+		/* Drop the oldest previews. They are reloaded from disk on demand */
+		while (g_queue_get_length(cache->surface_order) > CELL_PREVIEW_CACHE_MAX_SURFACES)
+			g_hash_table_remove(cache->surfaces, g_queue_pop_head(cache->surface_order));
+	}
+
+	g_signal_emit(cache, cell_preview_cache_signals[PREVIEW_READY], 0, job->cell);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void cell_preview_job_run(gpointer data, gpointer user_data)
+{
+	struct cell_preview_job *job = (struct cell_preview_job *)data;
+	CellPreviewCache *cache = (CellPreviewCache *)user_data;
+	GChecksum *checksum;
+	char *path = NULL;
+	gboolean skip;
+
+	g_mutex_lock(&cache->lock);
+	skip = (job->generation != cache->generation);
+	if (!skip)
+		cache->active_jobs++;
+	g_mutex_unlock(&cache->lock);
+
+	if (skip)
+		goto post;
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	g_checksum_update(checksum, (const guchar *)cell_preview_cache_cell_digest(cache, job->cell), -1);
+	g_checksum_update(checksum, (const guchar *)job->settings_key, -1);
+	g_checksum_update(checksum, (const guchar *)&cache->size, sizeof(cache->size));
+	job->key = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+
+	if (cache->disk_cache_dir) {
+		path = g_strdup_printf("%s%c%s.png", cache->disk_cache_dir, G_DIR_SEPARATOR, job->key);
+		job->surface = cairo_image_surface_create_from_png(path);
+		if (cairo_surface_status(job->surface) != CAIRO_STATUS_SUCCESS) {
+			cairo_surface_destroy(job->surface);
+			job->surface = NULL;
+		} else {
+			/* Mark as recently used for the pruning of the cache */
+			(void)g_utime(path, NULL);
+		}
+	}
+
+	if (!job->surface) {
+		job->surface = cell_preview_cache_render(cache, job);
+		if (job->surface && path)
+			cell_preview_cache_write_disk(path, job->surface);
+	}
+	g_free(path);
+
+	g_mutex_lock(&cache->lock);
+	if (--cache->active_jobs == 0)
+		g_cond_broadcast(&cache->idle_cond);
+	g_mutex_unlock(&cache->lock);
+
+post:
+	g_main_context_invoke_full(cache->main_context, G_PRIORITY_DEFAULT_IDLE, cell_preview_job_dispatch,
+				   job, cell_preview_job_free);
+}
+
+/**
+ * @brief Process the newest jobs first. These are most likely visible
+ */
+static gint cell_preview_job_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const struct cell_preview_job *job_a = (const struct cell_preview_job *)a;
+	const struct cell_preview_job *job_b = (const struct cell_preview_job *)b;
+	(void)user_data;
+
+	if (job_a->sequence == job_b->sequence)
+		return 0;
+
+	return job_a->sequence > job_b->sequence ? -1 : 1;
+}
+
+/**
+ * @brief Invalidate all looked up cells
+ *
+ * Jobs of the previous generation are skipped or cancelled.
+ *
+ * @param cache Preview cache
+ * @param wait Wait until no worker accesses a cell anymore
+ */
+static void cell_preview_cache_new_generation(CellPreviewCache *cache, gboolean wait)
+{
+	g_mutex_lock(&cache->lock);
+	cache->generation++;
+	g_mutex_unlock(&cache->lock);
+
+	g_cancellable_cancel(cache->cancellable);
+	g_object_unref(cache->cancellable);
+	cache->cancellable = g_cancellable_new();
+
+	g_mutex_lock(&cache->lock);
+	while (wait && cache->active_jobs)
+		g_cond_wait(&cache->idle_cond, &cache->lock);
+	if (wait)
+		g_hash_table_remove_all(cache->digests);
+	g_mutex_unlock(&cache->lock);
+
+	g_hash_table_remove_all(cache->pending);
+	g_hash_table_remove_all(cache->cell_keys);
+}
+
+static void cell_preview_cache_dispose(GObject *obj)
+{
+	CellPreviewCache *self = CELL_PREVIEW_CACHE(obj);
+
+	/* Every job holds a reference. No job is running or queued anymore */
+	if (self->pool) {
+		g_thread_pool_free(self->pool, FALSE, TRUE);
+		self->pool = NULL;
+	}
+
+	g_clear_pointer(&self->pending, g_hash_table_destroy);
+	g_clear_pointer(&self->cell_keys, g_hash_table_destroy);
+	g_clear_pointer(&self->digests, g_hash_table_destroy);
+	if (self->surface_order) {
+		g_queue_free(self->surface_order);
+		self->surface_order = NULL;
+	}
+	g_clear_pointer(&self->surfaces, g_hash_table_destroy);
+	g_clear_pointer(&self->settings_key, g_free);
+	g_clear_pointer(&self->disk_cache_dir, g_free);
+	g_clear_pointer(&self->main_context, g_main_context_unref);
+	g_clear_object(&self->settings);
+	g_clear_object(&self->cancellable);
+
+	G_OBJECT_CLASS(cell_preview_cache_parent_class)->dispose(obj);
+}
+
+static void cell_preview_cache_finalize(GObject *obj)
+{
+	CellPreviewCache *self = CELL_PREVIEW_CACHE(obj);
+
+	g_mutex_clear(&self->lock);
+	g_cond_clear(&self->idle_cond);
+
+	G_OBJECT_CLASS(cell_preview_cache_parent_class)->finalize(obj);
+}
+
+static void cell_preview_cache_class_init(CellPreviewCacheClass *klass)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+	GType cell_param[1] = {G_TYPE_POINTER};
+
+	oclass->dispose = cell_preview_cache_dispose;
+	oclass->finalize = cell_preview_cache_finalize;
+
+	cell_preview_cache_signals[PREVIEW_READY] =
+			g_signal_newv("preview-ready", TYPE_CELL_PREVIEW_CACHE,
+				      G_SIGNAL_RUN_LAST,
+				      NULL,
+				      NULL,
+				      NULL,
+				      NULL,
+				      G_TYPE_NONE,
+				      1,
+				      cell_param);
+}
+
+static void cell_preview_cache_init(CellPreviewCache *self)
+{
+	g_mutex_init(&self->lock);
+	g_cond_init(&self->idle_cond);
+
+	self->main_context = g_main_context_ref_thread_default();
+	self->pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+	self->cell_keys = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	self->digests = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	self->surfaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					       (GDestroyNotify)cairo_surface_destroy);
+	self->surface_order = g_queue_new();
+	self->cancellable = g_cancellable_new();
+
+	/* Leave some processors to the export jobs */
+	self->pool = g_thread_pool_new(cell_preview_job_run, self, MAX(g_get_num_processors() / 2, 1), FALSE, NULL);
+	g_thread_pool_set_sort_function(self->pool, cell_preview_job_compare, NULL);
+}
+
+CellPreviewCache *cell_preview_cache_new(unsigned int size)
+{
+	CellPreviewCache *cache;
+
+	cache = CELL_PREVIEW_CACHE(g_object_new(TYPE_CELL_PREVIEW_CACHE, NULL));
+	cache->size = MAX(size, 1U);
+
+	cache->disk_cache_dir = g_build_filename(g_get_user_cache_dir(), "gds-render", "previews", NULL);
+	if (g_mkdir_with_parents(cache->disk_cache_dir, 0700))
+		g_clear_pointer(&cache->disk_cache_dir, g_free);
+	else
+		g_thread_unref(g_thread_new("preview-cache-prune", cell_preview_cache_prune_disk,
+					    g_strdup(cache->disk_cache_dir)));
+
+	return cache;
+}
+
+void cell_preview_cache_set_layer_settings(CellPreviewCache *cache, LayerSettings *settings)
+{
+	GChecksum *checksum;
+	GList *info_list;
+	struct layer_info *info;
+
+	g_return_if_fail(CELL_PREVIEW_IS_CACHE(cache));
+	g_return_if_fail(GDS_RENDER_IS_LAYER_SETTINGS(settings));
+
+	/* Previews of the old settings are still valid for their content key. Only forget the cells */
+	cell_preview_cache_new_generation(cache, FALSE);
+
+	g_clear_object(&cache->settings);
+	cache->settings = g_object_ref(settings);
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	for (info_list = layer_settings_get_layer_info_list(settings); info_list; info_list = g_list_next(info_list)) {
+		info = (struct layer_info *)info_list->data;
+		if (!info->render)
+			continue;
+		g_checksum_update(checksum, (const guchar *)&info->layer, sizeof(info->layer));
+		g_checksum_update(checksum, (const guchar *)&info->color, sizeof(info->color));
+	}
+	g_free(cache->settings_key);
+	cache->settings_key = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+}
+
+cairo_surface_t *cell_preview_cache_lookup(CellPreviewCache *cache, struct gds_cell *cell, gboolean render)
+{
+	struct cell_preview_job *job;
+	const char *key;
+	cairo_surface_t *surface;
+
+	g_return_val_if_fail(CELL_PREVIEW_IS_CACHE(cache), NULL);
+
+	/* Cells with reference loops cannot be rendered. Unchecked cells might contain a loop */
+	if (!cell || !cache->settings || cell->checks.affected_by_reference_loop != 0)
+		return NULL;
+
+	key = (const char *)g_hash_table_lookup(cache->cell_keys, cell);
+	if (key) {
+		surface = (cairo_surface_t *)g_hash_table_lookup(cache->surfaces, key);
+		if (surface)
+			return surface;
+	}
+
+	if (!render || g_hash_table_contains(cache->pending, cell))
+		return NULL;
+
+	job = g_new0(struct cell_preview_job, 1);
+	job->cache = g_object_ref(cache);
+	job->cell = cell;
+	job->generation = cache->generation;
+	job->sequence = cache->sequence++;
+	job->settings = g_object_ref(cache->settings);
+	job->settings_key = g_strdup(cache->settings_key);
+	job->cancellable = g_object_ref(cache->cancellable);
+
+	g_hash_table_add(cache->pending, cell);
+	g_thread_pool_push(cache->pool, job, NULL);
+
+	return NULL;
+}
+
+void cell_preview_cache_clear(CellPreviewCache *cache)
+{
+	g_return_if_fail(CELL_PREVIEW_IS_CACHE(cache));
+
+	cell_preview_cache_new_generation(cache, TRUE);
+}
+
+/** @} */
@@ -0,0 +1,622 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file cell-tree-model.c
+ * @brief CellTreeModel GObject Class
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup CellTreeModel
+ * @{
+ */
+
+#include <string.h>
+
+#include <gds-render/cell-selector/cell-tree-model.h>
+#include <gds-render/cell-selector/lib-cell-renderer.h>
+
+/** @brief Length of the substrings stored in the search index */
+#define CELL_TREE_MODEL_NGRAM_LEN (3)
+
+/**
+ * @brief Top level node of the model
+ */
+struct cell_tree_lib {
+	struct gds_library *lib; /**< @brief Library shown in this node */
+	guint index; /**< @brief Position of the node in _CellTreeModel::libs */
+	GPtrArray *cells; /**< @brief Cells of the library. Elements are not owned */
+	guint8 *error_levels; /**< @brief Error level of each cell in @ref cell_tree_lib::cells */
+	GArray *visible; /**< @brief Indices (guint) of the cells matching the filter. NULL: All cells are visible */
+	GHashTable *trigrams; /**< @brief Search index. Maps a packed trigram to a GArray of cell indices. Built on demand */
+};
+
+struct _CellTreeModel {
+	/* Inheritance */
+	GObject parent;
+
+	/* Custom elements */
+	GPtrArray *libs; /**< @brief Array of @ref cell_tree_lib nodes */
+	gint stamp; /**< @brief Stamp of valid iters */
+	char *filter; /**< @brief Current search string or NULL */
+};
+
+static void cell_tree_model_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(CellTreeModel, cell_tree_model, G_TYPE_OBJECT,
+			G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, cell_tree_model_tree_model_init))
+
+static void cell_tree_lib_free(gpointer data)
+{
+	struct cell_tree_lib *node = (struct cell_tree_lib *)data;
+
+	g_ptr_array_free(node->cells, TRUE);
+	g_free(node->error_levels);
+	if (node->visible)
+		g_array_unref(node->visible);
+	if (node->trigrams)
+		g_hash_table_destroy(node->trigrams);
+	g_free(node);
+}
+
+static guint cell_tree_lib_row_count(const struct cell_tree_lib *node)
+{
+	return node->visible ? node->visible->len : node->cells->len;
+}
+
+static guint cell_tree_lib_cell_index(const struct cell_tree_lib *node, guint row)
+{
+	return node->visible ? g_array_index(node->visible, guint, row) : row;
+}
+
+/**
+ * @brief Pack the first three bytes of \p str into a hash table key
+ *
+ * Cell names do not contain NUL characters. The key is therefore never 0.
+ */
+static gpointer cell_tree_trigram_key(const char *str)
+{
+	return GUINT_TO_POINTER(((guint)(guchar)str[0] << 16) | ((guint)(guchar)str[1] << 8) | (guint)(guchar)str[2]);
+}
+
+/**
+ * @brief Build the trigram search index of a library node
+ *
+ * Each cell index is stored at most once per trigram. The index lists are sorted in ascending order.
+ *
+ * @param node Library node
+ */
+static void cell_tree_lib_build_index(struct cell_tree_lib *node)
+{
+	guint i;
+	const char *pos;
+	const struct gds_cell *cell;
+	gpointer key;
+	GArray *list;
+
+	node->trigrams = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_array_unref);
+
+	for (i = 0; i < node->cells->len; i++) {
+		cell = (const struct gds_cell *)g_ptr_array_index(node->cells, i);
+		for (pos = cell->name; pos[0] && pos[1] && pos[2]; pos++) {
+			key = cell_tree_trigram_key(pos);
+			list = (GArray *)g_hash_table_lookup(node->trigrams, key);
+			if (!list) {
+				list = g_array_new(FALSE, FALSE, sizeof(guint));
+				g_hash_table_insert(node->trigrams, key, list);
+			}
+
+			/* Trigram occurs more than once in this name */
+			if (list->len && g_array_index(list, guint, list->len - 1) == i)
+				continue;
+
+			g_array_append_val(list, i);
+		}
+	}
+}
+
+/**
+ * @brief Calculate the visible cells of a library node
+ *
+ * Search strings shorter than a trigram are matched by a linear scan. For longer strings, the
+ * cells containing the rarest trigram of the search string are taken as candidates and verified.
+ *
+ * @param node Library node
+ * @param search Search string. NULL or empty shows all cells
+ */
+static void cell_tree_lib_apply_filter(struct cell_tree_lib *node, const char *search)
+{
+	size_t len;
+	size_t pos;
+	guint i;
+	guint idx;
+	GArray *list;
+	GArray *candidates = NULL;
+	const struct gds_cell *cell;
+
+	if (node->visible) {
+		g_array_unref(node->visible);
+		node->visible = NULL;
+	}
+
+	if (!search || !*search)
+		return;
+
+	node->visible = g_array_new(FALSE, FALSE, sizeof(guint));
+	len = strlen(search);
+
+	if (len < CELL_TREE_MODEL_NGRAM_LEN) {
+		for (i = 0; i < node->cells->len; i++) {
+			cell = (const struct gds_cell *)g_ptr_array_index(node->cells, i);
+			if (strstr(cell->name, search))
+				g_array_append_val(node->visible, i);
+		}
+		return;
+	}
+
+	if (!node->trigrams)
+		cell_tree_lib_build_index(node);
+
+	for (pos = 0; pos + CELL_TREE_MODEL_NGRAM_LEN <= len; pos++) {
+		list = (GArray *)g_hash_table_lookup(node->trigrams, cell_tree_trigram_key(&search[pos]));
+
+		/* No cell contains this part of the search string */
+		if (!list)
+			return;
+
+		if (!candidates || list->len < candidates->len)
+			candidates = list;
+	}
+
+	for (i = 0; i < candidates->len; i++) {
+		idx = g_array_index(candidates, guint, i);
+		cell = (const struct gds_cell *)g_ptr_array_index(node->cells, idx);
+		if (strstr(cell->name, search))
+			g_array_append_val(node->visible, idx);
+	}
+}
+
+static struct cell_tree_lib *cell_tree_model_find_lib(CellTreeModel *self, const struct gds_library *lib)
+{
+	guint i;
+	struct cell_tree_lib *node;
+
+	for (i = 0; i < self->libs->len; i++) {
+		node = (struct cell_tree_lib *)g_ptr_array_index(self->libs, i);
+		if (node->lib == lib)
+			return node;
+	}
+
+	return NULL;
+}
+
+static void cell_tree_model_fill_iter(CellTreeModel *self, GtkTreeIter *iter, struct cell_tree_lib *node, guint row)
+{
+	iter->stamp = self->stamp;
+	iter->user_data = node;
+	/* 0 denotes the library row itself */
+	iter->user_data2 = GUINT_TO_POINTER(row);
+	iter->user_data3 = NULL;
+}
+
+/**
+ * @brief Get the library node and the cell row of an iter
+ * @param iter Iter
+ * @param[out] row Row of the cell in the library node. Only valid if TRUE is returned
+ * @return TRUE if \p iter points to a cell, FALSE if it points to a library
+ */
+static gboolean cell_tree_model_iter_is_cell(const GtkTreeIter *iter, guint *row)
+{
+	guint data = GPOINTER_TO_UINT(iter->user_data2);
+
+	if (!data)
+		return FALSE;
+
+	*row = data - 1;
+	return TRUE;
+}
+
+static GtkTreeModelFlags cell_tree_model_get_flags(GtkTreeModel *tree_model)
+{
+	(void)tree_model;
+
+	return 0;
+}
+
+static gint cell_tree_model_get_n_columns(GtkTreeModel *tree_model)
+{
+	(void)tree_model;
+
+	return CELL_SEL_COLUMN_COUNT;
+}
+
+static GType cell_tree_model_get_column_type(GtkTreeModel *tree_model, gint index)
+{
+	(void)tree_model;
+
+	g_return_val_if_fail(index >= 0 && index < CELL_SEL_COLUMN_COUNT, G_TYPE_INVALID);
+
+	return index == CELL_SEL_CELL_ERROR_STATE ? G_TYPE_UINT : G_TYPE_POINTER;
+}
+
+static gboolean cell_tree_model_get_iter(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	struct cell_tree_lib *node;
+	gint depth;
+	gint *indices;
+
+	indices = gtk_tree_path_get_indices_with_depth(path, &depth);
+	if (depth < 1 || depth > 2 || indices[0] < 0 || (guint)indices[0] >= self->libs->len)
+		return FALSE;
+
+	node = (struct cell_tree_lib *)g_ptr_array_index(self->libs, indices[0]);
+	if (depth == 1) {
+		cell_tree_model_fill_iter(self, iter, node, 0);
+		return TRUE;
+	}
+
+	if (indices[1] < 0 || (guint)indices[1] >= cell_tree_lib_row_count(node))
+		return FALSE;
+
+	cell_tree_model_fill_iter(self, iter, node, (guint)indices[1] + 1);
+	return TRUE;
+}
+
+static GtkTreePath *cell_tree_model_get_path(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	struct cell_tree_lib *node;
+	GtkTreePath *path;
+	guint row;
+
+	g_return_val_if_fail(iter->stamp == self->stamp, NULL);
+
+	node = (struct cell_tree_lib *)iter->user_data;
+	path = gtk_tree_path_new();
+	gtk_tree_path_append_index(path, (gint)node->index);
+	if (cell_tree_model_iter_is_cell(iter, &row))
+		gtk_tree_path_append_index(path, (gint)row);
+
+	return path;
+}
+
+static void cell_tree_model_get_value(GtkTreeModel *tree_model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	struct cell_tree_lib *node;
+	struct gds_cell *cell = NULL;
+	guint error_level = 0;
+	guint row;
+	guint idx;
+
+	g_return_if_fail(iter->stamp == self->stamp);
+
+	node = (struct cell_tree_lib *)iter->user_data;
+	if (cell_tree_model_iter_is_cell(iter, &row)) {
+		idx = cell_tree_lib_cell_index(node, row);
+		cell = (struct gds_cell *)g_ptr_array_index(node->cells, idx);
+		error_level = node->error_levels[idx];
+	}
+
+	g_value_init(value, cell_tree_model_get_column_type(tree_model, column));
+
+	switch (column) {
+	case CELL_SEL_LIBRARY:
+		g_value_set_pointer(value, node->lib);
+		break;
+	case CELL_SEL_CELL:
+		g_value_set_pointer(value, cell);
+		break;
+	case CELL_SEL_CELL_ERROR_STATE:
+		g_value_set_uint(value, error_level);
+		break;
+	case CELL_SEL_STAT:
+		g_value_set_pointer(value, cell ? &cell->stats : NULL);
+		break;
+	default:
+		break;
+	}
+}
+
+static gboolean cell_tree_model_iter_next(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	struct cell_tree_lib *node;
+	guint row;
+
+	g_return_val_if_fail(iter->stamp == self->stamp, FALSE);
+
+	node = (struct cell_tree_lib *)iter->user_data;
+	if (cell_tree_model_iter_is_cell(iter, &row)) {
+		if (row + 1 >= cell_tree_lib_row_count(node))
+			goto invalidate;
+		cell_tree_model_fill_iter(self, iter, node, row + 2);
+		return TRUE;
+	}
+
+	if (node->index + 1 >= self->libs->len)
+		goto invalidate;
+
+	cell_tree_model_fill_iter(self, iter, g_ptr_array_index(self->libs, node->index + 1), 0);
+	return TRUE;
+
+invalidate:
+	iter->stamp = 0;
+	return FALSE;
+}
+
+static gboolean cell_tree_model_iter_nth_child(GtkTreeModel *tree_model, GtkTreeIter *iter,
+					       GtkTreeIter *parent, gint n)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	struct cell_tree_lib *node;
+	guint row;
+
+	if (n < 0)
+		return FALSE;
+
+	if (!parent) {
+		if ((guint)n >= self->libs->len)
+			return FALSE;
+		cell_tree_model_fill_iter(self, iter, g_ptr_array_index(self->libs, n), 0);
+		return TRUE;
+	}
+
+	g_return_val_if_fail(parent->stamp == self->stamp, FALSE);
+
+	/* Cells do not have children */
+	if (cell_tree_model_iter_is_cell(parent, &row))
+		return FALSE;
+
+	node = (struct cell_tree_lib *)parent->user_data;
+	if ((guint)n >= cell_tree_lib_row_count(node))
+		return FALSE;
+
+	cell_tree_model_fill_iter(self, iter, node, (guint)n + 1);
+	return TRUE;
+}
+
+static gboolean cell_tree_model_iter_children(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return cell_tree_model_iter_nth_child(tree_model, iter, parent, 0);
+}
+
+static gint cell_tree_model_iter_n_children(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	guint row;
+
+	if (!iter)
+		return (gint)self->libs->len;
+
+	g_return_val_if_fail(iter->stamp == self->stamp, 0);
+
+	if (cell_tree_model_iter_is_cell(iter, &row))
+		return 0;
+
+	return (gint)cell_tree_lib_row_count((struct cell_tree_lib *)iter->user_data);
+}
+
+static gboolean cell_tree_model_iter_has_child(GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	return cell_tree_model_iter_n_children(tree_model, iter) > 0;
+}
+
+static gboolean cell_tree_model_iter_parent(GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(tree_model);
+	guint row;
+
+	g_return_val_if_fail(child->stamp == self->stamp, FALSE);
+
+	if (!cell_tree_model_iter_is_cell(child, &row))
+		return FALSE;
+
+	cell_tree_model_fill_iter(self, iter, (struct cell_tree_lib *)child->user_data, 0);
+	return TRUE;
+}
+
+static void cell_tree_model_tree_model_init(GtkTreeModelIface *iface)
+{
+	iface->get_flags = cell_tree_model_get_flags;
+	iface->get_n_columns = cell_tree_model_get_n_columns;
+	iface->get_column_type = cell_tree_model_get_column_type;
+	iface->get_iter = cell_tree_model_get_iter;
+	iface->get_path = cell_tree_model_get_path;
+	iface->get_value = cell_tree_model_get_value;
+	iface->iter_next = cell_tree_model_iter_next;
+	iface->iter_children = cell_tree_model_iter_children;
+	iface->iter_has_child = cell_tree_model_iter_has_child;
+	iface->iter_n_children = cell_tree_model_iter_n_children;
+	iface->iter_nth_child = cell_tree_model_iter_nth_child;
+	iface->iter_parent = cell_tree_model_iter_parent;
+}
+
+static void cell_tree_model_dispose(GObject *obj)
+{
+	CellTreeModel *self = CELL_TREE_MODEL(obj);
+
+	if (self->libs) {
+		g_ptr_array_free(self->libs, TRUE);
+		self->libs = NULL;
+	}
+
+	g_clear_pointer(&self->filter, g_free);
+
+	G_OBJECT_CLASS(cell_tree_model_parent_class)->dispose(obj);
+}
+
+static void cell_tree_model_class_init(CellTreeModelClass *klass)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+
+	oclass->dispose = cell_tree_model_dispose;
+}
+
+static void cell_tree_model_init(CellTreeModel *self)
+{
+	self->libs = g_ptr_array_new_with_free_func(cell_tree_lib_free);
+	self->stamp = g_random_int();
+	self->filter = NULL;
+}
+
+CellTreeModel *cell_tree_model_new(void)
+{
+	return CELL_TREE_MODEL(g_object_new(TYPE_CELL_TREE_MODEL, NULL));
+}
+
+void cell_tree_model_add_library(CellTreeModel *model, struct gds_library *lib)
+{
+	struct cell_tree_lib *node;
+	GList *cell_list;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	g_return_if_fail(CELL_TREE_IS_MODEL(model));
+	g_return_if_fail(lib);
+
+	node = g_new0(struct cell_tree_lib, 1);
+	node->lib = lib;
+	node->index = model->libs->len;
+	node->cells = g_ptr_array_sized_new(g_list_length(lib->cells));
+	for (cell_list = lib->cells; cell_list; cell_list = g_list_next(cell_list))
+		g_ptr_array_add(node->cells, cell_list->data);
+	node->error_levels = g_new0(guint8, node->cells->len);
+	cell_tree_lib_apply_filter(node, model->filter);
+
+	g_ptr_array_add(model->libs, node);
+
+	/* The view queries the cells on demand. Announcing the library row is sufficient */
+	cell_tree_model_fill_iter(model, &iter, node, 0);
+	path = gtk_tree_path_new_from_indices((gint)node->index, -1);
+	gtk_tree_model_row_inserted(GTK_TREE_MODEL(model), path, &iter);
+	if (cell_tree_lib_row_count(node))
+		gtk_tree_model_row_has_child_toggled(GTK_TREE_MODEL(model), path, &iter);
+	gtk_tree_path_free(path);
+}
+
+void cell_tree_model_set_library_checked(CellTreeModel *model, struct gds_library *lib)
+{
+	struct cell_tree_lib *node;
+	const struct gds_cell *cell;
+	guint i;
+	guint8 level;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+
+	g_return_if_fail(CELL_TREE_IS_MODEL(model));
+
+	node = cell_tree_model_find_lib(model, lib);
+	if (!node)
+		return;
+
+	for (i = 0; i < node->cells->len; i++) {
+		cell = (const struct gds_cell *)g_ptr_array_index(node->cells, i);
+		level = 0;
+		if (cell->checks.unresolved_child_count)
+			level |= LIB_CELL_RENDERER_ERROR_WARN;
+
+		/* Check if it is completely b0rken */
+		if (cell->checks.affected_by_reference_loop)
+			level |= LIB_CELL_RENDERER_ERROR_ERR;
+
+		node->error_levels[i] = level;
+	}
+
+	/* Only rows, which are not in the default state, have changed */
+	for (i = 0; i < cell_tree_lib_row_count(node); i++) {
+		if (!node->error_levels[cell_tree_lib_cell_index(node, i)])
+			continue;
+
+		cell_tree_model_fill_iter(model, &iter, node, i + 1);
+		path = gtk_tree_path_new_from_indices((gint)node->index, (gint)i, -1);
+		gtk_tree_model_row_changed(GTK_TREE_MODEL(model), path, &iter);
+		gtk_tree_path_free(path);
+	}
+}
+
+void cell_tree_model_clear(CellTreeModel *model)
+{
+	GtkTreePath *path;
+	guint idx;
+
+	g_return_if_fail(CELL_TREE_IS_MODEL(model));
+
+	while (model->libs->len) {
+		idx = model->libs->len - 1;
+		g_ptr_array_remove_index(model->libs, idx);
+		path = gtk_tree_path_new_from_indices((gint)idx, -1);
+		gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+		gtk_tree_path_free(path);
+	}
+
+	model->stamp++;
+}
+
+GtkTreePath *cell_tree_model_get_cell_path(CellTreeModel *model, const struct gds_cell *cell)
+{
+	struct cell_tree_lib *node;
+	guint i;
+	guint idx;
+	guint row;
+
+	g_return_val_if_fail(CELL_TREE_IS_MODEL(model), NULL);
+
+	for (i = 0; i < model->libs->len; i++) {
+		node = (struct cell_tree_lib *)g_ptr_array_index(model->libs, i);
+		for (idx = 0; idx < node->cells->len; idx++) {
+			if (g_ptr_array_index(node->cells, idx) == cell)
+				break;
+		}
+		if (idx == node->cells->len)
+			continue;
+
+		if (!node->visible)
+			return gtk_tree_path_new_from_indices((gint)node->index, (gint)idx, -1);
+
+		for (row = 0; row < node->visible->len; row++) {
+			if (g_array_index(node->visible, guint, row) == idx)
+				return gtk_tree_path_new_from_indices((gint)node->index, (gint)row, -1);
+		}
+
+		/* Filtered out */
+		return NULL;
+	}
+
+	return NULL;
+}
+
+void cell_tree_model_set_filter(CellTreeModel *model, const char *search)
+{
+	guint i;
+
+	g_return_if_fail(CELL_TREE_IS_MODEL(model));
+
+	g_free(model->filter);
+	model->filter = (search && *search) ? g_strdup(search) : NULL;
+
+	for (i = 0; i < model->libs->len; i++)
+		cell_tree_lib_apply_filter((struct cell_tree_lib *)g_ptr_array_index(model->libs, i), model->filter);
+
+	model->stamp++;
+}
+
+/** @} */
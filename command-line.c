@@ -31,12 +31,19 @@
 #include <stdio.h>
 #include <glib/gi18n.h>
 #include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
 
 #include <gds-render/command-line.h>
 #include <gds-render/gds-utils/gds-parser.h>
 #include <gds-render/layer/layer-settings.h>
 #include <gds-render/output-renderers/cairo-renderer.h>
 #include <gds-render/output-renderers/latex-renderer.h>
+#include <gds-render/output-renderers/pdf-renderer.h>
+#include <gds-render/output-renderers/svg-renderer.h>
+#include <gds-render/output-renderers/png-renderer.h>
+#include <gds-render/output-renderers/pyramid-renderer.h>
 #include <gds-render/output-renderers/external-renderer.h>
 #include <gds-render/gds-utils/gds-tree-checker.h>
 #include <gds-render/gds-utils/gds-statistics.h>
@@ -88,11 +95,87 @@ static int string_array_count(char **string_array)
 	return count;
 }
 
+GdsOutputRenderer *command_line_create_renderer(const char *renderer_id,
+					       const char *output_file,
+					       const struct command_line_render_options *options,
+					       LayerSettings *layer_settings)
+{
+	GdsOutputRenderer *output_renderer;
+	const struct external_renderer_params *ext_params = options->ext_params;
+
+	if (!renderer_id || !output_file || !output_file[0])
+		return NULL;
+
+	if (!strcmp(renderer_id, "tikz")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(latex_renderer_new_with_options(options->tex_layers,
+											     options->tex_standalone));
+	} else if (!strcmp(renderer_id, "pdf")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(cairo_renderer_new_pdf());
+		cairo_renderer_set_fork_isolation(GDS_RENDER_CAIRO_RENDERER(output_renderer), options->cairo_fork);
+		cairo_renderer_set_hairline_stroke(GDS_RENDER_CAIRO_RENDERER(output_renderer), options->cairo_hairline);
+		cairo_renderer_set_batch_polygons(GDS_RENDER_CAIRO_RENDERER(output_renderer), options->cairo_batch);
+	} else if (!strcmp(renderer_id, "pdf-native")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(pdf_renderer_new_with_options(options->pdf_layers,
+											   options->pdf_compress));
+	} else if (!strcmp(renderer_id, "svg")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(cairo_renderer_new_svg());
+		cairo_renderer_set_fork_isolation(GDS_RENDER_CAIRO_RENDERER(output_renderer), options->cairo_fork);
+		cairo_renderer_set_hairline_stroke(GDS_RENDER_CAIRO_RENDERER(output_renderer), options->cairo_hairline);
+		cairo_renderer_set_batch_polygons(GDS_RENDER_CAIRO_RENDERER(output_renderer), options->cairo_batch);
+	} else if (!strcmp(renderer_id, "svg-native")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(svg_renderer_new());
+	} else if (!strcmp(renderer_id, "png")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(png_renderer_new());
+	} else if (!strcmp(renderer_id, "tiles")) {
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(pyramid_renderer_new_with_options(options->tiles_overwrite));
+	} else if (!strcmp(renderer_id, "ext")) {
+		if (!ext_params || !ext_params->so_path) {
+			fprintf(stderr, _("Please specify shared object for external renderer. Will ignore this renderer.\n"));
+			return NULL;
+		}
+		output_renderer = GDS_RENDER_OUTPUT_RENDERER(
+					external_renderer_new_with_so_and_param(ext_params->so_path,
+										ext_params->cli_params));
+	} else {
+		return NULL;
+	}
+
+	gds_output_renderer_set_output_file(output_renderer, output_file);
+	gds_output_renderer_set_layer_settings(output_renderer, layer_settings);
+	if (options->window_set)
+		gds_output_renderer_set_window(output_renderer, &options->window);
+
+	return output_renderer;
+}
+
+/**
+ * @brief Check if a renderer must not run in parallel to other jobs
+ *
+ * Forking from a multithreaded process can deadlock the child on locks held by other threads.
+ * External renderers are not known to be thread safe.
+ *
+ * @param renderer_id Renderer id
+ * @param options Renderer options
+ * @return TRUE if all jobs have to be executed one after another
+ */
+static gboolean renderer_needs_serialization(const char *renderer_id,
+					     const struct command_line_render_options *options)
+{
+	if (!renderer_id)
+		return FALSE;
+
+	if (!strcmp(renderer_id, "ext"))
+		return TRUE;
+
+	if (options->cairo_fork && (!strcmp(renderer_id, "pdf") || !strcmp(renderer_id, "svg")))
+		return TRUE;
+
+	return FALSE;
+}
+
 static int create_renderers(char **renderers,
 			    char **output_file_names,
-			    gboolean tex_layers,
-			    gboolean tex_standalone,
-			    const struct external_renderer_params *ext_params,
+			    const struct command_line_render_options *options,
 			    GList **renderer_list,
 			    LayerSettings *layer_settings)
 {
@@ -124,31 +207,11 @@ static int create_renderers(char **renderers,
 		current_renderer = *renderer_iter;
 		current_out_file = output_file_names[idx];
 
-		/* File valid ? */
-		if (!current_out_file || !current_out_file[0])
-			continue;
-
-		if (!strcmp(current_renderer, "tikz")) {
-			output_renderer = GDS_RENDER_OUTPUT_RENDERER(latex_renderer_new_with_options(tex_layers,
-												     tex_standalone));
-		} else if (!strcmp(current_renderer, "pdf")) {
-			output_renderer = GDS_RENDER_OUTPUT_RENDERER(cairo_renderer_new_pdf());
-		} else if (!strcmp(current_renderer, "svg")) {
-			output_renderer = GDS_RENDER_OUTPUT_RENDERER(cairo_renderer_new_svg());
-		} else if (!strcmp(current_renderer, "ext")) {
-			if (!ext_params->so_path) {
-				fprintf(stderr, _("Please specify shared object for external renderer. Will ignore this renderer.\n"));
-				continue;
-			}
-			output_renderer = GDS_RENDER_OUTPUT_RENDERER(
-						external_renderer_new_with_so_and_param(ext_params->so_path,
-											ext_params->cli_params));
-		} else {
+		output_renderer = command_line_create_renderer(current_renderer, current_out_file, options,
+							       layer_settings);
+		if (!output_renderer)
 			continue;
-		}
 
-		gds_output_renderer_set_output_file(output_renderer, current_out_file);
-		gds_output_renderer_set_layer_settings(output_renderer, layer_settings);
 		*renderer_list = g_list_append(*renderer_list, output_renderer);
 	}
 
@@ -171,45 +234,310 @@ static struct gds_cell *find_gds_cell_in_lib(struct gds_library *lib, const char
 	return return_cell;
 }
 
+/**
+ * @brief Job for the batch rendering worker pool
+ */
+struct render_job {
+	struct gds_cell *cell; /**< @brief Cell to render */
+	GdsOutputRenderer *renderer; /**< @brief Renderer to use. Owned by the job */
+	double scale; /**< @brief Scale passed to the renderer */
+	int result; /**< @brief Return code of the renderer. Written by the worker */
+};
+
+/**
+ * @brief Replace the placeholders in an output path template
+ *
+ * The following placeholders are supported:
+ * - `{cell}` is replaced by the cell name
+ * - `{lib}` is replaced by the name of the cell's library
+ *
+ * @param template Template string
+ * @param cell Cell to fill in
+ * @return Newly allocated path. Free with g_free()
+ */
+static char *expand_output_template(const char *template, const struct gds_cell *cell)
+{
+	GString *path;
+	const char *iter;
+
+	path = g_string_new(NULL);
+
+	for (iter = template; *iter; iter++) {
+		if (!strncmp(iter, "{cell}", 6)) {
+			g_string_append(path, cell->name);
+			iter += 5;
+		} else if (!strncmp(iter, "{lib}", 5)) {
+			g_string_append(path, cell->parent_library->name);
+			iter += 4;
+		} else {
+			g_string_append_c(path, *iter);
+		}
+	}
+
+	return g_string_free(path, FALSE);
+}
+
+/**
+ * @brief Check if the output templates can distinguish between multiple cells
+ * @param output_file_names Output path templates
+ * @return TRUE if all templates contain the `{cell}` placeholder
+ */
+static gboolean output_templates_contain_cell_name(char **output_file_names)
+{
+	for (; output_file_names && *output_file_names; output_file_names++) {
+		if (!strstr(*output_file_names, "{cell}"))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * @brief Append \p cell to the selection list if it is not already selected
+ * @param selected_cells List of selected cells
+ * @param selected_set Set of already selected cells
+ * @param cell Cell to add
+ */
+static void select_cell(GList **selected_cells, GHashTable *selected_set, struct gds_cell *cell)
+{
+	if (g_hash_table_contains(selected_set, cell))
+		return;
+
+	g_hash_table_add(selected_set, cell);
+	/* Prepended for speed. The list is reversed after the selection is complete */
+	*selected_cells = g_list_prepend(*selected_cells, cell);
+}
+
+/**
+ * @brief Add all cells of \p lib that are not referenced by any other cell to the selection
+ * @param lib Library
+ * @param selected_cells List of selected cells
+ * @param selected_set Set of already selected cells
+ */
+static void select_top_cells(struct gds_library *lib, GList **selected_cells, GHashTable *selected_set)
+{
+	GHashTable *referenced;
+	GList *cell_iter;
+	GList *inst_iter;
+	struct gds_cell *cell;
+	struct gds_cell_instance *inst;
+
+	referenced = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	for (cell_iter = lib->cells; cell_iter; cell_iter = g_list_next(cell_iter)) {
+		cell = (struct gds_cell *)cell_iter->data;
+		for (inst_iter = cell->child_cells; inst_iter; inst_iter = g_list_next(inst_iter)) {
+			inst = (struct gds_cell_instance *)inst_iter->data;
+			if (inst->cell_ref)
+				g_hash_table_add(referenced, inst->cell_ref);
+		}
+	}
+
+	for (cell_iter = lib->cells; cell_iter; cell_iter = g_list_next(cell_iter)) {
+		cell = (struct gds_cell *)cell_iter->data;
+		if (!g_hash_table_contains(referenced, cell))
+			select_cell(selected_cells, selected_set, cell);
+	}
+
+	g_hash_table_destroy(referenced);
+}
+
+/**
+ * @brief Collect all cells matching the cell selection
+ * @param libs List of libraries to search in
+ * @param selection Cell selection
+ * @param[out] selected_cells List of matching cells. Free the list (not the cells) with g_list_free()
+ * @return 0 if successful. -1 if a named cell could not be found or the regex is invalid
+ */
+static int collect_selected_cells(GList *libs, const struct command_line_cell_selection *selection,
+				  GList **selected_cells)
+{
+	GHashTable *selected_set;
+	GList *lib_iter;
+	GList *cell_iter;
+	struct gds_library *lib;
+	struct gds_cell *cell;
+	char **name_iter;
+	GPatternSpec **globs = NULL;
+	GRegex *regex = NULL;
+	GError *error = NULL;
+	guint glob_count;
+	guint idx;
+	gboolean found;
+	int ret = 0;
+
+	selected_set = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* Explicitly named cells are selected first, in the order they are given */
+	for (name_iter = selection->cell_names; name_iter && *name_iter; name_iter++) {
+		found = FALSE;
+		for (lib_iter = libs; lib_iter && !found; lib_iter = g_list_next(lib_iter)) {
+			cell = find_gds_cell_in_lib((struct gds_library *)lib_iter->data, *name_iter);
+			if (cell) {
+				select_cell(selected_cells, selected_set, cell);
+				found = TRUE;
+			}
+		}
+		if (!found) {
+			fprintf(stderr, _("Couldn't find cell %s in library!\n"), *name_iter);
+			ret = -1;
+		}
+	}
+
+	glob_count = (guint)string_array_count(selection->cell_globs);
+	if (glob_count) {
+		globs = (GPatternSpec **)g_malloc0(sizeof(GPatternSpec *) * glob_count);
+		for (idx = 0; idx < glob_count; idx++)
+			globs[idx] = g_pattern_spec_new(selection->cell_globs[idx]);
+	}
+
+	if (selection->cell_regex) {
+		regex = g_regex_new(selection->cell_regex, G_REGEX_OPTIMIZE, 0, &error);
+		if (!regex) {
+			fprintf(stderr, _("Invalid cell regex: %s\n"), error->message);
+			g_error_free(error);
+			ret = -1;
+			goto ret_free_patterns;
+		}
+	}
+
+	for (lib_iter = libs; lib_iter; lib_iter = g_list_next(lib_iter)) {
+		lib = (struct gds_library *)lib_iter->data;
+
+		if (selection->all_top_cells)
+			select_top_cells(lib, selected_cells, selected_set);
+
+		if (!glob_count && !regex)
+			continue;
+
+		for (cell_iter = lib->cells; cell_iter; cell_iter = g_list_next(cell_iter)) {
+			cell = (struct gds_cell *)cell_iter->data;
+
+			for (idx = 0; idx < glob_count; idx++) {
+				if (g_pattern_match_string(globs[idx], cell->name))
+					select_cell(selected_cells, selected_set, cell);
+			}
+
+			if (regex && g_regex_match(regex, cell->name, 0, NULL))
+				select_cell(selected_cells, selected_set, cell);
+		}
+	}
+
+	*selected_cells = g_list_reverse(*selected_cells);
+
+	if (regex)
+		g_regex_unref(regex);
+ret_free_patterns:
+	for (idx = 0; idx < glob_count; idx++)
+		g_pattern_spec_free(globs[idx]);
+	g_free(globs);
+	g_hash_table_destroy(selected_set);
+
+	return ret;
+}
+
+/**
+ * @brief Check if a cell can be rendered
+ *
+ * The reference loop check has to be executed on the cell's library beforehand.
+ *
+ * @param cell Cell to check
+ * @return TRUE if renderable
+ */
+static gboolean cell_passes_vital_checks(struct gds_cell *cell)
+{
+	if (cell->checks.affected_by_reference_loop == 1) {
+		fprintf(stderr, _("Cell %s is affected by reference loop. Skipping!\n"), cell->name);
+		return FALSE;
+	}
+
+	if (cell->checks.affected_by_reference_loop == GDS_CELL_CHECK_NOT_RUN)
+		fprintf(stderr, _("Cell was not checked. This should not happen. Please report this issue. Will continue either way.\n"));
+
+	/* Note: unresolved references are not an abort condition.
+	 * Deal with it.
+	 */
+	return TRUE;
+}
+
+/**
+ * @brief Worker function of the batch rendering pool
+ * @param job_ptr #render_job to execute
+ * @param user_data unused
+ */
+static void render_job_worker(gpointer job_ptr, gpointer user_data)
+{
+	struct render_job *job = (struct render_job *)job_ptr;
+	(void)user_data;
+
+	job->result = gds_output_renderer_render_output(job->renderer, job->cell, job->scale);
+	if (job->result)
+		fprintf(stderr, _("Rendering cell %s to %s failed: %d\n"), job->cell->name,
+			gds_output_renderer_get_output_file(job->renderer), job->result);
+	else
+		printf(_("Rendered cell %s to %s\n"), job->cell->name,
+		       gds_output_renderer_get_output_file(job->renderer));
+}
+
 int command_line_convert_gds(const char *gds_name,
-			     const char *cell_name,
+			     const struct command_line_cell_selection *selection,
 			     char **renderers,
 			     char **output_file_names,
 			     const char *layer_file,
-			     struct external_renderer_params *ext_param,
-			     gboolean tex_standalone,
-			     gboolean tex_layers,
-			     double scale)
+			     const struct command_line_render_options *options,
+			     double scale,
+			     int jobs)
 {
 	int ret = -1;
 	GList *libs = NULL;
 	int res;
 	GList *renderer_list = NULL;
 	GList *list_iter;
-	struct gds_library *first_lib;
-	struct gds_cell *toplevel_cell = NULL;
+	GList *lib_iter;
+	GList *selected_cells = NULL;
+	GList *cell_iter;
+	GList *job_list = NULL;
+	struct gds_library *lib;
+	struct gds_cell *cell;
+	struct render_job *job;
 	LayerSettings *layer_sett;
-	GdsOutputRenderer *current_renderer;
+	GThreadPool *pool;
+	GError *error = NULL;
+	GHashTable *output_paths;
+	char **cell_output_names;
+	guint idx;
+	guint output_count;
+	int failed = 0;
 
 	const struct gds_library_parsing_opts gds_parsing_options = {
 		.simplified_polygons = 1,
 	};
 
 	/* Check if parameters are valid */
-	if (!gds_name || !cell_name || !output_file_names || !layer_file || !renderers) {
+	if (!gds_name || !selection || !output_file_names || !layer_file || !renderers ||
+	    (!selection->cell_names && !selection->cell_globs && !selection->cell_regex &&
+	     !selection->all_top_cells)) {
 		printf(_("Probably missing argument. Check --help option\n"));
 		return -2;
 	}
 
+	if (jobs < 1)
+		jobs = (int)g_get_num_processors();
+
 	/* Load layer_settings */
 	layer_sett = layer_settings_new();
 	layer_settings_load_from_csv(layer_sett, layer_file);
 
-	/* Create renderers */
-	if (create_renderers(renderers, output_file_names, tex_layers, tex_standalone,
-			     ext_param, &renderer_list, layer_sett))
+	/* Check the renderer configuration once before the GDS is parsed */
+	if (create_renderers(renderers, output_file_names, options, &renderer_list, layer_sett))
 		goto ret_destroy_layer_mapping;
 
+	for (idx = 0; jobs > 1 && renderers[idx]; idx++) {
+		if (renderer_needs_serialization(renderers[idx], options)) {
+			printf(_("Renderer %s cannot run in parallel. Rendering with a single job\n"), renderers[idx]);
+			jobs = 1;
+		}
+	}
 
 	/* Load GDS */
 	clear_lib_list(&libs);
@@ -217,65 +545,701 @@ int command_line_convert_gds(const char *gds_name,
 	if (res)
 		goto ret_destroy_library_list;
 
-	/* find_cell in first library. */
 	if (!libs)
 		goto ret_clear_renderers;
 
-	first_lib = (struct gds_library *)libs->data;
-	if (!first_lib) {
-		fprintf(stderr, _("No library in library list. This should not happen.\n"));
-		/* This is safe. Library destruction can handle an empty list element */
-		goto ret_destroy_library_list;
+	/* Check libraries for reference loops. Affected cells are skipped */
+	for (lib_iter = libs; lib_iter; lib_iter = g_list_next(lib_iter)) {
+		lib = (struct gds_library *)lib_iter->data;
+		if (!lib) {
+			fprintf(stderr, _("No library in library list. This should not happen.\n"));
+			/* This is safe. Library destruction can handle an empty list element */
+			goto ret_destroy_library_list;
+		}
+
+		res = gds_tree_check_reference_loops(lib);
+		if (res < 0) {
+			fprintf(stderr, _("Checking library %s failed.\n"), lib->name);
+			goto ret_destroy_library_list;
+		} else if (res > 0) {
+			fprintf(stderr, _("%d reference loops found.\n"), res);
+		}
 	}
 
-	/* Find cell in first library */
-	toplevel_cell = find_gds_cell_in_lib(first_lib, cell_name);
+	if (collect_selected_cells(libs, selection, &selected_cells))
+		goto ret_free_selection;
 
-	if (!toplevel_cell) {
-		printf(_("Couldn't find cell in first library!\n"));
-		goto ret_destroy_library_list;
+	if (!selected_cells) {
+		printf(_("No cell matches the selection!\n"));
+		goto ret_free_selection;
 	}
 
-	/* Check if cell passes vital checks */
-	res = gds_tree_check_reference_loops(toplevel_cell->parent_library);
-	if (res < 0) {
-		fprintf(stderr, _("Checking library %s failed.\n"), first_lib->name);
-		goto ret_destroy_library_list;
-	} else if (res > 0) {
-		fprintf(stderr, _("%d reference loops found.\n"), res);
+	if (g_list_length(selected_cells) > 1 && !output_templates_contain_cell_name(output_file_names)) {
+		fprintf(stderr, _("Multiple cells selected. Output file names must contain the {cell} placeholder\n"));
+		goto ret_free_selection;
+	}
 
-		/* do further checking if the specified cell and/or its subcells are affected */
-		if (toplevel_cell->checks.affected_by_reference_loop == 1) {
-			fprintf(stderr, _("Cell is affected by reference loop. Abort!\n"));
-			goto ret_destroy_library_list;
+	/* Create one renderer per selected cell and output file.
+	 * Cells of different libraries may have the same name. Their outputs must not overwrite each other
+	 */
+	output_count = (guint)string_array_count(output_file_names);
+	cell_output_names = (char **)g_malloc0(sizeof(char *) * (output_count + 1));
+	output_paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (cell_iter = selected_cells; cell_iter; cell_iter = g_list_next(cell_iter)) {
+		cell = (struct gds_cell *)cell_iter->data;
+		if (!cell_passes_vital_checks(cell)) {
+			failed++;
+			continue;
+		}
+
+		for (idx = 0; idx < output_count; idx++) {
+			g_free(cell_output_names[idx]);
+			cell_output_names[idx] = expand_output_template(output_file_names[idx], cell);
+			if (!g_hash_table_add(output_paths, g_strdup(cell_output_names[idx]))) {
+				fprintf(stderr, _("Output file %s is used for more than one cell. Use the {lib} placeholder\n"),
+					cell_output_names[idx]);
+				g_strfreev(cell_output_names);
+				g_hash_table_destroy(output_paths);
+				goto ret_free_jobs;
+			}
+		}
+
+		for (list_iter = renderer_list; list_iter; list_iter = list_iter->next)
+			g_object_unref(list_iter->data);
+		g_list_free(renderer_list);
+		renderer_list = NULL;
+
+		if (create_renderers(renderers, cell_output_names, options, &renderer_list, layer_sett)) {
+			g_strfreev(cell_output_names);
+			g_hash_table_destroy(output_paths);
+			goto ret_free_jobs;
+		}
+
+		for (list_iter = renderer_list; list_iter; list_iter = list_iter->next) {
+			job = (struct render_job *)g_malloc0(sizeof(struct render_job));
+			job->cell = cell;
+			job->renderer = GDS_RENDER_OUTPUT_RENDERER(g_object_ref(list_iter->data));
+			job->scale = scale;
+			job_list = g_list_prepend(job_list, job);
 		}
 	}
+	g_strfreev(cell_output_names);
+	g_hash_table_destroy(output_paths);
+	job_list = g_list_reverse(job_list);
+
+	/* Execute all rendererer instances. The library is only read from here on */
+	pool = g_thread_pool_new(render_job_worker, NULL, jobs, FALSE, &error);
+	if (!pool) {
+		fprintf(stderr, _("Could not create worker pool: %s\n"), error->message);
+		g_error_free(error);
+		goto ret_free_jobs;
+	}
 
-	if (toplevel_cell->checks.affected_by_reference_loop == GDS_CELL_CHECK_NOT_RUN)
-		fprintf(stderr, _("Cell was not checked. This should not happen. Please report this issue. Will continue either way.\n"));
+	for (list_iter = job_list; list_iter; list_iter = list_iter->next)
+		g_thread_pool_push(pool, list_iter->data, NULL);
 
-	/* Note: unresolved references are not an abort condition.
-	 * Deal with it.
-	 */
+	/* Wait for all jobs to complete */
+	g_thread_pool_free(pool, FALSE, TRUE);
 
-	/* Execute all rendererer instances */
-	for (list_iter = renderer_list; list_iter; list_iter = list_iter->next) {
-		current_renderer = GDS_RENDER_OUTPUT_RENDERER(list_iter->data);
-		gds_output_renderer_render_output(current_renderer, toplevel_cell, scale);
+	for (list_iter = job_list; list_iter; list_iter = list_iter->next) {
+		job = (struct render_job *)list_iter->data;
+		if (job->result)
+			failed++;
 	}
 
-	ret = 0;
+	ret = (failed ? -3 : 0);
 
+ret_free_jobs:
+	for (list_iter = job_list; list_iter; list_iter = list_iter->next) {
+		job = (struct render_job *)list_iter->data;
+		g_object_unref(job->renderer);
+		g_free(job);
+	}
+	g_list_free(job_list);
+ret_free_selection:
+	g_list_free(selected_cells);
 ret_destroy_library_list:
 	clear_lib_list(&libs);
 ret_clear_renderers:
 	for (list_iter = renderer_list; list_iter; list_iter = list_iter->next)
 		g_object_unref(list_iter->data);
+	g_list_free(renderer_list);
 ret_destroy_layer_mapping:
 	g_object_unref(layer_sett);
 	return ret;
 }
 
+/**
+ * @brief Default scale of manifest jobs without scale column. Same as the CLI default
+ */
+#define MANIFEST_DEFAULT_SCALE (1000.0)
+
+/**
+ * @brief Estimated ratio between the memory used by a parsed library and the GDS file size
+ */
+#define MANIFEST_LIB_MEMORY_FACTOR (6)
+
+/**
+ * @brief Single line of a job manifest
+ */
+struct manifest_entry {
+	char *gds; /**< @brief Path of the GDS file */
+	char *cell; /**< @brief Name of the cell to render */
+	char *renderer; /**< @brief Renderer id. Same as for the --renderer option */
+	char *output; /**< @brief Output file. May contain the same placeholders as the --output-file option */
+	char *mapping; /**< @brief Layer mapping file */
+	double scale; /**< @brief Scale */
+};
+
+/**
+ * @brief Shared state of the manifest scheduler used for memory aware admission of GDS files
+ */
+struct manifest_scheduler {
+	GMutex lock; /**< @brief Lock protecting the struct */
+	GCond released; /**< @brief Signalled whenever a group releases its memory */
+	guint64 budget; /**< @brief Memory budget in bytes. 0 if unlimited */
+	guint64 in_use; /**< @brief Estimated memory of all currently loaded GDS files */
+};
+
+/**
+ * @brief All manifest entries referring to the same GDS file
+ */
+struct manifest_group {
+	const char *gds; /**< @brief Path of the GDS file. Owned by the entries */
+	GList *entries; /**< @brief List of @ref manifest_entry */
+	GList *libs; /**< @brief Parsed libraries while the group is loaded */
+	guint64 memory_estimate; /**< @brief Estimated memory of the parsed file */
+	gint pending; /**< @brief Outstanding render jobs plus one reference held during scheduling */
+	struct manifest_scheduler *scheduler; /**< @brief Scheduler the memory is accounted in */
+};
+
+/**
+ * @brief Render job of the manifest worker pool
+ */
+struct manifest_render_job {
+	struct render_job job; /**< @brief Actual render job */
+	struct manifest_group *group; /**< @brief Group the rendered cell belongs to */
+};
+
+static void manifest_entry_free(gpointer data)
+{
+	struct manifest_entry *entry = (struct manifest_entry *)data;
+
+	g_free(entry->gds);
+	g_free(entry->cell);
+	g_free(entry->renderer);
+	g_free(entry->output);
+	g_free(entry->mapping);
+	g_free(entry);
+}
+
+static void manifest_group_free(gpointer data)
+{
+	struct manifest_group *group = (struct manifest_group *)data;
+
+	g_list_free_full(group->entries, manifest_entry_free);
+	clear_lib_list(&group->libs);
+	g_free(group);
+}
+
+/**
+ * @brief Split a CSV line into its fields
+ *
+ * Fields may be enclosed in double quotes as described in RFC 4180. A quoted field may contain commas.
+ * A double quote inside of a quoted field is written as two double quotes. Line breaks inside of fields are not supported.
+ * Whitespace around unquoted fields is removed.
+ *
+ * @param line Line to split
+ * @return NULL terminated array of fields. Free with g_strfreev(). NULL if a quoted field is malformed
+ */
+static char **manifest_split_fields(const char *line)
+{
+	GPtrArray *fields;
+	GString *field;
+	const char *ptr = line;
+	gboolean quoted;
+
+	fields = g_ptr_array_new();
+	field = g_string_new(NULL);
+
+	while (1) {
+		while (*ptr == ' ' || *ptr == '\t')
+			ptr++;
+
+		quoted = (*ptr == '"');
+		if (quoted) {
+			for (ptr++; *ptr; ptr++) {
+				if (*ptr == '"' && ptr[1] == '"')
+					ptr++;
+				else if (*ptr == '"')
+					break;
+				g_string_append_c(field, *ptr);
+			}
+
+			/* Unterminated field */
+			if (!*ptr)
+				goto ret_error;
+
+			/* Only whitespace is allowed between the closing quote and the separator */
+			for (ptr++; *ptr == ' ' || *ptr == '\t'; ptr++)
+				;
+			if (*ptr && *ptr != ',')
+				goto ret_error;
+		} else {
+			for (; *ptr && *ptr != ','; ptr++) {
+				/* Quotes are only allowed in quoted fields */
+				if (*ptr == '"')
+					goto ret_error;
+				g_string_append_c(field, *ptr);
+			}
+			g_strchomp(field->str);
+		}
+
+		g_ptr_array_add(fields, g_strdup(field->str));
+		g_string_truncate(field, 0);
+
+		if (!*ptr)
+			break;
+		/* Skip separator */
+		ptr++;
+	}
+
+	g_string_free(field, TRUE);
+	g_ptr_array_add(fields, NULL);
+
+	return (char **)g_ptr_array_free(fields, FALSE);
+
+ret_error:
+	g_string_free(field, TRUE);
+	g_ptr_array_add(fields, NULL);
+	g_strfreev((char **)g_ptr_array_free(fields, FALSE));
+
+	return NULL;
+}
+
+/**
+ * @brief Parse a single CSV line of the manifest
+ *
+ * Format: `gds,cell,renderer,output,mapping[,scale]`. Fields may be quoted. See manifest_split_fields()
+ *
+ * @param line Line to parse
+ * @param line_no Line number for error messages
+ * @param[out] entry_out Entry. NULL if the line is empty, a comment, the header or malformed
+ * @return 0 if successful, -1 if the line is malformed
+ */
+static int manifest_parse_line(char *line, unsigned int line_no, struct manifest_entry **entry_out)
+{
+	struct manifest_entry *entry = NULL;
+	char **fields;
+	guint field_count;
+	char *end;
+	int ret = 0;
+
+	*entry_out = NULL;
+
+	g_strstrip(line);
+	if (!line[0] || line[0] == '#')
+		return 0;
+
+	fields = manifest_split_fields(line);
+	if (!fields) {
+		fprintf(stderr, _("Manifest line %u: malformed quoted field. Skipping: %s\n"), line_no, line);
+		return -1;
+	}
+	field_count = g_strv_length(fields);
+
+	/* Header */
+	if (line_no == 1 && !strcmp(fields[0], "gds"))
+		goto ret_free_fields;
+
+	if (field_count < 5 || field_count > 6 || !fields[0][0] || !fields[1][0] || !fields[2][0] || !fields[3][0] ||
+	    !fields[4][0]) {
+		fprintf(stderr, _("Manifest line %u is malformed. Skipping: %s\n"), line_no, line);
+		ret = -1;
+		goto ret_free_fields;
+	}
+
+	entry = (struct manifest_entry *)g_malloc0(sizeof(struct manifest_entry));
+	entry->gds = g_strdup(fields[0]);
+	entry->cell = g_strdup(fields[1]);
+	entry->renderer = g_strdup(fields[2]);
+	entry->output = g_strdup(fields[3]);
+	entry->mapping = g_strdup(fields[4]);
+	entry->scale = MANIFEST_DEFAULT_SCALE;
+
+	if (field_count == 6 && fields[5][0]) {
+		entry->scale = g_ascii_strtod(fields[5], &end);
+		if (*end || entry->scale < 1.0) {
+			fprintf(stderr, _("Manifest line %u: invalid scale %s. Using 1\n"), line_no, fields[5]);
+			entry->scale = 1.0;
+		}
+	}
+
+ret_free_fields:
+	g_strfreev(fields);
+	*entry_out = entry;
+	return ret;
+}
+
+/**
+ * @brief Load the manifest and group its entries by GDS file
+ * @param path Manifest path
+ * @param[out] groups List of @ref manifest_group in order of first appearance
+ * @param[in,out] malformed_lines Incremented for every malformed line. These lines are skipped
+ * @return 0 if successful
+ */
+static int manifest_load(const char *path, GList **groups, int *malformed_lines)
+{
+	GFile *file;
+	GInputStream *in_stream;
+	GDataInputStream *data_stream;
+	GHashTable *group_table;
+	GList *group_iter;
+	struct manifest_group *group;
+	struct manifest_entry *entry;
+	GError *error = NULL;
+	char *line;
+	gsize len;
+	unsigned int line_no = 0;
+	int ret = 0;
+
+	file = g_file_new_for_path(path);
+	in_stream = G_INPUT_STREAM(g_file_read(file, NULL, &error));
+	if (!in_stream) {
+		fprintf(stderr, _("Could not open manifest: %s\n"), error->message);
+		g_error_free(error);
+		ret = -1;
+		goto ret_destroy_file;
+	}
+
+	data_stream = g_data_input_stream_new(in_stream);
+	group_table = g_hash_table_new(g_str_hash, g_str_equal);
+
+	while ((line = g_data_input_stream_read_line(data_stream, &len, NULL, NULL))) {
+		if (manifest_parse_line(line, ++line_no, &entry))
+			(*malformed_lines)++;
+		g_free(line);
+		if (!entry)
+			continue;
+
+		group = (struct manifest_group *)g_hash_table_lookup(group_table, entry->gds);
+		if (!group) {
+			group = (struct manifest_group *)g_malloc0(sizeof(struct manifest_group));
+			group->gds = entry->gds;
+			g_hash_table_insert(group_table, (gpointer)group->gds, group);
+			*groups = g_list_prepend(*groups, group);
+		}
+		group->entries = g_list_prepend(group->entries, entry);
+	}
+
+	*groups = g_list_reverse(*groups);
+	for (group_iter = *groups; group_iter; group_iter = g_list_next(group_iter)) {
+		group = (struct manifest_group *)group_iter->data;
+		group->entries = g_list_reverse(group->entries);
+	}
+
+	g_hash_table_destroy(group_table);
+	g_object_unref(data_stream);
+	g_object_unref(in_stream);
+ret_destroy_file:
+	g_object_unref(file);
+
+	return ret;
+}
+
+/**
+ * @brief Wait until the memory for \p group fits into the budget and account it
+ *
+ * A group is always admitted if no other group is loaded, even if it exceeds the budget.
+ *
+ * @param sched Scheduler
+ * @param group Group to admit
+ */
+static void manifest_scheduler_admit(struct manifest_scheduler *sched, struct manifest_group *group)
+{
+	g_mutex_lock(&sched->lock);
+	while (sched->budget && sched->in_use &&
+	       sched->in_use + group->memory_estimate > sched->budget)
+		g_cond_wait(&sched->released, &sched->lock);
+	sched->in_use += group->memory_estimate;
+	g_mutex_unlock(&sched->lock);
+}
+
+/**
+ * @brief Drop a reference of the group. Frees the parsed libraries if it was the last one.
+ * @param group Group
+ */
+static void manifest_group_release(struct manifest_group *group)
+{
+	struct manifest_scheduler *sched = group->scheduler;
+
+	if (!g_atomic_int_dec_and_test(&group->pending))
+		return;
+
+	clear_lib_list(&group->libs);
+
+	g_mutex_lock(&sched->lock);
+	sched->in_use -= group->memory_estimate;
+	g_cond_broadcast(&sched->released);
+	g_mutex_unlock(&sched->lock);
+}
+
+/**
+ * @brief Worker function of the manifest rendering pool
+ * @param job_ptr @ref manifest_render_job to execute
+ * @param user_data unused
+ */
+static void manifest_job_worker(gpointer job_ptr, gpointer user_data)
+{
+	struct manifest_render_job *mjob = (struct manifest_render_job *)job_ptr;
+
+	render_job_worker(&mjob->job, user_data);
+
+	/* Renderer is not needed anymore. Release it early to keep the memory footprint low */
+	g_clear_object(&mjob->job.renderer);
+	manifest_group_release(mjob->group);
+}
+
+static void manifest_layer_settings_unref(gpointer data)
+{
+	if (data)
+		g_object_unref(data);
+}
+
+/**
+ * @brief Get the layer settings for \p path from \p cache. Load them if not present.
+ * @param cache Cache of already loaded mapping files
+ * @param path Path of the layer mapping file
+ * @return Layer settings owned by the cache or NULL on error
+ */
+static LayerSettings *manifest_get_layer_settings(GHashTable *cache, const char *path)
+{
+	LayerSettings *settings;
+
+	if (g_hash_table_lookup_extended(cache, path, NULL, (gpointer *)&settings))
+		return settings;
+
+	settings = layer_settings_new();
+	if (layer_settings_load_from_csv(settings, path)) {
+		fprintf(stderr, _("Could not load layer mapping %s\n"), path);
+		g_clear_object(&settings);
+	}
+
+	/* Failures are cached, too. They are not retried for every job */
+	g_hash_table_insert(cache, g_strdup(path), settings);
+
+	return settings;
+}
+
+/**
+ * @brief Parse the GDS file of \p group and queue all its jobs in \p pool
+ * @param group Group. Must be admitted by the scheduler
+ * @param pool Worker pool
+ * @param layer_cache Layer settings cache
+ * @param options Renderer options
+ * @param[out] jobs Created jobs are prepended to this list
+ * @return Count of entries that could not be queued
+ */
+static int manifest_queue_group(struct manifest_group *group, GThreadPool *pool, GHashTable *layer_cache,
+				const struct command_line_render_options *options, GList **jobs)
+{
+	const struct gds_library_parsing_opts gds_parsing_options = {
+		.simplified_polygons = 1,
+	};
+	struct manifest_entry *entry;
+	struct manifest_render_job *mjob;
+	struct gds_cell *cell;
+	LayerSettings *layer_sett;
+	GList *entry_iter;
+	GList *lib_iter;
+	GList *renderer_list;
+	char *renderer_ids[2] = {NULL, NULL};
+	char *output_names[2] = {NULL, NULL};
+	int failed = 0;
+	int res;
+
+	if (parse_gds_from_file(group->gds, &group->libs, &gds_parsing_options) || !group->libs) {
+		fprintf(stderr, _("Could not parse %s\n"), group->gds);
+		return (int)g_list_length(group->entries);
+	}
+
+	for (lib_iter = group->libs; lib_iter; lib_iter = g_list_next(lib_iter)) {
+		if (gds_tree_check_reference_loops((struct gds_library *)lib_iter->data) < 0) {
+			fprintf(stderr, _("Checking library %s failed.\n"),
+				((struct gds_library *)lib_iter->data)->name);
+			return (int)g_list_length(group->entries);
+		}
+	}
+
+	for (entry_iter = group->entries; entry_iter; entry_iter = g_list_next(entry_iter)) {
+		entry = (struct manifest_entry *)entry_iter->data;
+
+		cell = NULL;
+		for (lib_iter = group->libs; lib_iter && !cell; lib_iter = g_list_next(lib_iter))
+			cell = find_gds_cell_in_lib((struct gds_library *)lib_iter->data, entry->cell);
+
+		if (!cell) {
+			fprintf(stderr, _("Couldn't find cell %s in %s!\n"), entry->cell, group->gds);
+			failed++;
+			continue;
+		}
+
+		if (!cell_passes_vital_checks(cell)) {
+			failed++;
+			continue;
+		}
+
+		layer_sett = manifest_get_layer_settings(layer_cache, entry->mapping);
+		if (!layer_sett) {
+			failed++;
+			continue;
+		}
+
+		renderer_ids[0] = entry->renderer;
+		output_names[0] = expand_output_template(entry->output, cell);
+		renderer_list = NULL;
+		res = create_renderers(renderer_ids, output_names, options, &renderer_list, layer_sett);
+		g_free(output_names[0]);
+
+		if (res || !renderer_list) {
+			fprintf(stderr, _("Invalid renderer %s for cell %s\n"), entry->renderer, entry->cell);
+			failed++;
+			continue;
+		}
+
+		mjob = (struct manifest_render_job *)g_malloc0(sizeof(struct manifest_render_job));
+		mjob->job.cell = cell;
+		mjob->job.renderer = GDS_RENDER_OUTPUT_RENDERER(renderer_list->data);
+		mjob->job.scale = entry->scale;
+		mjob->group = group;
+		g_list_free(renderer_list);
+
+		g_atomic_int_inc(&group->pending);
+		*jobs = g_list_prepend(*jobs, mjob);
+		g_thread_pool_push(pool, mjob, NULL);
+	}
+
+	return failed;
+}
+
+/**
+ * @brief Estimate the memory a parsed GDS file will occupy
+ * @param gds Path of the GDS file
+ * @return Estimated size in bytes. 0 if the file cannot be accessed
+ */
+static guint64 manifest_estimate_memory(const char *gds)
+{
+	GStatBuf stat_buf;
+
+	if (g_stat(gds, &stat_buf))
+		return 0;
+
+	return (guint64)stat_buf.st_size * MANIFEST_LIB_MEMORY_FACTOR;
+}
+
+int command_line_convert_manifest(const char *manifest,
+				  const struct command_line_render_options *options,
+				  int jobs,
+				  int memory_limit_mib)
+{
+	struct manifest_scheduler sched;
+	struct manifest_group *group;
+	struct manifest_render_job *mjob;
+	struct manifest_entry *entry;
+	GList *groups = NULL;
+	GList *group_iter;
+	GList *entry_iter;
+	GList *job_list = NULL;
+	GList *job_iter;
+	GHashTable *layer_cache;
+	GThreadPool *pool;
+	GError *error = NULL;
+	long pages;
+	long page_size;
+	int failed = 0;
+	int ret = -1;
+
+	if (!manifest)
+		return -2;
+
+	if (jobs < 1)
+		jobs = (int)g_get_num_processors();
+
+	/* Malformed lines count as failed jobs */
+	if (manifest_load(manifest, &groups, &failed))
+		return -1;
+
+	for (group_iter = groups; jobs > 1 && group_iter; group_iter = g_list_next(group_iter)) {
+		group = (struct manifest_group *)group_iter->data;
+		for (entry_iter = group->entries; jobs > 1 && entry_iter; entry_iter = g_list_next(entry_iter)) {
+			entry = (struct manifest_entry *)entry_iter->data;
+			if (renderer_needs_serialization(entry->renderer, options)) {
+				printf(_("Renderer %s cannot run in parallel. Rendering with a single job\n"),
+				       entry->renderer);
+				jobs = 1;
+			}
+		}
+	}
+
+	g_mutex_init(&sched.lock);
+	g_cond_init(&sched.released);
+	sched.in_use = 0;
+	if (memory_limit_mib > 0) {
+		sched.budget = (guint64)memory_limit_mib * 1024 * 1024;
+	} else {
+		/* Default: Half of the physical memory */
+		pages = sysconf(_SC_PHYS_PAGES);
+		page_size = sysconf(_SC_PAGESIZE);
+		sched.budget = (pages > 0 && page_size > 0) ? (guint64)pages * (guint64)page_size / 2 : 0;
+	}
+
+	layer_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, manifest_layer_settings_unref);
+
+	pool = g_thread_pool_new(manifest_job_worker, NULL, jobs, FALSE, &error);
+	if (!pool) {
+		fprintf(stderr, _("Could not create worker pool: %s\n"), error->message);
+		g_error_free(error);
+		goto ret_free_cache;
+	}
+
+	/* GDS files are parsed one after another while previously parsed files are rendered.
+	 * A file is only parsed if its estimated memory fits into the budget.
+	 */
+	for (group_iter = groups; group_iter; group_iter = g_list_next(group_iter)) {
+		group = (struct manifest_group *)group_iter->data;
+		group->scheduler = &sched;
+		group->memory_estimate = manifest_estimate_memory(group->gds);
+		/* Reference held while the group's jobs are queued */
+		group->pending = 1;
+
+		manifest_scheduler_admit(&sched, group);
+		failed += manifest_queue_group(group, pool, layer_cache, options, &job_list);
+		manifest_group_release(group);
+	}
+
+	/* Wait for all jobs to complete */
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	for (job_iter = job_list; job_iter; job_iter = g_list_next(job_iter)) {
+		mjob = (struct manifest_render_job *)job_iter->data;
+		if (mjob->job.result)
+			failed++;
+	}
+
+	if (failed)
+		fprintf(stderr, _("%d of the manifest jobs failed\n"), failed);
+	ret = (failed ? -3 : 0);
+
+	g_list_free_full(job_list, g_free);
+ret_free_cache:
+	g_hash_table_destroy(layer_cache);
+	g_list_free_full(groups, manifest_group_free);
+	g_cond_clear(&sched.released);
+	g_mutex_clear(&sched.lock);
+
+	return ret;
+}
+
 static void indent_line(int level)
 {
 	while (level--)
@@ -36,29 +36,31 @@
 #include <gds-render/gds-utils/gds-tree-checker.h>
 #include <gds-render/layer/layer-selector.h>
 #include <gds-render/widgets/activity-bar.h>
+#include <gds-render/widgets/export-queue.h>
+#include <gds-render/widgets/layout-viewer.h>
 #include <gds-render/cell-selector/lib-cell-renderer.h>
+#include <gds-render/cell-selector/cell-tree-model.h>
+#include <gds-render/cell-selector/cell-preview-cache.h>
 #include <gds-render/cell-selector/cell-statistics-renderer.h>
 #include <gds-render/output-renderers/latex-renderer.h>
 #include <gds-render/output-renderers/cairo-renderer.h>
+#include <gds-render/output-renderers/pdf-renderer.h>
+#include <gds-render/output-renderers/svg-renderer.h>
+#include <gds-render/output-renderers/png-renderer.h>
 #include <gds-render/widgets/conv-settings-dialog.h>
 #include <gds-render/geometric/cell-geometrics.h>
 #include <gds-render/version.h>
 
-/** @brief Columns of selection tree view */
-enum cell_store_columns {
-	CELL_SEL_LIBRARY = 0,
-	CELL_SEL_CELL,
-	CELL_SEL_CELL_ERROR_STATE, /**< Used for cell color and selectability */
-	CELL_SEL_STAT,
-	CELL_SEL_COLUMN_COUNT /**< @brief Not a column. Used to determine count of columns */
-};
+/** @brief Width and height of the cell previews in the cell selector */
+#define CELL_PREVIEW_SIZE (32)
 
 enum gds_render_gui_signal_sig_ids {SIGNAL_WINDOW_CLOSED = 0, SIGNAL_COUNT};
 
 static guint gds_render_gui_signals[SIGNAL_COUNT];
 
 struct gui_button_states {
-	gboolean rendering_active;
+	gboolean rendering_active; /**< @brief Export jobs are queued or running. The library must not be replaced */
+	gboolean loading_active;
 	gboolean valid_cell_selected;
 };
 
@@ -73,16 +75,51 @@ struct _GdsRenderGui {
 	GtkWidget *load_layer_button;
 	GtkWidget *save_layer_button;
 	GtkWidget *select_all_button;
-	GtkTreeStore *cell_tree_store;
-	GtkTreeModelFilter *cell_filter;
+	CellTreeModel *cell_tree_model;
+	CellPreviewCache *preview_cache;
+	LayerSettings *preview_layers; /**< @brief All layers of the loaded libraries colored by the palette */
 	GtkWidget *cell_search_entry;
 	LayerSelector *layer_selector;
 	GtkTreeView *cell_tree_view;
 	GList *gds_libraries;
 	ActivityBar *activity_status_bar;
+	ExportQueue *export_queue;
+	LayoutViewer *layout_viewer;
 	struct render_settings render_dialog_settings;
 	ColorPalette *palette;
 	struct gui_button_states button_state_data;
+	guint load_generation;
+	GCancellable *load_cancellable;
+};
+
+/**
+ * @brief State of a GDS file loaded in the background
+ */
+struct gds_load_job {
+	GdsRenderGui *gui; /**< @brief GUI object. Referenced */
+	char *filename; /**< @brief GDS file to load */
+	guint generation; /**< @brief Value of _GdsRenderGui::load_generation when the load was started */
+	GList *libraries; /**< @brief Loaded libraries. Owned by the job until the load is finished */
+	int last_percent; /**< @brief Last progress reported to the main context. Only used by the loading thread */
+};
+
+/**
+ * @brief Kind of a #gds_load_event
+ */
+enum gds_load_event_type {
+	LOAD_EVENT_PROGRESS = 0, /**< @brief Parsing progress changed */
+	LOAD_EVENT_LIBRARY_PARSED, /**< @brief A library is parsed and checked. Its cells and layers can be shown */
+};
+
+/**
+ * @brief Result of the loading thread passed to the main context
+ */
+struct gds_load_event {
+	GdsRenderGui *gui; /**< @brief GUI object. Referenced */
+	guint generation; /**< @brief Generation of the load this event belongs to */
+	enum gds_load_event_type type; /**< @brief Kind of event */
+	double fraction; /**< @brief Progress. Only for #LOAD_EVENT_PROGRESS */
+	struct gds_library *library; /**< @brief Library the event refers to */
 };
 
 G_DEFINE_TYPE(GdsRenderGui, gds_render_gui, G_TYPE_OBJECT)
@@ -104,11 +141,24 @@ static gboolean on_window_close(gpointer window, GdkEvent *event, gpointer user)
 	if (!self)
 		return TRUE;
 
+	/* Stop all exports */
+	export_queue_cancel_all(self->export_queue);
+
 	/* Close Window. Leads to termination of the program/the current instance */
 	g_clear_object(&self->main_window);
 	gtk_widget_destroy(GTK_WIDGET(window));
 
+	/* Abort a running load. The load job frees its data once it is finished */
+	self->load_generation++;
+	if (self->load_cancellable)
+		g_cancellable_cancel(self->load_cancellable);
+
+	/* Running renderers still read the library. The window is gone, so waiting cannot re-enter this handler */
+	export_queue_wait_for_running_jobs(self->export_queue);
+
 	/* Delete loaded library data */
+	cell_preview_cache_clear(self->preview_cache);
+	layout_viewer_set_cell(self->layout_viewer, NULL, NULL);
 	clear_lib_list(&self->gds_libraries);
 
 	g_signal_emit(self, gds_render_gui_signals[SIGNAL_WINDOW_CLOSED], 0);
@@ -152,65 +202,104 @@ static gboolean tree_sel_func(GtkTreeSelection *selection,
 	return ret;
 }
 
+static void cell_selection_changed(GtkTreeSelection *sel, GdsRenderGui *self);
+
 /**
- * @brief Trigger refiltering of cell filter
+ * @brief Filter the cells shown in the cell selector
+ *
+ * The model is detached from the view while the filter changes.
+ * This is much faster than announcing every changed row to the view.
+ * The selected cell stays selected if it is still shown.
+ *
  * @param entry Unused widget, that emitted the signal
  * @param data GdsrenderGui self instance
  */
 static void cell_tree_view_change_filter(GtkWidget *entry, gpointer data)
 {
 	GdsRenderGui *self = RENDERER_GUI(data);
+	const char *search_string;
+	GtkTreeSelection *selection;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	GtkTreePath *path = NULL;
+	struct gds_cell *selected_cell = NULL;
 	(void)entry;
 
-	gtk_tree_model_filter_refilter(self->cell_filter);
+	search_string = gtk_entry_get_text(GTK_ENTRY(self->cell_search_entry));
+	selection = gtk_tree_view_get_selection(self->cell_tree_view);
+	if (gtk_tree_selection_get_selected(selection, &model, &iter))
+		gtk_tree_model_get(model, &iter, CELL_SEL_CELL, &selected_cell, -1);
+
+	/* Detaching the model clears the selection. The layout viewer shall keep the cell */
+	g_signal_handlers_block_by_func(selection, G_CALLBACK(cell_selection_changed), self);
+
+	gtk_tree_view_set_model(self->cell_tree_view, NULL);
+	cell_tree_model_set_filter(self->cell_tree_model, search_string);
+	gtk_tree_view_set_model(self->cell_tree_view, GTK_TREE_MODEL(self->cell_tree_model));
+
+	/* Show the search results */
+	if (strlen(search_string))
+		gtk_tree_view_expand_all(self->cell_tree_view);
+
+	if (selected_cell)
+		path = cell_tree_model_get_cell_path(self->cell_tree_model, selected_cell);
+	if (path) {
+		gtk_tree_view_expand_to_path(self->cell_tree_view, path);
+		gtk_tree_selection_select_path(selection, path);
+		gtk_tree_path_free(path);
+	}
+
+	g_signal_handlers_unblock_by_func(selection, G_CALLBACK(cell_selection_changed), self);
+
+	/* The selected cell is filtered out */
+	if (selected_cell && !gtk_tree_selection_count_selected_rows(selection))
+		cell_selection_changed(selection, self);
 }
 
 /**
- * @brief cell_store_filter_visible_func Decides whether an element of the tree model @p model is visible.
- * @param model Tree model
- * @param iter Current element / iter in Model to check
- * @param data Data. Set to static stores variable
- * @return TRUE if visible, else FALSE
- * @note TODO: Maybe implement Damerau-Levenshtein distance matching
+ * @brief Cell data function of the preview column
+ *
+ * Previews are only requested for rows inside the visible area. The tree view also
+ * calls this function for invisible rows to calculate the column sizes.
  */
-static gboolean cell_store_filter_visible_func(GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
+static void cell_preview_data_func(GtkTreeViewColumn *column, GtkCellRenderer *renderer, GtkTreeModel *model,
+				   GtkTreeIter *iter, gpointer data)
 {
-	GdsRenderGui *self;
+	GdsRenderGui *self = RENDERER_GUI(data);
 	struct gds_cell *cell;
-	struct gds_library *lib;
-	gboolean result = FALSE;
-	const char *search_string;
-
-	self = RENDERER_GUI(data);
-	g_return_val_if_fail(RENDERER_IS_GUI(self), FALSE);
-
-	if (!model || !iter)
-		goto exit_filter;
+	cairo_surface_t *surface = NULL;
+	GtkTreePath *path;
+	GtkTreePath *start_path;
+	GtkTreePath *end_path;
+	gboolean visible = FALSE;
+	(void)column;
 
-	gtk_tree_model_get(model, iter, CELL_SEL_CELL, &cell, CELL_SEL_LIBRARY, &lib, -1);
+	gtk_tree_model_get(model, iter, CELL_SEL_CELL, &cell, -1);
 
-    /* Show always, if this is a pure lib entry */
-    if (lib && !cell) {
-		result = TRUE;
-		goto exit_filter;
+	if (cell) {
+		if (gtk_tree_view_get_visible_range(self->cell_tree_view, &start_path, &end_path)) {
+			path = gtk_tree_model_get_path(model, iter);
+			visible = gtk_tree_path_compare(path, start_path) >= 0 && gtk_tree_path_compare(path, end_path) <= 0;
+			gtk_tree_path_free(path);
+			gtk_tree_path_free(start_path);
+			gtk_tree_path_free(end_path);
+		}
+		surface = cell_preview_cache_lookup(self->preview_cache, cell, visible);
 	}
 
-	if (!cell)
-		goto exit_filter;
-
-	search_string = gtk_entry_get_text(GTK_ENTRY(self->cell_search_entry));
-
-	/* Show all, if field is empty */
-	if (!strlen(search_string))
-		result = TRUE;
-
-	if (strstr(cell->name, search_string))
-		result = TRUE;
+	g_object_set(renderer, "surface", surface, NULL);
+}
 
-	gtk_tree_view_expand_all(self->cell_tree_view);
+/**
+ * @brief A cell preview has been rendered
+ */
+static void on_cell_preview_ready(CellPreviewCache *cache, gpointer cell, gpointer data)
+{
+	GdsRenderGui *self = RENDERER_GUI(data);
+	(void)cache;
+	(void)cell;
 
-exit_filter:
-	return result;
+	gtk_widget_queue_draw(GTK_WIDGET(self->cell_tree_view));
 }
 
 /**
@@ -222,26 +311,28 @@ int gds_render_gui_setup_cell_selector(GdsRenderGui *self)
 	GtkCellRenderer *render_cell;
 	GtkCellRenderer *render_lib;
 	GtkCellRenderer *render_vertex_count;
+	GtkCellRenderer *render_preview;
 	GtkTreeViewColumn *column;
 
-	self->cell_tree_store = gtk_tree_store_new(CELL_SEL_COLUMN_COUNT, G_TYPE_POINTER,
-					 G_TYPE_POINTER, G_TYPE_UINT, G_TYPE_POINTER);
+	self->cell_tree_model = cell_tree_model_new();
+	self->preview_cache = cell_preview_cache_new(CELL_PREVIEW_SIZE);
+	g_signal_connect(self->preview_cache, "preview-ready", G_CALLBACK(on_cell_preview_ready), self);
 
 	/* Searching */
-	self->cell_filter = GTK_TREE_MODEL_FILTER(
-				gtk_tree_model_filter_new(GTK_TREE_MODEL(self->cell_tree_store), NULL));
-
-	gtk_tree_model_filter_set_visible_func(self->cell_filter,
-						(GtkTreeModelFilterVisibleFunc)cell_store_filter_visible_func,
-						 self, NULL);
 	g_signal_connect(GTK_SEARCH_ENTRY(self->cell_search_entry), "search-changed",
 			 G_CALLBACK(cell_tree_view_change_filter), self);
 
-	gtk_tree_view_set_model(self->cell_tree_view, GTK_TREE_MODEL(self->cell_filter));
+	gtk_tree_view_set_model(self->cell_tree_view, GTK_TREE_MODEL(self->cell_tree_model));
 
 	render_cell = lib_cell_renderer_new();
 	render_lib = lib_cell_renderer_new();
 	render_vertex_count = cell_statistics_renderer_new();
+	render_preview = gtk_cell_renderer_pixbuf_new();
+	gtk_cell_renderer_set_fixed_size(render_preview, CELL_PREVIEW_SIZE, CELL_PREVIEW_SIZE);
+
+	column = gtk_tree_view_column_new_with_attributes(_("Preview"), render_preview, NULL);
+	gtk_tree_view_column_set_cell_data_func(column, render_preview, cell_preview_data_func, self, NULL);
+	gtk_tree_view_append_column(self->cell_tree_view, column);
 
 	column = gtk_tree_view_column_new_with_attributes(_("Library"), render_lib, "gds-lib", CELL_SEL_LIBRARY, NULL);
 	gtk_tree_view_append_column(self->cell_tree_view, column);
@@ -267,32 +358,314 @@ const struct gds_cell_statistics cc =  {
 	.vertex_count = 12,
 };
 
+static void process_button_state_changes(GdsRenderGui *self);
+
+/**
+ * @brief Add a parsed library and its cells to the cell selector
+ *
+ * The error state of the cells is updated once the library is checked.
+ *
+ * @param self GUI object
+ * @param gds_lib Library
+ */
+static void gds_render_gui_add_library(GdsRenderGui *self, struct gds_library *gds_lib)
+{
+	cell_tree_model_add_library(self->cell_tree_model, gds_lib);
+}
+
+/**
+ * @brief Update the error state of all cells of \p gds_lib after the library is checked
+ * @param self GUI object
+ * @param gds_lib Library
+ */
+static void gds_render_gui_update_library_checks(GdsRenderGui *self, struct gds_library *gds_lib)
+{
+	cell_tree_model_set_library_checked(self->cell_tree_model, gds_lib);
+}
+
+/**
+ * @brief Add layers to the layers shown in the cell previews
+ *
+ * The preview colors are taken from the color palette by layer number.
+ * They do not follow the layer selector.
+ *
+ * @param self GUI object
+ * @param inventory Layer inventory of a library. Array of #gds_layer_count. Layers already known are ignored
+ */
+static void gds_render_gui_add_preview_layers(GdsRenderGui *self, const GArray *inventory)
+{
+	LayerSettings *settings;
+	GList *info_list;
+	struct layer_info *info;
+	struct layer_info new_info;
+	GdkRGBA color;
+	unsigned int color_count;
+	gboolean known;
+	guint i;
+	int layer;
+
+	color_count = color_palette_get_color_count(self->palette);
+
+	/* The preview cache requires unmodified settings. Create a new object */
+	settings = layer_settings_new();
+	if (self->preview_layers) {
+		for (info_list = layer_settings_get_layer_info_list(self->preview_layers); info_list;
+		     info_list = g_list_next(info_list))
+			layer_settings_append_layer_info(settings, (struct layer_info *)info_list->data);
+	}
+
+	for (i = 0; i < inventory->len; i++) {
+		layer = (int)g_array_index(inventory, struct gds_layer_count, i).layer;
+		known = FALSE;
+		for (info_list = layer_settings_get_layer_info_list(settings); info_list; info_list = g_list_next(info_list)) {
+			info = (struct layer_info *)info_list->data;
+			if (info->layer == layer) {
+				known = TRUE;
+				break;
+			}
+		}
+		if (known)
+			continue;
+
+		memset(&new_info, 0, sizeof(new_info));
+		new_info.layer = layer;
+		new_info.datatype = LAYER_INFO_ANY_DATATYPE;
+		new_info.render = 1;
+		if (color_count && color_palette_get_color(self->palette, &color, (unsigned int)ABS(new_info.layer) % color_count)) {
+			new_info.color.red = color.red;
+			new_info.color.green = color.green;
+			new_info.color.blue = color.blue;
+			new_info.color.alpha = color.alpha;
+		} else {
+			new_info.color.alpha = 1.0;
+		}
+		layer_settings_append_layer_info(settings, &new_info);
+	}
+
+	g_clear_object(&self->preview_layers);
+	self->preview_layers = settings;
+	cell_preview_cache_set_layer_settings(self->preview_cache, settings);
+	gtk_widget_queue_draw(GTK_WIDGET(self->cell_tree_view));
+}
+
+static void gds_load_event_free(gpointer data)
+{
+	struct gds_load_event *event = (struct gds_load_event *)data;
+
+	g_object_unref(event->gui);
+	g_free(event);
+}
+
+/**
+ * @brief Process a #gds_load_event in the main context
+ * @param data #gds_load_event
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean gds_load_event_dispatch(gpointer data)
+{
+	struct gds_load_event *event = (struct gds_load_event *)data;
+	GdsRenderGui *self = event->gui;
+	char *status;
+
+	/* Stale event of a cancelled load or window already closed */
+	if (event->generation != self->load_generation || !self->main_window)
+		return G_SOURCE_REMOVE;
+
+	switch (event->type) {
+	case LOAD_EVENT_PROGRESS:
+		status = g_strdup_printf(_("Loading GDS file: %.0f %%"), event->fraction * 100.0);
+		activity_bar_set_busy(self->activity_status_bar, status);
+		activity_bar_set_fraction(self->activity_status_bar, event->fraction);
+		g_free(status);
+		break;
+	case LOAD_EVENT_LIBRARY_PARSED:
+		gds_render_gui_add_library(self, event->library);
+		gds_render_gui_update_library_checks(self, event->library);
+		if (event->library->layer_inventory) {
+			layer_selector_add_layers(self->layer_selector, event->library->layer_inventory);
+			gds_render_gui_add_preview_layers(self, event->library->layer_inventory);
+		}
+		break;
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Pass an event from the loading thread to the main context
+ * @param job Load job
+ * @param type Event type
+ * @param fraction Progress
+ * @param library Library
+ */
+static void gds_load_job_post_event(struct gds_load_job *job, enum gds_load_event_type type, double fraction,
+				    struct gds_library *library)
+{
+	struct gds_load_event *event;
+
+	event = g_new0(struct gds_load_event, 1);
+	event->gui = g_object_ref(job->gui);
+	event->generation = job->generation;
+	event->type = type;
+	event->fraction = fraction;
+	event->library = library;
+
+	g_main_context_invoke_full(NULL, G_PRIORITY_DEFAULT, gds_load_event_dispatch, event, gds_load_event_free);
+}
+
+static gboolean gds_load_job_progress(goffset bytes_read, goffset file_size, gpointer user_data)
+{
+	GTask *task = G_TASK(user_data);
+	struct gds_load_job *job = (struct gds_load_job *)g_task_get_task_data(task);
+	int percent;
+
+	if (g_task_return_error_if_cancelled(task))
+		return FALSE;
+
+	if (file_size <= 0)
+		return TRUE;
+
+	/* Only report changes of the displayed value */
+	percent = (int)(bytes_read * 100 / file_size);
+	if (percent != job->last_percent) {
+		job->last_percent = percent;
+		gds_load_job_post_event(job, LOAD_EVENT_PROGRESS, (double)bytes_read / (double)file_size, NULL);
+	}
+
+	return TRUE;
+}
+
+/**
+ * @brief Check a parsed library and pass it to the main context
+ *
+ * The checks write the gds_cell::checks fields. They have to be finished before the library is handed over.
+ * The main context reads these fields and must not offer cells that are affected by a reference loop.
+ */
+static void gds_load_job_library_finished(struct gds_library *library, gpointer user_data)
+{
+	struct gds_load_job *job = (struct gds_load_job *)g_task_get_task_data(G_TASK(user_data));
+
+	(void)gds_tree_check_cell_references(library);
+	(void)gds_tree_check_reference_loops(library);
+	gds_load_job_post_event(job, LOAD_EVENT_LIBRARY_PARSED, 0.0, library);
+}
+
+/**
+ * @brief Loading thread: Parse the file and check the libraries
+ *
+ * Each library is checked and passed to the main context as soon as it is parsed.
+ */
+static void gds_load_job_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	struct gds_load_job *job = (struct gds_load_job *)task_data;
+	struct gds_parsing_callbacks callbacks;
+	int gds_result;
+	(void)source_object;
+
+	const struct gds_library_parsing_opts gds_parsing_options = {
+		.simplified_polygons = 1,
+	};
+
+	callbacks.progress = gds_load_job_progress;
+	callbacks.library_finished = gds_load_job_library_finished;
+	callbacks.user_data = task;
+
+	gds_result = parse_gds_from_file_with_callbacks(job->filename, &job->libraries, &gds_parsing_options,
+							&callbacks);
+	if (gds_result == GDS_PARSER_CANCELLED)
+		return;
+	if (gds_result) {
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, _("Could not parse GDS file (%d)"),
+					gds_result);
+		return;
+	}
+
+	(void)cancellable;
+	g_task_return_boolean(task, TRUE);
+}
+
+static void gds_load_job_free(gpointer data)
+{
+	struct gds_load_job *job = (struct gds_load_job *)data;
+
+	/* Libraries not handed over to the GUI */
+	clear_lib_list(&job->libraries);
+	g_object_unref(job->gui);
+	g_free(job->filename);
+	g_free(job);
+}
+
+/**
+ * @brief Completion of the loading thread in the main context
+ */
+static void gds_load_job_finished(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	GdsRenderGui *self = RENDERER_GUI(source_object);
+	struct gds_load_job *job = (struct gds_load_job *)g_task_get_task_data(G_TASK(res));
+	GError *error = NULL;
+	gboolean success;
+	GtkStyleContext *button_style;
+	(void)user_data;
+
+	success = g_task_propagate_boolean(G_TASK(res), &error);
+
+	/* A newer load has been started or the window is closed. Drop the result */
+	if (job->generation != self->load_generation || !self->main_window) {
+		g_clear_error(&error);
+		return;
+	}
+
+	g_clear_object(&self->load_cancellable);
+	self->button_state_data.loading_active = FALSE;
+	process_button_state_changes(self);
+	activity_bar_set_ready(self->activity_status_bar);
+
+	if (!success) {
+		if (error && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning("%s", error->message);
+		g_clear_error(&error);
+
+		/* Remove partially shown libraries. They are freed with the job.
+		 * Events still queued for this load must not access them.
+		 */
+		self->load_generation++;
+		cell_tree_model_clear(self->cell_tree_model);
+		cell_preview_cache_clear(self->preview_cache);
+		layout_viewer_set_cell(self->layout_viewer, NULL, NULL);
+		g_clear_object(&self->preview_layers);
+		layer_selector_clear_layers(self->layer_selector);
+		return;
+	}
+
+	/* Hand over the libraries to the GUI */
+	self->gds_libraries = job->libraries;
+	job->libraries = NULL;
+
+	/* remove suggested action from Open button */
+	button_style = gtk_widget_get_style_context(self->open_button);
+	gtk_style_context_remove_class(button_style, "suggested-action");
+}
+
 /**
  * @brief Callback function of Load GDS button
+ *
+ * The file is loaded in a separate thread. The cell selector and the layer selector are filled
+ * as soon as the results are available.
+ *
  * @param button
  * @param user GdsRenderGui instance
  */
 static void on_load_gds(gpointer button, gpointer user)
 {
-	GList *cell;
-	GtkTreeIter libiter;
-	GtkTreeIter celliter;
-	GList *lib;
-	struct gds_library *gds_lib;
-	struct gds_cell *gds_c;
 	GdsRenderGui *self;
 	GtkWidget *open_dialog;
 	GtkFileChooser *file_chooser;
 	GtkFileFilter *filter;
-	GtkStyleContext *button_style;
 	gint dialog_result;
-	int gds_result;
-	char *filename;
-	unsigned int cell_error_level;
-
-	const struct gds_library_parsing_opts gds_parsing_options = {
-		.simplified_polygons = 1,
-	};
+	struct gds_load_job *job;
+	GCancellable *cancellable;
+	GTask *task;
+	(void)button;
 
 	self = RENDERER_GUI(user);
 	if (!self)
@@ -316,62 +689,34 @@ static void on_load_gds(gpointer button, gpointer user)
 	if (dialog_result != GTK_RESPONSE_ACCEPT)
 		goto end_destroy;
 
-	/* Get File name */
-	filename = gtk_file_chooser_get_filename(file_chooser);
-
-	gtk_tree_store_clear(self->cell_tree_store);
+	cell_tree_model_clear(self->cell_tree_model);
+	cell_preview_cache_clear(self->preview_cache);
+	layout_viewer_set_cell(self->layout_viewer, NULL, NULL);
+	g_clear_object(&self->preview_layers);
 	clear_lib_list(&self->gds_libraries);
+	layer_selector_clear_layers(self->layer_selector);
 
-	/* Parse new GDSII file */
-	gds_result = parse_gds_from_file(filename, &self->gds_libraries, &gds_parsing_options);
+	job = g_new0(struct gds_load_job, 1);
+	job->gui = g_object_ref(self);
+	job->filename = gtk_file_chooser_get_filename(file_chooser);
+	job->generation = ++self->load_generation;
+	job->last_percent = -1;
 
-	/* Delete file name afterwards */
-	g_free(filename);
-	if (gds_result)
-		goto end_destroy;
+	cancellable = g_cancellable_new();
+	g_clear_object(&self->load_cancellable);
+	self->load_cancellable = g_object_ref(cancellable);
+	task = g_task_new(self, cancellable, gds_load_job_finished, NULL);
+	g_task_set_task_data(task, job, gds_load_job_free);
 
-	/* remove suggested action from Open button */
-	button_style = gtk_widget_get_style_context(GTK_WIDGET(button));
-	gtk_style_context_remove_class(button_style, "suggested-action");
+	self->button_state_data.loading_active = TRUE;
+	process_button_state_changes(self);
+	activity_bar_set_busy(self->activity_status_bar, _("Loading GDS file..."));
+	activity_bar_set_fraction(self->activity_status_bar, 0.0);
+	activity_bar_set_cancellable(self->activity_status_bar, cancellable);
 
-	for (lib = self->gds_libraries; lib != NULL; lib = lib->next) {
-		gds_lib = (struct gds_library *)lib->data;
-		/* Create top level iter */
-		gtk_tree_store_append(self->cell_tree_store, &libiter, NULL);
-
-		gtk_tree_store_set(self->cell_tree_store, &libiter,
-				   CELL_SEL_LIBRARY, gds_lib,
-				   -1);
-
-		/* Check this library. This might take a while */
-		(void)gds_tree_check_cell_references(gds_lib);
-		(void)gds_tree_check_reference_loops(gds_lib);
-
-		for (cell = gds_lib->cells; cell != NULL; cell = cell->next) {
-			gds_c = (struct gds_cell *)cell->data;
-			gtk_tree_store_append(self->cell_tree_store, &celliter, &libiter);
-
-			/* Get the checking results for this cell */
-			cell_error_level = 0;
-			if (gds_c->checks.unresolved_child_count)
-				cell_error_level |= LIB_CELL_RENDERER_ERROR_WARN;
-
-			/* Check if it is completely b0rken */
-			if (gds_c->checks.affected_by_reference_loop)
-				cell_error_level |= LIB_CELL_RENDERER_ERROR_ERR;
-
-			/* Add cell to tree store model */
-			gtk_tree_store_set(self->cell_tree_store, &celliter,
-					   CELL_SEL_CELL, gds_c,
-					   CELL_SEL_CELL_ERROR_STATE, cell_error_level,
-					   CELL_SEL_LIBRARY, gds_c->parent_library,
-					   CELL_SEL_STAT, &gds_c->stats,
-					   -1);
-		} /* for cells */
-	} /* for libraries */
-
-	/* Create Layers in Layer Box */
-	layer_selector_generate_layer_widgets(self->layer_selector, self->gds_libraries);
+	g_task_run_in_thread(task, gds_load_job_thread);
+	g_object_unref(task);
+	g_object_unref(cancellable);
 
 end_destroy:
 	/* Destroy dialog and filter */
@@ -383,9 +728,10 @@ static void process_button_state_changes(GdsRenderGui *self)
 	gboolean convert_button_state = FALSE;
 	gboolean open_gds_button_state = FALSE;
 
-	/* Calculate states */
-	if (!self->button_state_data.rendering_active) {
-		open_gds_button_state = TRUE;
+	/* Calculate states. Conversions can be queued while others are running */
+	if (!self->button_state_data.loading_active) {
+		if (!self->button_state_data.rendering_active)
+			open_gds_button_state = TRUE;
 		if (self->button_state_data.valid_cell_selected)
 			convert_button_state = TRUE;
 	}
@@ -409,29 +755,15 @@ static void on_auto_color_clicked(gpointer button, gpointer user)
 	layer_selector_auto_color_layers(self->layer_selector, self->palette, 1.0);
 }
 
-static void async_rendering_finished_callback(GdsOutputRenderer *renderer, gpointer gui)
+static void export_queue_active_jobs_changed(ExportQueue *queue, gpointer gui)
 {
 	GdsRenderGui *self;
 
 	self = RENDERER_GUI(gui);
 
-	self->button_state_data.rendering_active = FALSE;
+	/* Prevent user from replacing the library while it is rendered */
+	self->button_state_data.rendering_active = (export_queue_get_active_job_count(queue) ? TRUE : FALSE);
 	process_button_state_changes(self);
-	activity_bar_set_ready(self->activity_status_bar);
-
-	g_object_unref(renderer);
-}
-
-static void async_rendering_status_update_callback(GdsOutputRenderer *renderer,
-						   const char *status_message,
-						   gpointer data)
-{
-	GdsRenderGui *gui;
-	(void)renderer;
-
-	gui = RENDERER_GUI(data);
-
-	activity_bar_set_busy(gui->activity_status_bar, status_message);
 }
 
 /**
@@ -453,6 +785,8 @@ static void on_convert_clicked(gpointer button, gpointer user)
 	gint res;
 	char *file_name;
 	union bounding_box cell_box;
+	union bounding_box window;
+	gboolean window_set;
 	unsigned int height, width;
 	struct render_settings *sett;
 	LayerSettings *layer_settings;
@@ -463,8 +797,8 @@ static void on_convert_clicked(gpointer button, gpointer user)
 	if (!self)
 		return;
 
-	/* Abort if rendering is already active */
-	if (self->button_state_data.rendering_active == TRUE)
+	/* Abort if a library is being loaded */
+	if (self->button_state_data.loading_active == TRUE)
 		return;
 
 	sett = &self->render_dialog_settings;
@@ -486,6 +820,11 @@ static void on_convert_clicked(gpointer button, gpointer user)
 	bounding_box_prepare_empty(&cell_box);
 	calculate_cell_bounding_box(&cell_box, cell_to_render);
 
+	/* Only the window selected in the layout viewer is rendered */
+	window_set = layout_viewer_get_window(self->layout_viewer, &window);
+	if (window_set)
+		cell_box = window;
+
 	/* Calculate size in database units
 	 * Note that the results are bound to be positive,
 	 * so casting them to unsigned int is absolutely valid
@@ -523,13 +862,19 @@ static void on_convert_clicked(gpointer button, gpointer user)
 		gtk_file_filter_set_name(filter, "LaTeX-Files");
 		break;
 	case RENDERER_CAIROGRAPHICS_PDF:
+	case RENDERER_NATIVE_PDF:
 		gtk_file_filter_add_pattern(filter, "*.pdf");
 		gtk_file_filter_set_name(filter, "PDF-Files");
 		break;
 	case RENDERER_CAIROGRAPHICS_SVG:
+	case RENDERER_NATIVE_SVG:
 		gtk_file_filter_add_pattern(filter, "*.svg");
 		gtk_file_filter_set_name(filter, "SVG-Files");
 		break;
+	case RENDERER_PNG:
+		gtk_file_filter_add_pattern(filter, "*.png");
+		gtk_file_filter_set_name(filter, "PNG-Files");
+		break;
 	}
 
 	gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(dialog), filter);
@@ -553,6 +898,15 @@ static void on_convert_clicked(gpointer button, gpointer user)
 		case RENDERER_CAIROGRAPHICS_PDF:
 			render_engine = GDS_RENDER_OUTPUT_RENDERER(cairo_renderer_new_pdf());
 			break;
+		case RENDERER_NATIVE_PDF:
+			render_engine = GDS_RENDER_OUTPUT_RENDERER(pdf_renderer_new_with_options(sett->tex_pdf_layers, TRUE));
+			break;
+		case RENDERER_NATIVE_SVG:
+			render_engine = GDS_RENDER_OUTPUT_RENDERER(svg_renderer_new());
+			break;
+		case RENDERER_PNG:
+			render_engine = GDS_RENDER_OUTPUT_RENDERER(png_renderer_new());
+			break;
 		default:
 			/* Abort rendering */
 			render_engine = NULL;
@@ -562,18 +916,12 @@ static void on_convert_clicked(gpointer button, gpointer user)
 		if (render_engine) {
 			gds_output_renderer_set_output_file(render_engine, file_name);
 			gds_output_renderer_set_layer_settings(render_engine, layer_settings);
-			/* Prevent user from overwriting library or triggering additional conversion */
-			self->button_state_data.rendering_active = TRUE;
-			process_button_state_changes(self);
+			if (window_set)
+				gds_output_renderer_set_window(render_engine, &window);
 
-			g_signal_connect(render_engine, "async-finished", G_CALLBACK(async_rendering_finished_callback),
-					 self);
-
-			activity_bar_set_busy(self->activity_status_bar, _("Rendering cell..."));
-
-			g_signal_connect(render_engine, "progress-changed",
-					 G_CALLBACK(async_rendering_status_update_callback), self);
-			gds_output_renderer_render_output_async(render_engine, cell_to_render, sett->scale);
+			/* The queue runs the job concurrently to other exports and shows its progress */
+			export_queue_add_job(self->export_queue, render_engine, cell_to_render, sett->scale);
+			g_object_unref(render_engine);
 		}
 		g_free(file_name);
 	} else {
@@ -612,14 +960,26 @@ static void cell_selection_changed(GtkTreeSelection *sel, GdsRenderGui *self)
 {
 	GtkTreeModel *model = NULL;
 	GtkTreeIter iter;
+	struct gds_cell *cell = NULL;
+	LayerSettings *layer_settings;
 
 	if (gtk_tree_selection_get_selected(sel, &model, &iter)) {
 		/* Node selected. Show button */
 		self->button_state_data.valid_cell_selected = TRUE;
+		gtk_tree_model_get(model, &iter, CELL_SEL_CELL, &cell, -1);
 	} else {
 		self->button_state_data.valid_cell_selected = FALSE;
 	}
 
+	/* Show the selected cell with the current layer settings */
+	if (cell) {
+		layer_settings = layer_selector_export_rendered_layer_info(self->layer_selector);
+		layout_viewer_set_cell(self->layout_viewer, cell, layer_settings);
+		g_object_unref(layer_settings);
+	} else {
+		layout_viewer_set_cell(self->layout_viewer, NULL, NULL);
+	}
+
 	process_button_state_changes(self);
 }
 
@@ -651,13 +1011,25 @@ static void gds_render_gui_dispose(GObject *gobject)
 
 	self = RENDERER_GUI(gobject);
 
-	clear_lib_list(&self->gds_libraries);
-
+	/* Export jobs may still read the library if the window has not been closed. See on_window_close() */
+	if (self->preview_cache) {
+		g_signal_handlers_disconnect_by_data(self->preview_cache, self);
+		cell_preview_cache_clear(self->preview_cache);
+	}
+	if (self->layout_viewer)
+		layout_viewer_set_cell(self->layout_viewer, NULL, NULL);
+	if (!self->export_queue || !export_queue_get_active_job_count(self->export_queue))
+		clear_lib_list(&self->gds_libraries);
+
+	g_clear_object(&self->load_cancellable);
+	g_clear_object(&self->export_queue);
+	g_clear_object(&self->layout_viewer);
 	g_clear_object(&self->cell_tree_view);
 	g_clear_object(&self->convert_button);
 	g_clear_object(&self->layer_selector);
-	g_clear_object(&self->cell_tree_store);
-	g_clear_object(&self->cell_filter);
+	g_clear_object(&self->cell_tree_model);
+	g_clear_object(&self->preview_cache);
+	g_clear_object(&self->preview_layers);
 	g_clear_object(&self->cell_search_entry);
 	g_clear_object(&self->activity_status_bar);
 	g_clear_object(&self->palette);
@@ -768,12 +1140,20 @@ static void gds_render_gui_init(GdsRenderGui *self)
 	GtkWidget *activity_bar_box;
 	GtkWidget *auto_color_button;
 	GtkWidget *auto_naming_button;
+	GtkWidget *content_box;
 
 	main_builder = gtk_builder_new_from_resource("/gui/main.glade");
 
 	self->cell_tree_view = GTK_TREE_VIEW(gtk_builder_get_object(main_builder, "cell-tree"));
 	self->cell_search_entry = GTK_WIDGET(gtk_builder_get_object(main_builder, "cell-search"));
 
+	/* Create layout viewer between cell selector and layer selector */
+	content_box = GTK_WIDGET(gtk_builder_get_object(main_builder, "content-box"));
+	self->layout_viewer = layout_viewer_new();
+	gtk_box_pack_start(GTK_BOX(content_box), GTK_WIDGET(self->layout_viewer), TRUE, TRUE, 0);
+	gtk_box_reorder_child(GTK_BOX(content_box), GTK_WIDGET(self->layout_viewer), 1);
+	gtk_widget_show(GTK_WIDGET(self->layout_viewer));
+
 	gds_render_gui_setup_cell_selector(self);
 
 	self->main_window = GTK_WINDOW(gtk_builder_get_object(main_builder, "main-window"));
@@ -816,6 +1196,11 @@ static void gds_render_gui_init(GdsRenderGui *self)
 	g_signal_connect(GTK_WIDGET(self->main_window), "delete-event",
 			 G_CALLBACK(on_window_close), self);
 
+	/* Create and apply export queue panel above the ActivityBar */
+	self->export_queue = export_queue_new();
+	gtk_container_add(GTK_CONTAINER(activity_bar_box), GTK_WIDGET(self->export_queue));
+	g_signal_connect(self->export_queue, "active-jobs-changed", G_CALLBACK(export_queue_active_jobs_changed), self);
+
 	/* Create and apply ActivityBar */
 	self->activity_status_bar = activity_bar_new();
 	gtk_container_add(GTK_CONTAINER(activity_bar_box), GTK_WIDGET(self->activity_status_bar));
@@ -845,10 +1230,15 @@ static void gds_render_gui_init(GdsRenderGui *self)
 
 	/* Setup default button sensibility data */
 	self->button_state_data.rendering_active = FALSE;
+	self->button_state_data.loading_active = FALSE;
 	self->button_state_data.valid_cell_selected = FALSE;
+	self->load_generation = 0;
+	self->load_cancellable = NULL;
 
 	/* Reference all objects referenced by this object */
 	g_object_ref(self->activity_status_bar);
+	g_object_ref(self->export_queue);
+	g_object_ref(self->layout_viewer);
 	g_object_ref(self->main_window);
 	g_object_ref(self->cell_tree_view);
 	g_object_ref(self->convert_button);
@@ -0,0 +1,236 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file gds-layer-usage.c
+ * @brief Transitive layer usage of cells
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * Every cell stores the set of layers used by itself and all of its sub-cells.
+ * Renderers use it to skip sub-trees that do not contain any rendered layer.
+ */
+
+#include <string.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
+
+/**
+ * @addtogroup GDS-Utilities
+ * @{
+ */
+
+void gds_layer_usage_init(struct gds_layer_usage *usage)
+{
+	g_return_if_fail(usage);
+
+	memset(usage->mask, 0, sizeof(usage->mask));
+	usage->high_layers = NULL;
+	usage->state = GDS_LAYER_USAGE_VALID;
+}
+
+void gds_layer_usage_clear(struct gds_layer_usage *usage)
+{
+	g_return_if_fail(usage);
+
+	if (usage->high_layers)
+		g_array_free(usage->high_layers, TRUE);
+	memset(usage->mask, 0, sizeof(usage->mask));
+	usage->high_layers = NULL;
+	usage->state = GDS_LAYER_USAGE_NOT_CALCULATED;
+}
+
+/**
+ * @brief Search a layer in the sorted high layer array
+ * @param array Sorted array of int16_t
+ * @param layer Layer to search
+ * @param[out] index Index of the layer or the position it has to be inserted at
+ * @return TRUE if found
+ */
+static gboolean high_layers_search(GArray *array, int16_t layer, guint *index)
+{
+	guint low = 0;
+	guint high = array->len;
+	guint mid;
+	int16_t val;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		val = g_array_index(array, int16_t, mid);
+		if (val == layer) {
+			*index = mid;
+			return TRUE;
+		} else if (val < layer) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	*index = low;
+	return FALSE;
+}
+
+void gds_layer_usage_add(struct gds_layer_usage *usage, int16_t layer)
+{
+	guint index;
+
+	g_return_if_fail(usage);
+
+	if (layer >= 0 && layer < GDS_LAYER_USAGE_MASK_LAYERS) {
+		usage->mask[layer / 64] |= (guint64)1 << (layer % 64);
+		return;
+	}
+
+	if (!usage->high_layers)
+		usage->high_layers = g_array_new(FALSE, FALSE, sizeof(int16_t));
+
+	if (!high_layers_search(usage->high_layers, layer, &index))
+		g_array_insert_val(usage->high_layers, index, layer);
+}
+
+gboolean gds_layer_usage_contains(const struct gds_layer_usage *usage, int16_t layer)
+{
+	guint index;
+
+	if (!usage || usage->state != GDS_LAYER_USAGE_VALID)
+		return TRUE;
+
+	if (layer >= 0 && layer < GDS_LAYER_USAGE_MASK_LAYERS)
+		return (usage->mask[layer / 64] & ((guint64)1 << (layer % 64))) ? TRUE : FALSE;
+
+	if (!usage->high_layers)
+		return FALSE;
+
+	return high_layers_search(usage->high_layers, layer, &index);
+}
+
+gboolean gds_layer_usage_intersects(const struct gds_layer_usage *usage, const struct gds_layer_usage *other)
+{
+	unsigned int i;
+	guint a = 0, b = 0;
+	int16_t val_a, val_b;
+
+	if (!usage || !other)
+		return TRUE;
+
+	if (usage->state != GDS_LAYER_USAGE_VALID || other->state != GDS_LAYER_USAGE_VALID)
+		return TRUE;
+
+	for (i = 0; i < G_N_ELEMENTS(usage->mask); i++) {
+		if (usage->mask[i] & other->mask[i])
+			return TRUE;
+	}
+
+	if (!usage->high_layers || !other->high_layers)
+		return FALSE;
+
+	/* Merge the two sorted arrays */
+	while (a < usage->high_layers->len && b < other->high_layers->len) {
+		val_a = g_array_index(usage->high_layers, int16_t, a);
+		val_b = g_array_index(other->high_layers, int16_t, b);
+		if (val_a == val_b)
+			return TRUE;
+		else if (val_a < val_b)
+			a++;
+		else
+			b++;
+	}
+
+	return FALSE;
+}
+
+gboolean gds_layer_usage_cell_uses_layers(const struct gds_cell *cell, const struct gds_layer_usage *layers)
+{
+	if (!cell)
+		return FALSE;
+
+	return gds_layer_usage_intersects(&cell->layer_usage, layers);
+}
+
+/**
+ * @brief Add all layers of \p src to \p dest
+ * @param dest Destination set
+ * @param src Source set
+ */
+static void gds_layer_usage_merge(struct gds_layer_usage *dest, const struct gds_layer_usage *src)
+{
+	unsigned int i;
+	guint idx;
+
+	for (i = 0; i < G_N_ELEMENTS(dest->mask); i++)
+		dest->mask[i] |= src->mask[i];
+
+	if (!src->high_layers)
+		return;
+
+	for (idx = 0; idx < src->high_layers->len; idx++)
+		gds_layer_usage_add(dest, g_array_index(src->high_layers, int16_t, idx));
+}
+
+/**
+ * @brief Calculate the layer usage of a cell and all of its sub-cells
+ * @param cell Cell
+ */
+static void calculate_layer_usage_cell(struct gds_cell *cell)
+{
+	GList *iter;
+	struct gds_graphics *gfx;
+	struct gds_cell_instance *inst;
+	struct gds_cell *sub_cell;
+	gboolean all_layers = FALSE;
+
+	if (cell->layer_usage.state != GDS_LAYER_USAGE_NOT_CALCULATED)
+		return;
+
+	gds_layer_usage_init(&cell->layer_usage);
+	/* Mark before descending. Sub-cells referencing this cell are part of a reference loop */
+	cell->layer_usage.state = GDS_LAYER_USAGE_IN_PROGRESS;
+
+	for (iter = cell->graphic_objs; iter; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		gds_layer_usage_add(&cell->layer_usage, gfx->layer);
+	}
+
+	for (iter = cell->child_cells; iter; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		sub_cell = inst->cell_ref;
+		if (!sub_cell)
+			continue;
+
+		calculate_layer_usage_cell(sub_cell);
+
+		if (sub_cell->layer_usage.state != GDS_LAYER_USAGE_VALID)
+			all_layers = TRUE;
+		else
+			gds_layer_usage_merge(&cell->layer_usage, &sub_cell->layer_usage);
+	}
+
+	cell->layer_usage.state = (all_layers ? GDS_LAYER_USAGE_ALL : GDS_LAYER_USAGE_VALID);
+}
+
+void gds_layer_usage_calc_in_lib(struct gds_library *lib)
+{
+	GList *cell_iter;
+
+	g_return_if_fail(lib);
+
+	for (cell_iter = lib->cells; cell_iter; cell_iter = g_list_next(cell_iter))
+		calculate_layer_usage_cell((struct gds_cell *)cell_iter->data);
+}
+
+/** @} */
@@ -44,6 +44,7 @@
 
 #include <gds-render/gds-utils/gds-parser.h>
 #include <gds-render/gds-utils/gds-statistics.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
 
 /**
  * @brief Default units assumed for library.
@@ -51,6 +52,11 @@
  */
 #define GDS_DEFAULT_UNITS (10E-9)
 
+/**
+ * @brief Count of bytes between two calls of the progress callback
+ */
+#define GDS_PROGRESS_INTERVAL_BYTES (64 * 1024)
+
 #define GDS_ERROR(fmt, ...) fprintf(stderr, "[PARSE_ERROR] " fmt "\n", ##__VA_ARGS__) /**< @brief Print GDS error*/
 #define GDS_WARN(fmt, ...) fprintf(stderr, "[PARSE_WARNING] " fmt "\n", ##__VA_ARGS__) /**< @brief Print GDS warning */
 
@@ -284,6 +290,7 @@ static GList *append_library(GList *curr_list, const struct gds_library_parsing_
 		lib->stats.gfx_count = 0;
 		lib->stats.reference_count = 0;
 		lib->stats.vertex_count = 0;
+		lib->layer_inventory = NULL;
 	} else {
 		return NULL;
 	}
@@ -313,6 +320,7 @@ static __attribute__((warn_unused_result)) GList *prepend_graphics(GList *curr_l
 		gfx->width_absolute = 0;
 		gfx->gfx_type = type;
 		gfx->path_render_type = PATH_FLUSH;
+		gfx->rectangle = 0;
 	} else
 		return NULL;
 
@@ -367,6 +375,8 @@ static GList *append_cell(GList *curr_list, struct gds_cell **cell_ptr)
 		cell->stats.total_gfx_count = 0;
 		cell->stats.gfx_count = 0;
 		cell->stats.vertex_count = 0;
+		cell->layer_usage.high_layers = NULL;
+		gds_layer_usage_clear(&cell->layer_usage);
 	} else
 		return NULL;
 	/* return cell */
@@ -573,6 +583,56 @@ static void simplify_graphics(gpointer graphics, gpointer user_data)
 	}
 }
 
+/**
+ * @brief Detect axis-aligned rectangles
+ *
+ * Sets gds_graphics::rectangle for polygons and boxes consisting of four vertices (plus an optional closing vertex)
+ * whose edges are alternating horizontal and vertical. Renderers can draw these as rectangles.
+ *
+ * @param graphics gfx struct
+ * @param user_data unused
+ */
+static void detect_rectangle(gpointer graphics, gpointer user_data)
+{
+	struct gds_graphics *gfx = (struct gds_graphics *)graphics;
+	const struct gds_point *pts[5];
+	GList *vertex_iter;
+	unsigned int count = 0;
+	unsigned int i;
+	gboolean horizontal;
+	(void)user_data;
+
+	gfx->rectangle = 0;
+	if (gfx->gfx_type != GRAPHIC_POLYGON && gfx->gfx_type != GRAPHIC_BOX)
+		return;
+
+	for (vertex_iter = gfx->vertices; vertex_iter; vertex_iter = g_list_next(vertex_iter)) {
+		if (count == 5)
+			return;
+		pts[count++] = (const struct gds_point *)vertex_iter->data;
+	}
+
+	/* Ignore the closing vertex */
+	if (count == 5 && pts[4]->x == pts[0]->x && pts[4]->y == pts[0]->y)
+		count = 4;
+	if (count != 4)
+		return;
+
+	horizontal = (pts[0]->y == pts[1]->y);
+	for (i = 0; i < 4; i++) {
+		if (horizontal) {
+			if (pts[i]->y != pts[(i + 1) % 4]->y || pts[i]->x == pts[(i + 1) % 4]->x)
+				return;
+		} else {
+			if (pts[i]->x != pts[(i + 1) % 4]->x || pts[i]->y == pts[(i + 1) % 4]->y)
+				return;
+		}
+		horizontal = !horizontal;
+	}
+
+	gfx->rectangle = 1;
+}
+
 /**
  * @brief Scans cell and resolves references and simplifies polygons
  * This function searches all the references in \p gcell and updates the gds_cell_instance::cell_ref field in each instance
@@ -598,6 +658,9 @@ static void scan_cell_references_and_polygons(gpointer gcell, gpointer library)
 	if (simplify_polygons) {
 		g_list_foreach(cell->graphic_objs, simplify_graphics, library);
 	}
+
+	GDS_INF("\t\tDetecting rectangles\n");
+	g_list_foreach(cell->graphic_objs, detect_rectangle, NULL);
 }
 
 /**
@@ -616,6 +679,66 @@ static void scan_library_references(gpointer library_list_item, gpointer user)
 	g_list_foreach(lib->cells, scan_cell_references_and_polygons, lib);
 }
 
+/**
+ * @brief Key of a layer / datatype combination in the layer inventory hash table
+ */
+#define LAYER_INVENTORY_KEY(layer, datatype) \
+	GUINT_TO_POINTER(((guint)(guint16)(layer) << 16) | (guint)(guint16)(datatype))
+
+/**
+ * @brief Count a graphics object in the layer inventory of the current library
+ * @param inventory Hash table mapping the layer / datatype key to a #gds_layer_count
+ * @param gfx Finished graphics object
+ */
+static void layer_inventory_count(GHashTable *inventory, const struct gds_graphics *gfx)
+{
+	struct gds_layer_count *count;
+	gpointer key;
+
+	key = LAYER_INVENTORY_KEY(gfx->layer, gfx->datatype);
+	count = (struct gds_layer_count *)g_hash_table_lookup(inventory, key);
+	if (!count) {
+		count = g_new0(struct gds_layer_count, 1);
+		count->layer = gfx->layer;
+		count->datatype = gfx->datatype;
+		g_hash_table_insert(inventory, key, count);
+	}
+
+	count->gfx_count++;
+}
+
+static gint layer_inventory_compare(gconstpointer a, gconstpointer b)
+{
+	const struct gds_layer_count *count_a = (const struct gds_layer_count *)a;
+	const struct gds_layer_count *count_b = (const struct gds_layer_count *)b;
+
+	if (count_a->layer != count_b->layer)
+		return (int)count_a->layer - (int)count_b->layer;
+
+	return (int)count_a->datatype - (int)count_b->datatype;
+}
+
+/**
+ * @brief Convert the layer inventory collected while parsing into the sorted array stored in the library
+ * @param inventory Hash table mapping the layer / datatype key to a #gds_layer_count
+ * @return Array of #gds_layer_count sorted by layer and datatype
+ */
+static GArray *layer_inventory_finish(GHashTable *inventory)
+{
+	GArray *array;
+	GHashTableIter iter;
+	gpointer value;
+
+	array = g_array_sized_new(FALSE, FALSE, sizeof(struct gds_layer_count), g_hash_table_size(inventory));
+	g_hash_table_iter_init(&iter, inventory);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_array_append_vals(array, value, 1);
+
+	g_array_sort(array, layer_inventory_compare);
+
+	return array;
+}
+
 static void calc_library_stats(gpointer library_list_item, gpointer user)
 {
 	struct gds_library *lib = (struct gds_library *)library_list_item;
@@ -623,6 +746,7 @@ static void calc_library_stats(gpointer library_list_item, gpointer user)
 
 	GDS_INF("Calculating stats for Library: %s\n", lib->name);
 	gds_statistics_calc_cummulative_counts_in_lib(lib);
+	gds_layer_usage_calc_in_lib(lib);
 }
 
 /**
@@ -725,6 +849,13 @@ static void convert_aref_to_sref(struct gds_cell_array_instance *aref, struct gd
 
 int parse_gds_from_file(const char *filename, GList **library_list,
 			const struct gds_library_parsing_opts *parsing_options)
+{
+	return parse_gds_from_file_with_callbacks(filename, library_list, parsing_options, NULL);
+}
+
+int parse_gds_from_file_with_callbacks(const char *filename, GList **library_list,
+				       const struct gds_library_parsing_opts *parsing_options,
+				       const struct gds_parsing_callbacks *callbacks)
 {
 	char *workbuff;
 	int read;
@@ -739,7 +870,12 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 	struct gds_cell_instance *current_s_reference = NULL;
 	struct gds_cell_array_instance *current_a_reference = NULL;
 	struct gds_cell_array_instance temp_a_reference;
+	GHashTable *layer_inventory = NULL;
 	int x, y;
+	goffset file_size = 0;
+	goffset bytes_read = 0;
+	goffset next_progress = 0;
+	gboolean libs_finished_early;
 	////////////
 	GList *lib_list;
 
@@ -755,9 +891,19 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 	gds_file = fopen(filename, "rb");
 	if (gds_file == NULL) {
 		GDS_ERROR("Could not open File %s", filename);
+		free(workbuff);
 		return -1;
 	}
 
+	/* Libraries handed out by the callback are already post-processed */
+	libs_finished_early = (callbacks && callbacks->library_finished) ? TRUE : FALSE;
+
+	if (callbacks && callbacks->progress) {
+		if (!fseek(gds_file, 0, SEEK_END))
+			file_size = (goffset)ftell(gds_file);
+		rewind(gds_file);
+	}
+
 	/* Record parser */
 	while (run == 1) {
 		rec_type = INVALID;
@@ -792,6 +938,15 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 		}
 		rec_data_length -= 4;
 
+		bytes_read += 4 + rec_data_length;
+		if (callbacks && callbacks->progress && bytes_read >= next_progress) {
+			next_progress = bytes_read + GDS_PROGRESS_INTERVAL_BYTES;
+			if (!callbacks->progress(bytes_read, file_size, callbacks->user_data)) {
+				run = GDS_PARSER_CANCELLED;
+				break;
+			}
+		}
+
 		read = fread(workbuff, sizeof(char), 2, gds_file);
 		if (read != 2) {
 			run = -2;
@@ -811,6 +966,10 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 				break;
 
 			}
+			if (layer_inventory)
+				g_hash_table_remove_all(layer_inventory);
+			else
+				layer_inventory = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
 			GDS_INF("Entering Lib\n");
 			break;
 		case ENDLIB:
@@ -826,6 +985,15 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 				GDS_ERROR("Closing Library with opened cells");
 				break;
 			}
+
+			current_lib->layer_inventory = layer_inventory_finish(layer_inventory);
+
+			if (libs_finished_early) {
+				scan_library_references(current_lib, NULL);
+				calc_library_stats(current_lib, NULL);
+				callbacks->library_finished(current_lib, callbacks->user_data);
+			}
+
 			current_lib = NULL;
 			GDS_INF("Leaving Library\n");
 			break;
@@ -917,10 +1085,11 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 				GDS_INF("\tLeaving %s\n", (current_graphics->gfx_type == GRAPHIC_POLYGON ? "boundary"
 							: (current_graphics->gfx_type == GRAPHIC_PATH ? "path"
 							: "box")));
-				current_graphics = NULL;
 				if (current_cell) {
 					current_cell->stats.gfx_count++;
+					layer_inventory_count(layer_inventory, current_graphics);
 				}
+				current_graphics = NULL;
 			}
 			if (current_s_reference != NULL) {
 				GDS_INF("\tLeaving Reference\n");
@@ -1185,7 +1354,10 @@ int parse_gds_from_file(const char *filename, GList **library_list,
 
 	fclose(gds_file);
 
-	if (!run) {
+	if (layer_inventory)
+		g_hash_table_destroy(layer_inventory);
+
+	if (!run && !libs_finished_early) {
 		/* Iterate and find references to cells */
 		g_list_foreach(lib_list, scan_library_references, NULL);
 
@@ -1246,6 +1418,7 @@ static void delete_cell_element(struct gds_cell *cell)
 
 	g_list_free_full(cell->child_cells, (GDestroyNotify)delete_cell_inst_element);
 	g_list_free_full(cell->graphic_objs, (GDestroyNotify)delete_graphics_obj);
+	gds_layer_usage_clear(&cell->layer_usage);
 	free(cell);
 }
 
@@ -1260,6 +1433,8 @@ static void delete_library_element(struct gds_library *lib)
 
 	g_list_free(lib->cell_names);
 	g_list_free_full(lib->cells, (GDestroyNotify)delete_cell_element);
+	if (lib->layer_inventory)
+		g_array_free(lib->layer_inventory, TRUE);
 	free(lib);
 }
 
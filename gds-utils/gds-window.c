@@ -0,0 +1,479 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file gds-window.c
+ * @brief Restrict a cell hierarchy to a clip window
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * The window is transformed into the coordinate system of every visited cell, where it becomes
+ * a convex quadrilateral. The cached hierarchical bounding boxes decide if a cell instance is
+ * skipped, referenced as it is, or copied and clipped.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <gds-render/gds-utils/gds-window.h>
+#include <gds-render/geometric/cell-geometrics.h>
+
+/**
+ * @addtogroup GDS-Utilities
+ * @{
+ */
+
+struct gds_window {
+	GHashTable *boxes; /**< @brief Bounding box cache. See calculate_cell_bounding_box_cached() */
+	GHashTable *active; /**< @brief Set of cells currently being clipped. Used to break reference loops */
+	struct gds_cell *cell; /**< @brief Clipped top cell */
+	GList *cells; /**< @brief Copied cells */
+	GList *instances; /**< @brief Copied cell instances */
+	GList *graphics; /**< @brief Clipped graphics objects */
+};
+
+/**
+ * @brief Clip window in the coordinate system of a cell
+ */
+struct gds_window_clip {
+	struct vector_2d points[4]; /**< @brief Corners of the convex quadrilateral */
+	double orientation; /**< @brief 1 if the corners are counter clockwise, -1 otherwise */
+	union bounding_box box; /**< @brief Axis aligned bounding box of the corners */
+};
+
+/**
+ * @brief Calculate the orientation and bounding box of a clip window from its corners
+ * @param clip Clip window with valid gds_window_clip::points
+ */
+static void gds_window_clip_init(struct gds_window_clip *clip)
+{
+	double area = 0.0;
+	int i;
+
+	bounding_box_prepare_empty(&clip->box);
+	for (i = 0; i < 4; i++) {
+		area += clip->points[i].x * clip->points[(i + 1) % 4].y - clip->points[(i + 1) % 4].x * clip->points[i].y;
+		bounding_box_update_with_point(&clip->box, NULL, &clip->points[i]);
+	}
+
+	clip->orientation = (area < 0.0 ? -1.0 : 1.0);
+}
+
+/**
+ * @brief Signed distance measure of a point to an edge of the clip window
+ * @param clip Clip window
+ * @param edge Edge index. The edge starts at gds_window_clip::points[edge]
+ * @param x x coordinate
+ * @param y y coordinate
+ * @return Value >= 0 if the point is on the inner side of the edge
+ */
+static double gds_window_clip_side(const struct gds_window_clip *clip, int edge, double x, double y)
+{
+	const struct vector_2d *a = &clip->points[edge];
+	const struct vector_2d *b = &clip->points[(edge + 1) % 4];
+
+	return clip->orientation * ((b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x));
+}
+
+/**
+ * @brief Check if a point is inside the clip window
+ * @param clip Clip window
+ * @param x x coordinate
+ * @param y y coordinate
+ * @return TRUE if the point is inside or on the border
+ */
+static gboolean gds_window_clip_contains(const struct gds_window_clip *clip, double x, double y)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		if (gds_window_clip_side(clip, i, x, y) < 0.0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * @brief Check if a box is completely inside the clip window
+ * @param clip Clip window
+ * @param box Box
+ * @return TRUE if all corners of \p box are inside
+ */
+static gboolean gds_window_box_inside(const struct gds_window_clip *clip, const union bounding_box *box)
+{
+	return gds_window_clip_contains(clip, box->vectors.lower_left.x, box->vectors.lower_left.y) &&
+	       gds_window_clip_contains(clip, box->vectors.lower_left.x, box->vectors.upper_right.y) &&
+	       gds_window_clip_contains(clip, box->vectors.upper_right.x, box->vectors.lower_left.y) &&
+	       gds_window_clip_contains(clip, box->vectors.upper_right.x, box->vectors.upper_right.y);
+}
+
+/**
+ * @brief Check if a box is completely outside the bounding box of the clip window
+ * @param clip Clip window
+ * @param box Box
+ * @return TRUE if \p box can be skipped
+ */
+static gboolean gds_window_box_outside(const struct gds_window_clip *clip, const union bounding_box *box)
+{
+	return bounding_box_is_empty(box) ||
+	       box->vectors.upper_right.x < clip->box.vectors.lower_left.x ||
+	       box->vectors.upper_right.y < clip->box.vectors.lower_left.y ||
+	       box->vectors.lower_left.x > clip->box.vectors.upper_right.x ||
+	       box->vectors.lower_left.y > clip->box.vectors.upper_right.y;
+}
+
+/**
+ * @brief Transform a clip window into the coordinate system of an instantiated cell
+ * @param parent Clip window in the coordinate system of the instantiating cell
+ * @param inst Cell instance
+ * @param[out] child Clip window in the coordinate system of the instantiated cell
+ */
+static void gds_window_clip_transform(const struct gds_window_clip *parent, const struct gds_cell_instance *inst,
+				      struct gds_window_clip *child)
+{
+	double cos_a = cos(-inst->angle * M_PI / 180.0);
+	double sin_a = sin(-inst->angle * M_PI / 180.0);
+	double x, y;
+	int i;
+
+	/* Inverse of: mirror at x axis, scale, rotate, translate */
+	for (i = 0; i < 4; i++) {
+		x = parent->points[i].x - inst->origin.x;
+		y = parent->points[i].y - inst->origin.y;
+		child->points[i].x = (cos_a * x - sin_a * y) / inst->magnification;
+		child->points[i].y = (sin_a * x + cos_a * y) / inst->magnification;
+		if (inst->flipped)
+			child->points[i].y = -child->points[i].y;
+	}
+
+	gds_window_clip_init(child);
+}
+
+/**
+ * @brief Calculate the bounding box of a graphics object. Paths are padded by their width
+ * @param gfx Graphics object
+ * @param[out] box Bounding box
+ */
+static void gds_window_gfx_box(const struct gds_graphics *gfx, union bounding_box *box)
+{
+	GList *vertex_list;
+	const struct gds_point *pt;
+	double pad = (gfx->gfx_type == GRAPHIC_PATH ? ABS(gfx->width_absolute) : 0.0);
+	struct vector_2d point;
+
+	bounding_box_prepare_empty(box);
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		pt = (const struct gds_point *)vertex_list->data;
+		point.x = pt->x - pad;
+		point.y = pt->y - pad;
+		bounding_box_update_with_point(box, NULL, &point);
+		point.x = pt->x + pad;
+		point.y = pt->y + pad;
+		bounding_box_update_with_point(box, NULL, &point);
+	}
+}
+
+/**
+ * @brief Clip a polygon or box at the clip window (Sutherland-Hodgman)
+ * @param window Window. Owns the new object
+ * @param clip Clip window in the coordinate system of the polygon
+ * @param gfx Polygon or box
+ * @return Clipped polygon. NULL if nothing remains
+ */
+static struct gds_graphics *gds_window_clip_polygon(struct gds_window *window, const struct gds_window_clip *clip,
+						    const struct gds_graphics *gfx)
+{
+	GArray *input;
+	GArray *output;
+	GArray *temp;
+	GList *vertex_list;
+	GList *vertices = NULL;
+	const struct gds_point *pt;
+	struct gds_point *new_pt;
+	struct gds_point last = {0, 0};
+	struct gds_graphics *clipped = NULL;
+	struct vector_2d current, previous, cut;
+	double side_current, side_previous;
+	guint count = 0;
+	guint i;
+	int edge;
+
+	input = g_array_new(FALSE, FALSE, sizeof(struct vector_2d));
+	output = g_array_new(FALSE, FALSE, sizeof(struct vector_2d));
+
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		pt = (const struct gds_point *)vertex_list->data;
+		current.x = pt->x;
+		current.y = pt->y;
+		g_array_append_val(input, current);
+	}
+
+	for (edge = 0; edge < 4 && input->len; edge++) {
+		g_array_set_size(output, 0);
+		previous = g_array_index(input, struct vector_2d, input->len - 1);
+		side_previous = gds_window_clip_side(clip, edge, previous.x, previous.y);
+
+		for (i = 0; i < input->len; i++) {
+			current = g_array_index(input, struct vector_2d, i);
+			side_current = gds_window_clip_side(clip, edge, current.x, current.y);
+
+			if ((side_current >= 0.0) != (side_previous >= 0.0)) {
+				cut.x = previous.x + (current.x - previous.x) * side_previous / (side_previous - side_current);
+				cut.y = previous.y + (current.y - previous.y) * side_previous / (side_previous - side_current);
+				g_array_append_val(output, cut);
+			}
+			if (side_current >= 0.0)
+				g_array_append_val(output, current);
+
+			previous = current;
+			side_previous = side_current;
+		}
+
+		temp = input;
+		input = output;
+		output = temp;
+	}
+
+	/* Round to database units and drop repeated vertices */
+	for (i = 0; i < input->len; i++) {
+		current = g_array_index(input, struct vector_2d, i);
+		new_pt = g_new(struct gds_point, 1);
+		new_pt->x = (int)lround(current.x);
+		new_pt->y = (int)lround(current.y);
+		if (count && new_pt->x == last.x && new_pt->y == last.y) {
+			g_free(new_pt);
+			continue;
+		}
+		last = *new_pt;
+		vertices = g_list_prepend(vertices, new_pt);
+		count++;
+	}
+	vertices = g_list_reverse(vertices);
+
+	if (count >= 3) {
+		clipped = g_new(struct gds_graphics, 1);
+		*clipped = *gfx;
+		clipped->vertices = vertices;
+		clipped->rectangle = 0;
+		window->graphics = g_list_prepend(window->graphics, clipped);
+	} else {
+		g_list_free_full(vertices, g_free);
+	}
+
+	g_array_free(input, TRUE);
+	g_array_free(output, TRUE);
+
+	return clipped;
+}
+
+/**
+ * @brief Restrict a cell to a clip window
+ * @param window Window. Owns the copied objects
+ * @param cell Cell
+ * @param clip Clip window in the coordinate system of \p cell
+ * @return \p cell if it is completely inside, NULL if nothing of it is inside, else a clipped copy
+ */
+static struct gds_cell *gds_window_clip_cell(struct gds_window *window, struct gds_cell *cell,
+					     const struct gds_window_clip *clip)
+{
+	const union bounding_box *cell_box;
+	union bounding_box gfx_box;
+	struct gds_cell *copy;
+	struct gds_cell *child;
+	struct gds_cell_instance *inst;
+	struct gds_cell_instance *new_inst;
+	struct gds_graphics *gfx;
+	struct gds_graphics *clipped;
+	struct gds_window_clip child_clip;
+	GList *iter;
+
+	cell_box = calculate_cell_bounding_box_cached(window->boxes, cell);
+	if (gds_window_box_outside(clip, cell_box))
+		return NULL;
+
+	if (gds_window_box_inside(clip, cell_box))
+		return cell;
+
+	/* Reference loop */
+	if (g_hash_table_contains(window->active, cell))
+		return NULL;
+	g_hash_table_add(window->active, cell);
+
+	copy = g_new(struct gds_cell, 1);
+	*copy = *cell;
+	copy->child_cells = NULL;
+	copy->graphic_objs = NULL;
+	window->cells = g_list_prepend(window->cells, copy);
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		gds_window_gfx_box(gfx, &gfx_box);
+		if (gds_window_box_outside(clip, &gfx_box))
+			continue;
+
+		if (gfx->gfx_type == GRAPHIC_PATH || gds_window_box_inside(clip, &gfx_box)) {
+			copy->graphic_objs = g_list_prepend(copy->graphic_objs, gfx);
+			continue;
+		}
+
+		clipped = gds_window_clip_polygon(window, clip, gfx);
+		if (clipped)
+			copy->graphic_objs = g_list_prepend(copy->graphic_objs, clipped);
+	}
+
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		if (!inst->cell_ref || inst->magnification == 0.0)
+			continue;
+
+		gds_window_clip_transform(clip, inst, &child_clip);
+		child = gds_window_clip_cell(window, inst->cell_ref, &child_clip);
+		if (!child)
+			continue;
+
+		if (child == inst->cell_ref) {
+			copy->child_cells = g_list_prepend(copy->child_cells, inst);
+		} else {
+			new_inst = g_new(struct gds_cell_instance, 1);
+			*new_inst = *inst;
+			new_inst->cell_ref = child;
+			window->instances = g_list_prepend(window->instances, new_inst);
+			copy->child_cells = g_list_prepend(copy->child_cells, new_inst);
+		}
+	}
+
+	copy->graphic_objs = g_list_reverse(copy->graphic_objs);
+	copy->child_cells = g_list_reverse(copy->child_cells);
+	g_hash_table_remove(window->active, cell);
+
+	if (!copy->graphic_objs && !copy->child_cells)
+		return NULL;
+
+	return copy;
+}
+
+struct gds_window *gds_window_new(struct gds_cell *cell, const union bounding_box *window_box)
+{
+	struct gds_window *window;
+	struct gds_window_clip clip;
+	struct gds_cell *empty;
+
+	g_return_val_if_fail(cell != NULL, NULL);
+	g_return_val_if_fail(window_box != NULL, NULL);
+
+	window = g_new0(struct gds_window, 1);
+	window->boxes = cell_bounding_box_cache_new();
+	window->active = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	bounding_box_get_all_points(clip.points, (union bounding_box *)window_box);
+	gds_window_clip_init(&clip);
+
+	window->cell = gds_window_clip_cell(window, cell, &clip);
+	if (!window->cell) {
+		/* Nothing inside. Render an empty cell */
+		empty = g_new(struct gds_cell, 1);
+		*empty = *cell;
+		empty->child_cells = NULL;
+		empty->graphic_objs = NULL;
+		window->cells = g_list_prepend(window->cells, empty);
+		window->cell = empty;
+	}
+
+	return window;
+}
+
+struct gds_cell *gds_window_get_cell(struct gds_window *window)
+{
+	g_return_val_if_fail(window != NULL, NULL);
+
+	return window->cell;
+}
+
+/**
+ * @brief Free a copied cell. The referenced objects are freed separately
+ * @param data Cell
+ */
+static void gds_window_free_cell(gpointer data)
+{
+	struct gds_cell *cell = (struct gds_cell *)data;
+
+	g_list_free(cell->child_cells);
+	g_list_free(cell->graphic_objs);
+	g_free(cell);
+}
+
+/**
+ * @brief Free a clipped graphics object
+ * @param data Graphics object
+ */
+static void gds_window_free_gfx(gpointer data)
+{
+	struct gds_graphics *gfx = (struct gds_graphics *)data;
+
+	g_list_free_full(gfx->vertices, g_free);
+	g_free(gfx);
+}
+
+void gds_window_free(struct gds_window *window)
+{
+	if (!window)
+		return;
+
+	g_list_free_full(window->cells, gds_window_free_cell);
+	g_list_free_full(window->instances, g_free);
+	g_list_free_full(window->graphics, gds_window_free_gfx);
+	g_hash_table_destroy(window->boxes);
+	g_hash_table_destroy(window->active);
+	g_free(window);
+}
+
+gboolean gds_window_parse(const char *string, union bounding_box *window)
+{
+	gchar **parts;
+	gchar *end;
+	double values[4];
+	gboolean ret = FALSE;
+	int i;
+
+	if (!string || !window)
+		return FALSE;
+
+	parts = g_strsplit(string, ",", -1);
+	if (g_strv_length(parts) != 4)
+		goto ret_free;
+
+	for (i = 0; i < 4; i++) {
+		values[i] = g_ascii_strtod(parts[i], &end);
+		if (end == parts[i] || *end != '\0')
+			goto ret_free;
+	}
+
+	window->vectors.lower_left.x = MIN(values[0], values[2]);
+	window->vectors.lower_left.y = MIN(values[1], values[3]);
+	window->vectors.upper_right.x = MAX(values[0], values[2]);
+	window->vectors.upper_right.y = MAX(values[1], values[3]);
+
+	ret = (window->vectors.lower_left.x < window->vectors.upper_right.x &&
+	       window->vectors.lower_left.y < window->vectors.upper_right.y);
+
+ret_free:
+	g_strfreev(parts);
+	return ret;
+}
+
+/** @} */
@@ -91,6 +91,12 @@ void bounding_box_prepare_empty(union bounding_box *box)
 	box->vectors.upper_right.y = -DBL_MAX;
 }
 
+bool bounding_box_is_empty(const union bounding_box *box)
+{
+	return box->vectors.lower_left.x > box->vectors.upper_right.x ||
+	       box->vectors.lower_left.y > box->vectors.upper_right.y;
+}
+
 /**
  * @brief Calculate path miter points for a pathwith a \p width and the anchors \p a \p b \p c.
  * @param[in] a
@@ -117,4 +117,53 @@ void calculate_cell_bounding_box(union bounding_box *box, struct gds_cell *cell)
 	}
 }
 
+GHashTable *cell_bounding_box_cache_new(void)
+{
+	return g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+}
+
+const union bounding_box *calculate_cell_bounding_box_cached(GHashTable *cache, struct gds_cell *cell)
+{
+	union bounding_box *box;
+	const union bounding_box *sub_box;
+	union bounding_box temp_box;
+	GList *gfx_list;
+	GList *sub_cell_list;
+	struct gds_cell_instance *sub_cell;
+
+	box = (union bounding_box *)g_hash_table_lookup(cache, cell);
+	if (box)
+		return box;
+
+	/* Insert the box before descending. A reference loop ends here with an incomplete box */
+	box = g_new(union bounding_box, 1);
+	bounding_box_prepare_empty(box);
+	g_hash_table_insert(cache, cell, box);
+
+	for (gfx_list = cell->graphic_objs; gfx_list != NULL; gfx_list = gfx_list->next)
+		update_box_with_gfx(box, (struct gds_graphics *)gfx_list->data);
+
+	for (sub_cell_list = cell->child_cells; sub_cell_list != NULL; sub_cell_list = sub_cell_list->next) {
+		sub_cell = (struct gds_cell_instance *)sub_cell_list->data;
+		if (!sub_cell->cell_ref)
+			continue;
+
+		sub_box = calculate_cell_bounding_box_cached(cache, sub_cell->cell_ref);
+		if (bounding_box_is_empty(sub_box))
+			continue;
+
+		temp_box = *sub_box;
+		bounding_box_apply_transform(ABS(sub_cell->magnification), sub_cell->angle,
+					     sub_cell->flipped, &temp_box);
+		temp_box.vectors.lower_left.x += sub_cell->origin.x;
+		temp_box.vectors.upper_right.x += sub_cell->origin.x;
+		temp_box.vectors.lower_left.y += sub_cell->origin.y;
+		temp_box.vectors.upper_right.y += sub_cell->origin.y;
+
+		bounding_box_update_with_box(box, &temp_box);
+	}
+
+	return box;
+}
+
 /** @} */
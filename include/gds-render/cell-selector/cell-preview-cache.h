@@ -0,0 +1,90 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file cell-preview-cache.h
+ * @brief Header file for the CellPreviewCache GObject Class
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup CellPreviewCache
+ * @{
+ */
+
+#ifndef __CELL_PREVIEW_CACHE_H__
+#define __CELL_PREVIEW_CACHE_H__
+
+#include <glib-object.h>
+#include <cairo.h>
+#include <gds-render/gds-utils/gds-types.h>
+#include <gds-render/layer/layer-settings.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(CellPreviewCache, cell_preview_cache, CELL_PREVIEW, CACHE, GObject)
+#define TYPE_CELL_PREVIEW_CACHE (cell_preview_cache_get_type())
+
+/**
+ * @brief Create a new preview cache
+ * @param size Width and height of the previews in pixels
+ * @return New object
+ */
+CellPreviewCache *cell_preview_cache_new(unsigned int size);
+
+/**
+ * @brief Set the layers and colors used for the previews
+ *
+ * No previews are rendered until the layer settings are set.
+ *
+ * @param cache Preview cache
+ * @param settings Layer settings. The cache takes its own reference. The settings must not be modified afterwards
+ */
+void cell_preview_cache_set_layer_settings(CellPreviewCache *cache, LayerSettings *settings);
+
+/**
+ * @brief Get the preview of a cell
+ *
+ * If the preview is not available yet and \p render is set, it is rendered in the background.
+ * The "preview-ready" signal is emitted once it is available.
+ *
+ * @param cache Preview cache
+ * @param cell Cell
+ * @param render Render the preview if it is not available
+ * @return Preview surface owned by the cache or NULL if not available yet.
+ *	   Only valid until the main loop is entered again
+ */
+cairo_surface_t *cell_preview_cache_lookup(CellPreviewCache *cache, struct gds_cell *cell, gboolean render);
+
+/**
+ * @brief Forget all cells
+ *
+ * Pending renderings are cancelled. This function waits until no background rendering accesses any cell.
+ * It has to be called before the libraries of the looked up cells are freed.
+ * Rendered previews stay in the memory and disk cache. They are found again for cells with identical contents.
+ *
+ * @param cache Preview cache
+ */
+void cell_preview_cache_clear(CellPreviewCache *cache);
+
+G_END_DECLS
+
+#endif /* __CELL_PREVIEW_CACHE_H__ */
+
+/** @} */
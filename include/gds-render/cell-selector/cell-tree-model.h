@@ -0,0 +1,108 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file cell-tree-model.h
+ * @brief Header file for the CellTreeModel GObject Class
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup CellTreeModel
+ * @{
+ */
+
+#ifndef __CELL_TREE_MODEL_H__
+#define __CELL_TREE_MODEL_H__
+
+#include <gtk/gtk.h>
+#include <gds-render/gds-utils/gds-types.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(CellTreeModel, cell_tree_model, CELL_TREE, MODEL, GObject)
+#define TYPE_CELL_TREE_MODEL (cell_tree_model_get_type())
+
+/** @brief Columns of the cell tree model */
+enum cell_tree_model_columns {
+	CELL_SEL_LIBRARY = 0, /**< @brief Library of the row. G_TYPE_POINTER to @ref gds_library */
+	CELL_SEL_CELL, /**< @brief Cell of the row. NULL for library rows. G_TYPE_POINTER to @ref gds_cell */
+	CELL_SEL_CELL_ERROR_STATE, /**< @brief Used for cell color and selectability. G_TYPE_UINT */
+	CELL_SEL_STAT, /**< @brief Cell statistics. G_TYPE_POINTER to @ref gds_cell_statistics */
+	CELL_SEL_COLUMN_COUNT /**< @brief Not a column. Used to determine count of columns */
+};
+
+/**
+ * @brief Create a new empty cell tree model
+ * @return New model
+ */
+CellTreeModel *cell_tree_model_new(void);
+
+/**
+ * @brief Append a library and its cells to the model
+ *
+ * The cells are not copied. The library must not be modified or freed until it is removed
+ * by cell_tree_model_clear().
+ *
+ * @param model Model
+ * @param lib Library to add
+ */
+void cell_tree_model_add_library(CellTreeModel *model, struct gds_library *lib);
+
+/**
+ * @brief Update the error states of all cells of \p lib after the library has been checked
+ *
+ * The error state is taken from the gds_cell::checks fields of the cells.
+ *
+ * @param model Model
+ * @param lib Library that has been added with cell_tree_model_add_library() before
+ */
+void cell_tree_model_set_library_checked(CellTreeModel *model, struct gds_library *lib);
+
+/**
+ * @brief Remove all libraries from the model
+ * @param model Model
+ */
+void cell_tree_model_clear(CellTreeModel *model);
+
+/**
+ * @brief Only show cells, whose name contains \p search
+ *
+ * Library rows are always shown.
+ * Changing the filter invalidates all iters of the model. Detach the model from its views before
+ * calling this function and attach it afterwards.
+ *
+ * @param model Model
+ * @param search Substring to search for. NULL or an empty string shows all cells
+ */
+void cell_tree_model_set_filter(CellTreeModel *model, const char *search);
+
+/**
+ * @brief Get the path of the row showing \p cell
+ * @param model Model
+ * @param cell Cell
+ * @return New path or NULL if the cell is not part of the model or hidden by the filter
+ */
+GtkTreePath *cell_tree_model_get_cell_path(CellTreeModel *model, const struct gds_cell *cell);
+
+G_END_DECLS
+
+#endif /* __CELL_TREE_MODEL_H__ */
+
+/** @} */
@@ -33,6 +33,10 @@
 
 #include <glib.h>
 
+#include <gds-render/output-renderers/gds-output-renderer.h>
+#include <gds-render/layer/layer-settings.h>
+#include <gds-render/geometric/bounding-box.h>
+
 /**
  * @brief External renderer paramameters to command line renderer
  */
@@ -48,28 +52,157 @@ struct external_renderer_params {
 	char *cli_params;
 };
 
+/**
+ * @brief Options of the renderers created from the command line
+ */
+struct command_line_render_options {
+	/**
+	 * @brief Settings for external library renderer. May be NULL
+	 */
+	const struct external_renderer_params *ext_params;
+
+	/**
+	 * @brief Standalone TeX
+	 */
+	gboolean tex_standalone;
+
+	/**
+	 * @brief TeX OCR layers
+	 */
+	gboolean tex_layers;
+
+	/**
+	 * @brief Isolate the Cairo renderer in a forked child process
+	 */
+	gboolean cairo_fork;
+
+	/**
+	 * @brief Stroke the polygons of the Cairo renderer with a hairline
+	 */
+	gboolean cairo_hairline;
+
+	/**
+	 * @brief Fill all polygons of a cell on a layer at once in the Cairo renderer
+	 */
+	gboolean cairo_batch;
+
+	/**
+	 * @brief Flate compress the content streams of the native PDF renderer
+	 */
+	gboolean pdf_compress;
+
+	/**
+	 * @brief Create an optional content group for every layer in the native PDF renderer
+	 */
+	gboolean pdf_layers;
+
+	/**
+	 * @brief Render existing tiles of the tile pyramid renderer again
+	 */
+	gboolean tiles_overwrite;
+
+	/**
+	 * @brief Restrict the output to command_line_render_options::window
+	 */
+	gboolean window_set;
+
+	/**
+	 * @brief Window in database units. Only valid if command_line_render_options::window_set is TRUE
+	 */
+	union bounding_box window;
+};
+
+/**
+ * @brief Create an output renderer from its command line id
+ * @param renderer_id Renderer id: `pdf`, `pdf-native`, `svg`, `svg-native`, `png`, `tiles`, `tikz` or `ext`
+ * @param output_file Output file of the renderer
+ * @param options Renderer options
+ * @param layer_settings Layer settings of the renderer
+ * @return New renderer or NULL if the id is invalid or the renderer cannot be created
+ */
+GdsOutputRenderer *command_line_create_renderer(const char *renderer_id,
+					       const char *output_file,
+					       const struct command_line_render_options *options,
+					       LayerSettings *layer_settings);
+
+/**
+ * @brief Selection of the cells to render from a single GDS file
+ *
+ * All criteria are combined. A cell matching multiple criteria is only rendered once.
+ */
+struct command_line_cell_selection {
+	/**
+	 * @brief NULL terminated array of exact cell names. May be NULL
+	 */
+	char **cell_names;
+
+	/**
+	 * @brief NULL terminated array of glob patterns (e.g. `MACRO_*`). May be NULL
+	 */
+	char **cell_globs;
+
+	/**
+	 * @brief Regular expression matched against the cell names. May be NULL
+	 */
+	const char *cell_regex;
+
+	/**
+	 * @brief Select all cells that are not referenced by any other cell
+	 */
+	gboolean all_top_cells;
+};
+
 /**
  * @brief Convert GDS according to command line parameters
+ *
+ * The GDS file is parsed once. All selected cells are rendered
+ * with all given renderers on a pool of \p jobs worker threads.
+ *
+ * If more than one cell is selected, each output file name must contain the
+ * `{cell}` placeholder, which is replaced by the cell name. `{lib}` is replaced by
+ * the library name.
+ *
  * @param gds_name Path to GDS File
- * @param cell_name Cell name
+ * @param selection Cells to render
  * @param renderers Renderer ids
- * @param output_file_names Output file names
+ * @param output_file_names Output file names / templates
  * @param layer_file Layer mapping file
- * @param ext_param Settings for external library renderer
- * @param tex_standalone Standalone TeX
- * @param tex_layers TeX OCR layers
+ * @param options Renderer options
  * @param scale Scale value
+ * @param jobs Count of worker threads. If < 1, the count of available processors is used
  * @return Error code, 0 if successful
  */
 int command_line_convert_gds(const char *gds_name,
-			     const char *cell_name,
+			     const struct command_line_cell_selection *selection,
 			     char **renderers,
 			     char **output_file_names,
 			     const char *layer_file,
-			     struct external_renderer_params *ext_param,
-			     gboolean tex_standalone,
-			     gboolean tex_layers,
-			     double scale);
+			     const struct command_line_render_options *options,
+			     double scale,
+			     int jobs);
+
+/**
+ * @brief Execute all jobs of a manifest file
+ *
+ * The manifest is a CSV file with one job per line:
+ * `gds,cell,renderer,output,mapping[,scale]`.
+ * Empty lines and lines starting with `#` are ignored. The first line may be the header `gds,cell,...`.
+ *
+ * Jobs are grouped by their GDS file, so every file is only parsed once. Layer mapping files are
+ * loaded once and shared between all jobs using them. GDS files are parsed one after another
+ * while already parsed files are rendered on a pool of \p jobs threads. A file is only parsed
+ * if its estimated memory fits into \p memory_limit_mib together with the files still being rendered.
+ *
+ * @param manifest Path of the manifest file
+ * @param options Renderer options
+ * @param jobs Count of worker threads. If < 1, the count of available processors is used
+ * @param memory_limit_mib Memory budget for parsed GDS files in MiB. If < 1, half of the physical memory is used
+ * @return Error code, 0 if successful
+ */
+int command_line_convert_manifest(const char *manifest,
+				  const struct command_line_render_options *options,
+				  int jobs,
+				  int memory_limit_mib);
 
 /**
  * @brief Analyze the given GDS file
@@ -0,0 +1,99 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file gds-layer-usage.h
+ * @brief Header file for the transitive layer usage of cells
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+#ifndef _GDS_LAYER_USAGE_H_
+#define _GDS_LAYER_USAGE_H_
+
+/**
+ * @addtogroup GDS-Utilities
+ * @{
+ */
+
+#include <glib.h>
+
+#include <gds-render/gds-utils/gds-types.h>
+
+/**
+ * @brief Initialize an empty, valid layer set
+ * @param usage Layer set
+ */
+void gds_layer_usage_init(struct gds_layer_usage *usage);
+
+/**
+ * @brief Free the memory of a layer set and reset it to #GDS_LAYER_USAGE_NOT_CALCULATED
+ * @param usage Layer set
+ */
+void gds_layer_usage_clear(struct gds_layer_usage *usage);
+
+/**
+ * @brief Add a layer to a layer set
+ * @param usage Layer set
+ * @param layer Layer
+ */
+void gds_layer_usage_add(struct gds_layer_usage *usage, int16_t layer);
+
+/**
+ * @brief Check if a layer set contains \p layer
+ * @param usage Layer set
+ * @param layer Layer
+ * @return TRUE if the layer is contained. Always TRUE if the set is not valid
+ */
+gboolean gds_layer_usage_contains(const struct gds_layer_usage *usage, int16_t layer);
+
+/**
+ * @brief Check if two layer sets have a layer in common
+ *
+ * This is conservative: If one of the sets is not valid, TRUE is returned.
+ *
+ * @param usage Layer set
+ * @param other Other layer set
+ * @return TRUE if the sets may have a common layer
+ */
+gboolean gds_layer_usage_intersects(const struct gds_layer_usage *usage, const struct gds_layer_usage *other);
+
+/**
+ * @brief Check if a cell or one of its sub-cells contains graphics on a layer of \p layers
+ *
+ * Renderers use this to skip whole sub-trees without any rendered layer.
+ *
+ * @param cell Cell
+ * @param layers Set of rendered layers
+ * @return FALSE if the cell is guaranteed to contain nothing on the layers
+ */
+gboolean gds_layer_usage_cell_uses_layers(const struct gds_cell *cell, const struct gds_layer_usage *layers);
+
+/**
+ * @brief Calculate the transitive layer usage of all cells in a library
+ *
+ * This is done bottom-up. Every cell is only visited once. The cell references have to be resolved beforehand.
+ * Cells inside a reference loop are marked with #GDS_LAYER_USAGE_ALL.
+ *
+ * @param lib Library
+ */
+void gds_layer_usage_calc_in_lib(struct gds_library *lib);
+
+/** @} */
+
+#endif /* _GDS_LAYER_USAGE_H_ */
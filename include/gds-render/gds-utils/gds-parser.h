@@ -37,6 +37,30 @@
 
 #define GDS_PRINT_DEBUG_INFOS (0) /**< @brief 1: Print infos, 0: Don't print */
 
+#define GDS_PARSER_CANCELLED (-7) /**< @brief Return value of the parser if parsing was aborted by the progress callback */
+
+/**
+ * @brief Optional callbacks of the GDS parser
+ *
+ * All callbacks are executed in the thread running the parser.
+ */
+struct gds_parsing_callbacks {
+	/**
+	 * @brief Called periodically while reading the file.
+	 *
+	 * Return FALSE to abort parsing. The parser then returns #GDS_PARSER_CANCELLED.
+	 */
+	gboolean (*progress)(goffset bytes_read, goffset file_size, gpointer user_data);
+	/**
+	 * @brief Called for every completely parsed library.
+	 *
+	 * The references of the library are resolved and its statistics are calculated at this point.
+	 * The parser does not modify the library afterwards.
+	 */
+	void (*library_finished)(struct gds_library *library, gpointer user_data);
+	gpointer user_data; /**< @brief User data supplied to the callbacks */
+};
+
 /**
  * @brief Parse a GDS file
  *
@@ -54,6 +78,23 @@
 int parse_gds_from_file(const char *filename, GList **library_array,
                         const struct gds_library_parsing_opts *parsing_options);
 
+/**
+ * @brief Parse a GDS file and report the progress
+ *
+ * This function behaves like parse_gds_from_file(). Additionally, the \p callbacks
+ * are used to report the progress, to abort parsing and to hand out
+ * libraries as soon as they are completely parsed.
+ *
+ * @param[in] filename Path to the GDS file
+ * @param[in,out] library_array GList Pointer.
+ * @param[in] parsing_options Parsing options.
+ * @param[in] callbacks Callbacks. May be NULL. Callback members may be NULL.
+ * @return 0 if successful. #GDS_PARSER_CANCELLED if aborted by the progress callback
+ */
+int parse_gds_from_file_with_callbacks(const char *filename, GList **library_array,
+				       const struct gds_library_parsing_opts *parsing_options,
+				       const struct gds_parsing_callbacks *callbacks);
+
 /**
  * @brief Deletes all libraries including cells, references etc.
  * @param library_list Pointer to a list of #gds_library. Is set to NULL after completion.
@@ -81,6 +81,15 @@ struct gds_lib_statistics {
 };
 
 
+/**
+ * @brief Count of graphics objects on a layer / datatype combination of a library
+ */
+struct gds_layer_count {
+	int16_t layer; /**< @brief Layer */
+	int16_t datatype; /**< @brief Data type */
+	size_t gfx_count; /**< @brief Count of graphics objects with this layer and datatype */
+};
+
 /**
  * @brief Stores the result of the cell checks.
  */
@@ -96,6 +105,33 @@ struct gds_cell_checks {
 	} _internal;
 };
 
+/**
+ * @brief Count of layers, starting at 0, that are stored in the bitmask of a #gds_layer_usage
+ */
+#define GDS_LAYER_USAGE_MASK_LAYERS (256)
+
+/**
+ * @brief Calculation state of a #gds_layer_usage
+ */
+enum gds_layer_usage_state {
+	GDS_LAYER_USAGE_NOT_CALCULATED = 0, /**< @brief Usage has not been calculated. Treated like #GDS_LAYER_USAGE_ALL */
+	GDS_LAYER_USAGE_IN_PROGRESS, /**< @brief For internal use during the calculation */
+	GDS_LAYER_USAGE_VALID, /**< @brief Usage is valid */
+	GDS_LAYER_USAGE_ALL, /**< @brief Usage is unknown, e.g. due to a reference loop. Every layer may be used */
+};
+
+/**
+ * @brief Set of layers used by a cell and all of its sub-cells
+ *
+ * Layers 0 to #GDS_LAYER_USAGE_MASK_LAYERS - 1 are stored in a bitmask.
+ * All other layers are stored in a sorted array.
+ */
+struct gds_layer_usage {
+	guint64 mask[GDS_LAYER_USAGE_MASK_LAYERS / 64]; /**< @brief Bitmask of the low layers */
+	GArray *high_layers; /**< @brief Sorted array of int16_t layers outside of the bitmask. May be NULL */
+	enum gds_layer_usage_state state; /**< @brief Calculation state */
+};
+
 /**
  * @brief Date information for cells and libraries
  */
@@ -118,6 +154,7 @@ struct gds_graphics {
 	int width_absolute; /**< @brief Width. Not used for objects other than paths */
 	int16_t layer; /**< @brief Layer the graphic object is on */
 	int16_t datatype; /**< @brief Data type of graphic object */
+	int rectangle; /**< @brief 1 if the polygon or box is an axis-aligned rectangle. Its first and third vertex are opposite corners */
 };
 
 /**
@@ -144,6 +181,7 @@ struct gds_cell {
 	struct gds_library *parent_library; /**< @brief Pointer to parent library */
 	struct gds_cell_checks checks; /**< @brief Checking results */
     struct gds_cell_statistics stats; /**< @brief Optional statistic info */
+	struct gds_layer_usage layer_usage; /**< @brief Layers used by this cell and all of its sub-cells */
 };
 
 /**
@@ -165,6 +203,7 @@ struct gds_library {
 	GList *cells; /**< List of #gds_cell that contains all cells in this library*/
 	GList *cell_names /**< List of strings that contains all cell names */;
     struct gds_lib_statistics stats;
+	GArray *layer_inventory; /**< @brief Array of #gds_layer_count sorted by layer and datatype. Collected by the parser */
 };
 
 
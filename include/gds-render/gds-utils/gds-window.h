@@ -0,0 +1,86 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file gds-window.h
+ * @brief Restrict a cell hierarchy to a clip window
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+#ifndef _GDS_WINDOW_H_
+#define _GDS_WINDOW_H_
+
+/**
+ * @addtogroup GDS-Utilities
+ * @{
+ */
+
+#include <glib.h>
+
+#include <gds-render/gds-utils/gds-types.h>
+#include <gds-render/geometric/bounding-box.h>
+
+/**
+ * @brief Opaque clipped view of a cell hierarchy
+ */
+struct gds_window;
+
+/**
+ * @brief Restrict a cell to a window
+ *
+ * A new cell hierarchy is built, which only contains the parts of \p cell inside of \p window.
+ * Sub-cells completely inside the window are referenced as they are. Sub-cells completely outside
+ * are skipped without descending into them. Only cells crossing the border of the window are copied.
+ * Polygons and boxes crossing the border are clipped. Paths are kept as a whole.
+ *
+ * The original hierarchy is not modified. It must not be freed while the window is in use.
+ *
+ * @param cell Cell to clip
+ * @param window Window in database units of \p cell
+ * @return New window. Free with gds_window_free()
+ */
+struct gds_window *gds_window_new(struct gds_cell *cell, const union bounding_box *window);
+
+/**
+ * @brief Get the clipped cell
+ * @param window Window
+ * @return Cell to render. Owned by \p window or the original cell, if it is completely inside the window
+ */
+struct gds_cell *gds_window_get_cell(struct gds_window *window);
+
+/**
+ * @brief Free a window and all copied cells
+ * @param window Window. May be NULL
+ */
+void gds_window_free(struct gds_window *window);
+
+/**
+ * @brief Parse a window given as `x0,y0,x1,y1`
+ *
+ * The corners may be given in any order.
+ *
+ * @param string String to parse
+ * @param[out] window Parsed window
+ * @return TRUE if \p string is a valid window with a non zero area
+ */
+gboolean gds_window_parse(const char *string, union bounding_box *window);
+
+/** @} */
+
+#endif /* _GDS_WINDOW_H_ */
@@ -99,6 +99,13 @@ void bounding_box_update_with_box(union bounding_box *destination, union boundin
  */
 void bounding_box_prepare_empty(union bounding_box *box);
 
+/**
+ * @brief Check if a bounding box has not been updated since bounding_box_prepare_empty()
+ * @param box Bounding box
+ * @return true if \p box does not contain any point
+ */
+bool bounding_box_is_empty(const union bounding_box *box);
+
 /**
  * @brief Update bounding box with a point
  * @param destination Bounding box to update
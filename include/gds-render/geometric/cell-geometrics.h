@@ -49,6 +49,27 @@
  */
 void calculate_cell_bounding_box(union bounding_box *box, struct gds_cell *cell);
 
+/**
+ * @brief Create a cache for calculate_cell_bounding_box_cached()
+ * @return Hash table mapping a gds_cell to its bounding box. Free with g_hash_table_destroy()
+ */
+GHashTable *cell_bounding_box_cache_new(void);
+
+/**
+ * @brief Calculate the bounding box of a gds cell and all its sub-cells
+ *
+ * Every cell is only calculated once. The results are stored in \p cache.
+ * In contrast to calculate_cell_bounding_box(), a reference loop does not cause an infinite recursion.
+ * Sub-cells without any graphics do not contribute to the box.
+ *
+ * The cache is not thread safe. It may be read concurrently once it is no longer updated.
+ *
+ * @param cache Cache created with cell_bounding_box_cache_new()
+ * @param cell Cell
+ * @return Bounding box of \p cell. Owned by \p cache. The box is empty if the cell does not contain any graphics
+ */
+const union bounding_box *calculate_cell_bounding_box_cached(GHashTable *cache, struct gds_cell *cell);
+
 #endif /* _CELL_GEOMETRICS_H_ */
 
 /** @} */
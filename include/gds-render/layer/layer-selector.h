@@ -62,6 +62,23 @@ LayerSelector *layer_selector_new(GtkListBox *list_box);
  */
 void layer_selector_generate_layer_widgets(LayerSelector *selector, GList *libs);
 
+/**
+ * @brief Remove all layer widgets from the LayerSelector instance
+ * @param selector LayerSelector instance
+ */
+void layer_selector_clear_layers(LayerSelector *selector);
+
+/**
+ * @brief Add layer widgets for the layers of a library's layer inventory to the LayerSelector instance
+ *
+ * The object count of each layer is shown in its widget. Layers that are already present
+ * only get their count increased. This can be used to add the layers of libraries one after another.
+ *
+ * @param selector LayerSelector instance
+ * @param inventory Array of #gds_layer_count sorted by layer. See gds_library::layer_inventory. May be NULL
+ */
+void layer_selector_add_layers(LayerSelector *selector, const GArray *inventory);
+
 /**
  * @brief Supply button for loading the layer mapping
  * @param selector LayerSelector instance
@@ -26,10 +26,29 @@
 #ifndef _LAYER_INFO_H_
 #define _LAYER_INFO_H_
 
-#include <gtk/gtk.h>
+#include <glib-object.h>
 
 G_BEGIN_DECLS
 
+/**
+ * @brief RGBA color of a layer
+ *
+ * All components range from 0 to 1.
+ * The layout is identical to GdkRGBA. This keeps the layer settings, and therefore the renderers,
+ * independent of GTK.
+ */
+struct layer_color {
+	double red; /**< @brief Red component */
+	double green; /**< @brief Green component */
+	double blue; /**< @brief Blue component */
+	double alpha; /**< @brief Opacity */
+};
+
+/**
+ * @brief Value of layer_info::datatype for entries that apply to all datatypes of a layer
+ */
+#define LAYER_INFO_ANY_DATATYPE (-1)
+
 /**
  * @brief Layer information.
  *
@@ -40,9 +59,10 @@ G_BEGIN_DECLS
 struct layer_info
 {
 	int layer; /**< @brief Layer number */
+	int datatype; /**< @brief Datatype this entry applies to. #LAYER_INFO_ANY_DATATYPE for all datatypes of the layer */
 	char *name; /**< @brief Layer name. */
 	int stacked_position; /**< @brief Position of layer in output @warning This parameter is not used by any renderer so far @note Lower is bottom, higher is top */
-	GdkRGBA color; /**< @brief RGBA color used to render this layer */
+	struct layer_color color; /**< @brief RGBA color used to render this layer */
 	int render; /**< @brief true: Render to output */
 };
 
@@ -78,12 +98,42 @@ void layer_settings_clear(LayerSettings *settings);
 
 /**
  * @brief Remove a specific layer number from the layer settings.
+ *
+ * If the layer is present multiple times, the last entry is removed.
+ * Only entries applying to all datatypes of the layer are considered. Datatype specific entries are kept.
+ *
  * @param settings LayerSettings object
  * @param layer Layer number
  * @return Error code. 0 if successful
  */
 int layer_settings_remove_layer(LayerSettings *settings, int layer);
 
+/**
+ * @brief Look up the layer information for a graphics object
+ *
+ * An entry for the exact \p layer and \p datatype combination takes precedence
+ * over an entry for all datatypes of \p layer. If a combination is present multiple times,
+ * the first one in the stacking list is returned.
+ *
+ * The lookup does not depend on the number of layers. It is intended for the hot loops of the renderers.
+ * The returned struct stays valid until the layer is removed or the settings are cleared.
+ *
+ * @param settings LayerSettings object
+ * @param layer Layer number
+ * @param datatype Datatype or #LAYER_INFO_ANY_DATATYPE to only look up entries for all datatypes
+ * @return Layer information or NULL if the layer is not present
+ */
+const struct layer_info *layer_settings_lookup(LayerSettings *settings, int layer, int datatype);
+
+/**
+ * @brief Check if graphics objects on \p layer and \p datatype shall be rendered
+ * @param settings LayerSettings object
+ * @param layer Layer number
+ * @param datatype Datatype or #LAYER_INFO_ANY_DATATYPE
+ * @return TRUE if the layer is present and shall be rendered. See layer_settings_lookup()
+ */
+gboolean layer_settings_is_rendered(LayerSettings *settings, int layer, int datatype);
+
 /**
  * @brief Get a GList with layer_info structs
  *
@@ -95,6 +145,19 @@ int layer_settings_remove_layer(LayerSettings *settings, int layer);
  */
 GList *layer_settings_get_layer_info_list(LayerSettings *settings);
 
+/**
+ * @brief Get the entries applying to all datatypes of a layer
+ *
+ * This is intended for renderers, which render each layer as a whole.
+ * Datatype specific entries are left out. Of multiple entries for the same layer,
+ * only the first one is returned. See layer_settings_lookup().
+ *
+ * @param settings LayerSettings object
+ * @return New GList with struct layer_info elements in rendering order. Free the list with g_list_free().
+ *	   The elements are owned by \p settings
+ */
+GList *layer_settings_get_whole_layer_list(LayerSettings *settings);
+
 /**
  * @brief Write layer settings to a CSV file.
  *
@@ -53,6 +53,41 @@ CairoRenderer *cairo_renderer_new_svg();
  */
 CairoRenderer *cairo_renderer_new_pdf();
 
+/**
+ * @brief Select between in-process and forked rendering
+ *
+ * By default, the output is rendered in the calling thread. With fork isolation enabled, a child process
+ * is forked for each rendering run. This contains memory leaks in Cairo, but copying the page tables of
+ * a large process is expensive.
+ *
+ * @param renderer Renderer
+ * @param fork_isolation TRUE: Render in a forked child process
+ */
+void cairo_renderer_set_fork_isolation(CairoRenderer *renderer, gboolean fork_isolation);
+
+/**
+ * @brief Enable or disable the hairline outline of polygons
+ *
+ * By default, every polygon is additionally stroked with a hairline. This hides gaps between adjacent
+ * polygons in some viewers, but doubles the rasterization work and enlarges the output.
+ *
+ * @param renderer Renderer
+ * @param hairline_stroke TRUE: Stroke polygons with a hairline
+ */
+void cairo_renderer_set_hairline_stroke(CairoRenderer *renderer, gboolean hairline_stroke);
+
+/**
+ * @brief Enable or disable filling all polygons of a cell on the same layer at once
+ *
+ * The polygons are collected into a single path using the nonzero winding rule and filled with a single operation.
+ * This reduces the operation count of the recording surfaces and the size of the output file for dense layers.
+ * Disabled by default. Axis-aligned rectangles are always collected.
+ *
+ * @param renderer Renderer
+ * @param batch_polygons TRUE: Collect the polygons of a cell per layer
+ */
+void cairo_renderer_set_batch_polygons(CairoRenderer *renderer, gboolean batch_polygons);
+
 /** @} */
 
 G_END_DECLS
@@ -34,7 +34,9 @@
 #include <gds-render/gds-utils/gds-types.h>
 #include <glib-object.h>
 #include <glib.h>
+#include <gio/gio.h>
 #include <gds-render/layer/layer-settings.h>
+#include <gds-render/geometric/bounding-box.h>
 
 G_BEGIN_DECLS
 
@@ -60,9 +62,25 @@ struct _GdsOutputRendererClass {
 
 enum {
 	GDS_OUTPUT_RENDERER_GEN_ERR = -100, /**< @brief Error set by the _GdsOutputRendererClass::render_output virtual function, if renderer is invalid. */
-	GDS_OUTPUT_RENDERER_PARAM_ERR = -200 /**< @brief Error set by the _GdsOutputRendererClass::render_output virtual function, if parameters are faulty. */
+	GDS_OUTPUT_RENDERER_PARAM_ERR = -200, /**< @brief Error set by the _GdsOutputRendererClass::render_output virtual function, if parameters are faulty. */
+	GDS_OUTPUT_RENDERER_CANCELLED = -300 /**< @brief Returned by the _GdsOutputRendererClass::render_output virtual function, if the rendering was cancelled. */
 };
 
+/**
+ * @brief Phase of a rendering reported by #gds_output_renderer_update_async_fraction
+ */
+enum gds_output_renderer_phase {
+	GDS_OUTPUT_RENDERER_PHASE_SETUP = 0, /**< @brief Renderer is preparing the output */
+	GDS_OUTPUT_RENDERER_PHASE_RENDERING, /**< @brief Cell hierarchy is being rendered */
+	GDS_OUTPUT_RENDERER_PHASE_EXPORTING, /**< @brief Rendered output is written to the output file */
+	GDS_OUTPUT_RENDERER_PHASE_FINISHED /**< @brief Rendering is finished */
+};
+
+/**
+ * @brief Minimum time between two emissions of the 'progress-fraction-changed' signal in milliseconds
+ */
+#define GDS_OUTPUT_RENDERER_PROGRESS_INTERVAL_MS (50)
+
 /**
  * @brief Create a new GdsOutputRenderer GObject.
  * @return New object
@@ -129,6 +147,25 @@ LayerSettings *gds_output_renderer_get_and_ref_layer_settings(GdsOutputRenderer
  */
 void gds_output_renderer_set_layer_settings(GdsOutputRenderer *renderer, LayerSettings *settings);
 
+/**
+ * @brief Restrict the output to a window
+ *
+ * Only the part of the cell inside the window is rendered. Sub-cells outside of the window
+ * are skipped. This applies to all renderers.
+ *
+ * @param renderer Renderer
+ * @param window Window in database units. NULL renders the whole cell
+ */
+void gds_output_renderer_set_window(GdsOutputRenderer *renderer, const union bounding_box *window);
+
+/**
+ * @brief Get the window the output is restricted to
+ * @param renderer Renderer
+ * @param[out] window Window in database units. May be NULL
+ * @return TRUE if a window is set
+ */
+gboolean gds_output_renderer_get_window(GdsOutputRenderer *renderer, union bounding_box *window);
+
 /**
  * @brief Render output asynchronously
  *
@@ -154,6 +191,66 @@ int gds_output_renderer_render_output_async(GdsOutputRenderer *renderer, struct
  */
 void gds_output_renderer_update_async_progress(GdsOutputRenderer *renderer, const char *status);
 
+/**
+ * @brief Report the numeric progress of an asynchronous rendering
+ *
+ * This function is meant to be called from the rendering loop of a renderer and is cheap enough to be
+ * called for every rendered element: It does not allocate memory and does not lock.
+ * The values are stored atomically and the 'progress-fraction-changed' signal is emitted in the
+ * context that triggered the rendering at most every #GDS_OUTPUT_RENDERER_PROGRESS_INTERVAL_MS milliseconds
+ * with the latest values.
+ *
+ * If the rendering is not asynchronous, this function has no effect.
+ *
+ * @param renderer GdsOutputrenderer object
+ * @param fraction Progress of the current phase in the range of 0.0 to 1.0
+ * @param phase Current phase of the rendering
+ */
+void gds_output_renderer_update_async_fraction(GdsOutputRenderer *renderer, double fraction,
+					       enum gds_output_renderer_phase phase);
+
+/**
+ * @brief Cancel an asynchronous rendering
+ *
+ * The renderer stops at the next cancellation point, removes the partially written output
+ * and finishes with the 'async-finished' signal. If no rendering is active, this function has no effect.
+ *
+ * @param renderer GdsOutputrenderer object
+ */
+void gds_output_renderer_cancel_async(GdsOutputRenderer *renderer);
+
+/**
+ * @brief Get the cancellable of the current asynchronous rendering
+ *
+ * This function may be called from the rendering thread, e.g. to wait for a file descriptor
+ * and the cancellation at the same time.
+ *
+ * @param renderer GdsOutputrenderer object
+ * @return Cancellable owned by the renderer. NULL if no asynchronous rendering is active
+ */
+GCancellable *gds_output_renderer_get_cancellable(GdsOutputRenderer *renderer);
+
+/**
+ * @brief Get the return value of the last asynchronous rendering
+ *
+ * The value is available in handlers of the 'async-finished' signal and afterwards.
+ *
+ * @param renderer GdsOutputrenderer object
+ * @return 0 if successful, #GDS_OUTPUT_RENDERER_CANCELLED if cancelled, else the renderer's error code
+ */
+int gds_output_renderer_get_async_result(GdsOutputRenderer *renderer);
+
+/**
+ * @brief Check if the current rendering has been cancelled
+ *
+ * This function is meant to be polled from the rendering loops of the renderers. It can be called
+ * from the rendering thread.
+ *
+ * @param renderer GdsOutputrenderer object
+ * @return TRUE if the rendering shall be aborted
+ */
+gboolean gds_output_renderer_is_cancelled(GdsOutputRenderer *renderer);
+
 G_END_DECLS
 
 #endif /* _GDS_OUTPUT_RENDERER_H_ */
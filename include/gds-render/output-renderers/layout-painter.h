@@ -0,0 +1,102 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file layout-painter.h
+ * @brief Paint a cell hierarchy into a Cairo context with culling
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup LayoutPainter
+ * @{
+ */
+
+#ifndef __LAYOUT_PAINTER_H__
+#define __LAYOUT_PAINTER_H__
+
+#include <cairo.h>
+#include <gio/gio.h>
+#include <gds-render/gds-utils/gds-types.h>
+#include <gds-render/layer/layer-settings.h>
+#include <gds-render/geometric/bounding-box.h>
+
+/** @brief Default size in device units below which cell instances are not painted */
+#define LAYOUT_PAINTER_DEFAULT_LOD_THRESHOLD (0.5)
+
+/**
+ * @brief Opaque painter structure
+ */
+struct layout_painter;
+
+/**
+ * @brief Create a new painter for a cell
+ *
+ * The bounding boxes of the cell and all its sub-cells are calculated here.
+ * Afterwards, the painter is read-only and can be used from multiple threads concurrently.
+ * The cell hierarchy must not be modified or freed while the painter is in use.
+ *
+ * @param cell Cell to paint
+ * @param settings Layers to paint. Only layers with layer_info::render set are painted in the order of the list.
+ *		   Datatype specific entries are respected. See layer_settings_lookup()
+ * @return New painter with a reference count of 1
+ */
+struct layout_painter *layout_painter_new(struct gds_cell *cell, LayerSettings *settings);
+
+/**
+ * @brief Increase the reference count of \p painter
+ * @param painter Painter
+ * @return \p painter
+ */
+struct layout_painter *layout_painter_ref(struct layout_painter *painter);
+
+/**
+ * @brief Decrease the reference count of \p painter and free it if it drops to zero
+ * @param painter Painter
+ */
+void layout_painter_unref(struct layout_painter *painter);
+
+/**
+ * @brief Get the bounding box of the painted cell in database units
+ * @param painter Painter
+ * @return Bounding box. Owned by the painter. Empty if the cell does not contain any graphics
+ */
+const union bounding_box *layout_painter_get_bounding_box(struct layout_painter *painter);
+
+/**
+ * @brief Paint the cell
+ *
+ * The current transformation of \p cr has to map database units to device units.
+ * Cell instances, whose bounding box lies outside of the device rectangle (0, 0, \p width, \p height),
+ * are skipped without descending into them. Instances smaller than \p lod_threshold device units are skipped as well.
+ *
+ * @param painter Painter
+ * @param cr Cairo context to paint into
+ * @param width Width of the visible device area
+ * @param height Height of the visible device area
+ * @param lod_threshold Minimum size of painted instances in device units. Use 0 to paint everything
+ * @param cancellable Cancellable. May be NULL
+ * @return 0 if successful, -1 if cancelled
+ */
+int layout_painter_paint(struct layout_painter *painter, cairo_t *cr, double width, double height,
+			 double lod_threshold, GCancellable *cancellable);
+
+#endif /* __LAYOUT_PAINTER_H__ */
+
+/** @} */
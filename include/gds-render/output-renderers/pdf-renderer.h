@@ -0,0 +1,71 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pdf-renderer.h
+ * @brief Native streaming PDF output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup PDF-Renderer
+ * @{
+ */
+
+#ifndef _PDF_RENDERER_H_
+#define _PDF_RENDERER_H_
+
+#include <gds-render/output-renderers/gds-output-renderer.h>
+#include <gds-render/gds-utils/gds-types.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(PdfRenderer, pdf_renderer, GDS_RENDER, PDF_RENDERER, GdsOutputRenderer)
+
+#define GDS_RENDER_TYPE_PDF_RENDERER (pdf_renderer_get_type())
+
+/**
+ * @brief Size of the content stream buffer in KiB
+ *
+ * Content streams are written to the output file (and compressed) in chunks of this size.
+ */
+#define PDF_STREAM_BUFFER_KB (64)
+
+/**
+ * @brief Create new PdfRenderer object
+ * @return New object
+ */
+PdfRenderer *pdf_renderer_new();
+
+/**
+ * @brief Create new PdfRenderer object
+ *
+ * This function sets the 'pdf-layers' and 'compress' properties for the newly created object.
+ *
+ * @param pdf_layers If every layer shall become an optional content group (OCG)
+ * @param compress If the content streams shall be Flate compressed
+ * @return New object
+ */
+PdfRenderer *pdf_renderer_new_with_options(gboolean pdf_layers, gboolean compress);
+
+G_END_DECLS
+
+#endif /* _PDF_RENDERER_H_ */
+
+/** @} */
@@ -0,0 +1,82 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file png-renderer.h
+ * @brief Tiled multithreaded PNG output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup PNG-Renderer
+ * @{
+ */
+
+#ifndef _PNG_RENDERER_H_
+#define _PNG_RENDERER_H_
+
+#include <gds-render/output-renderers/gds-output-renderer.h>
+#include <gds-render/gds-utils/gds-types.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(PngRenderer, png_renderer, GDS_RENDER, PNG_RENDERER, GdsOutputRenderer)
+
+#define GDS_RENDER_TYPE_PNG_RENDERER (png_renderer_get_type())
+
+/**
+ * @brief Edge length of a tile in pixels
+ *
+ * The image is rendered in bands of this height. Each band is split into tiles rendered in parallel.
+ */
+#define PNG_RENDERER_TILE_SIZE (256)
+
+/**
+ * @brief Maximum width and height of the image in pixels
+ *
+ * Limits the memory of the two band buffers to 2 x 4 x #PNG_RENDERER_TILE_SIZE bytes per pixel column.
+ */
+#define PNG_RENDERER_MAX_DIMENSION (262144)
+
+/**
+ * @brief Size of the compressed data buffer in KiB. Every full buffer becomes an IDAT chunk
+ */
+#define PNG_RENDERER_IDAT_KB (256)
+
+/**
+ * @brief Create new PngRenderer object
+ * @return New object
+ */
+PngRenderer *png_renderer_new();
+
+/**
+ * @brief Create new PngRenderer object
+ *
+ * This function sets the 'threads' property for the newly created object.
+ *
+ * @param threads Count of rendering threads. 0 uses one thread per processor
+ * @return New object
+ */
+PngRenderer *png_renderer_new_with_options(guint threads);
+
+G_END_DECLS
+
+#endif /* _PNG_RENDERER_H_ */
+
+/** @} */
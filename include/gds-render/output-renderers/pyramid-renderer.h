@@ -0,0 +1,73 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pyramid-renderer.h
+ * @brief XYZ tile pyramid output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup Pyramid-Renderer
+ * @{
+ */
+
+#ifndef _PYRAMID_RENDERER_H_
+#define _PYRAMID_RENDERER_H_
+
+#include <gds-render/output-renderers/gds-output-renderer.h>
+#include <gds-render/gds-utils/gds-types.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(PyramidRenderer, pyramid_renderer, GDS_RENDER, PYRAMID_RENDERER, GdsOutputRenderer)
+
+#define GDS_RENDER_TYPE_PYRAMID_RENDERER (pyramid_renderer_get_type())
+
+/**
+ * @brief Edge length of a tile in pixels
+ */
+#define PYRAMID_RENDERER_TILE_SIZE (256)
+
+/**
+ * @brief Highest zoom level generated
+ */
+#define PYRAMID_RENDERER_MAX_ZOOM (20)
+
+/**
+ * @brief Create new PyramidRenderer object
+ * @return New object
+ */
+PyramidRenderer *pyramid_renderer_new();
+
+/**
+ * @brief Create new PyramidRenderer object
+ *
+ * This function sets the 'overwrite' property for the newly created object.
+ *
+ * @param overwrite Render tiles that already exist in the output directory again
+ * @return New object
+ */
+PyramidRenderer *pyramid_renderer_new_with_options(gboolean overwrite);
+
+G_END_DECLS
+
+#endif /* _PYRAMID_RENDERER_H_ */
+
+/** @} */
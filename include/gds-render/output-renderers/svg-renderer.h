@@ -0,0 +1,58 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file svg-renderer.h
+ * @brief Hierarchy preserving SVG output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup SVG-Renderer
+ * @{
+ */
+
+#ifndef _SVG_RENDERER_H_
+#define _SVG_RENDERER_H_
+
+#include <gds-render/output-renderers/gds-output-renderer.h>
+#include <gds-render/gds-utils/gds-types.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(SvgRenderer, svg_renderer, GDS_RENDER, SVG_RENDERER, GdsOutputRenderer)
+
+#define GDS_RENDER_TYPE_SVG_RENDERER (svg_renderer_get_type())
+
+/**
+ * @brief Size of the output buffer in KiB
+ */
+#define SVG_BUFFER_KB (64)
+
+/**
+ * @brief Create new SvgRenderer object
+ * @return New object
+ */
+SvgRenderer *svg_renderer_new();
+
+G_END_DECLS
+
+#endif /* _SVG_RENDERER_H_ */
+
+/** @} */
@@ -0,0 +1,56 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2018  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file render-server.h
+ * @brief Resident render server answering requests on a Unix domain socket
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup render-server
+ * @{
+ */
+
+#ifndef _RENDER_SERVER_H_
+#define _RENDER_SERVER_H_
+
+#include <glib.h>
+
+#include <gds-render/command-line.h>
+
+/**
+ * @brief Run the render server until SIGINT or SIGTERM is received
+ *
+ * Parsed GDS files are kept in a cache of \p cache_size files. If the cache is full,
+ * the least recently used file is evicted. Files modified on disk are parsed again.
+ *
+ * @param socket_path Path of the Unix domain socket to listen on. A stale socket of a previous instance is replaced.
+ *		      Any other existing file is an error
+ * @param max_clients Count of clients served in parallel. If < 1, the count of available processors is used
+ * @param cache_size Maximum count of cached GDS files
+ * @param options Options of the renderers
+ * @return 0 if successful
+ */
+int render_server_run(const char *socket_path, int max_clients, int cache_size,
+		      const struct command_line_render_options *options);
+
+#endif /* _RENDER_SERVER_H_ */
+
+/** @} */
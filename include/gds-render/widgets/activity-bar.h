@@ -61,6 +61,24 @@ void activity_bar_set_ready(ActivityBar *bar);
  */
 void activity_bar_set_busy(ActivityBar *bar, const char *text);
 
+/**
+ * @brief Show the progress of the current activity
+ * @param bar Activity bar object
+ * @param fraction Progress in the range of 0.0 to 1.0. A negative value hides the progress bar
+ */
+void activity_bar_set_fraction(ActivityBar *bar, double fraction);
+
+/**
+ * @brief Show a cancel button for the current activity
+ *
+ * Clicking the button cancels \p cancellable. The button is hidden again by activity_bar_set_ready()
+ * or by supplying NULL.
+ *
+ * @param bar Activity bar object
+ * @param cancellable Cancellable of the current activity. The bar keeps a reference. May be NULL
+ */
+void activity_bar_set_cancellable(ActivityBar *bar, GCancellable *cancellable);
+
 G_END_DECLS
 
 #endif /* __LAYER_ELEMENT_H__ */
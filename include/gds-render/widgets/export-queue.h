@@ -0,0 +1,101 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file export-queue.h
+ * @brief Header file for the export queue widget
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup ExportQueue
+ * @ingroup Widgets
+ * @{
+ */
+
+#ifndef __EXPORT_QUEUE_H__
+#define __EXPORT_QUEUE_H__
+
+#include <gtk/gtk.h>
+#include <gds-render/output-renderers/gds-output-renderer.h>
+
+G_BEGIN_DECLS
+
+/* Creates Class structure etc */
+G_DECLARE_FINAL_TYPE(ExportQueue, export_queue, EXPORT, QUEUE, GtkBox)
+
+#define TYPE_EXPORT_QUEUE (export_queue_get_type())
+
+/**
+ * @brief Create new ExportQueue object
+ *
+ * The count of concurrently running jobs defaults to the number of processors.
+ *
+ * @return New object. In case of error: NULL.
+ */
+ExportQueue *export_queue_new();
+
+/**
+ * @brief Set the maximum count of concurrently running jobs
+ * @param queue Export queue
+ * @param max_jobs Maximum job count. Values < 1 are treated as 1
+ */
+void export_queue_set_max_concurrent_jobs(ExportQueue *queue, guint max_jobs);
+
+/**
+ * @brief Add a rendering job to the queue
+ *
+ * The job is started as soon as less than the maximum count of jobs is running.
+ * The cell and its library must not be modified or freed until the job is finished.
+ *
+ * @param queue Export queue
+ * @param renderer Renderer with output file and layer settings set. The queue takes its own reference
+ * @param cell Cell to render
+ * @param scale Scale the output down by this value
+ */
+void export_queue_add_job(ExportQueue *queue, GdsOutputRenderer *renderer, struct gds_cell *cell, double scale);
+
+/**
+ * @brief Get the count of queued and running jobs
+ * @param queue Export queue
+ * @return Count of jobs that are not finished
+ */
+guint export_queue_get_active_job_count(ExportQueue *queue);
+
+/**
+ * @brief Cancel all queued and running jobs
+ * @param queue Export queue
+ */
+void export_queue_cancel_all(ExportQueue *queue);
+
+/**
+ * @brief Wait until all running jobs are finished
+ *
+ * The default main context is iterated while waiting. Call export_queue_cancel_all() beforehand
+ * to let the jobs finish quickly.
+ *
+ * @param queue Export queue
+ */
+void export_queue_wait_for_running_jobs(ExportQueue *queue);
+
+G_END_DECLS
+
+#endif /* __EXPORT_QUEUE_H__ */
+
+/** @} */
@@ -48,6 +48,8 @@ typedef struct _LayerElementPriv {
 	GtkEventBox *event_handle;
 	GtkColorButton *color;
 	GtkCheckButton *export;
+	GtkLabel *count;
+	size_t object_count;
 } LayerElementPriv;
 
 struct _LayerElement {
@@ -107,6 +109,25 @@ void layer_element_set_layer(LayerElement *elem, int layer);
  */
 int layer_element_get_layer(LayerElement *elem);
 
+/**
+ * @brief Add graphics objects to the count shown for this layer
+ *
+ * The count is shown next to the layer number. It starts at 0.
+ * This can be called once per library containing the layer.
+ *
+ * @param elem Layer element
+ * @param count Count of objects to add
+ * @param details Tooltip text with details, e.g. the datatypes. Appended to the previous details. May be NULL
+ */
+void layer_element_add_object_count(LayerElement *elem, size_t count, const char *details);
+
+/**
+ * @brief Get the count of graphics objects on this layer
+ * @param elem Layer element
+ * @return Object count added by layer_element_add_object_count(). 0 if unknown
+ */
+size_t layer_element_get_object_count(LayerElement *elem);
+
 /**
  * @brief Set export flag for this layer
  * @param elem Layer Element
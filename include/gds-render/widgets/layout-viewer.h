@@ -0,0 +1,92 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file layout-viewer.h
+ * @brief Header file for the zoomable layout viewer widget
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup LayoutViewer
+ * @ingroup Widgets
+ * @{
+ */
+
+#ifndef __LAYOUT_VIEWER_H__
+#define __LAYOUT_VIEWER_H__
+
+#include <gtk/gtk.h>
+#include <gds-render/gds-utils/gds-types.h>
+#include <gds-render/layer/layer-settings.h>
+#include <gds-render/geometric/bounding-box.h>
+
+G_BEGIN_DECLS
+
+/* Creates Class structure etc */
+G_DECLARE_FINAL_TYPE(LayoutViewer, layout_viewer, LAYOUT, VIEWER, GtkDrawingArea)
+
+#define TYPE_LAYOUT_VIEWER (layout_viewer_get_type())
+
+/**
+ * @brief Create new LayoutViewer object
+ * @return New object. In case of error: NULL.
+ */
+LayoutViewer *layout_viewer_new();
+
+/**
+ * @brief Show a cell in the viewer
+ *
+ * All rendered tiles of the previous cell are discarded. This function waits until no
+ * background rendering accesses the previous cell anymore. Call it with a NULL cell
+ * before the library of the shown cell is freed.
+ *
+ * The view is zoomed to fit the cell. A selected window is cleared if \p cell differs from the shown cell.
+ *
+ * @param viewer Layout viewer
+ * @param cell Cell to show. May be NULL
+ * @param settings Layers to show. Ignored if \p cell is NULL
+ */
+void layout_viewer_set_cell(LayoutViewer *viewer, struct gds_cell *cell, LayerSettings *settings);
+
+/**
+ * @brief Zoom and pan the view, so the whole cell is visible
+ * @param viewer Layout viewer
+ */
+void layout_viewer_zoom_to_fit(LayoutViewer *viewer);
+
+/**
+ * @brief Get the window selected by dragging with the shift key held down
+ * @param viewer Layout viewer
+ * @param[out] window Selected window in database units. May be NULL
+ * @return TRUE if a window is selected
+ */
+gboolean layout_viewer_get_window(LayoutViewer *viewer, union bounding_box *window);
+
+/**
+ * @brief Clear the selected window. A click with the secondary button does the same
+ * @param viewer Layout viewer
+ */
+void layout_viewer_clear_window(LayoutViewer *viewer);
+
+G_END_DECLS
+
+#endif /* __LAYOUT_VIEWER_H__ */
+
+/** @} */
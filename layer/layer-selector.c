@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <glib/gi18n.h>
 #include <gds-render/layer/layer-selector.h>
 #include <gds-render/gds-utils/gds-parser.h>
 #include <gds-render/widgets/layer-element.h>
@@ -392,6 +393,7 @@ LayerSettings *layer_selector_export_rendered_layer_info(LayerSelector *selector
 	GList *row_list;
 	GList *iterator;
 	LayerElement *le;
+	GdkRGBA color;
 	int i;
 
 	layer_settings = layer_settings_new();
@@ -406,10 +408,15 @@ LayerSettings *layer_selector_export_rendered_layer_info(LayerSelector *selector
 		/* Get name from layer element. This must not be freed */
 		linfo.name = (char *)layer_element_get_name(le);
 
-		layer_element_get_color(le, &linfo.color);
+		layer_element_get_color(le, &color);
+		linfo.color.red = color.red;
+		linfo.color.green = color.green;
+		linfo.color.blue = color.blue;
+		linfo.color.alpha = color.alpha;
 		linfo.render = (layer_element_get_export(le) ? 1 : 0);
 		linfo.stacked_position = i;
 		linfo.layer = layer_element_get_layer(le);
+		linfo.datatype = LAYER_INFO_ANY_DATATYPE;
 
 		/* This function copies the entire layer info struct including the name string.
 		 * Therefore, using the same layer_info struct over and over is safe.
@@ -440,34 +447,6 @@ static void layer_selector_clear_widgets(LayerSelector *self)
 		gtk_widget_set_sensitive(self->associated_save_button, FALSE);
 }
 
-/**
- * @brief Check if a specific layer element with the given layer number is present in the layer selector
- * @param self LayerSelector instance
- * @param layer Layer number to check for
- * @return TRUE if layer is present, else FALSE
- */
-static gboolean layer_selector_check_if_layer_widget_exists(LayerSelector *self, int layer)
-{
-	GList *list;
-	GList *temp;
-	LayerElement *widget;
-	gboolean ret = FALSE;
-
-	list = gtk_container_get_children(GTK_CONTAINER(self->list_box));
-
-	for (temp = list; temp != NULL; temp = temp->next) {
-		widget = LAYER_ELEMENT(temp->data);
-		if (layer_element_get_layer(widget) == layer) {
-			ret = TRUE;
-			break;
-		}
-	}
-
-	g_list_free(list);
-
-	return ret;
-}
-
 /**
  * @brief Setup the necessary drag and drop callbacks of layer elements.
  * @param self LayerSelector instance. Used to get the DnD target entry.
@@ -490,28 +469,78 @@ static void sel_layer_element_setup_dnd_callbacks(LayerSelector *self, LayerElem
 }
 
 /**
- * @brief Analyze \p cell layers and append detected layers to layer selector \p self
+ * @brief Map the layer numbers of all present layer elements to the elements
+ * @param self LayerSelector instance
+ * @return Hash table mapping the layer number to its LayerElement. Free with g_hash_table_destroy()
+ */
+static GHashTable *layer_selector_get_element_table(LayerSelector *self)
+{
+	GHashTable *table;
+	GList *list;
+	GList *temp;
+	LayerElement *widget;
+
+	table = g_hash_table_new(g_direct_hash, g_direct_equal);
+	list = gtk_container_get_children(GTK_CONTAINER(self->list_box));
+	for (temp = list; temp != NULL; temp = temp->next) {
+		widget = LAYER_ELEMENT(temp->data);
+		g_hash_table_insert(table, GINT_TO_POINTER(layer_element_get_layer(widget)), widget);
+	}
+	g_list_free(list);
+
+	return table;
+}
+
+/**
+ * @brief Add the layers of a library's layer inventory to the layer selector
+ *
+ * The inventory is sorted by layer. Therefore, all datatypes of a layer are consecutive.
+ * Layers already present get their object count increased, e.g. if they are used in multiple libraries.
+ *
  * @param self LayerSelector instance
- * @param cell Cell to analyze
+ * @param elements Table of present layer elements. See layer_selector_get_element_table(). New elements are added
+ * @param inventory Array of #gds_layer_count
  */
-static void layer_selector_analyze_cell_layers(LayerSelector *self, struct gds_cell *cell)
+static void layer_selector_add_inventory(LayerSelector *self, GHashTable *elements, const GArray *inventory)
 {
-	GList *graphics;
-	struct gds_graphics *gfx;
+	const struct gds_layer_count *count;
+	LayerElement *le;
+	GString *details;
+	size_t layer_count;
+	guint i = 0;
 	int layer;
-	GtkWidget *le;
-
-	for (graphics = cell->graphic_objs; graphics != NULL; graphics = graphics->next) {
-		gfx = (struct gds_graphics *)graphics->data;
-		layer = (int)gfx->layer;
-		if (layer_selector_check_if_layer_widget_exists(self, layer) == FALSE) {
-			le = layer_element_new();
-			sel_layer_element_setup_dnd_callbacks(self, LAYER_ELEMENT(le));
-			layer_element_set_layer(LAYER_ELEMENT(le), layer);
-			gtk_list_box_insert(self->list_box, le, -1);
-			gtk_widget_show(le);
+
+	details = g_string_new(NULL);
+
+	while (i < inventory->len) {
+		layer = (int)g_array_index(inventory, struct gds_layer_count, i).layer;
+		layer_count = 0;
+		g_string_truncate(details, 0);
+
+		/* Sum up all datatypes of this layer */
+		for (; i < inventory->len; i++) {
+			count = &g_array_index(inventory, struct gds_layer_count, i);
+			if ((int)count->layer != layer)
+				break;
+			layer_count += count->gfx_count;
+			g_string_append_printf(details, "%s%s %d: %zu", (details->len ? "\n" : ""), _("Datatype"),
+					       (int)count->datatype, count->gfx_count);
 		}
+
+		le = LAYER_ELEMENT(g_hash_table_lookup(elements, GINT_TO_POINTER(layer)));
+		if (!le) {
+			le = LAYER_ELEMENT(layer_element_new());
+			sel_layer_element_setup_dnd_callbacks(self, le);
+			layer_element_set_layer(le, layer);
+			gtk_list_box_insert(self->list_box, GTK_WIDGET(le), -1);
+			gtk_widget_show(GTK_WIDGET(le));
+			g_hash_table_insert(elements, GINT_TO_POINTER(layer), le);
+		}
+
+		layer_element_add_object_count(le, layer_count, details->str);
 	}
+
+	g_string_free(details, TRUE);
 }
 
 /**
@@ -548,18 +577,27 @@ static gint layer_selector_sort_func(GtkListBoxRow *row1, GtkListBoxRow *row2, g
 
 void layer_selector_generate_layer_widgets(LayerSelector *selector, GList *libs)
 {
-	GList *cell_list = NULL;
-	struct gds_library *lib;
+	layer_selector_clear_widgets(selector);
+
+	for (; libs != NULL; libs = libs->next)
+		layer_selector_add_layers(selector, ((struct gds_library *)libs->data)->layer_inventory);
+}
 
+void layer_selector_clear_layers(LayerSelector *selector)
+{
 	layer_selector_clear_widgets(selector);
+}
 
-	for (; libs != NULL; libs = libs->next) {
-		lib = (struct gds_library *)libs->data;
-		for (cell_list = lib->cells; cell_list != NULL; cell_list = cell_list->next)
-			layer_selector_analyze_cell_layers(selector, (struct gds_cell *)cell_list->data);
-	} /* For libs */
+void layer_selector_add_layers(LayerSelector *selector, const GArray *inventory)
+{
+	GHashTable *elements;
+
+	if (inventory) {
+		elements = layer_selector_get_element_table(selector);
+		layer_selector_add_inventory(selector, elements, inventory);
+		g_hash_table_destroy(elements);
+	}
 
-	/* Sort the layers */
 	layer_selector_force_sort(selector, LAYER_SELECTOR_SORT_DOWN);
 
 	/* Activate Buttons */
@@ -611,6 +649,7 @@ static void layer_selector_load_layer_mapping_from_file(LayerSelector *self, con
 	int status;
 	LayerSettings *layer_settings;
 	struct layer_info *linfo;
+	GdkRGBA color;
 
 	file = g_file_new_for_path(file_name);
 	stream = g_file_read(file, NULL, NULL);
@@ -644,13 +683,20 @@ static void layer_selector_load_layer_mapping_from_file(LayerSelector *self, con
 	/* Loop over all layer infos read from the CSV file */
 	for (; layer_infos; layer_infos = g_list_next(layer_infos)) {
 		linfo = (struct layer_info *)layer_infos->data;
+		/* The layer selector only configures whole layers */
+		if (linfo->datatype != LAYER_INFO_ANY_DATATYPE)
+			continue;
 		le = layer_selector_find_layer_element_in_list(rows, linfo->layer);
 		if (!le)
 			continue;
 
 		layer_element_set_name(le, linfo->name);
 		layer_element_set_export(le, (linfo->render ? TRUE : FALSE));
-		layer_element_set_color(le, &linfo->color);
+		color.red = linfo->color.red;
+		color.green = linfo->color.green;
+		color.blue = linfo->color.blue;
+		color.alpha = linfo->color.alpha;
+		layer_element_set_color(le, &color);
 		gtk_container_add(GTK_CONTAINER(self->list_box), GTK_WIDGET(le));
 		rows = g_list_remove(rows, le);
 	}
@@ -25,10 +25,25 @@
 
 #include <gds-render/layer/layer-settings.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gio/gio.h>
+
+/**
+ * @brief Count of layers, starting at 0, whose entries for all datatypes are indexed in a dense array
+ */
+#define LAYER_SETTINGS_DENSE_LAYERS (256)
 
 struct _LayerSettings {
 	GObject parent;
 	GList *layer_infos;
+	GList *layer_infos_tail; /**< @brief Last link of layer_infos. Allows appending in constant time */
+	/** @brief Links of the layer_infos list for all datatypes of layers 0 to LAYER_SETTINGS_DENSE_LAYERS - 1 */
+	GList *dense_index[LAYER_SETTINGS_DENSE_LAYERS];
+	/** @brief Maps the gint64 key of all other layer / datatype combinations to their link. Created on demand */
+	GHashTable *index;
+	/** @brief Count of appended entries whose combination has already been indexed */
+	guint duplicates;
 	gpointer padding[12];
 };
 
@@ -37,6 +52,70 @@ G_DEFINE_TYPE(LayerSettings, layer_settings, G_TYPE_OBJECT)
 static void layer_settings_init(LayerSettings *self)
 {
 	self->layer_infos = NULL;
+	self->layer_infos_tail = NULL;
+	memset(self->dense_index, 0, sizeof(self->dense_index));
+	self->index = NULL;
+	self->duplicates = 0;
+}
+
+/**
+ * @brief Get the key of a layer / datatype combination in the index hash table
+ * @param layer Layer
+ * @param datatype Datatype
+ * @return Key
+ */
+static inline gint64 layer_settings_index_key(int layer, int datatype)
+{
+	return ((gint64)layer << 32) | (guint32)datatype;
+}
+
+/**
+ * @brief Get the slot of a layer / datatype combination in the index
+ * @param settings LayerSettings object
+ * @param layer Layer
+ * @param datatype Datatype
+ * @param create Create the hash table entry if necessary
+ * @return Slot to store the link in. NULL if not present and \p create is not set
+ */
+static GList **layer_settings_index_slot(LayerSettings *settings, int layer, int datatype, gboolean create)
+{
+	gint64 key;
+	gint64 *new_key;
+	GList **slot;
+
+	if (datatype == LAYER_INFO_ANY_DATATYPE && layer >= 0 && layer < LAYER_SETTINGS_DENSE_LAYERS)
+		return &settings->dense_index[layer];
+
+	if (!settings->index) {
+		if (!create)
+			return NULL;
+		settings->index = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, g_free);
+	}
+
+	key = layer_settings_index_key(layer, datatype);
+	slot = (GList **)g_hash_table_lookup(settings->index, &key);
+	if (!slot && create) {
+		new_key = g_new(gint64, 1);
+		*new_key = key;
+		slot = g_new0(GList *, 1);
+		g_hash_table_insert(settings->index, new_key, slot);
+	}
+
+	return slot;
+}
+
+/**
+ * @brief Reset the index to an empty state
+ * @param settings LayerSettings object
+ */
+static void layer_settings_clear_index(LayerSettings *settings)
+{
+	memset(settings->dense_index, 0, sizeof(settings->dense_index));
+	if (settings->index) {
+		g_hash_table_destroy(settings->index);
+		settings->index = NULL;
+	}
+	settings->duplicates = 0;
 }
 
 static void layer_info_delete_with_name(struct layer_info *const info)
@@ -58,7 +137,9 @@ static void layer_settings_dispose(GObject *obj)
 	if (self->layer_infos) {
 		g_list_free_full(self->layer_infos, (GDestroyNotify)layer_info_delete_with_name);
 		self->layer_infos = NULL;
+		self->layer_infos_tail = NULL;
 	}
+	layer_settings_clear_index(self);
 
 	G_OBJECT_CLASS(layer_settings_parent_class)->dispose(obj);
 }
@@ -111,6 +192,8 @@ LayerSettings *layer_settings_new()
 int layer_settings_append_layer_info(LayerSettings *settings, struct layer_info *info)
 {
 	struct layer_info *info_copy;
+	GList *link;
+	GList **slot;
 
 	g_return_val_if_fail(GDS_RENDER_IS_LAYER_SETTINGS(settings), -1);
 	if (!info)
@@ -118,11 +201,28 @@ int layer_settings_append_layer_info(LayerSettings *settings, struct layer_info
 
 	/* Copy layer info */
 	info_copy = layer_info_copy(info);
-
-	/* Append to list */
-	settings->layer_infos = g_list_append(settings->layer_infos, info_copy);
-
-	return (settings->layer_infos ? 0 : -3);
+	if (!info_copy)
+		return -3;
+
+	/* Append to list. g_list_append() would walk the whole list */
+	link = g_list_alloc();
+	link->data = info_copy;
+	link->next = NULL;
+	link->prev = settings->layer_infos_tail;
+	if (link->prev)
+		link->prev->next = link;
+	else
+		settings->layer_infos = link;
+	settings->layer_infos_tail = link;
+
+	/* The first entry of a combination is found by the lookup */
+	slot = layer_settings_index_slot(settings, info_copy->layer, info_copy->datatype, TRUE);
+	if (*slot)
+		settings->duplicates++;
+	else
+		*slot = link;
+
+	return 0;
 }
 
 void layer_settings_clear(LayerSettings *settings)
@@ -132,35 +232,77 @@ void layer_settings_clear(LayerSettings *settings)
 	/* Clear list and delete layer_info structs including the name field */
 	g_list_free_full(settings->layer_infos, (GDestroyNotify)layer_info_delete_with_name);
 	settings->layer_infos = NULL;
+	settings->layer_infos_tail = NULL;
+	layer_settings_clear_index(settings);
 }
 
 int layer_settings_remove_layer(LayerSettings *settings, int layer)
 {
+	GList *found;
 	GList *list_iter;
-	GList *found = NULL;
+	GList **slot;
 	struct layer_info *inf;
 
 	g_return_val_if_fail(GDS_RENDER_IS_LAYER_SETTINGS(settings), -1);
 
-	/* Find in list */
-	for (list_iter = settings->layer_infos; list_iter; list_iter = list_iter->next) {
-		inf = (struct layer_info *)list_iter->data;
+	slot = layer_settings_index_slot(settings, layer, LAYER_INFO_ANY_DATATYPE, FALSE);
+	if (!slot || !*slot)
+		return -2;
 
-		if (!inf)
-			continue;
-		if (inf->layer == layer)
-			found = list_iter;
+	/* The last entry is removed. The indexed one is the first. Only search if there can be another one */
+	found = *slot;
+	if (settings->duplicates) {
+		for (list_iter = settings->layer_infos_tail; list_iter != *slot; list_iter = list_iter->prev) {
+			inf = (struct layer_info *)list_iter->data;
+			if (inf->layer == layer && inf->datatype == LAYER_INFO_ANY_DATATYPE) {
+				found = list_iter;
+				settings->duplicates--;
+				break;
+			}
+		}
 	}
 
-	if (found)  {
-		/* Free the layer_info struct */
-		layer_info_delete_with_name((struct layer_info *)found->data);
-		/* Delete the list element */
-		settings->layer_infos = g_list_delete_link(settings->layer_infos, found);
-		return 0;
+	if (found == *slot)
+		*slot = NULL;
+
+	if (found == settings->layer_infos_tail)
+		settings->layer_infos_tail = found->prev;
+
+	/* Free the layer_info struct */
+	layer_info_delete_with_name((struct layer_info *)found->data);
+	/* Delete the list element */
+	settings->layer_infos = g_list_delete_link(settings->layer_infos, found);
+
+	return 0;
+}
+
+const struct layer_info *layer_settings_lookup(LayerSettings *settings, int layer, int datatype)
+{
+	GList **slot;
+
+	g_return_val_if_fail(settings != NULL, NULL);
+
+	/* Exact combination first */
+	if (datatype != LAYER_INFO_ANY_DATATYPE && settings->index) {
+		slot = layer_settings_index_slot(settings, layer, datatype, FALSE);
+		if (slot && *slot)
+			return (const struct layer_info *)(*slot)->data;
 	}
 
-	return -2;
+	slot = layer_settings_index_slot(settings, layer, LAYER_INFO_ANY_DATATYPE, FALSE);
+	if (slot && *slot)
+		return (const struct layer_info *)(*slot)->data;
+
+	return NULL;
+}
+
+gboolean layer_settings_is_rendered(LayerSettings *settings, int layer, int datatype)
+{
+	const struct layer_info *info;
+
+	info = layer_settings_lookup(settings, layer, datatype);
+
+	return (info && info->render) ? TRUE : FALSE;
 }
 
 GList *layer_settings_get_layer_info_list(LayerSettings *settings)
@@ -169,6 +311,29 @@ GList *layer_settings_get_layer_info_list(LayerSettings *settings)
 	return settings->layer_infos;
 }
 
+GList *layer_settings_get_whole_layer_list(LayerSettings *settings)
+{
+	GList *list_iter;
+	GList *whole_layers = NULL;
+	struct layer_info *inf;
+
+	g_return_val_if_fail(GDS_RENDER_IS_LAYER_SETTINGS(settings), NULL);
+
+	for (list_iter = settings->layer_infos; list_iter; list_iter = list_iter->next) {
+		inf = (struct layer_info *)list_iter->data;
+		if (inf->datatype != LAYER_INFO_ANY_DATATYPE)
+			continue;
+
+		/* Skip entries hidden by an earlier one for the same layer */
+		if (layer_settings_lookup(settings, inf->layer, LAYER_INFO_ANY_DATATYPE) != inf)
+			continue;
+
+		whole_layers = g_list_prepend(whole_layers, inf);
+	}
+
+	return g_list_reverse(whole_layers);
+}
+
 /**
  * @brief Generate a layer mapping CSV line for a given layer_info struct
  * @param string Buffer to write to
@@ -178,8 +343,13 @@ static void layer_settings_gen_csv_line(GString *string, struct layer_info *linf
 {
 	int i;
 
-	g_string_printf(string, "%d:%lf:%lf:%lf:%lf:%d:%s\n",
-			linfo->layer, linfo->color.red, linfo->color.green,
+	if (linfo->datatype == LAYER_INFO_ANY_DATATYPE)
+		g_string_printf(string, "%d", linfo->layer);
+	else
+		g_string_printf(string, "%d/%d", linfo->layer, linfo->datatype);
+
+	g_string_append_printf(string, ":%lf:%lf:%lf:%lf:%d:%s\n",
+			linfo->color.red, linfo->color.green,
 			linfo->color.blue, linfo->color.alpha, (linfo->render ? 1 : 0), linfo->name);
 	/* Fix broken locale settings */
 	for (i = 0; string->str[i]; i++) {
@@ -258,7 +428,7 @@ static int layer_settings_load_csv_line_from_stream(GDataInputStream *stream, st
 		goto ret_direct;
 	}
 
-	regex = g_regex_new("^(?<layer>[0-9]+),(?<r>[0-9\\.]+),(?<g>[0-9\\.]+),(?<b>[0-9\\.]+),(?<a>[0-9\\.]+),(?<export>[01]),(?<name>.*)$", 0, 0, NULL);
+	regex = g_regex_new("^(?<layer>[0-9]+)(/(?<datatype>[0-9]+))?,(?<r>[0-9\\.]+),(?<g>[0-9\\.]+),(?<b>[0-9\\.]+),(?<a>[0-9\\.]+),(?<export>[01]),(?<name>.*)$", 0, 0, NULL);
 
 	line = g_data_input_stream_read_line(stream, &len, NULL, NULL);
 	if (!line) {
@@ -273,6 +443,9 @@ static int layer_settings_load_csv_line_from_stream(GDataInputStream *stream, st
 		match = g_match_info_fetch_named(mi, "layer");
 		linfo->layer = (int)g_ascii_strtoll(match, NULL, 10);
 		g_free(match);
+		match = g_match_info_fetch_named(mi, "datatype");
+		linfo->datatype = ((match && *match) ? (int)g_ascii_strtoll(match, NULL, 10) : LAYER_INFO_ANY_DATATYPE);
+		g_free(match);
 		match = g_match_info_fetch_named(mi, "r");
 		linfo->color.red = g_ascii_strtod(match, NULL);
 		g_free(match);
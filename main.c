@@ -24,16 +24,22 @@
  */
 
 #include <stdio.h>
-#include <gtk/gtk.h>
+#include <stdlib.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <locale.h>
 
+#ifndef GDS_RENDER_HEADLESS
+#include <gtk/gtk.h>
 #include <gds-render/gds-render-gui.h>
+#endif
 #include <gds-render/command-line.h>
+#include <gds-render/render-server.h>
 #include <gds-render/output-renderers/external-renderer.h>
+#include <gds-render/gds-utils/gds-window.h>
 #include <gds-render/version.h>
 
+#ifndef GDS_RENDER_HEADLESS
 /**
  * @brief Structure containing The GtkApplication and a list containing the GdsRenderGui objects.
  */
@@ -236,6 +242,25 @@ static int start_gui(int argc, char **argv)
 	return app_status;
 }
 
+#else /* GDS_RENDER_HEADLESS */
+
+/**
+ * @brief Replacement of the GUI in the headless build
+ * @param argc unused
+ * @param argv unused
+ * @return Always 1
+ */
+static int start_gui(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	fprintf(stderr, _("This build of gds-render has no graphical interface. Check --help option\n"));
+	return 1;
+}
+
+#endif /* GDS_RENDER_HEADLESS */
+
 /**
  * @brief Print the application version string to stdout
  */
@@ -259,14 +284,33 @@ int main(int argc, char **argv)
 	gchar *gds_name;
 	gchar **output_paths = NULL;
 	gchar *mappingname = NULL;
-	gchar *cellname = NULL;
+	struct command_line_cell_selection cell_selection = {
+		.cell_names = NULL,
+		.cell_globs = NULL,
+		.cell_regex = NULL,
+		.all_top_cells = FALSE,
+	};
+	gchar *cell_regex = NULL;
 	gchar **renderer_args = NULL;
 	gboolean version = FALSE, pdf_standalone = FALSE, pdf_layers = FALSE;
 	gboolean analyze = FALSE;
 	gchar *format = NULL;
 	int scale = 1000;
+	int jobs = 0;
+	gchar *manifest = NULL;
+	int memory_limit = 0;
+	gchar *serve_socket = NULL;
+	int serve_cache = 4;
 	int app_status = 0;
 	struct external_renderer_params so_render_params;
+	gboolean cairo_fork = FALSE;
+	gboolean cairo_no_hairline = FALSE;
+	gboolean cairo_batch = FALSE;
+	gboolean pdf_no_compress = FALSE;
+	gboolean pdf_native_layers = FALSE;
+	gboolean tiles_overwrite = FALSE;
+	gchar *window = NULL;
+	struct command_line_render_options render_options;
 
 	so_render_params.so_path = NULL;
 	so_render_params.cli_params = NULL;
@@ -280,12 +324,45 @@ int main(int argc, char **argv)
 		{"analyze", 'A', 0, G_OPTION_ARG_NONE, &analyze, _("Anaylze GDS file"), NULL},
 		{"format", 'f', 0, G_OPTION_ARG_STRING, &format, _("Output format of analysis result, Default simple"), "[simple | pretty | cellsonly]"},
 		{"renderer", 'r', 0, G_OPTION_ARG_STRING_ARRAY, &renderer_args,
-			_("Renderer to use. Can be used multiple times."), "pdf|svg|tikz|ext"},
+			_("Renderer to use. Can be used multiple times."), "pdf|pdf-native|svg|svg-native|png|tiles|tikz|ext"},
 		{"scale", 's', 0, G_OPTION_ARG_INT, &scale, _("Divide output coordinates by <SCALE>"), "<SCALE>" },
 		{"output-file", 'o', 0, G_OPTION_ARG_FILENAME_ARRAY, &output_paths,
-			_("Output file path. Can be used multiple times."), "PATH" },
+			_("Output file path. Can be used multiple times. {cell} and {lib} are replaced by cell and library name."),
+			"PATH" },
 		{"mapping", 'm', 0, G_OPTION_ARG_FILENAME, &mappingname, _("Path for Layer Mapping File"), "PATH" },
-		{"cell", 'c', 0, G_OPTION_ARG_STRING, &cellname, _("Cell to render"), "NAME" },
+		{"cell", 'c', 0, G_OPTION_ARG_STRING_ARRAY, &cell_selection.cell_names,
+			_("Cell to render. Can be used multiple times."), "NAME" },
+		{"cell-glob", 'g', 0, G_OPTION_ARG_STRING_ARRAY, &cell_selection.cell_globs,
+			_("Render all cells matching the glob pattern. Can be used multiple times."), "PATTERN" },
+		{"cell-regex", 'x', 0, G_OPTION_ARG_STRING, &cell_regex,
+			_("Render all cells matching the regular expression"), "REGEX" },
+		{"all-top-cells", 't', 0, G_OPTION_ARG_NONE, &cell_selection.all_top_cells,
+			_("Render all cells not referenced by another cell"), NULL },
+		{"jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+			_("Count of parallel rendering jobs. Default: count of processors"), "N" },
+		{"manifest", 'M', 0, G_OPTION_ARG_FILENAME, &manifest,
+			_("Execute all jobs of a CSV manifest (gds,cell,renderer,output,mapping[,scale])"), "PATH" },
+		{"memory-limit", 0, 0, G_OPTION_ARG_INT, &memory_limit,
+			_("Memory budget for parsed GDS files in manifest mode. Default: half of the physical memory"),
+			"MiB" },
+		{"serve", 0, 0, G_OPTION_ARG_FILENAME, &serve_socket,
+			_("Run as render server listening on the Unix domain socket PATH"), "PATH" },
+		{"serve-cache", 0, 0, G_OPTION_ARG_INT, &serve_cache,
+			_("Count of GDS files kept in memory by the render server. Default: 4"), "N" },
+		{"cairo-fork", 0, 0, G_OPTION_ARG_NONE, &cairo_fork,
+			_("Isolate the Cairo renderer (pdf, svg) in a separate process"), NULL },
+		{"cairo-no-hairline", 0, 0, G_OPTION_ARG_NONE, &cairo_no_hairline,
+			_("Do not stroke the polygons of the Cairo renderer (pdf, svg) with a hairline"), NULL },
+		{"cairo-batch", 0, 0, G_OPTION_ARG_NONE, &cairo_batch,
+			_("Fill all polygons of a cell on the same layer at once in the Cairo renderer (pdf, svg)"), NULL },
+		{"pdf-no-compress", 0, 0, G_OPTION_ARG_NONE, &pdf_no_compress,
+			_("Do not compress the content streams of the native PDF renderer (pdf-native)"), NULL },
+		{"pdf-layers", 0, 0, G_OPTION_ARG_NONE, &pdf_native_layers,
+			_("Create PDF Layers (OCG) in the native PDF renderer (pdf-native)"), NULL },
+		{"tiles-overwrite", 0, 0, G_OPTION_ARG_NONE, &tiles_overwrite,
+			_("Render existing tiles of the tile pyramid again (tiles)"), NULL },
+		{"window", 0, 0, G_OPTION_ARG_STRING, &window,
+			_("Only render the window given in database units"), "X0,Y0,X1,Y1" },
 		{"tex-standalone", 'a', 0, G_OPTION_ARG_NONE, &pdf_standalone, _("Create standalone TeX"), NULL },
 		{"tex-layers", 'l', 0, G_OPTION_ARG_NONE, &pdf_layers, _("Create PDF Layers (OCG)"), NULL },
 		{"custom-render-lib", 'P', 0, G_OPTION_ARG_FILENAME, &so_render_params.so_path,
@@ -297,7 +374,9 @@ int main(int argc, char **argv)
 
 	context = g_option_context_new(_(" FILE - Convert GDS file <FILE> to graphic"));
 	g_option_context_add_main_entries(context, entries, NULL);
+#ifndef GDS_RENDER_HEADLESS
 	g_option_context_add_group(context, gtk_get_option_group(TRUE));
+#endif
 
 	if (!g_option_context_parse(context, &argc, &argv, &error)) {
 		g_print(_("Option parsing failed: %s\n"), error->message);
@@ -311,7 +390,33 @@ int main(int argc, char **argv)
 		goto ret_status;
 	}
 
-	if (argc >= 2) {
+	render_options.ext_params = &so_render_params;
+	render_options.tex_standalone = pdf_standalone;
+	render_options.tex_layers = pdf_layers;
+	render_options.cairo_fork = cairo_fork;
+	render_options.cairo_hairline = !cairo_no_hairline;
+	render_options.cairo_batch = cairo_batch;
+	render_options.pdf_compress = !pdf_no_compress;
+	render_options.pdf_layers = pdf_native_layers;
+	render_options.tiles_overwrite = tiles_overwrite;
+	render_options.window_set = FALSE;
+	if (window) {
+		if (!gds_window_parse(window, &render_options.window)) {
+			fprintf(stderr, _("Invalid window: %s\n"), window);
+			app_status = 1;
+			goto ret_status;
+		}
+		render_options.window_set = TRUE;
+	}
+
+	if (serve_socket) {
+		app_status = render_server_run(serve_socket, jobs, serve_cache, &render_options);
+	} else if (manifest) {
+		for (i = 1; i < argc; i++)
+			printf(_("Ignored argument: %s"), argv[i]);
+
+		app_status = command_line_convert_manifest(manifest, &render_options, jobs, memory_limit);
+	} else if (argc >= 2) {
 		if (scale < 1) {
 			printf(_("Scale < 1 not allowed. Setting to 1\n"));
 			scale = 1;
@@ -327,9 +432,10 @@ int main(int argc, char **argv)
 		if (analyze) {
 			app_status = command_line_analyze_lib(format, gds_name);
 		} else {
+			cell_selection.cell_regex = cell_regex;
 			app_status =
-				command_line_convert_gds(gds_name, cellname, renderer_args, output_paths, mappingname,
-							 &so_render_params, pdf_standalone, pdf_layers, scale);
+				command_line_convert_gds(gds_name, &cell_selection, renderer_args, output_paths,
+							 mappingname, &render_options, scale, jobs);
 		}
 	} else {
 		app_status = start_gui(argc, argv);
@@ -346,8 +452,18 @@ ret_status:
 		g_strfreev(renderer_args);
 	if (mappingname)
 		g_free(mappingname);
-	if (cellname)
-		free(cellname);
+	if (cell_selection.cell_names)
+		g_strfreev(cell_selection.cell_names);
+	if (cell_selection.cell_globs)
+		g_strfreev(cell_selection.cell_globs);
+	if (cell_regex)
+		g_free(cell_regex);
+	if (manifest)
+		g_free(manifest);
+	if (serve_socket)
+		g_free(serve_socket);
+	if (window)
+		g_free(window);
 	if (so_render_params.so_path)
 		free(so_render_params.so_path);
 	if (so_render_params.cli_params)
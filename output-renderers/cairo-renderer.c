@@ -28,22 +28,108 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
 #include <cairo.h>
 #include <cairo-pdf.h>
 #include <cairo-svg.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include <gds-render/output-renderers/cairo-renderer.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
 #include <sys/wait.h>
+#include <signal.h>
 #include <unistd.h>
 
 struct _CairoRenderer {
 	GdsOutputRenderer parent;
 	gboolean svg; /**< @brief TRUE: SVG output, FALSE: PDF output */
+	gboolean fork_isolation; /**< @brief TRUE: Render in a forked child process */
+	gboolean hairline_stroke; /**< @brief TRUE: Stroke the outline of polygons with a hairline */
+	gboolean batch_polygons; /**< @brief TRUE: Fill all polygons of a cell on a layer at once */
 };
 
 G_DEFINE_TYPE(CairoRenderer, cairo_renderer, GDS_RENDER_TYPE_OUTPUT_RENDERER)
 
+enum {
+	PROP_FORK_ISOLATION = 1,
+	PROP_HAIRLINE_STROKE,
+	PROP_BATCH_POLYGONS,
+	N_PROPERTIES
+};
+
+static GParamSpec *cairo_renderer_properties[N_PROPERTIES] = {NULL};
+
+/**
+ * @brief Maximum length of a progress message including the terminating null character
+ */
+#define CAIRO_PROGRESS_MESSAGE_LEN (200)
+
+/**
+ * @brief Count of progress records the parent process reads from the pipe at once
+ */
+#define CAIRO_PROGRESS_READ_RECORDS (32)
+
+/**
+ * @brief Count of progress reports sent while rendering the primitives
+ */
+#define CAIRO_PROGRESS_STEPS (100)
+
+/**
+ * @brief Phases of a Cairo rendering run
+ */
+enum cairo_render_phase {
+	CAIRO_PHASE_SETUP = 0, /**< @brief Creating the layers */
+	CAIRO_PHASE_RENDERING, /**< @brief Rendering the primitives into the layers */
+	CAIRO_PHASE_MEASURING, /**< @brief Calculating the output size */
+	CAIRO_PHASE_EXPORTING, /**< @brief Writing the layers to the output file */
+	CAIRO_PHASE_FINISHED, /**< @brief Output complete */
+};
+
+/**
+ * @brief Progress record sent from the rendering child process to the parent
+ *
+ * The records have a fixed size smaller than PIPE_BUF. Therefore, they are written atomically.
+ */
+struct cairo_progress_record {
+	guint32 phase; /**< @brief Current phase. See @ref cairo_render_phase */
+	guint32 reserved; /**< @brief Padding */
+	guint64 done; /**< @brief Primitives rendered so far */
+	guint64 total; /**< @brief Total count of primitives, including all instances */
+	guint64 bytes_written; /**< @brief Bytes written to the output file(s) */
+	char message[CAIRO_PROGRESS_MESSAGE_LEN]; /**< @brief Null terminated status message */
+};
+
+/**
+ * @brief Progress state and destination of a rendering run
+ */
+struct cairo_render_status {
+	GdsOutputRenderer *renderer; /**< @brief Renderer to report to if rendering in-process */
+	int pipe_fd; /**< @brief Write end of the status pipe if rendering in a child process. Else -1 */
+	gint64 start_time; /**< @brief Monotonic start time of the rendering run. Used for in-process ETA */
+	guint64 next_report; /**< @brief Primitive count at which the next progress report is sent */
+	guint64 report_step; /**< @brief Primitives between two progress reports */
+	GCancellable *cancellable; /**< @brief Cancellable of the rendering. NULL in a child process */
+	gboolean cancelled; /**< @brief The rendering has been cancelled */
+	struct gds_layer_usage rendered_layers; /**< @brief Layers that are rendered. Used to skip empty sub-trees */
+	gboolean hairline_stroke; /**< @brief Stroke the outline of polygons with a hairline to prevent gaps */
+	gboolean batch_polygons; /**< @brief Collect all polygons of a cell on a layer in the pending path */
+	GArray *pending_layers; /**< @brief Layer numbers (int) with a pending path of the current cell. See cairo_layer::pending */
+	struct cairo_progress_record record; /**< @brief Current progress */
+};
+
+/**
+ * @brief Output file of the Cairo surfaces. Counts the written bytes
+ */
+struct cairo_output_stream {
+	FILE *file; /**< @brief Output file */
+	struct cairo_render_status *status; /**< @brief Progress state to update */
+	gboolean error; /**< @brief A write error occured */
+};
+
 /**
  * @brief The cairo_layer struct
  * Each rendered layer is represented by this struct.
@@ -52,8 +138,131 @@ struct cairo_layer {
 	cairo_t *cr; /**< @brief cairo context for layer*/
 	cairo_surface_t *rec; /**< @brief Recording surface to hold the layer */
 	struct layer_info *linfo; /**< @brief Reference to layer information */
+	gboolean pending; /**< @brief The current path contains polygons that have not been filled yet */
 };
 
+/**
+ * @brief Check if the rendering has been cancelled
+ *
+ * In a child process, the cancellable is not available. The parent process kills the child instead.
+ *
+ * @param status Progress state
+ * @return TRUE if the rendering shall be aborted
+ */
+static inline gboolean cairo_render_status_cancelled(struct cairo_render_status *status)
+{
+	if (!status->cancelled && status->cancellable)
+		status->cancelled = g_cancellable_is_cancelled(status->cancellable);
+
+	return status->cancelled;
+}
+
+/**
+ * @brief Pass a progress record to the renderer's progress reporting
+ * @param renderer Renderer
+ * @param record Progress
+ * @param start_time Monotonic time the rendering was started. Used to estimate the remaining time
+ */
+static void cairo_renderer_report_progress(GdsOutputRenderer *renderer, const struct cairo_progress_record *record,
+					   gint64 start_time)
+{
+	char *message;
+	char *size;
+	double fraction;
+	double elapsed;
+
+	if (record->phase == CAIRO_PHASE_RENDERING && record->total && record->done) {
+		fraction = (double)record->done / (double)record->total;
+		elapsed = (double)(g_get_monotonic_time() - start_time) / G_USEC_PER_SEC;
+		message = g_strdup_printf(_("%s: %.0f %% (%" G_GUINT64_FORMAT " / %" G_GUINT64_FORMAT "), %.1f s remaining"),
+					  record->message, fraction * 100.0, record->done, record->total,
+					  elapsed * (1.0 - fraction) / fraction);
+	} else if (record->phase >= CAIRO_PHASE_EXPORTING && record->bytes_written) {
+		size = g_format_size(record->bytes_written);
+		message = g_strdup_printf(_("%s: %s written"), record->message, size);
+		g_free(size);
+	} else {
+		message = g_strdup(record->message);
+	}
+
+	gds_output_renderer_update_async_progress(renderer, message);
+	g_free(message);
+
+	switch (record->phase) {
+	case CAIRO_PHASE_SETUP:
+		gds_output_renderer_update_async_fraction(renderer, 0.0, GDS_OUTPUT_RENDERER_PHASE_SETUP);
+		break;
+	case CAIRO_PHASE_RENDERING:
+		gds_output_renderer_update_async_fraction(renderer, (record->total ?
+							  (double)record->done / (double)record->total : 0.0),
+							  GDS_OUTPUT_RENDERER_PHASE_RENDERING);
+		break;
+	case CAIRO_PHASE_MEASURING:
+	case CAIRO_PHASE_EXPORTING:
+		/* The final output size is unknown. Only the phase is reported */
+		gds_output_renderer_update_async_fraction(renderer, 0.0, GDS_OUTPUT_RENDERER_PHASE_EXPORTING);
+		break;
+	default:
+		gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_FINISHED);
+		break;
+	}
+}
+
+/**
+ * @brief Publish the current progress of \p status
+ *
+ * In-process, the progress is reported directly. In a child process, the record is written to the status pipe
+ * and forwarded by the parent process.
+ *
+ * @param status Progress state
+ */
+static void cairo_render_status_send(struct cairo_render_status *status)
+{
+	ssize_t res;
+
+	if (status->pipe_fd < 0) {
+		cairo_renderer_report_progress(status->renderer, &status->record, status->start_time);
+		return;
+	}
+
+	do {
+		res = write(status->pipe_fd, &status->record, sizeof(status->record));
+	} while (res < 0 && errno == EINTR);
+}
+
+/**
+ * @brief Change the phase and message of the rendering run and publish it
+ * @param status Progress state
+ * @param phase New phase
+ * @param format printf format string of the message
+ */
+static void G_GNUC_PRINTF(3, 4) cairo_render_status_message(struct cairo_render_status *status,
+							    enum cairo_render_phase phase,
+							    const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	g_vsnprintf(status->record.message, sizeof(status->record.message), format, args);
+	va_end(args);
+
+	status->record.phase = (guint32)phase;
+	cairo_render_status_send(status);
+}
+
+/**
+ * @brief Count a rendered primitive. Publishes the progress every 1/@ref CAIRO_PROGRESS_STEPS of the total count
+ * @param status Progress state
+ */
+static inline void cairo_render_status_primitive_done(struct cairo_render_status *status)
+{
+	if (++status->record.done < status->next_report)
+		return;
+
+	status->next_report += status->report_step;
+	cairo_render_status_send(status);
+}
+
 /**
  * @brief Revert the last transformation on all layers
  * @param layers Pointer to #cairo_layer structures
@@ -102,13 +311,137 @@ static void apply_inherited_transform_to_all_layers(struct cairo_layer *layers,
 	}
 }
 
+/**
+ * @brief Fill the pending path of a layer
+ * @param lay Layer
+ * @param scale Scale the image down by this factor. Used for the hairline width
+ * @param status Rendering state
+ */
+static void cairo_layer_flush(struct cairo_layer *lay, double scale, struct cairo_render_status *status)
+{
+	if (!lay->pending)
+		return;
+
+	if (status->hairline_stroke) {
+		cairo_set_line_width(lay->cr, 0.1/scale);
+		cairo_stroke_preserve(lay->cr); // Prevent graphic glitches
+	}
+	cairo_fill(lay->cr);
+	lay->pending = FALSE;
+}
+
+/**
+ * @brief Fill the pending paths of all layers
+ * @param layers Array of layers
+ * @param scale Scale the image down by this factor
+ * @param status Rendering state
+ */
+static void cairo_layers_flush_pending(struct cairo_layer *layers, double scale, struct cairo_render_status *status)
+{
+	guint i;
+
+	for (i = 0; i < status->pending_layers->len; i++)
+		cairo_layer_flush(&layers[g_array_index(status->pending_layers, int, i)], scale, status);
+
+	g_array_set_size(status->pending_layers, 0);
+}
+
+/**
+ * @brief Add a rectangle to the pending path of a layer
+ *
+ * All rectangles are added with the same orientation. Therefore, overlapping rectangles do not cancel out
+ * with the nonzero winding rule.
+ *
+ * @param lay Layer
+ * @param layer Layer number
+ * @param gfx Rectangle. See gds_graphics::rectangle
+ * @param scale Scale the image down by this factor
+ * @param status Rendering state
+ */
+static void cairo_layer_add_rectangle(struct cairo_layer *lay, int layer, const struct gds_graphics *gfx,
+				      double scale, struct cairo_render_status *status)
+{
+	const struct gds_point *p0;
+	const struct gds_point *p2;
+
+	p0 = (const struct gds_point *)gfx->vertices->data;
+	p2 = (const struct gds_point *)gfx->vertices->next->next->data;
+
+	cairo_rectangle(lay->cr, MIN(p0->x, p2->x)/scale, MIN(p0->y, p2->y)/scale,
+			ABS(p2->x - p0->x)/scale, ABS(p2->y - p0->y)/scale);
+
+	if (!lay->pending) {
+		lay->pending = TRUE;
+		g_array_append_val(status->pending_layers, layer);
+	}
+}
+
+/**
+ * @brief Add a polygon to the pending path of a layer
+ *
+ * The polygon is added counter clockwise, regardless of the order of its vertices. Therefore, overlapping polygons
+ * of the same layer do not cancel out with the nonzero winding rule.
+ *
+ * @param lay Layer
+ * @param layer Layer number
+ * @param gfx Polygon or box
+ * @param scale Scale the image down by this factor
+ * @param status Rendering state
+ */
+static void cairo_layer_add_polygon(struct cairo_layer *lay, int layer, const struct gds_graphics *gfx,
+				    double scale, struct cairo_render_status *status)
+{
+	GList *vertex_list;
+	GList *last = NULL;
+	const struct gds_point *vertex;
+	const struct gds_point *next;
+	double area = 0.0;
+
+	if (!gfx->vertices)
+		return;
+
+	/* Shoelace formula. The sign gives the orientation */
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		next = (const struct gds_point *)(vertex_list->next ? vertex_list->next->data : gfx->vertices->data);
+		area += (double)vertex->x * (double)next->y - (double)next->x * (double)vertex->y;
+		last = vertex_list;
+	}
+
+	if (area >= 0.0) {
+		for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+			vertex = (const struct gds_point *)vertex_list->data;
+			if (vertex_list->prev == NULL)
+				cairo_move_to(lay->cr, vertex->x/scale, vertex->y/scale);
+			else
+				cairo_line_to(lay->cr, vertex->x/scale, vertex->y/scale);
+		}
+	} else {
+		for (vertex_list = last; vertex_list != NULL; vertex_list = vertex_list->prev) {
+			vertex = (const struct gds_point *)vertex_list->data;
+			if (vertex_list == last)
+				cairo_move_to(lay->cr, vertex->x/scale, vertex->y/scale);
+			else
+				cairo_line_to(lay->cr, vertex->x/scale, vertex->y/scale);
+		}
+	}
+	cairo_close_path(lay->cr);
+
+	if (!lay->pending) {
+		lay->pending = TRUE;
+		g_array_append_val(status->pending_layers, layer);
+	}
+}
+
 /**
  * @brief render_cell Render a cell with its sub-cells
  * @param cell Cell to render
  * @param layers Cell will be rendered into these layers
  * @param scale sclae image down by this factor
+ * @param status Progress state. Every graphics object is counted
  */
-static void render_cell(struct gds_cell *cell, struct cairo_layer *layers, double scale)
+static void render_cell(struct gds_cell *cell, struct cairo_layer *layers, double scale,
+			struct cairo_render_status *status)
 {
 	GList *instance_list;
 	struct gds_cell *temp_cell;
@@ -119,18 +452,21 @@ static void render_cell(struct gds_cell *cell, struct cairo_layer *layers, doubl
 	struct gds_point *vertex;
 	cairo_t *cr;
 
+	if (cairo_render_status_cancelled(status))
+		return;
+
 	/* Render child cells */
 	for (instance_list = cell->child_cells; instance_list != NULL; instance_list = instance_list->next) {
 		cell_instance = (struct gds_cell_instance *)instance_list->data;
 		temp_cell = cell_instance->cell_ref;
-		if (temp_cell != NULL) {
+		if (temp_cell != NULL && gds_layer_usage_cell_uses_layers(temp_cell, &status->rendered_layers)) {
 			apply_inherited_transform_to_all_layers(layers,
 								&cell_instance->origin,
 								cell_instance->magnification,
 								cell_instance->flipped,
 								cell_instance->angle,
 								scale);
-			render_cell(temp_cell, layers, scale);
+			render_cell(temp_cell, layers, scale, status);
 			revert_inherited_transform(layers);
 		}
 	}
@@ -138,6 +474,7 @@ static void render_cell(struct gds_cell *cell, struct cairo_layer *layers, doubl
 	/* Render graphics */
 	for (gfx_list = cell->graphic_objs; gfx_list != NULL; gfx_list = gfx_list->next) {
 		gfx = (struct gds_graphics *)gfx_list->data;
+		cairo_render_status_primitive_done(status);
 
 		/* Get layer renderer */
 		if (gfx->layer >= MAX_LAYERS)
@@ -147,6 +484,20 @@ static void render_cell(struct gds_cell *cell, struct cairo_layer *layers, doubl
 		if (cr == NULL)
 			continue;
 
+		/* Rectangles of a cell are collected and filled at once */
+		if (gfx->rectangle) {
+			cairo_layer_add_rectangle(&layers[gfx->layer], gfx->layer, gfx, scale, status);
+			continue;
+		}
+
+		if (status->batch_polygons && (gfx->gfx_type == GRAPHIC_POLYGON || gfx->gfx_type == GRAPHIC_BOX)) {
+			cairo_layer_add_polygon(&layers[gfx->layer], gfx->layer, gfx, scale, status);
+			continue;
+		}
+
+		/* Do not mix the pending rectangles into this object's path */
+		cairo_layer_flush(&layers[gfx->layer], scale, status);
+
 		/* Apply settings */
 		cairo_set_line_width(cr, (gfx->width_absolute ? gfx->width_absolute/scale : 1));
 
@@ -181,121 +532,173 @@ static void render_cell(struct gds_cell *cell, struct cairo_layer *layers, doubl
 		case GRAPHIC_BOX:
 			/* Expected fallthrough */
 		case GRAPHIC_POLYGON:
-			cairo_set_line_width(cr, 0.1/scale);
 			cairo_close_path(cr);
-			cairo_stroke_preserve(cr); // Prevent graphic glitches
+			if (status->hairline_stroke) {
+				cairo_set_line_width(cr, 0.1/scale);
+				cairo_stroke_preserve(cr); // Prevent graphic glitches
+			}
 			cairo_fill(cr);
 			break;
 		}
 	} /* for gfx list */
+
+	cairo_layers_flush_pending(layers, scale, status);
 }
 
 /**
- * @brief Read a line from a file descriptor
+ * @brief Count the primitives rendered for \p cell, including all instances of sub-cells
  *
- * In case of a broken pipe / closed writing end, it will terminate
+ * Sub-cells without any rendered layer are skipped like in render_cell().
  *
- * @param fd File descriptor to read from
- * @param buff Buffer to write data in
- * @param buff_size Buffer size
- * @return length of read data
+ * @param cell Cell
+ * @param counts Already counted cells. Maps the cell to a guint64 count
+ * @param layers Rendered layers
+ * @return Primitive count
  */
-static int read_line_from_fd(int fd, char *buff, size_t buff_size)
+static guint64 cairo_renderer_count_primitives(struct gds_cell *cell, GHashTable *counts,
+					       const struct gds_layer_usage *layers)
 {
-	ssize_t cnt;
-	char c;
-	unsigned int buff_cnt = 0;
-
-	while ((cnt = read(fd, &c, 1)) == 1) {
-		if (buff_cnt < (buff_size-1)) {
-			buff[buff_cnt++] = c;
-			if (c == '\n')
-				break;
-		} else {
-			break;
-		}
+	guint64 *count;
+	GList *instance_list;
+	struct gds_cell_instance *cell_instance;
+	guint64 sum;
+
+	count = (guint64 *)g_hash_table_lookup(counts, cell);
+	if (count)
+		return *count;
+
+	/* Insert before descending. Guards against reference loops */
+	count = g_new0(guint64, 1);
+	g_hash_table_insert(counts, cell, count);
+
+	sum = g_list_length(cell->graphic_objs);
+	for (instance_list = cell->child_cells; instance_list != NULL; instance_list = instance_list->next) {
+		cell_instance = (struct gds_cell_instance *)instance_list->data;
+		if (cell_instance->cell_ref && gds_layer_usage_cell_uses_layers(cell_instance->cell_ref, layers))
+			sum += cairo_renderer_count_primitives(cell_instance->cell_ref, counts, layers);
 	}
 
-	buff[buff_cnt] = 0;
-	return (int)buff_cnt;
+	*count = sum;
+	return sum;
 }
 
 /**
- * @brief Render \p cell to a PDF file specified by \p pdf_file
- * @param renderer The current renderer this function is running from
+ * @brief Initialize the progress state of a rendering run
+ * @param status Progress state
+ * @param renderer Renderer for in-process reporting
+ * @param pipe_fd Pipe to write progress records to. -1 for in-process reporting
+ * @param cancellable Cancellable of the rendering. May be NULL
+ * @param cell Cell that is rendered
+ * @param layer_infos List of layer information
+ * @note Free the status with cairo_render_status_clear()
+ */
+static void cairo_render_status_init(struct cairo_render_status *status, GdsOutputRenderer *renderer, int pipe_fd,
+				     GCancellable *cancellable, struct gds_cell *cell, GList *layer_infos)
+{
+	GHashTable *counts;
+	GList *info_list;
+	struct layer_info *linfo;
+
+	memset(status, 0, sizeof(*status));
+	status->renderer = renderer;
+	status->pipe_fd = pipe_fd;
+	status->cancellable = cancellable;
+	status->start_time = g_get_monotonic_time();
+
+	status->hairline_stroke = TRUE;
+	status->batch_polygons = FALSE;
+	status->pending_layers = g_array_new(FALSE, FALSE, sizeof(int));
+
+	gds_layer_usage_init(&status->rendered_layers);
+	for (info_list = layer_infos; info_list != NULL; info_list = g_list_next(info_list)) {
+		linfo = (struct layer_info *)info_list->data;
+		if (linfo->render)
+			gds_layer_usage_add(&status->rendered_layers, (int16_t)linfo->layer);
+	}
+
+	counts = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	status->record.total = cairo_renderer_count_primitives(cell, counts, &status->rendered_layers);
+	g_hash_table_destroy(counts);
+
+	status->report_step = MAX(status->record.total / CAIRO_PROGRESS_STEPS, 1);
+	status->next_report = status->report_step;
+}
+
+/**
+ * @brief Free the memory held by a progress state
+ * @param status Progress state
+ */
+static void cairo_render_status_clear(struct cairo_render_status *status)
+{
+	gds_layer_usage_clear(&status->rendered_layers);
+	g_array_free(status->pending_layers, TRUE);
+	status->pending_layers = NULL;
+}
+
+/**
+ * @brief Write callback of the Cairo output surfaces
+ * @param closure @ref cairo_output_stream
+ * @param data Data to write
+ * @param length Length of \p data
+ * @return Cairo status
+ */
+static cairo_status_t cairo_renderer_write_to_stream(void *closure, const unsigned char *data, unsigned int length)
+{
+	struct cairo_output_stream *stream = (struct cairo_output_stream *)closure;
+	struct cairo_render_status *status = stream->status;
+	guint64 before;
+
+	if (fwrite(data, 1, length, stream->file) != length) {
+		stream->error = TRUE;
+		return CAIRO_STATUS_WRITE_ERROR;
+	}
+
+	/* Report every MiB written */
+	before = status->record.bytes_written;
+	status->record.bytes_written += length;
+	if ((before >> 20) != (status->record.bytes_written >> 20))
+		cairo_render_status_send(status);
+
+	return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * @brief Render \p cell to a PDF and/or SVG file
+ *
+ * All Cairo objects are destroyed before this function returns, also in case of an error.
+ * This function is thread safe and can be used in-process as well as in a child process.
+ *
  * @param cell Toplevel cell to @ref Cairo-Renderer
  * @param layer_infos List of layer information. Specifies color and layer stacking
  * @param pdf_file PDF output file. Set to NULL if no PDF file has to be generated
  * @param svg_file SVG output file. Set to NULL if no SVG file has to be generated
  * @param scale Scale the output image down by \p scale
- * @return Error
+ * @param status Progress state
+ * @return 0 if successful
  */
-static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer,
-						     struct gds_cell *cell,
-						     GList *layer_infos,
-						     const char *pdf_file,
-						     const char *svg_file,
-						     double scale)
+static int cairo_renderer_render_layers(struct gds_cell *cell,
+					GList *layer_infos,
+					const char *pdf_file,
+					const char *svg_file,
+					double scale,
+					struct cairo_render_status *status)
 {
 	cairo_surface_t *pdf_surface = NULL, *svg_surface = NULL;
 	cairo_t *pdf_cr = NULL, *svg_cr = NULL;
+	struct cairo_output_stream pdf_stream = {NULL, status, FALSE};
+	struct cairo_output_stream svg_stream = {NULL, status, FALSE};
 	struct layer_info *linfo;
 	struct cairo_layer *layers;
 	struct cairo_layer *lay;
 	GList *info_list;
 	int i;
+	int ret = 0;
 	double rec_x0, rec_y0, rec_width, rec_height;
 	double xmin = INT32_MAX, xmax = INT32_MIN, ymin = INT32_MAX, ymax = INT32_MIN;
-	pid_t process_id;
-	int comm_pipe[2];
-	char receive_message[200];
-
-	if (pdf_file == NULL && svg_file == NULL) {
-		/* No output specified */
-		return -1;
-	}
-
-	/* Generate communication pipe for status updates */
-	if (pipe(comm_pipe) == -1)
-		return -2;
-
-	/* Fork to a new child process. This ensures the memory leaks (see issue #16) in Cairo don't
-	 * brick everything.
-	 *
-	 * And by the way: This now bricks all Windows compatibility. Deal with it.
-	 */
-	process_id = fork();
-	//process_id = -1;
-	if (process_id < 0) {
-		/* This should not happen */
-		fprintf(stderr, _("Fatal error: Cairo Renderer: Could not spawn child process!"));
-		exit(-2);
-	} else if (process_id > 0) {
-		/* Woohoo... Successfully dumped the shitty code to an unknowing victim */
-		goto ret_parent;
-	}
-
-	/* We are now in a separate process just for rendering the output image.
-     * You may print a log message to the activity bar of the gui by writing a line
-     * teminated with '\n' to comm_pipe[1]. This will be handled by the parent process.
-     * Directly calling the update function 
-     *     gds_output_renderer_update_async_progress()
-     * does not have any effect because this is a separate process.
-     */
-  
-	/*
-     * Close stdin and (stdout and stderr may live on)
-     */
-	close(0);
-	close(comm_pipe[0]);
 
 	layers = (struct cairo_layer *)calloc(MAX_LAYERS, sizeof(struct cairo_layer));
-
-	/* Clear layers */
-	for (i = 0; i < MAX_LAYERS; i++) {
-		layers[i].cr = NULL;
-		layers[i].rec = NULL;
-	}
+	if (!layers)
+		return -3;
 
 	/* Create recording surface for each layer */
 	for (info_list = layer_infos; info_list != NULL; info_list = g_list_next(info_list)) {
@@ -314,12 +717,17 @@ static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer
 			cairo_set_source_rgb(lay->cr, linfo->color.red, linfo->color.green, linfo->color.blue);
 		} else {
 			printf("Layer number (%d) too high!\n", linfo->layer);
+			ret = -4;
 			goto ret_clear_layers;
 		}
 	}
 
-	dprintf(comm_pipe[1], "Rendering layers\n");
-	render_cell(cell, layers, scale);
+	cairo_render_status_message(status, CAIRO_PHASE_RENDERING, _("Rendering layers"));
+	render_cell(cell, layers, scale, status);
+	if (status->cancelled) {
+		ret = GDS_OUTPUT_RENDERER_CANCELLED;
+		goto ret_clear_layers;
+	}
 
 	/* get size of image and top left coordinate */
 	for (info_list = layer_infos; info_list != NULL; info_list = g_list_next(info_list)) {
@@ -336,12 +744,13 @@ static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer
 		/* Print size */
 		cairo_recording_surface_ink_extents(layers[linfo->layer].rec, &rec_x0, &rec_y0,
 				&rec_width, &rec_height);
-		dprintf(comm_pipe[1], _("Size of layer %d%s%s%s: <%lf x %lf> @ (%lf | %lf)\n"),
-			linfo->layer,
-			(linfo->name && linfo->name[0] ? " (" : ""),
-			(linfo->name && linfo->name[0] ? linfo->name : ""),
-			(linfo->name && linfo->name[0] ? ")" : ""),
-			rec_width, rec_height, rec_x0, rec_y0);
+		cairo_render_status_message(status, CAIRO_PHASE_MEASURING,
+					    _("Size of layer %d%s%s%s: <%lf x %lf> @ (%lf | %lf)"),
+					    linfo->layer,
+					    (linfo->name && linfo->name[0] ? " (" : ""),
+					    (linfo->name && linfo->name[0] ? linfo->name : ""),
+					    (linfo->name && linfo->name[0] ? ")" : ""),
+					    rec_width, rec_height, rec_x0, rec_y0);
 
 		/* update bounding box */
 		xmin = MIN(xmin, rec_x0);
@@ -357,13 +766,28 @@ static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer
 
 	/* printf("Cell bounding box: (%lf | %lf) -- (%lf | %lf)\n", xmin, ymin, xmax, ymax); */
 
+	/* The surfaces write through cairo_renderer_write_to_stream() to count the written bytes */
 	if (pdf_file) {
-		pdf_surface = cairo_pdf_surface_create(pdf_file, xmax-xmin, ymax-ymin);
+		pdf_stream.file = fopen(pdf_file, "wb");
+		if (!pdf_stream.file) {
+			fprintf(stderr, _("Could not create PDF file %s\n"), pdf_file);
+			ret = -5;
+			goto ret_destroy_output;
+		}
+		pdf_surface = cairo_pdf_surface_create_for_stream(cairo_renderer_write_to_stream, &pdf_stream,
+								  xmax-xmin, ymax-ymin);
 		pdf_cr = cairo_create(pdf_surface);
 	}
 
 	if (svg_file) {
-		svg_surface = cairo_svg_surface_create(svg_file, xmax-xmin, ymax-ymin);
+		svg_stream.file = fopen(svg_file, "wb");
+		if (!svg_stream.file) {
+			fprintf(stderr, _("Could not create SVG file %s\n"), svg_file);
+			ret = -5;
+			goto ret_destroy_output;
+		}
+		svg_surface = cairo_svg_surface_create_for_stream(cairo_renderer_write_to_stream, &svg_stream,
+								  xmax-xmin, ymax-ymin);
 		svg_cr = cairo_create(svg_surface);
 	}
 
@@ -379,7 +803,13 @@ static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer
 		if (!linfo->render)
 			continue;
 
-		dprintf(comm_pipe[1], _("Exporting layer %d to file\n"), linfo->layer);
+		if (cairo_render_status_cancelled(status)) {
+			ret = GDS_OUTPUT_RENDERER_CANCELLED;
+			goto ret_destroy_output;
+		}
+
+		cairo_render_status_message(status, CAIRO_PHASE_EXPORTING, _("Exporting layer %d to file"),
+					    linfo->layer);
 
 		if (pdf_file && pdf_cr) {
 			cairo_set_source_surface(pdf_cr, layers[linfo->layer].rec, -xmin, -ymin);
@@ -392,17 +822,41 @@ static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer
 		}
 	}
 
-	if (pdf_file) {
+	if (pdf_cr)
 		cairo_show_page(pdf_cr);
+	if (svg_cr)
+		cairo_show_page(svg_cr);
+
+ret_destroy_output:
+	/* Destroying the contexts releases the source surfaces, which reference the layer recordings */
+	if (pdf_cr)
 		cairo_destroy(pdf_cr);
+	if (pdf_surface) {
+		cairo_surface_finish(pdf_surface);
 		cairo_surface_destroy(pdf_surface);
 	}
-
-	if (svg_file) {
-		cairo_show_page(svg_cr);
+	if (svg_cr)
 		cairo_destroy(svg_cr);
+	if (svg_surface) {
+		cairo_surface_finish(svg_surface);
 		cairo_surface_destroy(svg_surface);
 	}
+	if (pdf_stream.file)
+		fclose(pdf_stream.file);
+	if (svg_stream.file)
+		fclose(svg_stream.file);
+	if (pdf_stream.error || svg_stream.error) {
+		fprintf(stderr, _("Error writing Cairo output file\n"));
+		ret = -6;
+	}
+
+	/* Do not leave incomplete output behind */
+	if (ret == GDS_OUTPUT_RENDERER_CANCELLED) {
+		if (pdf_file)
+			g_unlink(pdf_file);
+		if (svg_file)
+			g_unlink(svg_file);
+	}
 
 ret_clear_layers:
 	for (i = 0; i < MAX_LAYERS; i++) {
@@ -414,35 +868,219 @@ ret_clear_layers:
 	}
 	free(layers);
 
-	printf(_("Cairo export finished. It might still be buggy!\n"));
+	if (!ret) {
+		cairo_render_status_message(status, CAIRO_PHASE_FINISHED, _("Cairo export finished"));
+		printf(_("Cairo export finished. It might still be buggy!\n"));
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Forward the progress records of the child process until the pipe is closed or the rendering is cancelled
+ *
+ * The pipe is drained with bulk reads. Only the newest complete record of each read is reported.
+ *
+ * @param renderer Renderer to report the progress to
+ * @param fd Read end of the status pipe
+ * @param cancellable Cancellable of the rendering. May be NULL
+ * @return TRUE if the rendering has been cancelled
+ */
+static gboolean cairo_renderer_forward_child_progress(GdsOutputRenderer *renderer, int fd, GCancellable *cancellable)
+{
+	char buffer[CAIRO_PROGRESS_READ_RECORDS * sizeof(struct cairo_progress_record)];
+	struct cairo_progress_record record;
+	GPollFD poll_fds[2];
+	gint poll_count = 1;
+	gboolean cancelled = FALSE;
+	gint64 start_time;
+	size_t fill = 0;
+	size_t offset;
+	ssize_t cnt;
+
+	start_time = g_get_monotonic_time();
+
+	poll_fds[0].fd = fd;
+	poll_fds[0].events = G_IO_IN | G_IO_HUP | G_IO_ERR;
+	if (g_cancellable_make_pollfd(cancellable, &poll_fds[1]))
+		poll_count = 2;
+
+	for (;;) {
+		if (g_poll(poll_fds, poll_count, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (g_cancellable_is_cancelled(cancellable)) {
+			cancelled = TRUE;
+			break;
+		}
+
+		if (!poll_fds[0].revents)
+			continue;
+
+		cnt = read(fd, &buffer[fill], sizeof(buffer) - fill);
+		if (cnt < 0 && errno == EINTR)
+			continue;
+		if (cnt <= 0)
+			break;
+
+		fill += (size_t)cnt;
+		if (fill < sizeof(record))
+			continue;
+
+		/* Newest complete record */
+		offset = (fill / sizeof(record) - 1) * sizeof(record);
+		memcpy(&record, &buffer[offset], sizeof(record));
+		record.message[sizeof(record.message) - 1] = '\0';
+		cairo_renderer_report_progress(renderer, &record, start_time);
+
+		/* Keep incomplete record */
+		offset += sizeof(record);
+		memmove(buffer, &buffer[offset], fill - offset);
+		fill -= offset;
+	}
+
+	if (poll_count == 2)
+		g_cancellable_release_fd(cancellable);
+
+	return cancelled;
+}
+
+/**
+ * @brief Render \p cell in a forked child process
+ *
+ * The child process contains the memory leaks (see issue #16) in Cairo. Forking a process with
+ * a large address space is expensive. Therefore, this is only done if requested.
+ *
+ * If the rendering is cancelled, the child process is killed and its partial output is removed.
+ *
+ * @param renderer The current renderer this function is running from
+ * @param cell Toplevel cell to @ref Cairo-Renderer
+ * @param layer_infos List of layer information. Specifies color and layer stacking
+ * @param pdf_file PDF output file. Set to NULL if no PDF file has to be generated
+ * @param svg_file SVG output file. Set to NULL if no SVG file has to be generated
+ * @param scale Scale the output image down by \p scale
+ * @return 0 if successful
+ */
+static int cairo_renderer_render_in_child_process(GdsOutputRenderer *renderer,
+						  struct gds_cell *cell,
+						  GList *layer_infos,
+						  const char *pdf_file,
+						  const char *svg_file,
+						  double scale)
+{
+	struct cairo_render_status status;
+	GCancellable *cancellable;
+	gboolean cancelled;
+	pid_t process_id;
+	int comm_pipe[2];
+	int child_status;
+
+	/* Generate communication pipe for status updates */
+	if (pipe(comm_pipe) == -1)
+		return -2;
+
+	/* And by the way: This bricks all Windows compatibility. Deal with it. */
+	process_id = fork();
+	if (process_id < 0) {
+		/* This should not happen */
+		fprintf(stderr, _("Fatal error: Cairo Renderer: Could not spawn child process!"));
+		exit(-2);
+	} else if (process_id > 0) {
+		goto ret_parent;
+	}
+
+	/* We are now in a separate process just for rendering the output image.
+	 * Progress records are written to comm_pipe[1] and forwarded by the parent process.
+	 * Close stdin (stdout and stderr may live on).
+	 */
+	close(0);
+	close(comm_pipe[0]);
+
+	cairo_render_status_init(&status, NULL, comm_pipe[1], NULL, cell, layer_infos);
+	status.hairline_stroke = GDS_RENDER_CAIRO_RENDERER(renderer)->hairline_stroke;
+	status.batch_polygons = GDS_RENDER_CAIRO_RENDERER(renderer)->batch_polygons;
 
 	/* Suspend child process */
-	exit(0);
+	exit(cairo_renderer_render_layers(cell, layer_infos, pdf_file, svg_file, scale, &status) ? 1 : 0);
 
 ret_parent:
 	close(comm_pipe[1]);
 
-	while (read_line_from_fd(comm_pipe[0], receive_message, sizeof(receive_message)) > 0) {
-		/* Strip \n from string and replace with ' ' */
-		for (i = 0; receive_message[i] != '\0'; i++) {
-			if (receive_message[i] == '\n')
-				receive_message[i] = ' ';
-		}
+	cancellable = gds_output_renderer_get_cancellable(renderer);
+	cancelled = cairo_renderer_forward_child_progress(renderer, comm_pipe[0], cancellable);
+	if (cancelled)
+		kill(process_id, SIGKILL);
+
+	waitpid(process_id, &child_status, 0);
 
-		/* Update asyc progress*/
-		gds_output_renderer_update_async_progress(renderer, receive_message);
+	close(comm_pipe[0]);
+
+	if (cancelled) {
+		if (pdf_file)
+			g_unlink(pdf_file);
+		if (svg_file)
+			g_unlink(svg_file);
+		return GDS_OUTPUT_RENDERER_CANCELLED;
 	}
 
-	waitpid(process_id, NULL, 0);
+	if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0)
+		return -3;
 
-	close(comm_pipe[0]);
 	return 0;
 }
 
+/**
+ * @brief Render \p cell to a PDF file specified by \p pdf_file
+ *
+ * Rendering is done in the calling thread unless fork isolation is enabled.
+ *
+ * @param renderer The current renderer this function is running from
+ * @param cell Toplevel cell to @ref Cairo-Renderer
+ * @param layer_infos List of layer information. Specifies color and layer stacking
+ * @param pdf_file PDF output file. Set to NULL if no PDF file has to be generated
+ * @param svg_file SVG output file. Set to NULL if no SVG file has to be generated
+ * @param scale Scale the output image down by \p scale
+ * @return Error
+ */
+static int cairo_renderer_render_cell_to_vector_file(GdsOutputRenderer *renderer,
+						     struct gds_cell *cell,
+						     GList *layer_infos,
+						     const char *pdf_file,
+						     const char *svg_file,
+						     double scale)
+{
+	struct cairo_render_status status;
+	int ret;
+
+	if (pdf_file == NULL && svg_file == NULL) {
+		/* No output specified */
+		return -1;
+	}
+
+	if (GDS_RENDER_CAIRO_RENDERER(renderer)->fork_isolation)
+		return cairo_renderer_render_in_child_process(renderer, cell, layer_infos, pdf_file, svg_file, scale);
+
+	cairo_render_status_init(&status, renderer, -1, gds_output_renderer_get_cancellable(renderer), cell,
+				 layer_infos);
+	status.hairline_stroke = GDS_RENDER_CAIRO_RENDERER(renderer)->hairline_stroke;
+	status.batch_polygons = GDS_RENDER_CAIRO_RENDERER(renderer)->batch_polygons;
+
+	ret = cairo_renderer_render_layers(cell, layer_infos, pdf_file, svg_file, scale, &status);
+	cairo_render_status_clear(&status);
+
+	return ret;
+}
+
 static void cairo_renderer_init(CairoRenderer *self)
 {
 	/* PDF default */
 	self->svg = FALSE;
+	self->fork_isolation = FALSE;
+	self->hairline_stroke = TRUE;
+	self->batch_polygons = FALSE;
 }
 
 static int cairo_renderer_render_output(GdsOutputRenderer *renderer,
@@ -463,9 +1101,11 @@ static int cairo_renderer_render_output(GdsOutputRenderer *renderer,
 	output_file = gds_output_renderer_get_output_file(renderer);
 	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
 
-	/* Set layer info list. In case of failure it remains NULL */
+	/* Set layer info list. In case of failure it remains NULL.
+	 * Each layer is rendered as a whole. Datatype specific entries are not supported
+	 */
 	if (settings)
-		layer_infos = layer_settings_get_layer_info_list(settings);
+		layer_infos = layer_settings_get_whole_layer_list(settings);
 
 	if (c_renderer->svg == TRUE)
 		svg_file = output_file;
@@ -475,17 +1115,83 @@ static int cairo_renderer_render_output(GdsOutputRenderer *renderer,
 	gds_output_renderer_update_async_progress(renderer, _("Rendering Cairo Output..."));
 	ret = cairo_renderer_render_cell_to_vector_file(renderer, cell, layer_infos, pdf_file, svg_file, scale);
 
+	g_list_free(layer_infos);
 	if (settings)
 		g_object_unref(settings);
 
 	return ret;
 }
 
+static void cairo_renderer_get_property(GObject *obj, guint property_id, GValue *value, GParamSpec *pspec)
+{
+	CairoRenderer *self = GDS_RENDER_CAIRO_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_FORK_ISOLATION:
+		g_value_set_boolean(value, self->fork_isolation);
+		break;
+	case PROP_HAIRLINE_STROKE:
+		g_value_set_boolean(value, self->hairline_stroke);
+		break;
+	case PROP_BATCH_POLYGONS:
+		g_value_set_boolean(value, self->batch_polygons);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void cairo_renderer_set_property(GObject *obj, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+	CairoRenderer *self = GDS_RENDER_CAIRO_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_FORK_ISOLATION:
+		self->fork_isolation = g_value_get_boolean(value);
+		break;
+	case PROP_HAIRLINE_STROKE:
+		self->hairline_stroke = g_value_get_boolean(value);
+		break;
+	case PROP_BATCH_POLYGONS:
+		self->batch_polygons = g_value_get_boolean(value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
 static void cairo_renderer_class_init(CairoRendererClass *klass)
 {
 	GdsOutputRendererClass *renderer_class = GDS_RENDER_OUTPUT_RENDERER_CLASS(klass);
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
 
 	renderer_class->render_output = cairo_renderer_render_output;
+
+	oclass->get_property = cairo_renderer_get_property;
+	oclass->set_property = cairo_renderer_set_property;
+
+	cairo_renderer_properties[PROP_FORK_ISOLATION] =
+			g_param_spec_boolean("fork-isolation",
+					     N_("Fork isolation"),
+					     N_("Render in a forked child process instead of the calling thread"),
+					     FALSE,
+					     G_PARAM_READWRITE);
+	cairo_renderer_properties[PROP_HAIRLINE_STROKE] =
+			g_param_spec_boolean("hairline-stroke",
+					     N_("Hairline stroke"),
+					     N_("Stroke the outline of polygons with a hairline to prevent gaps between adjacent polygons"),
+					     TRUE,
+					     G_PARAM_READWRITE);
+	cairo_renderer_properties[PROP_BATCH_POLYGONS] =
+			g_param_spec_boolean("batch-polygons",
+					     N_("Batch polygons"),
+					     N_("Fill all polygons of a cell on the same layer as a single path"),
+					     FALSE,
+					     G_PARAM_READWRITE);
+
+	g_object_class_install_properties(oclass, N_PROPERTIES, cairo_renderer_properties);
 }
 
 CairoRenderer *cairo_renderer_new_pdf()
@@ -508,4 +1214,25 @@ CairoRenderer *cairo_renderer_new_svg()
 	return renderer;
 }
 
+void cairo_renderer_set_fork_isolation(CairoRenderer *renderer, gboolean fork_isolation)
+{
+	g_return_if_fail(GDS_RENDER_IS_CAIRO_RENDERER(renderer));
+
+	g_object_set(renderer, "fork-isolation", fork_isolation, NULL);
+}
+
+void cairo_renderer_set_hairline_stroke(CairoRenderer *renderer, gboolean hairline_stroke)
+{
+	g_return_if_fail(GDS_RENDER_IS_CAIRO_RENDERER(renderer));
+
+	g_object_set(renderer, "hairline-stroke", hairline_stroke, NULL);
+}
+
+void cairo_renderer_set_batch_polygons(CairoRenderer *renderer, gboolean batch_polygons)
+{
+	g_return_if_fail(GDS_RENDER_IS_CAIRO_RENDERER(renderer));
+
+	g_object_set(renderer, "batch-polygons", batch_polygons, NULL);
+}
+
 /** @} */
@@ -30,13 +30,17 @@
 
 #include <dlfcn.h>
 #include <stdio.h>
+#include <errno.h>
+#include <signal.h>
 #include <sys/wait.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include <gds-render/output-renderers/external-renderer.h>
 #include <gds-render/version.h>
 
 #define FORCE_FORK 0U /**< @brief if != 0, then forking is forced regardless of the shared object's settings */
+#define CHILD_POLL_INTERVAL_MS (100) /**< @brief Interval the forked child's state is polled while waiting for cancellation */
 
 struct _ExternalRenderer {
 	GdsOutputRenderer parent;
@@ -52,18 +56,72 @@ enum {
 
 G_DEFINE_TYPE(ExternalRenderer, external_renderer, GDS_RENDER_TYPE_OUTPUT_RENDERER)
 
+/**
+ * @brief Wait for the forked rendering process to terminate
+ *
+ * If \p cancellable is cancelled while waiting, the process is killed.
+ *
+ * @param pid Process ID of the child
+ * @param cancellable Cancellable of the rendering. May be NULL
+ * @param[out] cancelled Set to TRUE if the child was killed because of a cancellation
+ * @return Exit status of the child as returned by waitpid()
+ */
+static int external_renderer_wait_child(pid_t pid, GCancellable *cancellable, gboolean *cancelled)
+{
+	GPollFD cancel_fd;
+	gboolean have_fd;
+	int status = 0;
+	pid_t res;
+
+	*cancelled = FALSE;
+	have_fd = g_cancellable_make_pollfd(cancellable, &cancel_fd);
+
+	for (;;) {
+		res = waitpid(pid, &status, (cancellable ? WNOHANG : 0));
+		if (res == pid || (res < 0 && errno != EINTR))
+			break;
+		if (res < 0)
+			continue;
+
+		if (g_cancellable_is_cancelled(cancellable)) {
+			*cancelled = TRUE;
+			kill(pid, SIGKILL);
+			while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+				;
+			break;
+		}
+
+		/* Wakes up immediately on cancellation. Otherwise poll the child periodically */
+		if (have_fd)
+			g_poll(&cancel_fd, 1, CHILD_POLL_INTERVAL_MS);
+		else
+			g_usleep(CHILD_POLL_INTERVAL_MS * 1000);
+	}
+
+	if (have_fd)
+		g_cancellable_release_fd(cancellable);
+
+	return status;
+}
+
 /**
  * @brief Execute render function in shared object to render the supplied cell
+ *
+ * The rendering can only be interrupted if the shared object requests forking. Otherwise the cancellation
+ * is only checked before and after calling the shared object.
+ *
  * @param toplevel_cell Cell to render
  * @param layer_info_list Layer information (Color etc.)
  * @param output_file Destination file
  * @param scale the scaling value to scale the output cell down by.
  * @param so_path Path to shared object
  * @param params Parameters passed to EXTERNAL_LIBRARY_INIT_FUNCTION
+ * @param cancellable Cancellable of the rendering. May be NULL
  * @return 0 if successful
  */
 static int external_renderer_render_cell(struct gds_cell *toplevel_cell, GList *layer_info_list,
-				   const char *output_file, double scale,  const char *so_path, const char *params)
+				   const char *output_file, double scale,  const char *so_path, const char *params,
+				   GCancellable *cancellable)
 {
 	int (*so_render_func)(struct gds_cell *, GList *, const char *, double) = NULL;
 	int (*so_init_func)(const char *, const char *) = NULL;
@@ -73,6 +131,7 @@ static int external_renderer_render_cell(struct gds_cell *toplevel_cell, GList *
 	int ret = 0;
 	pid_t fork_pid = 0;
 	int forked_status;
+	gboolean cancelled = FALSE;
 
 	if (!so_path) {
 		fprintf(stderr, _("Path to shared object not set!\n"));
@@ -117,10 +176,20 @@ static int external_renderer_render_cell(struct gds_cell *toplevel_cell, GList *
 
 	/* Execute */
 
+	if (g_cancellable_is_cancelled(cancellable)) {
+		ret = GDS_OUTPUT_RENDERER_CANCELLED;
+		goto ret_close_so_handle;
+	}
+
 	g_message(_("Calling external renderer."));
 
 	if (forking_req)
 		fork_pid = fork();
+	if (fork_pid < 0) {
+		fprintf(stderr, _("Could not spawn child process for external renderer\n"));
+		ret = -2000;
+		goto ret_close_so_handle;
+	}
 	if (fork_pid != 0)
 		goto end_forked;
 
@@ -135,8 +204,18 @@ static int external_renderer_render_cell(struct gds_cell *toplevel_cell, GList *
 	/* The forked paths end here */
 end_forked:
 	if (forking_req) {
-		waitpid(fork_pid, &forked_status, 0);
+		forked_status = external_renderer_wait_child(fork_pid, cancellable, &cancelled);
 		ret = WEXITSTATUS(forked_status);
+	} else {
+		cancelled = g_cancellable_is_cancelled(cancellable);
+	}
+
+	if (cancelled) {
+		/* Do not leave incomplete output behind */
+		g_unlink(output_file);
+		ret = GDS_OUTPUT_RENDERER_CANCELLED;
+		g_message(_("External renderer cancelled."));
+		goto ret_close_so_handle;
 	}
 
 	g_message(_("External renderer finished."));
@@ -159,12 +238,15 @@ static int external_renderer_render_output(GdsOutputRenderer *renderer,
 	output_file = gds_output_renderer_get_output_file(renderer);
 	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
 
-	/* Set layer info list. In case of failure it remains NULL */
+	/* Set layer info list. In case of failure it remains NULL.
+	 * The library interface knows whole layers only. Datatype specific entries are not passed
+	 */
 	if (settings)
-		layer_infos = layer_settings_get_layer_info_list(settings);
+		layer_infos = layer_settings_get_whole_layer_list(settings);
 
 	ret = external_renderer_render_cell(cell, layer_infos, output_file, scale, ext_renderer->shared_object_path,
-					    ext_renderer->cli_param_string);
+					    ext_renderer->cli_param_string, gds_output_renderer_get_cancellable(renderer));
+	g_list_free(layer_infos);
 	if (settings)
 		g_object_unref(settings);
 
@@ -28,7 +28,9 @@
  */
 
 #include <gds-render/output-renderers/gds-output-renderer.h>
+#include <gds-render/gds-utils/gds-window.h>
 #include <glib/gi18n.h>
+#include <gio/gio.h>
 
 struct renderer_params {
 		struct gds_cell *cell;
@@ -40,16 +42,37 @@ struct idle_function_params {
 	char *status_message;
 };
 
+/**
+ * @brief Fixed point scale of the progress fraction stored in progress_params::fraction
+ */
+#define PROGRESS_FRACTION_SCALE (1000000)
+
+/**
+ * @brief Numeric progress shared between the rendering thread and the main context.
+ *
+ * All members are only accessed atomically
+ */
+struct progress_params {
+	gint fraction; /**< @brief Progress fraction scaled by #PROGRESS_FRACTION_SCALE */
+	gint phase; /**< @brief Current phase. See enum gds_output_renderer_phase */
+	gint source_pending; /**< @brief A source emitting the current values is attached to the main context */
+};
+
 typedef struct {
 	gchar *output_file;
 	LayerSettings *layer_settings;
 	GMutex settings_lock;
 	gboolean mutex_init_status;
 	GTask *task;
+	GCancellable *cancellable;
+	int async_result;
 	GMainContext *main_context;
 	struct renderer_params async_params;
 	struct idle_function_params idle_function_parameters;
-	gpointer padding[11];
+	struct progress_params progress;
+	gboolean window_set;
+	union bounding_box window;
+	gpointer padding[7];
 } GdsOutputRendererPrivate;
 
 enum {
@@ -60,7 +83,8 @@ enum {
 
 G_DEFINE_TYPE_WITH_PRIVATE(GdsOutputRenderer, gds_output_renderer, G_TYPE_OBJECT)
 
-enum gds_output_renderer_signal_ids {ASYNC_FINISHED = 0, ASYNC_PROGRESS_CHANGED, GDS_OUTPUT_RENDERER_SIGNAL_COUNT};
+enum gds_output_renderer_signal_ids {ASYNC_FINISHED = 0, ASYNC_PROGRESS_CHANGED, ASYNC_PROGRESS_FRACTION_CHANGED,
+				     GDS_OUTPUT_RENDERER_SIGNAL_COUNT};
 static guint gds_output_renderer_signals[GDS_OUTPUT_RENDERER_SIGNAL_COUNT];
 
 static int gds_output_renderer_render_dummy(GdsOutputRenderer *renderer,
@@ -96,6 +120,7 @@ static void gds_output_renderer_dispose(GObject *self_obj)
 	}
 
 	g_clear_object(&priv->task);
+	g_clear_object(&priv->cancellable);
 
 	if (priv->output_file)
 		g_free(priv->output_file);
@@ -165,6 +190,7 @@ static void gds_output_renderer_class_init(GdsOutputRendererClass *klass)
 {
 	GObjectClass *oclass = G_OBJECT_CLASS(klass);
 	GType progress_changed_param_types[1] = {G_TYPE_POINTER};
+	GType progress_fraction_changed_param_types[2] = {G_TYPE_DOUBLE, G_TYPE_INT};
 
 	klass->render_output = gds_output_renderer_render_dummy;
 
@@ -203,6 +229,16 @@ static void gds_output_renderer_class_init(GdsOutputRendererClass *klass)
 				      G_TYPE_NONE,
 				      1,
 				      progress_changed_param_types);
+	gds_output_renderer_signals[ASYNC_PROGRESS_FRACTION_CHANGED] =
+			g_signal_newv(N_("progress-fraction-changed"), GDS_RENDER_TYPE_OUTPUT_RENDERER,
+				      G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE,
+				      NULL,
+				      NULL,
+				      NULL,
+				      NULL,
+				      G_TYPE_NONE,
+				      2,
+				      progress_fraction_changed_param_types);
 }
 
 void gds_output_renderer_init(GdsOutputRenderer *self)
@@ -214,9 +250,14 @@ void gds_output_renderer_init(GdsOutputRenderer *self)
 	priv->layer_settings = NULL;
 	priv->output_file = NULL;
 	priv->task = NULL;
+	priv->cancellable = NULL;
+	priv->async_result = 0;
 	priv->mutex_init_status = TRUE;
 	priv->main_context = NULL;
 	priv->idle_function_parameters.status_message = NULL;
+	priv->progress.fraction = 0;
+	priv->progress.phase = GDS_OUTPUT_RENDERER_PHASE_SETUP;
+	priv->progress.source_pending = 0;
 	g_mutex_init(&priv->settings_lock);
 	g_mutex_init(&priv->idle_function_parameters.message_lock);
 }
@@ -278,11 +319,44 @@ void gds_output_renderer_set_layer_settings(GdsOutputRenderer *renderer, LayerSe
 	g_object_set(renderer, N_("layer-settings"), settings, NULL);
 }
 
+void gds_output_renderer_set_window(GdsOutputRenderer *renderer, const union bounding_box *window)
+{
+	GdsOutputRendererPrivate *priv;
+
+	g_return_if_fail(GDS_RENDER_IS_OUTPUT_RENDERER(renderer));
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	g_mutex_lock(&priv->settings_lock);
+	priv->window_set = (window != NULL);
+	if (window)
+		priv->window = *window;
+	g_mutex_unlock(&priv->settings_lock);
+}
+
+gboolean gds_output_renderer_get_window(GdsOutputRenderer *renderer, union bounding_box *window)
+{
+	GdsOutputRendererPrivate *priv;
+	gboolean ret;
+
+	g_return_val_if_fail(GDS_RENDER_IS_OUTPUT_RENDERER(renderer), FALSE);
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	g_mutex_lock(&priv->settings_lock);
+	ret = priv->window_set;
+	if (ret && window)
+		*window = priv->window;
+	g_mutex_unlock(&priv->settings_lock);
+
+	return ret;
+}
+
 int gds_output_renderer_render_output(GdsOutputRenderer *renderer, struct gds_cell *cell, double scale)
 {
 	int ret;
 	GdsOutputRendererClass *klass;
 	GdsOutputRendererPrivate *priv = gds_output_renderer_get_instance_private(renderer);
+	struct gds_window *window = NULL;
+	union bounding_box window_box;
 
 	if (GDS_RENDER_IS_OUTPUT_RENDERER(renderer) == FALSE) {
 		g_error(_("Output Renderer not valid."));
@@ -310,8 +384,16 @@ int gds_output_renderer_render_output(GdsOutputRenderer *renderer, struct gds_ce
 		return GDS_OUTPUT_RENDERER_GEN_ERR;
 	}
 
+	/* Render only the part of the cell inside the window. The renderers do not need to know about it */
+	if (gds_output_renderer_get_window(renderer, &window_box)) {
+		window = gds_window_new(cell, &window_box);
+		cell = gds_window_get_cell(window);
+	}
+
 	ret = klass->render_output(renderer, cell, scale);
 
+	gds_window_free(window);
+
 	return ret;
 }
 
@@ -346,15 +428,24 @@ ret_from_task:
 static void gds_output_renderer_async_finished(GObject *src_obj, GAsyncResult *res, gpointer user_data)
 {
 	GdsOutputRendererPrivate *priv;
+	GError *error = NULL;
 	(void)user_data;
-	(void)res; /* Will hopefully be destroyed later */
 
 	priv = gds_output_renderer_get_instance_private(GDS_RENDER_OUTPUT_RENDERER(src_obj));
 
 	priv->main_context = NULL;
+	priv->async_result = (int)g_task_propagate_int(G_TASK(res), &error);
+	if (error) {
+		/* The wrapper always returns an int. Cancellation is reported by the renderer itself */
+		g_warning(_("Rendering task failed: %s"), error->message);
+		priv->async_result = -1;
+		g_error_free(error);
+	}
 
 	g_signal_emit(src_obj, gds_output_renderer_signals[ASYNC_FINISHED], 0);
 	g_clear_object(&priv->task);
+	/* Handlers of 'async-finished' may still query the cancellation. Later synchronous runs must not see it */
+	g_clear_object(&priv->cancellable);
 
 	/* Clear reference set in gds_output_renderer_render_output_async() */
 	g_object_unref(src_obj);
@@ -371,11 +462,18 @@ int gds_output_renderer_render_output_async(GdsOutputRenderer *renderer, struct
 		return -2000;
 	}
 
-	priv->task = g_task_new(renderer, NULL, gds_output_renderer_async_finished, NULL);
+	/* A new cancellable for each run. A cancelled one cannot be reused */
+	priv->cancellable = g_cancellable_new();
+	priv->task = g_task_new(renderer, priv->cancellable, gds_output_renderer_async_finished, NULL);
+	/* The result is the renderer's return code. A late cancellation must not replace a finished result */
+	g_task_set_check_cancellable(priv->task, FALSE);
 	
 	/* This function is not available on current debian distros. */
 	/* g_task_set_name(priv->task, "Rendering Thread"); */
 
+	g_atomic_int_set(&priv->progress.fraction, 0);
+	g_atomic_int_set(&priv->progress.phase, GDS_OUTPUT_RENDERER_PHASE_SETUP);
+
 	g_mutex_lock(&priv->settings_lock);
 	priv->async_params.cell = cell;
 	priv->async_params.scale = scale;
@@ -452,4 +550,99 @@ void gds_output_renderer_update_async_progress(GdsOutputRenderer *renderer, cons
 	}
 }
 
+static gboolean progress_fraction_processor_callback(gpointer user_data)
+{
+	GdsOutputRenderer *renderer = GDS_RENDER_OUTPUT_RENDERER(user_data);
+	GdsOutputRendererPrivate *priv;
+	double fraction;
+	int phase;
+
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	/* Clear the flag first. Updates arriving from now on attach a new source */
+	g_atomic_int_set(&priv->progress.source_pending, 0);
+
+	/* Do not report progress after the 'async-finished' signal */
+	if (!priv->main_context)
+		return G_SOURCE_REMOVE;
+
+	fraction = (double)g_atomic_int_get(&priv->progress.fraction) / PROGRESS_FRACTION_SCALE;
+	phase = g_atomic_int_get(&priv->progress.phase);
+	g_signal_emit(renderer, gds_output_renderer_signals[ASYNC_PROGRESS_FRACTION_CHANGED], 0, fraction, phase);
+
+	return G_SOURCE_REMOVE;
+}
+
+void gds_output_renderer_update_async_fraction(GdsOutputRenderer *renderer, double fraction,
+					       enum gds_output_renderer_phase phase)
+{
+	GdsOutputRendererPrivate *priv;
+	GSource *source;
+
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	/* If rendering is not async */
+	if (!priv->main_context)
+		return;
+
+	g_atomic_int_set(&priv->progress.fraction, (gint)(CLAMP(fraction, 0.0, 1.0) * PROGRESS_FRACTION_SCALE));
+	g_atomic_int_set(&priv->progress.phase, (gint)phase);
+
+	/* Coalesce: The pending source will pick up the values stored above */
+	if (g_atomic_int_get(&priv->progress.source_pending))
+		return;
+	if (!g_atomic_int_compare_and_exchange(&priv->progress.source_pending, 0, 1))
+		return;
+
+	source = g_timeout_source_new(GDS_OUTPUT_RENDERER_PROGRESS_INTERVAL_MS);
+	g_source_set_callback(source, progress_fraction_processor_callback, g_object_ref(renderer),
+			      (GDestroyNotify)g_object_unref);
+	g_source_attach(source, priv->main_context);
+	g_source_unref(source);
+}
+
+void gds_output_renderer_cancel_async(GdsOutputRenderer *renderer)
+{
+	GdsOutputRendererPrivate *priv;
+
+	g_return_if_fail(GDS_RENDER_IS_OUTPUT_RENDERER(renderer));
+
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	/* Only cancel a running rendering */
+	if (priv->task && priv->cancellable)
+		g_cancellable_cancel(priv->cancellable);
+}
+
+GCancellable *gds_output_renderer_get_cancellable(GdsOutputRenderer *renderer)
+{
+	GdsOutputRendererPrivate *priv;
+
+	g_return_val_if_fail(GDS_RENDER_IS_OUTPUT_RENDERER(renderer), NULL);
+
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	return priv->cancellable;
+}
+
+int gds_output_renderer_get_async_result(GdsOutputRenderer *renderer)
+{
+	GdsOutputRendererPrivate *priv;
+
+	g_return_val_if_fail(GDS_RENDER_IS_OUTPUT_RENDERER(renderer), GDS_OUTPUT_RENDERER_GEN_ERR);
+
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	return priv->async_result;
+}
+
+gboolean gds_output_renderer_is_cancelled(GdsOutputRenderer *renderer)
+{
+	GdsOutputRendererPrivate *priv;
+
+	priv = gds_output_renderer_get_instance_private(renderer);
+
+	return g_cancellable_is_cancelled(priv->cancellable);
+}
+
 /** @} */
@@ -25,9 +25,13 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <gds-render/output-renderers/latex-renderer.h>
-#include <gdk/gdk.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
+#include <gds-render/geometric/bounding-box.h>
+#include <gds-render/geometric/vector-operations.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 /**
  * @addtogroup LaTeX-Renderer
@@ -59,6 +63,34 @@ enum {
  */
 #define WRITEOUT_BUFFER(buff) fwrite((buff)->str, sizeof(char), (buff)->len, tex_file)
 
+/** @brief Size of the buffer holding a layer identifier. See latex_layer_id() */
+#define LATEX_LAYER_ID_LEN (32)
+
+/**
+ * @brief Maximum count of cell boxes
+ *
+ * e-TeX provides 32768 box registers. Some of them are used by LaTeX and the loaded packages.
+ * If more boxes would be needed, the cells are expanded inline instead.
+ */
+#define LATEX_MAX_BOXES (32000)
+
+/**
+ * @brief Generate the identifier of a layer entry used in the TeX layer and color names
+ *
+ * Entries for a single datatype get the datatype appended. Entries for all datatypes only use the layer number.
+ *
+ * @param id Output buffer
+ * @param len Size of \p id
+ * @param info Layer information
+ */
+static void latex_layer_id(char *id, size_t len, const struct layer_info *info)
+{
+	if (info->datatype == LAYER_INFO_ANY_DATATYPE)
+		g_snprintf(id, len, "%d", info->layer);
+	else
+		g_snprintf(id, len, "%dd%d", info->layer, info->datatype);
+}
+
 /**
  * @brief Write the layer declarration to TeX file
  *
@@ -75,6 +107,7 @@ static void write_layer_definitions(FILE *tex_file, GList *layer_infos, GString
 {
 	GList *list;
 	struct layer_info *lifo;
+	char id[LATEX_LAYER_ID_LEN];
 
 	for (list = layer_infos; list != NULL; list = list->next) {
 		lifo = (struct layer_info *)list->data;
@@ -82,8 +115,9 @@ static void write_layer_definitions(FILE *tex_file, GList *layer_infos, GString
 		if (!lifo->render)
 			continue;
 
-		g_string_printf(buffer, "\\pgfdeclarelayer{l%d}\n\\definecolor{c%d}{rgb}{%lf,%lf,%lf}\n",
-				lifo->layer, lifo->layer,
+		latex_layer_id(id, sizeof(id), lifo);
+		g_string_printf(buffer, "\\pgfdeclarelayer{l%s}\n\\definecolor{c%s}{rgb}{%lf,%lf,%lf}\n",
+				id, id,
 				lifo->color.red, lifo->color.green, lifo->color.blue);
 		WRITEOUT_BUFFER(buffer);
 	}
@@ -97,7 +131,8 @@ static void write_layer_definitions(FILE *tex_file, GList *layer_infos, GString
 		if (!lifo->render)
 			continue;
 
-		g_string_printf(buffer, "l%d,", lifo->layer);
+		latex_layer_id(id, sizeof(id), lifo);
+		g_string_printf(buffer, "l%s,", id);
 		WRITEOUT_BUFFER(buffer);
 	}
 	g_string_printf(buffer, "main}\n");
@@ -107,8 +142,7 @@ static void write_layer_definitions(FILE *tex_file, GList *layer_infos, GString
 /**
  * @brief Write layer Envirmonment
  *
- * If the requested layer shall be rendered, this code writes the necessary code
- * to open the layer. It also returns the color the layer shall be rendered in.
+ * This writes the necessary code to open the layer of \p inf.
  *
  * The followingenvironments are generated:
  *
@@ -118,189 +152,497 @@ static void write_layer_definitions(FILE *tex_file, GList *layer_infos, GString
  * \begin{scope}[ocg={ref=<layer>, status=visible,name={<Layer Name>}}]
  * @endcode
  *
- *
- * If the layer shall not be rendered, FALSE is returned and the color is not filled in and
- * the cod eis not written to the file.
- *
  * @param tex_file TeX file to write to
- * @param color Return of the layer's color
- * @param layer Requested layer number
- * @param linfo Layer information list containing layer_info structs
+ * @param inf Layer information
  * @param buffer Some working buffer
- * @return TRUE, if the layer shall be rendered.
  * @note The opened environments have to be closed afterwards
  */
-static gboolean write_layer_env(FILE *tex_file, GdkRGBA *color, int layer, GList *linfo, GString *buffer)
+static void write_layer_env(FILE *tex_file, const struct layer_info *inf, GString *buffer)
 {
-	GList *temp;
-	struct layer_info *inf;
-
-	for (temp = linfo; temp != NULL; temp = temp->next) {
-		inf = (struct layer_info *)temp->data;
-		if (inf->layer == layer && inf->render) {
-			color->alpha = inf->color.alpha;
-			color->red = inf->color.red;
-			color->green = inf->color.green;
-			color->blue = inf->color.blue;
-			g_string_printf(buffer,
-					"\\begin{pgfonlayer}{l%d}\n\\ifcreatepdflayers\n\\begin{scope}[ocg={ref=%d, status=visible,name={%s}}]\n\\fi\n",
-					layer, layer, inf->name);
-			WRITEOUT_BUFFER(buffer);
-			return TRUE;
-		}
-	}
-	return FALSE;
+	char id[LATEX_LAYER_ID_LEN];
+
+	latex_layer_id(id, sizeof(id), inf);
+	g_string_printf(buffer,
+			"\\begin{pgfonlayer}{l%s}\n\\ifcreatepdflayers\n\\begin{scope}[ocg={ref=%s, status=visible,name={%s}}]\n\\fi\n",
+			id, id, inf->name);
+	WRITEOUT_BUFFER(buffer);
 }
 
 /**
- * @brief Writes a graphics object to the specified tex_file
- *
- * This function opens the layer, writes a graphics object and closes the layer
- *
- * @param tex_file File to write to
- * @param graphics Object to render
- * @param linfo Layer information
- * @param buffer Working buffer
+ * @brief Append the code of a graphics object to a code fragment
+ * @param out Code fragment to append to
+ * @param gfx Object to render
+ * @param inf Layer information of the object
+ * @param id Identifier of the layer entry. See latex_layer_id()
  * @param scale Scale abject down by this value
  */
-static void generate_graphics(FILE *tex_file, GList *graphics, GList *linfo, GString *buffer, double scale)
+static void generate_graphics(GString *out, const struct gds_graphics *gfx, const struct layer_info *inf,
+			      const char *id, double scale)
 {
-	GList *temp;
 	GList *temp_vertex;
-	struct gds_graphics *gfx;
 	struct gds_point *pt;
-	GdkRGBA color;
+	int cap;
 	static const char * const line_caps[] = {"butt", "round", "rect"};
 
-	for (temp = graphics; temp != NULL; temp = temp->next) {
-		gfx = (struct gds_graphics *)temp->data;
-		if (write_layer_env(tex_file, &color, (int)gfx->layer, linfo, buffer) == TRUE) {
-
-			/* Layer is defined => create graphics */
-			if (gfx->gfx_type == GRAPHIC_POLYGON || gfx->gfx_type == GRAPHIC_BOX) {
-				g_string_printf(buffer,
-						"\\draw[line width=0.00001 pt, draw={c%d}, fill={c%d}, fill opacity={%lf}] ",
-						gfx->layer, gfx->layer, color.alpha);
-				WRITEOUT_BUFFER(buffer);
-				/* Append vertices */
-				for (temp_vertex = gfx->vertices;
-				     temp_vertex != NULL;
-				     temp_vertex = temp_vertex->next) {
-					pt = (struct gds_point *)temp_vertex->data;
-					g_string_printf(buffer, "(%lf pt, %lf pt) -- ",
-							((double)pt->x)/scale,
-							((double)pt->y)/scale);
-					WRITEOUT_BUFFER(buffer);
-				}
-				g_string_printf(buffer, "cycle;\n");
-				WRITEOUT_BUFFER(buffer);
-			} else if (gfx->gfx_type == GRAPHIC_PATH) {
-
-				if (g_list_length(gfx->vertices) < 2) {
-					printf("Cannot write path with less than 2 points\n");
-					break;
-				}
-
-				if (gfx->path_render_type < 0 || gfx->path_render_type > 2) {
-					printf("Path type unrecognized. Setting to 'flushed'\n");
-					gfx->path_render_type = PATH_FLUSH;
-				}
-
-				g_string_printf(buffer, "\\draw[line width=%lf pt, draw={c%d}, opacity={%lf}, cap=%s] ",
-						gfx->width_absolute/scale, gfx->layer, color.alpha,
-						line_caps[gfx->path_render_type]);
-				WRITEOUT_BUFFER(buffer);
-
-				/* Append vertices */
-				for (temp_vertex = gfx->vertices;
-				     temp_vertex != NULL;
-				     temp_vertex = temp_vertex->next) {
-					pt = (struct gds_point *)temp_vertex->data;
-					g_string_printf(buffer, "(%lf pt, %lf pt)%s",
-							((double)pt->x)/scale,
-							((double)pt->y)/scale,
-							(temp_vertex->next ? " -- " : ""));
-					WRITEOUT_BUFFER(buffer);
-				}
-				g_string_printf(buffer, ";\n");
-				WRITEOUT_BUFFER(buffer);
-			}
+	if (gfx->gfx_type == GRAPHIC_POLYGON || gfx->gfx_type == GRAPHIC_BOX) {
+		g_string_append_printf(out,
+				       "\\draw[line width=0.00001 pt, draw={c%s}, fill={c%s}, fill opacity={%lf}] ",
+				       id, id, inf->color.alpha);
+		/* Append vertices */
+		for (temp_vertex = gfx->vertices; temp_vertex != NULL; temp_vertex = temp_vertex->next) {
+			pt = (struct gds_point *)temp_vertex->data;
+			g_string_append_printf(out, "(%lf pt, %lf pt) -- ",
+					       ((double)pt->x)/scale,
+					       ((double)pt->y)/scale);
+		}
+		g_string_append(out, "cycle;\n");
+	} else if (gfx->gfx_type == GRAPHIC_PATH) {
+
+		if (g_list_length(gfx->vertices) < 2) {
+			printf("Cannot write path with less than 2 points\n");
+			return;
+		}
 
-			g_string_printf(buffer, "\\ifcreatepdflayers\n\\end{scope}\n\\fi\n\\end{pgfonlayer}\n");
-			WRITEOUT_BUFFER(buffer);
+		/* The object is not modified. It may be shared with other threads */
+		cap = (int)gfx->path_render_type;
+		if (cap < 0 || cap > 2) {
+			printf("Path type unrecognized. Setting to 'flushed'\n");
+			cap = PATH_FLUSH;
 		}
 
-	} /* For graphics */
+		g_string_append_printf(out, "\\draw[line width=%lf pt, draw={c%s}, opacity={%lf}, cap=%s] ",
+				       gfx->width_absolute/scale, id, inf->color.alpha,
+				       line_caps[cap]);
+
+		/* Append vertices */
+		for (temp_vertex = gfx->vertices; temp_vertex != NULL; temp_vertex = temp_vertex->next) {
+			pt = (struct gds_point *)temp_vertex->data;
+			g_string_append_printf(out, "(%lf pt, %lf pt)%s",
+					       ((double)pt->x)/scale,
+					       ((double)pt->y)/scale,
+					       (temp_vertex->next ? " -- " : ""));
+		}
+		g_string_append(out, ";\n");
+	}
 }
 
 /**
- * @brief Render cell to file
- * @param cell Cell to render
- * @param layer_infos Layer information
- * @param tex_file File to write to
- * @param buffer Working buffer
+ * @brief Box holding a cell on a single layer
+ */
+struct latex_cell_box {
+	gboolean written; /**< @brief The box has been written. FALSE if the cell has no content on the layer */
+	gboolean in_progress; /**< @brief The box is currently being written. Used to break reference loops */
+	union bounding_box box; /**< @brief Bounding box in pt */
+};
+
+/**
+ * @brief Job generating the boxes of all cells on a single layer
+ *
+ * Jobs of different layers are independent of each other and run in parallel.
+ * Every job formats its code into its own fragment. The fragments are written to the file in layer order.
+ * Only a limited count of jobs is queued ahead of the writer. This bounds the memory used by finished fragments.
+ */
+struct latex_layer_pass {
+	GdsOutputRenderer *renderer; /**< @brief Renderer to check the cancellation */
+	LayerSettings *settings; /**< @brief Layer settings. Used to map the datatypes */
+	struct gds_cell *cell; /**< @brief Top cell */
+	const struct layer_info *linfo; /**< @brief Layer that is written */
+	char id[LATEX_LAYER_ID_LEN]; /**< @brief Identifier of the layer. See latex_layer_id() */
+	GHashTable *boxes; /**< @brief Maps a cell to its #latex_cell_box on this layer */
+	GHashTable *cell_numbers; /**< @brief Maps a cell to its number used in the box names. Read only, shared by all jobs */
+	double scale; /**< @brief Scale output down by this value */
+	gboolean inline_cells; /**< @brief Expand the cells inline instead of writing boxes */
+	GString *fragment; /**< @brief Generated code */
+	gboolean top_written; /**< @brief The top cell has content on this layer */
+	union bounding_box top_box; /**< @brief Bounding box of the top cell on this layer in pt */
+	gboolean cancelled; /**< @brief The rendering has been cancelled. The fragment is incomplete */
+	gboolean done; /**< @brief The job has finished. Protected by latex_layer_pass::lock */
+	GMutex lock; /**< @brief Lock protecting latex_layer_pass::done */
+	GCond finished; /**< @brief Signalled when the job has finished */
+};
+
+/**
+ * @brief Number all cells referenced by \p cell
+ *
+ * The numbers are used in the box names. They are assigned in a fixed pre-order before any job is started.
+ * The generated code therefore does not depend on the order in which the jobs are executed.
+ *
+ * @param numbers Table mapping a cell to its number
+ * @param cell Cell to number
+ */
+static void latex_number_cells(GHashTable *numbers, struct gds_cell *cell)
+{
+	GList *iter;
+	struct gds_cell_instance *inst;
+
+	if (g_hash_table_contains(numbers, cell))
+		return;
+
+	g_hash_table_insert(numbers, cell, GUINT_TO_POINTER(g_hash_table_size(numbers) + 1));
+
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		if (inst->cell_ref)
+			latex_number_cells(numbers, inst->cell_ref);
+	}
+}
+
+/**
+ * @brief Get the name of the box of a cell on the layer of \p pass
+ * @param pass Layer pass
+ * @param cell Cell
+ * @param[out] name Output buffer
+ * @param len Size of \p name
+ */
+static void latex_box_name(const struct latex_layer_pass *pass, struct gds_cell *cell, char *name, size_t len)
+{
+	g_snprintf(name, len, "%ul%s", GPOINTER_TO_UINT(g_hash_table_lookup(pass->cell_numbers, cell)), pass->id);
+}
+
+/**
+ * @brief Check if a graphics object is rendered on the layer of a pass
+ * @param pass Layer pass
+ * @param gfx Graphics object
+ * @return TRUE if \p gfx belongs to the layer. See layer_settings_lookup()
+ */
+static gboolean latex_gfx_on_layer(const struct latex_layer_pass *pass, const struct gds_graphics *gfx)
+{
+	if (gfx->layer != pass->linfo->layer)
+		return FALSE;
+
+	return layer_settings_lookup(pass->settings, gfx->layer, gfx->datatype) == pass->linfo;
+}
+
+/**
+ * @brief Add a graphics object to a bounding box. Paths are padded by their width
+ * @param box Box to update
+ * @param gfx Graphics object
  * @param scale Scale output down by this value
- * @param renderer The current renderer as GdsOutputRenderer. This is used to emit the status updates to the GUI
  */
-static void render_cell(struct gds_cell *cell, GList *layer_infos, FILE *tex_file, GString *buffer, double scale,
-			GdsOutputRenderer *renderer)
+static void latex_box_add_gfx(union bounding_box *box, const struct gds_graphics *gfx, double scale)
 {
-	GString *status;
-	GList *list_child;
+	GList *vertex_list;
+	const struct gds_point *pt;
+	struct vector_2d point;
+	double pad = (gfx->gfx_type == GRAPHIC_PATH ? gfx->width_absolute / scale : 0.0);
+
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		pt = (const struct gds_point *)vertex_list->data;
+		point.x = pt->x / scale - pad;
+		point.y = pt->y / scale - pad;
+		bounding_box_update_with_point(box, NULL, &point);
+		point.x = pt->x / scale + pad;
+		point.y = pt->y / scale + pad;
+		bounding_box_update_with_point(box, NULL, &point);
+	}
+}
+
+/**
+ * @brief Add the bounding box of a cell instance to a bounding box
+ * @param box Box to update
+ * @param child_box Bounding box of the instantiated cell in pt
+ * @param inst Cell instance
+ * @param scale Scale output down by this value
+ */
+static void latex_box_add_instance(union bounding_box *box, const union bounding_box *child_box,
+				   const struct gds_cell_instance *inst, double scale)
+{
+	union bounding_box transformed;
+	struct vector_2d origin;
+
+	transformed = *child_box;
+	bounding_box_apply_transform(inst->magnification, inst->angle, inst->flipped ? true : false, &transformed);
+	origin.x = inst->origin.x / scale;
+	origin.y = inst->origin.y / scale;
+	vector_2d_add(&transformed.vectors.lower_left, &transformed.vectors.lower_left, &origin);
+	vector_2d_add(&transformed.vectors.upper_right, &transformed.vectors.upper_right, &origin);
+	bounding_box_update_with_box(box, &transformed);
+}
+
+/**
+ * @brief Write the box of \p cell on the layer of \p pass
+ *
+ * The boxes of all sub-cells are written first. Every cell is only written once per layer.
+ * The box contains a zero width TikZ picture whose reference point is the origin of the cell.
+ * Instances of sub-cells are nodes placing the sub-cell's box with the instance's transformation.
+ * A cell without content on the layer is not written at all.
+ *
+ * @param pass Layer pass
+ * @param cell Cell
+ * @return Box of the cell. Owned by latex_layer_pass::boxes
+ */
+static struct latex_cell_box *latex_write_cell_box(struct latex_layer_pass *pass, struct gds_cell *cell)
+{
+	GString *out = pass->fragment;
+	struct latex_cell_box *cell_box;
+	const struct latex_cell_box *child_box;
 	struct gds_cell_instance *inst;
+	struct gds_graphics *gfx;
+	GList *iter;
+	char name[LATEX_LAYER_ID_LEN + 16];
+
+	cell_box = (struct latex_cell_box *)g_hash_table_lookup(pass->boxes, cell);
+	if (cell_box)
+		return cell_box;
+
+	/* Insert before descending. Prevents endless recursion in case of reference loops */
+	cell_box = g_new0(struct latex_cell_box, 1);
+	cell_box->in_progress = TRUE;
+	bounding_box_prepare_empty(&cell_box->box);
+	g_hash_table_insert(pass->boxes, cell, cell_box);
+
+	/* Cancellation point. The incomplete output is removed by the caller */
+	if (pass->cancelled || gds_output_renderer_is_cancelled(pass->renderer)) {
+		pass->cancelled = TRUE;
+		return cell_box;
+	}
 
-	status = g_string_new(NULL);
-	g_string_printf(status, _("Generating cell %s"), cell->name);
-	gds_output_renderer_update_async_progress(renderer, status->str);
-	g_string_free(status, TRUE);
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
 
-	/* Draw polygons of current cell */
-	generate_graphics(tex_file, cell->graphic_objs, layer_infos, buffer, scale);
+		/* Skip sub-trees without the layer */
+		if (!inst->cell_ref || !gds_layer_usage_contains(&inst->cell_ref->layer_usage, (int16_t)pass->linfo->layer))
+			continue;
+
+		child_box = latex_write_cell_box(pass, inst->cell_ref);
+		if (pass->cancelled)
+			goto ret_box;
+
+		if (child_box->written && !child_box->in_progress)
+			latex_box_add_instance(&cell_box->box, &child_box->box, inst, pass->scale);
+	}
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (latex_gfx_on_layer(pass, gfx))
+			latex_box_add_gfx(&cell_box->box, gfx, pass->scale);
+	}
 
-	/* Draw polygons of childs */
-	for (list_child = cell->child_cells; list_child != NULL; list_child = list_child->next) {
-		inst = (struct gds_cell_instance *)list_child->data;
+	if (bounding_box_is_empty(&cell_box->box))
+		goto ret_box;
 
-		/* Abort if cell has no reference */
+	latex_box_name(pass, cell, name, sizeof(name));
+	g_string_append_printf(out,
+			       "\\gdsbeginbox{%s}\\begin{tikzpicture}[baseline=0pt, trim left=0pt, trim right=0pt]\n",
+			       name);
+
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
 		if (!inst->cell_ref)
 			continue;
 
-		/* generate translation scope */
-		g_string_printf(buffer, "\\begin{scope}[shift={(%lf pt,%lf pt)}]\n",
-				((double)inst->origin.x) / scale, ((double)inst->origin.y) / scale);
-		WRITEOUT_BUFFER(buffer);
+		child_box = (const struct latex_cell_box *)g_hash_table_lookup(pass->boxes, inst->cell_ref);
+		if (!child_box || !child_box->written || child_box->in_progress)
+			continue;
 
-		g_string_printf(buffer, "\\begin{scope}[rotate=%lf]\n", inst->angle);
-		WRITEOUT_BUFFER(buffer);
+		latex_box_name(pass, inst->cell_ref, name, sizeof(name));
+		g_string_append_printf(out,
+				       "\\node[inner sep=0pt, outer sep=0pt, anchor=base west, rotate=%lf, xscale=%lf, yscale=%lf] at (%lf pt, %lf pt) {\\gdsusebox{%s}};\n",
+				       inst->angle, inst->magnification,
+				       (inst->flipped ? -1*inst->magnification : inst->magnification),
+				       ((double)inst->origin.x) / pass->scale, ((double)inst->origin.y) / pass->scale,
+				       name);
+	}
 
-		g_string_printf(buffer, "\\begin{scope}[yscale=%lf, xscale=%lf]\n",
-				(inst->flipped ? -1*inst->magnification : inst->magnification),
-				inst->magnification);
-		WRITEOUT_BUFFER(buffer);
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (latex_gfx_on_layer(pass, gfx))
+			generate_graphics(out, gfx, pass->linfo, pass->id, pass->scale);
+	}
 
-		render_cell(inst->cell_ref, layer_infos, tex_file, buffer, scale, renderer);
+	g_string_append(out, "\\end{tikzpicture}\\gdsendbox\n");
+	cell_box->written = TRUE;
 
-		g_string_printf(buffer, "\\end{scope}\n");
-		WRITEOUT_BUFFER(buffer);
+ret_box:
+	cell_box->in_progress = FALSE;
+	return cell_box;
+}
 
-		g_string_printf(buffer, "\\end{scope}\n");
-		WRITEOUT_BUFFER(buffer);
+/**
+ * @brief Write the content of \p cell on the layer of \p pass inline
+ *
+ * Fallback if the boxes would exceed #LATEX_MAX_BOXES. Sub-cells are expanded in place inside of scopes
+ * applying the instance's transformation. Sub-trees without the layer are skipped.
+ *
+ * @param pass Layer pass. latex_layer_pass::boxes holds the cells currently being expanded
+ * @param cell Cell
+ */
+static void latex_write_cell_inline(struct latex_layer_pass *pass, struct gds_cell *cell)
+{
+	GString *out = pass->fragment;
+	struct gds_cell_instance *inst;
+	struct gds_graphics *gfx;
+	GList *iter;
 
-		g_string_printf(buffer, "\\end{scope}\n");
-		WRITEOUT_BUFFER(buffer);
+	/* Cancellation point. The incomplete output is removed by the caller */
+	if (pass->cancelled || gds_output_renderer_is_cancelled(pass->renderer)) {
+		pass->cancelled = TRUE;
+		return;
+	}
+
+	/* Break reference loops */
+	if (g_hash_table_contains(pass->boxes, cell))
+		return;
+	g_hash_table_add(pass->boxes, cell);
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (latex_gfx_on_layer(pass, gfx))
+			generate_graphics(out, gfx, pass->linfo, pass->id, pass->scale);
 	}
 
+	for (iter = cell->child_cells; iter != NULL && !pass->cancelled; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		if (!inst->cell_ref || !gds_layer_usage_contains(&inst->cell_ref->layer_usage, (int16_t)pass->linfo->layer))
+			continue;
+
+		g_string_append_printf(out, "\\begin{scope}[shift={(%lf pt,%lf pt)}, rotate=%lf, xscale=%lf, yscale=%lf]\n",
+				       ((double)inst->origin.x) / pass->scale, ((double)inst->origin.y) / pass->scale,
+				       inst->angle, inst->magnification,
+				       (inst->flipped ? -1*inst->magnification : inst->magnification));
+		latex_write_cell_inline(pass, inst->cell_ref);
+		g_string_append(out, "\\end{scope}\n");
+	}
+
+	g_hash_table_remove(pass->boxes, cell);
 }
 
-static int latex_render_cell_to_code(struct gds_cell *cell, GList *layer_infos, FILE *tex_file, double scale,
+/**
+ * @brief Run a layer pass. Worker function of the thread pool
+ * @param data Layer pass
+ * @param user_data Unused
+ */
+static void latex_layer_pass_run(gpointer data, gpointer user_data)
+{
+	struct latex_layer_pass *pass = (struct latex_layer_pass *)data;
+	struct latex_cell_box *top_box;
+	(void)user_data;
+
+	pass->fragment = g_string_new(NULL);
+
+	if (pass->inline_cells) {
+		pass->boxes = g_hash_table_new(g_direct_hash, g_direct_equal);
+		latex_write_cell_inline(pass, pass->cell);
+		pass->top_written = (pass->fragment->len > 0);
+	} else {
+		pass->boxes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+		top_box = latex_write_cell_box(pass, pass->cell);
+		pass->top_written = top_box->written;
+		pass->top_box = top_box->box;
+	}
+
+	g_hash_table_destroy(pass->boxes);
+	pass->boxes = NULL;
+
+	g_mutex_lock(&pass->lock);
+	pass->done = TRUE;
+	g_cond_signal(&pass->finished);
+	g_mutex_unlock(&pass->lock);
+}
+
+/**
+ * @brief Wait for a layer pass to finish
+ * @param pass Layer pass
+ */
+static void latex_layer_pass_wait(struct latex_layer_pass *pass)
+{
+	g_mutex_lock(&pass->lock);
+	while (!pass->done)
+		g_cond_wait(&pass->finished, &pass->lock);
+	g_mutex_unlock(&pass->lock);
+}
+
+/**
+ * @brief Estimate the count of boxes written for a cell hierarchy
+ *
+ * A box is counted for every cell and layer used by the cell or its sub-cells.
+ * This is an upper bound of the boxes actually written.
+ *
+ * @param cell_numbers Table containing all cells of the hierarchy
+ * @param passes Layer passes
+ * @param pass_count Count of \p passes
+ * @return Count of boxes
+ */
+static guint64 latex_count_boxes(GHashTable *cell_numbers, const struct latex_layer_pass *passes, guint pass_count)
+{
+	GHashTableIter iter;
+	gpointer key;
+	struct gds_cell *cell;
+	guint64 count = 0;
+	guint idx;
+
+	g_hash_table_iter_init(&iter, cell_numbers);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		cell = (struct gds_cell *)key;
+		for (idx = 0; idx < pass_count; idx++) {
+			if (gds_layer_usage_contains(&cell->layer_usage, (int16_t)passes[idx].linfo->layer))
+				count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief Queue a layer pass in the thread pool
+ * @param pool Thread pool. If NULL, or if the pass cannot be queued, it is run directly
+ * @param pass Layer pass
+ */
+static void latex_layer_pass_queue(GThreadPool *pool, struct latex_layer_pass *pass)
+{
+	/* Fall back to serial generation if no threads are available */
+	if (!pool || !g_thread_pool_push(pool, pass, NULL))
+		latex_layer_pass_run(pass, NULL);
+}
+
+/**
+ * @brief Write the macros for defining and using the cell boxes
+ *
+ * The boxes are allocated on first use. Therefore, the generated code can be included multiple times.
+ * The box content is not passed as macro argument. This keeps the memory usage of TeX low for large cells.
+ *
+ * @param tex_file File to write to
+ * @param buffer Working buffer
+ */
+static void write_box_macros(FILE *tex_file, GString *buffer)
+{
+	g_string_printf(buffer,
+			"\\providecommand{\\gdsbeginbox}[1]{\\expandafter\\ifx\\csname gdsbox#1\\endcsname\\relax"
+			"\\expandafter\\newsavebox\\csname gdsbox#1\\endcsname\\fi"
+			"\\expandafter\\global\\expandafter\\setbox\\csname gdsbox#1\\endcsname=\\hbox\\bgroup}\n"
+			"\\providecommand{\\gdsendbox}{\\egroup}\n"
+			"\\providecommand{\\gdsusebox}[1]{\\expandafter\\usebox\\csname gdsbox#1\\endcsname}\n");
+	WRITEOUT_BUFFER(buffer);
+}
+
+static int latex_render_cell_to_code(struct gds_cell *cell, LayerSettings *settings, FILE *tex_file, double scale,
 			       gboolean create_pdf_layers, gboolean standalone_document, GdsOutputRenderer *renderer)
 {
 	GString *working_line;
+	struct latex_layer_pass *passes;
+	struct latex_layer_pass *pass;
+	const struct layer_info *linfo;
+	GList *layer_infos;
+	GList *info_list;
+	GHashTable *cell_numbers;
+	GThreadPool *pool;
+	union bounding_box picture_box;
+	char name[LATEX_LAYER_ID_LEN + 16];
+	guint pass_count = 0;
+	guint window;
+	guint idx;
+	gboolean inline_cells;
+	gboolean cancelled = FALSE;
+
+	if (!tex_file || !settings || !cell)
+		return -1;
 
-
-	if (!tex_file || !layer_infos || !cell)
+	layer_infos = layer_settings_get_layer_info_list(settings);
+	if (!layer_infos)
 		return -1;
 
+	gds_output_renderer_update_async_progress(renderer, _("Generating TikZ code"));
+
 	/* 10 kB Line working buffer should be enough */
 	working_line = g_string_new_len(NULL, LATEX_LINE_BUFFER_KB*1024);
 
@@ -322,14 +664,115 @@ static int latex_render_cell_to_code(struct gds_cell *cell, GList *layer_infos,
 	/* Write layer definitions */
 	write_layer_definitions(tex_file, layer_infos, working_line);
 
+	cell_numbers = g_hash_table_new(g_direct_hash, g_direct_equal);
+	latex_number_cells(cell_numbers, cell);
+
+	/* One job per rendered layer used by the cell */
+	passes = g_new0(struct latex_layer_pass, g_list_length(layer_infos));
+	for (info_list = layer_infos; info_list != NULL; info_list = g_list_next(info_list)) {
+		linfo = (const struct layer_info *)info_list->data;
+		if (!linfo->render || !gds_layer_usage_contains(&cell->layer_usage, (int16_t)linfo->layer))
+			continue;
+
+		pass = &passes[pass_count++];
+		pass->renderer = renderer;
+		pass->settings = settings;
+		pass->cell = cell;
+		pass->linfo = linfo;
+		latex_layer_id(pass->id, sizeof(pass->id), linfo);
+		pass->cell_numbers = cell_numbers;
+		pass->scale = scale;
+		g_mutex_init(&pass->lock);
+		g_cond_init(&pass->finished);
+	}
+
+	/* TeX only provides a limited count of box registers */
+	inline_cells = (latex_count_boxes(cell_numbers, passes, pass_count) > LATEX_MAX_BOXES);
+	if (inline_cells) {
+		g_message(_("Cell %s needs more than %d boxes. Sub-cells are expanded inline"), cell->name, LATEX_MAX_BOXES);
+		g_string_printf(working_line, "\\begin{tikzpicture}\n");
+		WRITEOUT_BUFFER(working_line);
+	} else {
+		write_box_macros(tex_file, working_line);
+	}
+
+	for (idx = 0; idx < pass_count; idx++)
+		passes[idx].inline_cells = inline_cells;
+
+	/* At most one job per thread is queued ahead of the writer */
+	window = MAX(g_get_num_processors(), 1);
+	pool = g_thread_pool_new(latex_layer_pass_run, NULL, (gint)window, FALSE, NULL);
+	for (idx = 0; idx < MIN(window, pass_count); idx++)
+		latex_layer_pass_queue(pool, &passes[idx]);
+
+	/* Every cell is written once per layer as a box. Fragments are written in layer order */
+	bounding_box_prepare_empty(&picture_box);
+	for (idx = 0; idx < pass_count; idx++) {
+		pass = &passes[idx];
+		latex_layer_pass_wait(pass);
+		if (idx + window < pass_count)
+			latex_layer_pass_queue(pool, &passes[idx + window]);
+		gds_output_renderer_update_async_fraction(renderer, (double)(idx + 1) / (double)pass_count,
+							  GDS_OUTPUT_RENDERER_PHASE_RENDERING);
+
+		if (pass->cancelled)
+			cancelled = TRUE;
+
+		if (!cancelled && inline_cells) {
+			if (pass->top_written) {
+				write_layer_env(tex_file, pass->linfo, working_line);
+				WRITEOUT_BUFFER(pass->fragment);
+				g_string_printf(working_line, "\\ifcreatepdflayers\n\\end{scope}\n\\fi\n\\end{pgfonlayer}\n");
+				WRITEOUT_BUFFER(working_line);
+			}
+		} else if (!cancelled) {
+			WRITEOUT_BUFFER(pass->fragment);
+			if (pass->top_written)
+				bounding_box_update_with_box(&picture_box, &pass->top_box);
+		}
+
+		g_string_free(pass->fragment, TRUE);
+		pass->fragment = NULL;
+	}
+
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	if (cancelled)
+		goto ret_clear_passes;
+
+	/* The inline picture is already complete */
+	if (inline_cells)
+		goto ret_close_picture;
+
 	/* Open tikz Pictute */
 	g_string_printf(working_line, "\\begin{tikzpicture}\n");
 	WRITEOUT_BUFFER(working_line);
 
-	/* Generate graphics output */
-	render_cell(cell, layer_infos, tex_file, working_line, scale, renderer);
+	/* The boxes have zero width. The picture size is set explicitly */
+	if (!bounding_box_is_empty(&picture_box)) {
+		g_string_printf(working_line, "\\useasboundingbox (%lf pt, %lf pt) rectangle (%lf pt, %lf pt);\n",
+				picture_box.vectors.lower_left.x, picture_box.vectors.lower_left.y,
+				picture_box.vectors.upper_right.x, picture_box.vectors.upper_right.y);
+		WRITEOUT_BUFFER(working_line);
+	}
+
+	for (idx = 0; idx < pass_count; idx++) {
+		pass = &passes[idx];
+		if (!pass->top_written)
+			continue;
 
+		latex_box_name(pass, cell, name, sizeof(name));
+		write_layer_env(tex_file, pass->linfo, working_line);
+		g_string_printf(working_line,
+				"\\node[inner sep=0pt, outer sep=0pt, anchor=base west] at (0pt, 0pt) {\\gdsusebox{%s}};\n",
+				name);
+		WRITEOUT_BUFFER(working_line);
+		g_string_printf(working_line, "\\ifcreatepdflayers\n\\end{scope}\n\\fi\n\\end{pgfonlayer}\n");
+		WRITEOUT_BUFFER(working_line);
+	}
 
+ret_close_picture:
 	g_string_printf(working_line, "\\end{tikzpicture}\n");
 	WRITEOUT_BUFFER(working_line);
 
@@ -341,9 +784,18 @@ static int latex_render_cell_to_code(struct gds_cell *cell, GList *layer_infos,
 	WRITEOUT_BUFFER(working_line);
 
 	fflush(tex_file);
+	gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_FINISHED);
+
+ret_clear_passes:
+	for (idx = 0; idx < pass_count; idx++) {
+		g_mutex_clear(&passes[idx].lock);
+		g_cond_clear(&passes[idx].finished);
+	}
+	g_free(passes);
+	g_hash_table_destroy(cell_numbers);
 	g_string_free(working_line, TRUE);
 
-	return 0;
+	return (cancelled ? GDS_OUTPUT_RENDERER_CANCELLED : 0);
 }
 
 static int latex_renderer_render_output(GdsOutputRenderer *renderer,
@@ -354,21 +806,20 @@ static int latex_renderer_render_output(GdsOutputRenderer *renderer,
 	FILE *tex_file;
 	int ret = -2;
 	LayerSettings *settings;
-	GList *layer_infos = NULL;
 	const char *output_file;
 
 	output_file = gds_output_renderer_get_output_file(renderer);
 	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
 
-	/* Set layer info list. In case of failure it remains NULL */
-	if (settings)
-		layer_infos = layer_settings_get_layer_info_list(settings);
-
 	tex_file = fopen(output_file, "w");
 	if (tex_file) {
-		ret = latex_render_cell_to_code(cell, layer_infos, tex_file, scale,
+		ret = latex_render_cell_to_code(cell, settings, tex_file, scale,
 						l_renderer->pdf_layers, l_renderer->tex_standalone, renderer);
 		fclose(tex_file);
+
+		/* Do not leave incomplete output behind */
+		if (ret == GDS_OUTPUT_RENDERER_CANCELLED)
+			g_unlink(output_file);
 	} else {
         g_warning(_("Could not open LaTeX output file"));
 	}
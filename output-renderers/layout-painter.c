@@ -0,0 +1,419 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file layout-painter.c
+ * @brief Paint a cell hierarchy into a Cairo context with culling
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup LayoutPainter
+ * @{
+ */
+
+#include <math.h>
+#include <gds-render/output-renderers/layout-painter.h>
+#include <gds-render/geometric/cell-geometrics.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
+
+/** @brief Count of polygons collected in the current path before it is filled */
+#define LAYOUT_PAINTER_FILL_BATCH (4096)
+
+/** @brief Count of painted cells between two checks of the cancellable */
+#define LAYOUT_PAINTER_CANCEL_CHECK_INTERVAL (1024)
+
+/** @brief Key of a layer / datatype combination in layout_painter::datatypes */
+#define LAYOUT_PAINTER_DATATYPE_KEY(layer, datatype) \
+	GUINT_TO_POINTER((((guint)(layer) & 0xFFFFU) << 16) | ((guint)(datatype) & 0xFFFFU))
+
+/**
+ * @brief A layer to paint
+ */
+struct layout_painter_layer {
+	int layer; /**< @brief Layer number */
+	int datatype; /**< @brief Datatype or #LAYER_INFO_ANY_DATATYPE for all datatypes without an own entry */
+	struct layer_color color; /**< @brief Fill color */
+};
+
+struct layout_painter {
+	gint ref_count; /**< @brief Reference count. Atomically accessed */
+	struct gds_cell *cell; /**< @brief Cell to paint */
+	GArray *layers; /**< @brief Array of @ref layout_painter_layer in painting order */
+	/** @brief Set of layer / datatype combinations with an own entry. NULL if there is none */
+	GHashTable *datatypes;
+	GHashTable *boxes; /**< @brief Bounding box cache. See calculate_cell_bounding_box_cached() */
+	const union bounding_box *box; /**< @brief Bounding box of @ref layout_painter::cell */
+};
+
+/**
+ * @brief State of a single layout_painter_paint() call
+ */
+struct layout_painter_state {
+	struct layout_painter *painter; /**< @brief Painter */
+	cairo_t *cr; /**< @brief Target context */
+	double width; /**< @brief Width of the visible device area */
+	double height; /**< @brief Height of the visible device area */
+	double lod_threshold; /**< @brief Minimum instance size in device units */
+	GCancellable *cancellable; /**< @brief Cancellable or NULL */
+	gboolean cancelled; /**< @brief Painting has been cancelled */
+	guint cell_count; /**< @brief Painted cells. Used to limit the cancellation checks */
+	guint pending_polygons; /**< @brief Polygons in the current path */
+	int layer; /**< @brief Layer painted in the current pass */
+	int datatype; /**< @brief Datatype painted in the current pass */
+};
+
+struct layout_painter *layout_painter_new(struct gds_cell *cell, LayerSettings *settings)
+{
+	struct layout_painter *painter;
+	struct layout_painter_layer layer;
+	struct layer_info *info;
+	GList *info_list;
+
+	g_return_val_if_fail(cell != NULL, NULL);
+	g_return_val_if_fail(GDS_RENDER_IS_LAYER_SETTINGS(settings), NULL);
+
+	painter = g_new0(struct layout_painter, 1);
+	painter->ref_count = 1;
+	painter->cell = cell;
+	painter->layers = g_array_new(FALSE, FALSE, sizeof(struct layout_painter_layer));
+
+	for (info_list = layer_settings_get_layer_info_list(settings); info_list; info_list = g_list_next(info_list)) {
+		info = (struct layer_info *)info_list->data;
+
+		/* Entries hidden by an earlier one for the same combination are not used */
+		if (layer_settings_lookup(settings, info->layer, info->datatype) != info)
+			continue;
+
+		/* The datatype is excluded from the pass of the whole layer even if it is not rendered */
+		if (info->datatype != LAYER_INFO_ANY_DATATYPE) {
+			if (!painter->datatypes)
+				painter->datatypes = g_hash_table_new(g_direct_hash, g_direct_equal);
+			g_hash_table_add(painter->datatypes, LAYOUT_PAINTER_DATATYPE_KEY(info->layer, info->datatype));
+		}
+
+		if (!info->render)
+			continue;
+		layer.layer = info->layer;
+		layer.datatype = info->datatype;
+		layer.color = info->color;
+		g_array_append_val(painter->layers, layer);
+	}
+
+	painter->boxes = cell_bounding_box_cache_new();
+	painter->box = calculate_cell_bounding_box_cached(painter->boxes, cell);
+
+	return painter;
+}
+
+struct layout_painter *layout_painter_ref(struct layout_painter *painter)
+{
+	g_return_val_if_fail(painter != NULL, NULL);
+
+	g_atomic_int_inc(&painter->ref_count);
+
+	return painter;
+}
+
+void layout_painter_unref(struct layout_painter *painter)
+{
+	if (!painter)
+		return;
+
+	if (!g_atomic_int_dec_and_test(&painter->ref_count))
+		return;
+
+	g_array_free(painter->layers, TRUE);
+	if (painter->datatypes)
+		g_hash_table_destroy(painter->datatypes);
+	g_hash_table_destroy(painter->boxes);
+	g_free(painter);
+}
+
+const union bounding_box *layout_painter_get_bounding_box(struct layout_painter *painter)
+{
+	g_return_val_if_fail(painter != NULL, NULL);
+
+	return painter->box;
+}
+
+/**
+ * @brief Check if a box in user coordinates is visible on the device
+ * @param state Painting state
+ * @param box Box in the current user coordinates
+ * @return TRUE if the box intersects the visible device area and is not smaller than the LOD threshold
+ */
+static gboolean layout_painter_box_visible(struct layout_painter_state *state, const union bounding_box *box)
+{
+	struct vector_2d corners[4];
+	union bounding_box device_box;
+	int i;
+
+	bounding_box_get_all_points(corners, (union bounding_box *)box);
+	bounding_box_prepare_empty(&device_box);
+	for (i = 0; i < 4; i++) {
+		cairo_user_to_device(state->cr, &corners[i].x, &corners[i].y);
+		bounding_box_update_with_point(&device_box, NULL, &corners[i]);
+	}
+
+	if (device_box.vectors.upper_right.x < 0 || device_box.vectors.upper_right.y < 0 ||
+	    device_box.vectors.lower_left.x > state->width || device_box.vectors.lower_left.y > state->height)
+		return FALSE;
+
+	if (device_box.vectors.upper_right.x - device_box.vectors.lower_left.x < state->lod_threshold &&
+	    device_box.vectors.upper_right.y - device_box.vectors.lower_left.y < state->lod_threshold)
+		return FALSE;
+
+	return TRUE;
+}
+
+/**
+ * @brief Fill all polygons collected in the current path
+ * @param state Painting state
+ */
+static void layout_painter_flush(struct layout_painter_state *state)
+{
+	if (!state->pending_polygons)
+		return;
+
+	cairo_fill(state->cr);
+	state->pending_polygons = 0;
+}
+
+/**
+ * @brief Add a polygon to the current path
+ *
+ * All polygons are added with the same orientation in device space.
+ * Overlapping polygons therefore add up with the nonzero winding rule instead of cancelling each other out.
+ *
+ * @param state Painting state
+ * @param gfx Polygon or box
+ * @param mirrored The current transformation mirrors the user space
+ */
+static void layout_painter_add_polygon(struct layout_painter_state *state, struct gds_graphics *gfx, gboolean mirrored)
+{
+	GList *vertex_list;
+	struct gds_point *vertex;
+	struct gds_point *next;
+	double area = 0.0;
+	gboolean reverse;
+
+	if (!gfx->vertices)
+		return;
+
+	/* Signed area (shoelace formula) determines the orientation */
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (struct gds_point *)vertex_list->data;
+		next = (struct gds_point *)(vertex_list->next ? vertex_list->next->data : gfx->vertices->data);
+		area += (double)vertex->x * (double)next->y - (double)next->x * (double)vertex->y;
+	}
+	reverse = ((area < 0.0) != mirrored);
+
+	vertex_list = reverse ? g_list_last(gfx->vertices) : gfx->vertices;
+	vertex = (struct gds_point *)vertex_list->data;
+	cairo_move_to(state->cr, vertex->x, vertex->y);
+	for (vertex_list = reverse ? vertex_list->prev : vertex_list->next; vertex_list != NULL;
+	     vertex_list = reverse ? vertex_list->prev : vertex_list->next) {
+		vertex = (struct gds_point *)vertex_list->data;
+		cairo_line_to(state->cr, vertex->x, vertex->y);
+	}
+	cairo_close_path(state->cr);
+
+	if (++state->pending_polygons >= LAYOUT_PAINTER_FILL_BATCH)
+		layout_painter_flush(state);
+}
+
+/**
+ * @brief Stroke a path object
+ * @param state Painting state
+ * @param gfx Path
+ */
+static void layout_painter_stroke_path(struct layout_painter_state *state, struct gds_graphics *gfx)
+{
+	GList *vertex_list;
+	struct gds_point *vertex;
+	double hairline_x = 1.0;
+	double hairline_y = 0.0;
+
+	/* The current path must only contain the stroked path */
+	layout_painter_flush(state);
+
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (struct gds_point *)vertex_list->data;
+		if (vertex_list->prev == NULL)
+			cairo_move_to(state->cr, vertex->x, vertex->y);
+		else
+			cairo_line_to(state->cr, vertex->x, vertex->y);
+	}
+
+	if (gfx->width_absolute) {
+		cairo_set_line_width(state->cr, gfx->width_absolute);
+	} else {
+		cairo_device_to_user_distance(state->cr, &hairline_x, &hairline_y);
+		cairo_set_line_width(state->cr, hypot(hairline_x, hairline_y));
+	}
+
+	switch (gfx->path_render_type) {
+	case PATH_FLUSH:
+		cairo_set_line_cap(state->cr, CAIRO_LINE_CAP_BUTT);
+		break;
+	case PATH_ROUNDED:
+		cairo_set_line_cap(state->cr, CAIRO_LINE_CAP_ROUND);
+		break;
+	case PATH_SQUARED:
+		cairo_set_line_cap(state->cr, CAIRO_LINE_CAP_SQUARE);
+		break;
+	}
+
+	cairo_stroke(state->cr);
+}
+
+/**
+ * @brief Check if a graphics object belongs to the current pass
+ *
+ * A pass for all datatypes leaves out the datatypes that have an own entry. This matches layer_settings_lookup().
+ *
+ * @param state Painting state
+ * @param gfx Graphics object
+ * @return TRUE if \p gfx is painted in the current pass
+ */
+static inline gboolean layout_painter_gfx_in_pass(const struct layout_painter_state *state,
+						  const struct gds_graphics *gfx)
+{
+	if (gfx->layer != state->layer)
+		return FALSE;
+
+	if (state->datatype != LAYER_INFO_ANY_DATATYPE)
+		return gfx->datatype == state->datatype;
+
+	return !state->painter->datatypes ||
+	       !g_hash_table_contains(state->painter->datatypes, LAYOUT_PAINTER_DATATYPE_KEY(gfx->layer, gfx->datatype));
+}
+
+/**
+ * @brief Paint the graphics of the current layer of a cell and its visible sub-cells
+ * @param state Painting state
+ * @param cell Cell
+ */
+static void layout_painter_paint_cell(struct layout_painter_state *state, struct gds_cell *cell)
+{
+	GList *list;
+	struct gds_graphics *gfx;
+	struct gds_cell_instance *instance;
+	const union bounding_box *box;
+	cairo_matrix_t matrix;
+	gboolean mirrored;
+
+	if (state->cancelled)
+		return;
+
+	if (state->cancellable && ++state->cell_count % LAYOUT_PAINTER_CANCEL_CHECK_INTERVAL == 0 &&
+	    g_cancellable_is_cancelled(state->cancellable)) {
+		state->cancelled = TRUE;
+		return;
+	}
+
+	cairo_get_matrix(state->cr, &matrix);
+	mirrored = (matrix.xx * matrix.yy - matrix.xy * matrix.yx) < 0.0;
+
+	for (list = cell->graphic_objs; list != NULL; list = list->next) {
+		gfx = (struct gds_graphics *)list->data;
+		if (!layout_painter_gfx_in_pass(state, gfx))
+			continue;
+
+		switch (gfx->gfx_type) {
+		case GRAPHIC_PATH:
+			layout_painter_stroke_path(state, gfx);
+			break;
+		case GRAPHIC_BOX:
+			/* Expected fallthrough */
+		case GRAPHIC_POLYGON:
+			layout_painter_add_polygon(state, gfx, mirrored);
+			break;
+		}
+	}
+
+	for (list = cell->child_cells; list != NULL; list = list->next) {
+		instance = (struct gds_cell_instance *)list->data;
+		if (!instance->cell_ref)
+			continue;
+
+		/* Skip sub-trees without any graphics on the current layer */
+		if (!gds_layer_usage_contains(&instance->cell_ref->layer_usage, (int16_t)state->layer))
+			continue;
+
+		box = (const union bounding_box *)g_hash_table_lookup(state->painter->boxes, instance->cell_ref);
+		if (!box || bounding_box_is_empty(box))
+			continue;
+
+		cairo_save(state->cr);
+		cairo_translate(state->cr, instance->origin.x, instance->origin.y);
+		cairo_rotate(state->cr, M_PI * instance->angle / 180.0);
+		cairo_scale(state->cr, instance->magnification,
+			    (instance->flipped ? -instance->magnification : instance->magnification));
+
+		if (layout_painter_box_visible(state, box))
+			layout_painter_paint_cell(state, instance->cell_ref);
+
+		cairo_restore(state->cr);
+	}
+}
+
+int layout_painter_paint(struct layout_painter *painter, cairo_t *cr, double width, double height,
+			 double lod_threshold, GCancellable *cancellable)
+{
+	struct layout_painter_state state;
+	const struct layout_painter_layer *layer;
+	guint i;
+
+	g_return_val_if_fail(painter != NULL, -1);
+	g_return_val_if_fail(cr != NULL, -1);
+
+	state.painter = painter;
+	state.cr = cr;
+	state.width = width;
+	state.height = height;
+	state.lod_threshold = lod_threshold;
+	state.cancellable = cancellable;
+	state.cancelled = FALSE;
+	state.cell_count = 0;
+	state.pending_polygons = 0;
+
+	if (bounding_box_is_empty(painter->box) || !layout_painter_box_visible(&state, painter->box))
+		return 0;
+
+	cairo_save(cr);
+	cairo_new_path(cr);
+	cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+
+	for (i = 0; i < painter->layers->len && !state.cancelled; i++) {
+		layer = &g_array_index(painter->layers, struct layout_painter_layer, i);
+		state.layer = layer->layer;
+		state.datatype = layer->datatype;
+		cairo_set_source_rgba(cr, layer->color.red, layer->color.green, layer->color.blue, layer->color.alpha);
+		layout_painter_paint_cell(&state, painter->cell);
+		layout_painter_flush(&state);
+	}
+
+	cairo_restore(cr);
+
+	return state.cancelled ? -1 : 0;
+}
+
+/** @} */
@@ -0,0 +1,1152 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pdf-renderer.c
+ * @brief Native streaming PDF output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/** @addtogroup PDF-Renderer
+ *  @{
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include <gds-render/output-renderers/pdf-renderer.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
+#include <gds-render/geometric/bounding-box.h>
+
+struct _PdfRenderer {
+	GdsOutputRenderer parent;
+	gboolean pdf_layers; /**< @brief TRUE: Every layer becomes an optional content group */
+	gboolean compress; /**< @brief TRUE: Flate compress the content streams */
+};
+
+G_DEFINE_TYPE(PdfRenderer, pdf_renderer, GDS_RENDER_TYPE_OUTPUT_RENDERER)
+
+enum {
+	PROP_PDF_LAYERS = 1,
+	PROP_COMPRESS,
+	N_PROPERTIES
+};
+
+static GParamSpec *pdf_renderer_properties[N_PROPERTIES] = {NULL};
+
+/**
+ * @brief Output file and cross reference table of a PDF file that is written
+ */
+struct pdf_writer {
+	FILE *file; /**< @brief Output file */
+	guint64 offset; /**< @brief Count of bytes written to the file */
+	GArray *xref; /**< @brief File offsets (guint64) of the objects. Indexed by the object number */
+	GString *stream_buffer; /**< @brief Not yet written data of the current content stream */
+	GConverter *compressor; /**< @brief Flate compressor for the content streams. NULL if not compressing */
+	guchar *compress_buffer; /**< @brief Output buffer of the compressor */
+	guint64 stream_start; /**< @brief File offset of the data of the current content stream */
+	gboolean error; /**< @brief A write error occured */
+};
+
+/**
+ * @brief Form XObject of a cell on a single layer
+ */
+struct pdf_form {
+	guint32 object; /**< @brief Object number. 0 if the cell has no content on the layer */
+	union bounding_box box; /**< @brief Bounding box in output coordinates */
+	gboolean in_progress; /**< @brief The form is currently being written. Used to break reference loops */
+};
+
+/**
+ * @brief State of writing all forms of a single layer
+ */
+struct pdf_layer_pass {
+	GdsOutputRenderer *renderer; /**< @brief Renderer. Used for cancellation */
+	struct pdf_writer *writer; /**< @brief Output */
+	LayerSettings *settings; /**< @brief Layer settings. Used to map the datatypes */
+	const struct layer_info *linfo; /**< @brief Layer that is written */
+	struct gds_cell *top_cell; /**< @brief Rendered cell */
+	GHashTable *forms; /**< @brief Maps a cell to its #pdf_form on this layer */
+	gboolean transparency_group; /**< @brief Make the form of the top cell a transparency group */
+	double scale; /**< @brief Scale the output down by this factor */
+	gboolean cancelled; /**< @brief The rendering has been cancelled */
+};
+
+/**
+ * @brief Layer of the output page
+ */
+struct pdf_page_layer {
+	const struct layer_info *linfo; /**< @brief Layer information */
+	guint32 form; /**< @brief Form XObject of the top cell */
+	guint32 ocg; /**< @brief Optional content group. 0 if not used */
+	guint32 ext_gstate; /**< @brief Graphics state setting the opacity. 0 if the layer is opaque */
+};
+
+/**
+ * @brief Format a number for PDF output
+ *
+ * The number is formatted independent of the locale and trailing zeros are removed.
+ *
+ * @param buffer Output buffer of size G_ASCII_DTOSTR_BUF_SIZE
+ * @param value Value
+ * @return \p buffer
+ */
+static char *pdf_format_number(char *buffer, double value)
+{
+	char *end;
+
+	g_ascii_formatd(buffer, G_ASCII_DTOSTR_BUF_SIZE, "%.4f", value);
+
+	end = buffer + strlen(buffer) - 1;
+	while (end > buffer && *end == '0')
+		*end-- = '\0';
+	if (*end == '.')
+		*end = '\0';
+
+	if (!strcmp(buffer, "-0"))
+		strcpy(buffer, "0");
+
+	return buffer;
+}
+
+/**
+ * @brief Write raw data to the output file
+ * @param writer PDF writer
+ * @param data Data
+ * @param length Length of \p data
+ */
+static void pdf_writer_write(struct pdf_writer *writer, const void *data, size_t length)
+{
+	if (writer->error || !length)
+		return;
+
+	if (fwrite(data, 1, length, writer->file) != length) {
+		writer->error = TRUE;
+		return;
+	}
+
+	writer->offset += length;
+}
+
+/**
+ * @brief Write formatted data to the output file
+ * @param writer PDF writer
+ * @param format printf format string
+ */
+static void G_GNUC_PRINTF(2, 3) pdf_writer_printf(struct pdf_writer *writer, const char *format, ...)
+{
+	va_list args;
+	char *str;
+
+	va_start(args, format);
+	str = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	pdf_writer_write(writer, str, strlen(str));
+	g_free(str);
+}
+
+/**
+ * @brief Reserve a new object number
+ * @param writer PDF writer
+ * @return Object number
+ */
+static guint32 pdf_writer_new_object(struct pdf_writer *writer)
+{
+	guint64 offset = 0;
+
+	g_array_append_val(writer->xref, offset);
+
+	return writer->xref->len - 1;
+}
+
+/**
+ * @brief Start writing an object
+ * @param writer PDF writer
+ * @param object Object number reserved with pdf_writer_new_object()
+ */
+static void pdf_writer_begin_object(struct pdf_writer *writer, guint32 object)
+{
+	g_array_index(writer->xref, guint64, object) = writer->offset;
+	pdf_writer_printf(writer, "%u 0 obj\n", object);
+}
+
+/**
+ * @brief Start writing a stream object
+ *
+ * The length of the stream is written as separate object after the stream. Therefore, the stream data
+ * does not have to be known in advance. Add the data with pdf_stream_printf() and pdf_stream_number().
+ *
+ * @param writer PDF writer
+ * @param object Object number reserved with pdf_writer_new_object()
+ * @param dict_entries Additional entries of the stream dictionary
+ * @return Object number of the stream length. Pass to pdf_writer_end_stream()
+ */
+static guint32 pdf_writer_begin_stream(struct pdf_writer *writer, guint32 object, const char *dict_entries)
+{
+	guint32 length_object;
+
+	length_object = pdf_writer_new_object(writer);
+
+	pdf_writer_begin_object(writer, object);
+	pdf_writer_printf(writer, "<< %s/Length %u 0 R%s >>\nstream\n", dict_entries, length_object,
+			  (writer->compressor ? " /Filter /FlateDecode" : ""));
+
+	writer->stream_start = writer->offset;
+	g_string_truncate(writer->stream_buffer, 0);
+	if (writer->compressor)
+		g_converter_reset(writer->compressor);
+
+	return length_object;
+}
+
+/**
+ * @brief Write the buffered stream data to the output file
+ * @param writer PDF writer
+ * @param end_of_stream TRUE if this is the last data of the stream
+ */
+static void pdf_stream_flush(struct pdf_writer *writer, gboolean end_of_stream)
+{
+	GConverterResult res;
+	GError *error = NULL;
+	gsize consumed = 0;
+	gsize bytes_read;
+	gsize bytes_written;
+
+	if (!writer->compressor) {
+		pdf_writer_write(writer, writer->stream_buffer->str, writer->stream_buffer->len);
+		g_string_truncate(writer->stream_buffer, 0);
+		return;
+	}
+
+	if (!writer->stream_buffer->len && !end_of_stream)
+		return;
+
+	do {
+		res = g_converter_convert(writer->compressor,
+					  writer->stream_buffer->str + consumed,
+					  writer->stream_buffer->len - consumed,
+					  writer->compress_buffer, PDF_STREAM_BUFFER_KB * 1024,
+					  (end_of_stream ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_NO_FLAGS),
+					  &bytes_read, &bytes_written, &error);
+		if (res == G_CONVERTER_ERROR) {
+			g_warning(_("Could not compress PDF content stream: %s"), error->message);
+			g_clear_error(&error);
+			writer->error = TRUE;
+			break;
+		}
+
+		pdf_writer_write(writer, writer->compress_buffer, bytes_written);
+		consumed += bytes_read;
+	} while (consumed < writer->stream_buffer->len || (end_of_stream && res != G_CONVERTER_FINISHED));
+
+	g_string_truncate(writer->stream_buffer, 0);
+}
+
+/**
+ * @brief Add formatted data to the current stream
+ * @param writer PDF writer
+ * @param format printf format string
+ */
+static void G_GNUC_PRINTF(2, 3) pdf_stream_printf(struct pdf_writer *writer, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	g_string_append_vprintf(writer->stream_buffer, format, args);
+	va_end(args);
+
+	if (writer->stream_buffer->len >= PDF_STREAM_BUFFER_KB * 1024)
+		pdf_stream_flush(writer, FALSE);
+}
+
+/**
+ * @brief Add a number followed by a space to the current stream
+ * @param writer PDF writer
+ * @param value Value
+ */
+static void pdf_stream_number(struct pdf_writer *writer, double value)
+{
+	char buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_string_append(writer->stream_buffer, pdf_format_number(buffer, value));
+	g_string_append_c(writer->stream_buffer, ' ');
+}
+
+/**
+ * @brief Finish the current stream object
+ * @param writer PDF writer
+ * @param length_object Object number returned by pdf_writer_begin_stream()
+ */
+static void pdf_writer_end_stream(struct pdf_writer *writer, guint32 length_object)
+{
+	guint64 length;
+
+	pdf_stream_flush(writer, TRUE);
+	length = writer->offset - writer->stream_start;
+	pdf_writer_printf(writer, "\nendstream\nendobj\n");
+
+	pdf_writer_begin_object(writer, length_object);
+	pdf_writer_printf(writer, "%" G_GUINT64_FORMAT "\nendobj\n", length);
+}
+
+/**
+ * @brief Calculate the transformation matrix of a cell instance
+ *
+ * The matrix is ordered like the operands of the PDF `cm` operator. It is the same transformation the
+ * @ref Cairo-Renderer applies: Mirror at the x-axis, scale, rotate and translate.
+ *
+ * @param inst Cell instance
+ * @param scale Scale the output down by this factor. Only applied to the origin
+ * @param[out] matrix Transformation matrix
+ */
+static void pdf_instance_matrix(const struct gds_cell_instance *inst, double scale, double matrix[6])
+{
+	double angle = M_PI * inst->angle / 180.0;
+	double mag = inst->magnification;
+	double flip = (inst->flipped ? -1.0 : 1.0);
+
+	matrix[0] = mag * cos(angle);
+	matrix[1] = mag * sin(angle);
+	matrix[2] = -mag * flip * sin(angle);
+	matrix[3] = mag * flip * cos(angle);
+	matrix[4] = (double)inst->origin.x / scale;
+	matrix[5] = (double)inst->origin.y / scale;
+}
+
+/**
+ * @brief Add the transformed bounding box of a sub-cell to a bounding box
+ * @param box Box to update
+ * @param child_box Bounding box of the sub-cell
+ * @param matrix Transformation of the cell instance
+ */
+static void pdf_box_add_transformed(union bounding_box *box, const union bounding_box *child_box, const double matrix[6])
+{
+	struct vector_2d corner;
+	struct vector_2d transformed;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		corner.x = (i & 1) ? child_box->vectors.upper_right.x : child_box->vectors.lower_left.x;
+		corner.y = (i & 2) ? child_box->vectors.upper_right.y : child_box->vectors.lower_left.y;
+		transformed.x = matrix[0] * corner.x + matrix[2] * corner.y + matrix[4];
+		transformed.y = matrix[1] * corner.x + matrix[3] * corner.y + matrix[5];
+		bounding_box_update_with_point(box, NULL, &transformed);
+	}
+}
+
+/**
+ * @brief Check if a graphics object is rendered on the layer of a pass
+ *
+ * The datatype specific entries of the layer settings are respected. See layer_settings_lookup().
+ *
+ * @param pass Layer pass
+ * @param gfx Graphics object
+ * @return TRUE if \p gfx belongs to the layer
+ */
+static gboolean pdf_gfx_on_layer(const struct pdf_layer_pass *pass, const struct gds_graphics *gfx)
+{
+	if (gfx->layer != pass->linfo->layer || !gfx->vertices)
+		return FALSE;
+
+	return layer_settings_lookup(pass->settings, gfx->layer, gfx->datatype) == pass->linfo;
+}
+
+/**
+ * @brief Width of a path in output coordinates. Zero width paths are drawn 1 unit wide like in the @ref Cairo-Renderer
+ * @param gfx Path
+ * @param scale Scale the output down by this factor
+ * @return Width
+ */
+static double pdf_path_width(const struct gds_graphics *gfx, double scale)
+{
+	return (gfx->width_absolute ? gfx->width_absolute / scale : 1.0);
+}
+
+/**
+ * @brief Add a graphics object to a bounding box
+ *
+ * The vertices of paths are padded by the full path width. This covers the line caps and miter joins up to 60°.
+ *
+ * @param box Box to update
+ * @param gfx Graphics object
+ * @param scale Scale the output down by this factor
+ */
+static void pdf_box_add_gfx(union bounding_box *box, const struct gds_graphics *gfx, double scale)
+{
+	GList *vertex_list;
+	const struct gds_point *vertex;
+	struct vector_2d point;
+	double pad = 0.0;
+
+	if (gfx->gfx_type == GRAPHIC_PATH)
+		pad = pdf_path_width(gfx, scale);
+
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		point.x = vertex->x / scale - pad;
+		point.y = vertex->y / scale - pad;
+		bounding_box_update_with_point(box, NULL, &point);
+		point.x = vertex->x / scale + pad;
+		point.y = vertex->y / scale + pad;
+		bounding_box_update_with_point(box, NULL, &point);
+	}
+}
+
+/**
+ * @brief Add a polygon to the path of the current stream
+ *
+ * All polygons are added counter clockwise. Therefore, overlapping polygons do not cancel out
+ * when the path is filled with the nonzero winding rule.
+ *
+ * @param writer PDF writer
+ * @param gfx Polygon, box or rectangle
+ * @param scale Scale the output down by this factor
+ */
+static void pdf_stream_add_polygon(struct pdf_writer *writer, const struct gds_graphics *gfx, double scale)
+{
+	GList *vertex_list;
+	GList *last = NULL;
+	const struct gds_point *vertex;
+	const struct gds_point *next;
+	const struct gds_point *p2;
+	double area = 0.0;
+	gboolean reverse;
+
+	vertex = (const struct gds_point *)gfx->vertices->data;
+
+	if (gfx->rectangle) {
+		/* A rectangle with positive extents is counter clockwise */
+		p2 = (const struct gds_point *)gfx->vertices->next->next->data;
+		pdf_stream_number(writer, MIN(vertex->x, p2->x) / scale);
+		pdf_stream_number(writer, MIN(vertex->y, p2->y) / scale);
+		pdf_stream_number(writer, ABS(p2->x - vertex->x) / scale);
+		pdf_stream_number(writer, ABS(p2->y - vertex->y) / scale);
+		pdf_stream_printf(writer, "re\n");
+		return;
+	}
+
+	/* Shoelace formula. The sign gives the orientation */
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		next = (const struct gds_point *)(vertex_list->next ? vertex_list->next->data : gfx->vertices->data);
+		area += (double)vertex->x * (double)next->y - (double)next->x * (double)vertex->y;
+		last = vertex_list;
+	}
+
+	reverse = (area < 0.0);
+	for (vertex_list = (reverse ? last : gfx->vertices); vertex_list != NULL;
+	     vertex_list = (reverse ? vertex_list->prev : vertex_list->next)) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		pdf_stream_number(writer, vertex->x / scale);
+		pdf_stream_number(writer, vertex->y / scale);
+		pdf_stream_printf(writer, "%s\n", (vertex_list == (reverse ? last : gfx->vertices) ? "m" : "l"));
+	}
+	pdf_stream_printf(writer, "h\n");
+}
+
+/**
+ * @brief Stroke a path in the current stream
+ * @param writer PDF writer
+ * @param gfx Path
+ * @param scale Scale the output down by this factor
+ */
+static void pdf_stream_stroke_path(struct pdf_writer *writer, const struct gds_graphics *gfx, double scale)
+{
+	GList *vertex_list;
+	const struct gds_point *vertex;
+	int cap = 0;
+
+	switch (gfx->path_render_type) {
+	case PATH_FLUSH:
+		cap = 0;
+		break;
+	case PATH_ROUNDED:
+		cap = 1;
+		break;
+	case PATH_SQUARED:
+		cap = 2;
+		break;
+	}
+
+	pdf_stream_number(writer, pdf_path_width(gfx, scale));
+	pdf_stream_printf(writer, "w %d J\n", cap);
+
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		pdf_stream_number(writer, vertex->x / scale);
+		pdf_stream_number(writer, vertex->y / scale);
+		pdf_stream_printf(writer, "%s\n", (vertex_list->prev == NULL ? "m" : "l"));
+	}
+	pdf_stream_printf(writer, "S\n");
+}
+
+/**
+ * @brief Compare two object numbers. Used for sorting
+ * @param a Object number (guint32)
+ * @param b Object number (guint32)
+ * @return Comparison result
+ */
+static gint pdf_compare_object(gconstpointer a, gconstpointer b)
+{
+	guint32 obj_a = *(const guint32 *)a;
+	guint32 obj_b = *(const guint32 *)b;
+
+	return (obj_a > obj_b) - (obj_a < obj_b);
+}
+
+/**
+ * @brief Look up the written form of a cell instance
+ * @param pass Layer pass
+ * @param inst Cell instance
+ * @return Form or NULL if the instance has no content on the layer
+ */
+static const struct pdf_form *pdf_instance_form(const struct pdf_layer_pass *pass, const struct gds_cell_instance *inst)
+{
+	const struct pdf_form *form;
+
+	if (!inst->cell_ref)
+		return NULL;
+
+	form = (const struct pdf_form *)g_hash_table_lookup(pass->forms, inst->cell_ref);
+	if (!form || form->in_progress || !form->object)
+		return NULL;
+
+	return form;
+}
+
+/**
+ * @brief Write the Form XObject of \p cell on the layer of \p pass
+ *
+ * The forms of all sub-cells are written first. Every cell is only written once per layer.
+ * Instances of sub-cells are drawn by transforming the coordinate system with `cm` and invoking the sub-cell's form.
+ * A cell without content on the layer is not written at all.
+ *
+ * @param pass Layer pass
+ * @param cell Cell
+ * @return Form of the cell. Owned by pass::forms
+ */
+static struct pdf_form *pdf_write_cell_form(struct pdf_layer_pass *pass, struct gds_cell *cell)
+{
+	struct pdf_writer *writer = pass->writer;
+	struct pdf_form *form;
+	const struct pdf_form *child_form;
+	struct gds_cell_instance *inst;
+	struct gds_graphics *gfx;
+	GList *iter;
+	GString *dict;
+	GArray *resources;
+	guint32 length_object;
+	guint32 res_obj;
+	gboolean has_polygons = FALSE;
+	double matrix[6];
+	char num[4][G_ASCII_DTOSTR_BUF_SIZE];
+	guint i;
+
+	form = (struct pdf_form *)g_hash_table_lookup(pass->forms, cell);
+	if (form)
+		return form;
+
+	/* Insert before descending. Guards against reference loops */
+	form = g_new0(struct pdf_form, 1);
+	form->in_progress = TRUE;
+	bounding_box_prepare_empty(&form->box);
+	g_hash_table_insert(pass->forms, cell, form);
+
+	if (pass->cancelled || gds_output_renderer_is_cancelled(pass->renderer)) {
+		pass->cancelled = TRUE;
+		return form;
+	}
+
+	/* Sub-cells first. Their bounding boxes are needed for this cell's box */
+	resources = g_array_new(FALSE, FALSE, sizeof(guint32));
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		if (!inst->cell_ref || !gds_layer_usage_contains(&inst->cell_ref->layer_usage, (int16_t)pass->linfo->layer))
+			continue;
+
+		pdf_write_cell_form(pass, inst->cell_ref);
+		if (pass->cancelled)
+			goto ret_free_resources;
+
+		child_form = pdf_instance_form(pass, inst);
+		if (!child_form)
+			continue;
+
+		pdf_instance_matrix(inst, pass->scale, matrix);
+		pdf_box_add_transformed(&form->box, &child_form->box, matrix);
+		g_array_append_val(resources, child_form->object);
+	}
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (pdf_gfx_on_layer(pass, gfx))
+			pdf_box_add_gfx(&form->box, gfx, pass->scale);
+	}
+
+	if (bounding_box_is_empty(&form->box))
+		goto ret_free_resources;
+
+	/* Form dictionary. Every sub-cell form is listed once */
+	dict = g_string_new(NULL);
+	g_string_printf(dict, "/Type /XObject /Subtype /Form /BBox [%s %s %s %s] ",
+			pdf_format_number(num[0], form->box.vectors.lower_left.x),
+			pdf_format_number(num[1], form->box.vectors.lower_left.y),
+			pdf_format_number(num[2], form->box.vectors.upper_right.x),
+			pdf_format_number(num[3], form->box.vectors.upper_right.y));
+	if (pass->transparency_group && cell == pass->top_cell)
+		g_string_append(dict, "/Group << /S /Transparency >> ");
+	g_string_append(dict, "/Resources << /XObject << ");
+	g_array_sort(resources, pdf_compare_object);
+	for (i = 0; i < resources->len; i++) {
+		res_obj = g_array_index(resources, guint32, i);
+		if (i > 0 && res_obj == g_array_index(resources, guint32, i - 1))
+			continue;
+		g_string_append_printf(dict, "/X%u %u 0 R ", res_obj, res_obj);
+	}
+	g_string_append(dict, ">> >> ");
+
+	form->object = pdf_writer_new_object(writer);
+	length_object = pdf_writer_begin_stream(writer, form->object, dict->str);
+	g_string_free(dict, TRUE);
+
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		child_form = pdf_instance_form(pass, inst);
+		if (!child_form)
+			continue;
+
+		pdf_instance_matrix(inst, pass->scale, matrix);
+		pdf_stream_printf(writer, "q ");
+		for (i = 0; i < 6; i++)
+			pdf_stream_number(writer, matrix[i]);
+		pdf_stream_printf(writer, "cm /X%u Do Q\n", child_form->object);
+	}
+
+	/* All polygons of the cell are filled at once */
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (gfx->gfx_type == GRAPHIC_PATH || !pdf_gfx_on_layer(pass, gfx))
+			continue;
+
+		pdf_stream_add_polygon(writer, gfx, pass->scale);
+		has_polygons = TRUE;
+	}
+	if (has_polygons)
+		pdf_stream_printf(writer, "f\n");
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (gfx->gfx_type == GRAPHIC_PATH && pdf_gfx_on_layer(pass, gfx))
+			pdf_stream_stroke_path(writer, gfx, pass->scale);
+	}
+
+	pdf_writer_end_stream(writer, length_object);
+
+ret_free_resources:
+	g_array_free(resources, TRUE);
+	form->in_progress = FALSE;
+
+	return form;
+}
+
+/**
+ * @brief Write a text string in UTF-16BE encoding
+ * @param writer PDF writer
+ * @param text UTF-8 text
+ */
+static void pdf_writer_text_string(struct pdf_writer *writer, const char *text)
+{
+	gunichar2 *utf16;
+	glong length;
+	glong i;
+
+	utf16 = g_utf8_to_utf16(text, -1, NULL, &length, NULL);
+	if (!utf16) {
+		pdf_writer_printf(writer, "()");
+		return;
+	}
+
+	pdf_writer_printf(writer, "<FEFF");
+	for (i = 0; i < length; i++)
+		pdf_writer_printf(writer, "%04X", (unsigned int)utf16[i]);
+	pdf_writer_printf(writer, ">");
+
+	g_free(utf16);
+}
+
+/**
+ * @brief Write the optional content group of a layer
+ * @param writer PDF writer
+ * @param linfo Layer
+ * @return Object number of the group
+ */
+static guint32 pdf_write_ocg(struct pdf_writer *writer, const struct layer_info *linfo)
+{
+	guint32 object;
+	char *name;
+
+	if (linfo->name && linfo->name[0])
+		name = g_strdup(linfo->name);
+	else if (linfo->datatype != LAYER_INFO_ANY_DATATYPE)
+		name = g_strdup_printf(_("Layer %d/%d"), linfo->layer, linfo->datatype);
+	else
+		name = g_strdup_printf(_("Layer %d"), linfo->layer);
+
+	object = pdf_writer_new_object(writer);
+	pdf_writer_begin_object(writer, object);
+	pdf_writer_printf(writer, "<< /Type /OCG /Name ");
+	pdf_writer_text_string(writer, name);
+	pdf_writer_printf(writer, " >>\nendobj\n");
+	g_free(name);
+
+	return object;
+}
+
+/**
+ * @brief Write the graphics state setting the opacity of a layer
+ * @param writer PDF writer
+ * @param alpha Opacity
+ * @return Object number of the graphics state
+ */
+static guint32 pdf_write_ext_gstate(struct pdf_writer *writer, double alpha)
+{
+	guint32 object;
+	char num[G_ASCII_DTOSTR_BUF_SIZE];
+
+	pdf_format_number(num, alpha);
+	object = pdf_writer_new_object(writer);
+	pdf_writer_begin_object(writer, object);
+	pdf_writer_printf(writer, "<< /Type /ExtGState /ca %s /CA %s >>\nendobj\n", num, num);
+
+	return object;
+}
+
+/**
+ * @brief Write the cross reference table and the trailer
+ * @param writer PDF writer
+ * @param catalog Object number of the document catalog
+ */
+static void pdf_writer_finish(struct pdf_writer *writer, guint32 catalog)
+{
+	guint64 xref_offset;
+	char entry[32];
+	guint i;
+
+	xref_offset = writer->offset;
+	pdf_writer_printf(writer, "xref\n0 %u\n0000000000 65535 f \n", writer->xref->len);
+	for (i = 1; i < writer->xref->len; i++) {
+		g_snprintf(entry, sizeof(entry), "%010" G_GUINT64_FORMAT " 00000 n \n",
+			   g_array_index(writer->xref, guint64, i));
+		pdf_writer_write(writer, entry, strlen(entry));
+	}
+
+	pdf_writer_printf(writer, "trailer\n<< /Size %u /Root %u 0 R >>\nstartxref\n%" G_GUINT64_FORMAT "\n%%%%EOF\n",
+			  writer->xref->len, catalog, xref_offset);
+}
+
+/**
+ * @brief Write the page invoking the top cell forms of all layers
+ * @param writer PDF writer
+ * @param page_layers Array of #pdf_page_layer in stacking order
+ * @param page_box Bounding box of the page content
+ * @param pdf_layers Wrap every layer in its optional content group
+ * @return Object number of the page tree root
+ */
+static guint32 pdf_write_page(struct pdf_writer *writer, GArray *page_layers, union bounding_box *page_box,
+			      gboolean pdf_layers)
+{
+	struct pdf_page_layer *page_layer;
+	GString *resources;
+	guint32 content;
+	guint32 length_object;
+	guint32 page;
+	guint32 pages;
+	char num[2][G_ASCII_DTOSTR_BUF_SIZE];
+	guint i;
+
+	content = pdf_writer_new_object(writer);
+	length_object = pdf_writer_begin_stream(writer, content, "");
+
+	/* Move the lower left corner of the layout to the origin of the page */
+	pdf_stream_printf(writer, "1 0 0 1 ");
+	pdf_stream_number(writer, -page_box->vectors.lower_left.x);
+	pdf_stream_number(writer, -page_box->vectors.lower_left.y);
+	pdf_stream_printf(writer, "cm\n");
+
+	for (i = 0; i < page_layers->len; i++) {
+		page_layer = &g_array_index(page_layers, struct pdf_page_layer, i);
+		if (page_layer->ocg)
+			pdf_stream_printf(writer, "/OC /L%u BDC\n", i);
+
+		pdf_stream_printf(writer, "q ");
+		if (page_layer->ext_gstate)
+			pdf_stream_printf(writer, "/G%u gs ", i);
+		pdf_stream_number(writer, page_layer->linfo->color.red);
+		pdf_stream_number(writer, page_layer->linfo->color.green);
+		pdf_stream_number(writer, page_layer->linfo->color.blue);
+		pdf_stream_printf(writer, "rg ");
+		pdf_stream_number(writer, page_layer->linfo->color.red);
+		pdf_stream_number(writer, page_layer->linfo->color.green);
+		pdf_stream_number(writer, page_layer->linfo->color.blue);
+		pdf_stream_printf(writer, "RG /X%u Do Q\n", page_layer->form);
+
+		if (page_layer->ocg)
+			pdf_stream_printf(writer, "EMC\n");
+	}
+	pdf_writer_end_stream(writer, length_object);
+
+	resources = g_string_new("/XObject << ");
+	for (i = 0; i < page_layers->len; i++) {
+		page_layer = &g_array_index(page_layers, struct pdf_page_layer, i);
+		g_string_append_printf(resources, "/X%u %u 0 R ", page_layer->form, page_layer->form);
+	}
+	g_string_append(resources, ">> /ExtGState << ");
+	for (i = 0; i < page_layers->len; i++) {
+		page_layer = &g_array_index(page_layers, struct pdf_page_layer, i);
+		if (page_layer->ext_gstate)
+			g_string_append_printf(resources, "/G%u %u 0 R ", i, page_layer->ext_gstate);
+	}
+	g_string_append(resources, ">>");
+	if (pdf_layers) {
+		g_string_append(resources, " /Properties << ");
+		for (i = 0; i < page_layers->len; i++) {
+			page_layer = &g_array_index(page_layers, struct pdf_page_layer, i);
+			g_string_append_printf(resources, "/L%u %u 0 R ", i, page_layer->ocg);
+		}
+		g_string_append(resources, ">>");
+	}
+
+	page = pdf_writer_new_object(writer);
+	pages = pdf_writer_new_object(writer);
+
+	pdf_writer_begin_object(writer, page);
+	pdf_writer_printf(writer, "<< /Type /Page /Parent %u 0 R /MediaBox [0 0 %s %s] /Resources << %s >> "
+			  "/Contents %u 0 R >>\nendobj\n",
+			  pages,
+			  pdf_format_number(num[0], page_box->vectors.upper_right.x - page_box->vectors.lower_left.x),
+			  pdf_format_number(num[1], page_box->vectors.upper_right.y - page_box->vectors.lower_left.y),
+			  resources->str, content);
+	g_string_free(resources, TRUE);
+
+	pdf_writer_begin_object(writer, pages);
+	pdf_writer_printf(writer, "<< /Type /Pages /Kids [%u 0 R] /Count 1 >>\nendobj\n", page);
+
+	return pages;
+}
+
+/**
+ * @brief Write the document catalog
+ * @param writer PDF writer
+ * @param pages Object number of the page tree root
+ * @param page_layers Array of #pdf_page_layer in stacking order
+ * @param pdf_layers Register the optional content groups of the layers
+ * @return Object number of the catalog
+ */
+static guint32 pdf_write_catalog(struct pdf_writer *writer, guint32 pages, GArray *page_layers, gboolean pdf_layers)
+{
+	struct pdf_page_layer *page_layer;
+	GString *ocgs;
+	guint32 catalog;
+	guint i;
+
+	catalog = pdf_writer_new_object(writer);
+	pdf_writer_begin_object(writer, catalog);
+	pdf_writer_printf(writer, "<< /Type /Catalog /Pages %u 0 R", pages);
+
+	if (pdf_layers && page_layers->len) {
+		ocgs = g_string_new("[");
+		for (i = 0; i < page_layers->len; i++) {
+			page_layer = &g_array_index(page_layers, struct pdf_page_layer, i);
+			g_string_append_printf(ocgs, "%u 0 R ", page_layer->ocg);
+		}
+		g_string_append(ocgs, "]");
+		pdf_writer_printf(writer, " /OCProperties << /OCGs %s /D << /Order %s >> >>", ocgs->str, ocgs->str);
+		g_string_free(ocgs, TRUE);
+	}
+
+	pdf_writer_printf(writer, " >>\nendobj\n");
+
+	return catalog;
+}
+
+/**
+ * @brief Render \p cell to a PDF file
+ *
+ * The layers are written one after another in the order of the layer settings. For every layer, the Form XObjects of all
+ * cells with content on the layer are written bottom-up. Only the forms of the current layer are held in memory.
+ *
+ * @param renderer Renderer. Used for progress reports and cancellation
+ * @param cell Toplevel cell
+ * @param settings Layer settings
+ * @param pdf_file Output file
+ * @param scale Scale the output down by this factor
+ * @param pdf_layers Make every layer an optional content group
+ * @param compress Flate compress the content streams
+ * @return 0 if successful
+ */
+static int pdf_render_cell_to_file(GdsOutputRenderer *renderer, struct gds_cell *cell, LayerSettings *settings,
+				   FILE *pdf_file, double scale, gboolean pdf_layers, gboolean compress)
+{
+	struct pdf_writer writer;
+	struct pdf_layer_pass pass;
+	struct pdf_page_layer page_layer;
+	struct pdf_page_layer *layer_ptr;
+	struct pdf_form *top_form;
+	union bounding_box page_box;
+	GArray *page_layers;
+	GList *info_list;
+	const struct layer_info *linfo;
+	guint layer_count;
+	guint layer_idx;
+	guint32 pages;
+	guint32 catalog;
+	guint i;
+	int ret = 0;
+
+	memset(&writer, 0, sizeof(writer));
+	writer.file = pdf_file;
+	writer.xref = g_array_new(FALSE, FALSE, sizeof(guint64));
+	writer.stream_buffer = g_string_sized_new(PDF_STREAM_BUFFER_KB * 1024 + 1024);
+	if (compress) {
+		writer.compressor = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1));
+		writer.compress_buffer = (guchar *)g_malloc(PDF_STREAM_BUFFER_KB * 1024);
+	}
+
+	/* Object 0 is the head of the free list */
+	(void)pdf_writer_new_object(&writer);
+
+	page_layers = g_array_new(FALSE, FALSE, sizeof(struct pdf_page_layer));
+	bounding_box_prepare_empty(&page_box);
+
+	/* The comment with high bytes marks the file as binary */
+	pdf_writer_printf(&writer, "%%PDF-1.5\n%%\xe2\xe3\xcf\xd3\n");
+
+	gds_output_renderer_update_async_progress(renderer, _("Writing PDF forms"));
+
+	memset(&pass, 0, sizeof(pass));
+	pass.renderer = renderer;
+	pass.writer = &writer;
+	pass.settings = settings;
+	pass.top_cell = cell;
+	pass.scale = scale;
+
+	info_list = layer_settings_get_layer_info_list(settings);
+	layer_count = g_list_length(info_list);
+	for (layer_idx = 0; info_list != NULL; info_list = g_list_next(info_list), layer_idx++) {
+		linfo = (const struct layer_info *)info_list->data;
+		gds_output_renderer_update_async_fraction(renderer, (double)layer_idx / (double)layer_count,
+							  GDS_OUTPUT_RENDERER_PHASE_RENDERING);
+
+		if (!linfo->render || !gds_layer_usage_contains(&cell->layer_usage, (int16_t)linfo->layer))
+			continue;
+
+		pass.linfo = linfo;
+		pass.transparency_group = (linfo->color.alpha < 1.0);
+		pass.forms = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+		top_form = pdf_write_cell_form(&pass, cell);
+		if (top_form->object) {
+			page_layer.linfo = linfo;
+			page_layer.form = top_form->object;
+			page_layer.ocg = 0;
+			page_layer.ext_gstate = 0;
+			g_array_append_val(page_layers, page_layer);
+
+			bounding_box_update_with_point(&page_box, NULL, &top_form->box.vectors.lower_left);
+			bounding_box_update_with_point(&page_box, NULL, &top_form->box.vectors.upper_right);
+		}
+
+		g_hash_table_destroy(pass.forms);
+		pass.forms = NULL;
+
+		if (pass.cancelled) {
+			ret = GDS_OUTPUT_RENDERER_CANCELLED;
+			goto ret_free;
+		}
+
+		if (writer.error)
+			break;
+	}
+
+	gds_output_renderer_update_async_fraction(renderer, 0.0, GDS_OUTPUT_RENDERER_PHASE_EXPORTING);
+	gds_output_renderer_update_async_progress(renderer, _("Writing PDF page"));
+
+	for (i = 0; i < page_layers->len; i++) {
+		layer_ptr = &g_array_index(page_layers, struct pdf_page_layer, i);
+		if (pdf_layers)
+			layer_ptr->ocg = pdf_write_ocg(&writer, layer_ptr->linfo);
+		if (layer_ptr->linfo->color.alpha < 1.0)
+			layer_ptr->ext_gstate = pdf_write_ext_gstate(&writer, layer_ptr->linfo->color.alpha);
+	}
+
+	/* Nothing rendered. Create an empty page */
+	if (bounding_box_is_empty(&page_box)) {
+		page_box.vectors.lower_left.x = 0.0;
+		page_box.vectors.lower_left.y = 0.0;
+		page_box.vectors.upper_right.x = 1.0;
+		page_box.vectors.upper_right.y = 1.0;
+	}
+
+	pages = pdf_write_page(&writer, page_layers, &page_box, pdf_layers);
+	catalog = pdf_write_catalog(&writer, pages, page_layers, pdf_layers);
+	pdf_writer_finish(&writer, catalog);
+
+	if (writer.error) {
+		g_warning(_("Error writing PDF output file"));
+		ret = -3;
+	}
+
+ret_free:
+	g_array_free(page_layers, TRUE);
+	g_array_free(writer.xref, TRUE);
+	g_string_free(writer.stream_buffer, TRUE);
+	if (writer.compressor)
+		g_object_unref(writer.compressor);
+	g_free(writer.compress_buffer);
+
+	if (!ret)
+		gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_FINISHED);
+
+	return ret;
+}
+
+static int pdf_renderer_render_output(GdsOutputRenderer *renderer,
+				      struct gds_cell *cell,
+				      double scale)
+{
+	PdfRenderer *p_renderer = GDS_RENDER_PDF_RENDERER(renderer);
+	FILE *pdf_file;
+	int ret = -2;
+	LayerSettings *settings;
+	const char *output_file;
+
+	output_file = gds_output_renderer_get_output_file(renderer);
+	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
+	if (!settings)
+		return GDS_OUTPUT_RENDERER_PARAM_ERR;
+
+	pdf_file = fopen(output_file, "wb");
+	if (pdf_file) {
+		ret = pdf_render_cell_to_file(renderer, cell, settings, pdf_file, scale,
+					      p_renderer->pdf_layers, p_renderer->compress);
+		if (fclose(pdf_file) && !ret) {
+			g_warning(_("Error writing PDF output file"));
+			ret = -3;
+		}
+
+		/* Do not leave incomplete output behind */
+		if (ret == GDS_OUTPUT_RENDERER_CANCELLED)
+			g_unlink(output_file);
+	} else {
+		g_warning(_("Could not open PDF output file"));
+	}
+
+	g_object_unref(settings);
+
+	return ret;
+}
+
+static void pdf_renderer_init(PdfRenderer *self)
+{
+	self->pdf_layers = FALSE;
+	self->compress = TRUE;
+}
+
+static void pdf_renderer_get_property(GObject *obj, guint property_id, GValue *value, GParamSpec *pspec)
+{
+	PdfRenderer *self = GDS_RENDER_PDF_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_PDF_LAYERS:
+		g_value_set_boolean(value, self->pdf_layers);
+		break;
+	case PROP_COMPRESS:
+		g_value_set_boolean(value, self->compress);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void pdf_renderer_set_property(GObject *obj, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+	PdfRenderer *self = GDS_RENDER_PDF_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_PDF_LAYERS:
+		self->pdf_layers = g_value_get_boolean(value);
+		break;
+	case PROP_COMPRESS:
+		self->compress = g_value_get_boolean(value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void pdf_renderer_class_init(PdfRendererClass *klass)
+{
+	GdsOutputRendererClass *render_class = GDS_RENDER_OUTPUT_RENDERER_CLASS(klass);
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+
+	/* Overwrite virtual function */
+	render_class->render_output = pdf_renderer_render_output;
+
+	/* Property stuff */
+	oclass->get_property = pdf_renderer_get_property;
+	oclass->set_property = pdf_renderer_set_property;
+
+	pdf_renderer_properties[PROP_PDF_LAYERS] =
+			g_param_spec_boolean("pdf-layers",
+					     N_("PDF OCG layers"),
+					     N_("Make every layer an optional content group"),
+					     FALSE,
+					     G_PARAM_READWRITE);
+	pdf_renderer_properties[PROP_COMPRESS] =
+			g_param_spec_boolean("compress",
+					     N_("Compress content"),
+					     N_("Flate compress the content streams"),
+					     TRUE,
+					     G_PARAM_READWRITE);
+
+	g_object_class_install_properties(oclass, N_PROPERTIES, pdf_renderer_properties);
+}
+
+PdfRenderer *pdf_renderer_new()
+{
+	return GDS_RENDER_PDF_RENDERER(g_object_new(GDS_RENDER_TYPE_PDF_RENDERER, NULL));
+}
+
+PdfRenderer *pdf_renderer_new_with_options(gboolean pdf_layers, gboolean compress)
+{
+	GObject *obj;
+
+	obj = g_object_new(GDS_RENDER_TYPE_PDF_RENDERER, "pdf-layers", pdf_layers, "compress", compress, NULL);
+	return GDS_RENDER_PDF_RENDERER(obj);
+}
+
+/** @} */
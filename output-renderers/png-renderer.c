@@ -0,0 +1,638 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file png-renderer.c
+ * @brief Tiled multithreaded PNG output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/** @addtogroup PNG-Renderer
+ *  @{
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <cairo.h>
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include <gds-render/output-renderers/png-renderer.h>
+#include <gds-render/output-renderers/layout-painter.h>
+
+/** @brief zlib compression level of the image data. Low levels keep the encoder ahead of the rendering threads */
+#define PNG_RENDERER_COMPRESSION_LEVEL (3)
+
+struct _PngRenderer {
+	GdsOutputRenderer parent;
+	guint threads; /**< @brief Count of rendering threads. 0: One per processor */
+};
+
+G_DEFINE_TYPE(PngRenderer, png_renderer, GDS_RENDER_TYPE_OUTPUT_RENDERER)
+
+enum {
+	PROP_THREADS = 1,
+	N_PROPERTIES
+};
+
+static GParamSpec *png_renderer_properties[N_PROPERTIES] = {NULL};
+
+/**
+ * @brief Streaming PNG encoder
+ */
+struct png_writer {
+	FILE *file; /**< @brief Output file */
+	GConverter *compressor; /**< @brief zlib compressor of the image data */
+	guchar *idat_buffer; /**< @brief Compressed data not yet written as IDAT chunk */
+	gsize idat_fill; /**< @brief Used bytes of png_writer::idat_buffer */
+	guint32 crc_table[256]; /**< @brief CRC-32 lookup table */
+	gboolean error; /**< @brief A write or compression error occured */
+};
+
+/**
+ * @brief Settings shared by all tiles of an image
+ */
+struct png_render_context {
+	struct layout_painter *painter; /**< @brief Painter of the rendered cell */
+	GCancellable *cancellable; /**< @brief Cancellable of the rendering. May be NULL */
+	double scale; /**< @brief Database units per pixel */
+	double origin_x; /**< @brief x coordinate of the left image edge in database units */
+	double origin_y; /**< @brief y coordinate of the top image edge in database units */
+};
+
+struct png_band;
+
+/**
+ * @brief A single tile of a band rendered by a worker thread
+ */
+struct png_tile {
+	const struct png_render_context *context; /**< @brief Image settings */
+	struct png_band *band; /**< @brief Band the tile belongs to */
+	guint x0; /**< @brief Left edge of the tile in pixels */
+	guint width; /**< @brief Width of the tile in pixels */
+};
+
+/**
+ * @brief A horizontal band of the image with a height of up to #PNG_RENDERER_TILE_SIZE pixels
+ */
+struct png_band {
+	guchar *data; /**< @brief Pixel data in CAIRO_FORMAT_ARGB32 */
+	int stride; /**< @brief Length of a pixel row in bytes */
+	guint y0; /**< @brief Top edge of the band in pixels */
+	guint height; /**< @brief Height of the band in pixels */
+	struct png_tile *tiles; /**< @brief Tiles of the band */
+	guint pending; /**< @brief Count of tiles not yet rendered. Protected by png_band::lock */
+	gboolean cancelled; /**< @brief A tile has been cancelled. Protected by png_band::lock */
+	GMutex lock; /**< @brief Lock */
+	GCond finished; /**< @brief Signalled when all tiles have been rendered */
+};
+
+/**
+ * @brief Store a 32 bit value in network byte order
+ * @param buffer Output buffer of at least 4 bytes
+ * @param value Value
+ */
+static void png_put_uint32(guchar *buffer, guint32 value)
+{
+	buffer[0] = (guchar)(value >> 24);
+	buffer[1] = (guchar)(value >> 16);
+	buffer[2] = (guchar)(value >> 8);
+	buffer[3] = (guchar)value;
+}
+
+/**
+ * @brief Calculate the CRC-32 lookup table used by PNG
+ * @param table Table of 256 entries
+ */
+static void png_crc_table_init(guint32 *table)
+{
+	guint32 crc;
+	int i, bit;
+
+	for (i = 0; i < 256; i++) {
+		crc = (guint32)i;
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (0xEDB88320UL ^ (crc >> 1)) : (crc >> 1);
+		table[i] = crc;
+	}
+}
+
+/**
+ * @brief Update a running CRC-32 with \p data
+ * @param table Lookup table
+ * @param crc Running CRC
+ * @param data Data
+ * @param len Length of \p data
+ * @return Updated CRC
+ */
+static guint32 png_crc_update(const guint32 *table, guint32 crc, const guchar *data, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	return crc;
+}
+
+/**
+ * @brief Write a chunk to the PNG file
+ * @param writer PNG writer
+ * @param type Four character chunk type
+ * @param data Chunk data
+ * @param len Length of \p data
+ */
+static void png_writer_write_chunk(struct png_writer *writer, const char *type, const guchar *data, guint32 len)
+{
+	guchar header[8];
+	guchar trailer[4];
+	guint32 crc;
+
+	png_put_uint32(header, len);
+	memcpy(&header[4], type, 4);
+
+	crc = png_crc_update(writer->crc_table, 0xFFFFFFFFUL, &header[4], 4);
+	crc = png_crc_update(writer->crc_table, crc, data, len);
+	png_put_uint32(trailer, crc ^ 0xFFFFFFFFUL);
+
+	if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header) ||
+	    (len && fwrite(data, 1, len, writer->file) != len) ||
+	    fwrite(trailer, 1, sizeof(trailer), writer->file) != sizeof(trailer))
+		writer->error = TRUE;
+}
+
+/**
+ * @brief Write the compressed data collected so far as IDAT chunk
+ * @param writer PNG writer
+ */
+static void png_writer_flush_idat(struct png_writer *writer)
+{
+	if (!writer->idat_fill)
+		return;
+
+	png_writer_write_chunk(writer, "IDAT", writer->idat_buffer, (guint32)writer->idat_fill);
+	writer->idat_fill = 0;
+}
+
+/**
+ * @brief Compress image data
+ * @param writer PNG writer
+ * @param data Filtered image rows
+ * @param len Length of \p data
+ * @param end_of_image TRUE if this is the last data of the image
+ */
+static void png_writer_compress(struct png_writer *writer, const guchar *data, gsize len, gboolean end_of_image)
+{
+	GConverterResult res;
+	GError *error = NULL;
+	gsize consumed = 0;
+	gsize bytes_read;
+	gsize bytes_written;
+	const gsize idat_size = PNG_RENDERER_IDAT_KB * 1024;
+
+	if (writer->error)
+		return;
+
+	do {
+		res = g_converter_convert(writer->compressor, data + consumed, len - consumed,
+					  writer->idat_buffer + writer->idat_fill, idat_size - writer->idat_fill,
+					  (end_of_image ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_NO_FLAGS),
+					  &bytes_read, &bytes_written, &error);
+		if (res == G_CONVERTER_ERROR) {
+			/* Compressor needs more output space */
+			if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NO_SPACE) && writer->idat_fill) {
+				g_clear_error(&error);
+				png_writer_flush_idat(writer);
+				continue;
+			}
+
+			g_warning(_("Could not compress PNG image data: %s"), error->message);
+			g_clear_error(&error);
+			writer->error = TRUE;
+			break;
+		}
+
+		writer->idat_fill += bytes_written;
+		consumed += bytes_read;
+		if (writer->idat_fill == idat_size)
+			png_writer_flush_idat(writer);
+	} while (consumed < len || (end_of_image && res != G_CONVERTER_FINISHED));
+}
+
+/**
+ * @brief Write the PNG signature and header of an 8 bit RGBA image
+ * @param writer PNG writer
+ * @param width Image width
+ * @param height Image height
+ */
+static void png_writer_begin(struct png_writer *writer, guint32 width, guint32 height)
+{
+	static const guchar signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	guchar ihdr[13];
+
+	if (fwrite(signature, 1, sizeof(signature), writer->file) != sizeof(signature))
+		writer->error = TRUE;
+
+	png_put_uint32(&ihdr[0], width);
+	png_put_uint32(&ihdr[4], height);
+	ihdr[8] = 8; /* Bit depth */
+	ihdr[9] = 6; /* Color type: RGBA */
+	ihdr[10] = 0; /* Compression: deflate */
+	ihdr[11] = 0; /* Filter method */
+	ihdr[12] = 0; /* No interlacing */
+	png_writer_write_chunk(writer, "IHDR", ihdr, sizeof(ihdr));
+}
+
+/**
+ * @brief Finish the image data and write the end chunk
+ * @param writer PNG writer
+ */
+static void png_writer_finish(struct png_writer *writer)
+{
+	png_writer_compress(writer, NULL, 0, TRUE);
+	png_writer_flush_idat(writer);
+	png_writer_write_chunk(writer, "IEND", NULL, 0);
+}
+
+/**
+ * @brief Render a tile. Worker function of the thread pool
+ * @param data Tile
+ * @param user_data Unused
+ */
+static void png_render_tile(gpointer data, gpointer user_data)
+{
+	struct png_tile *tile = (struct png_tile *)data;
+	struct png_band *band = tile->band;
+	const struct png_render_context *context = tile->context;
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	int ret;
+	(void)user_data;
+
+	/* The tile renders directly into its part of the band */
+	surface = cairo_image_surface_create_for_data(band->data + (gsize)tile->x0 * 4, CAIRO_FORMAT_ARGB32,
+						      (int)tile->width, (int)band->height, band->stride);
+	cr = cairo_create(surface);
+
+	/* Database units to image pixels. The y axis points down in the image */
+	cairo_translate(cr, -(double)tile->x0, -(double)band->y0);
+	cairo_scale(cr, 1.0 / context->scale, -1.0 / context->scale);
+	cairo_translate(cr, -context->origin_x, -context->origin_y);
+
+	/* Cell instances outside of the tile are culled by their bounding boxes */
+	ret = layout_painter_paint(context->painter, cr, tile->width, band->height, 0.0, context->cancellable);
+
+	cairo_destroy(cr);
+	cairo_surface_destroy(surface);
+
+	g_mutex_lock(&band->lock);
+	if (ret)
+		band->cancelled = TRUE;
+	if (--band->pending == 0)
+		g_cond_signal(&band->finished);
+	g_mutex_unlock(&band->lock);
+}
+
+/**
+ * @brief Start rendering a band
+ *
+ * The tiles are pushed to the thread pool. If no pool is available, they are rendered immediately.
+ *
+ * @param band Band
+ * @param context Image settings
+ * @param pool Thread pool. May be NULL
+ * @param y0 Top edge of the band in pixels
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ */
+static void png_band_start(struct png_band *band, const struct png_render_context *context, GThreadPool *pool,
+			   guint y0, guint width, guint height)
+{
+	guint tile_count;
+	guint i;
+
+	tile_count = (width + PNG_RENDERER_TILE_SIZE - 1) / PNG_RENDERER_TILE_SIZE;
+
+	band->y0 = y0;
+	band->height = MIN(PNG_RENDERER_TILE_SIZE, height - y0);
+	band->pending = tile_count;
+	band->cancelled = FALSE;
+	memset(band->data, 0, (gsize)band->stride * band->height);
+
+	g_free(band->tiles);
+	band->tiles = g_new(struct png_tile, tile_count);
+
+	for (i = 0; i < tile_count; i++) {
+		band->tiles[i].context = context;
+		band->tiles[i].band = band;
+		band->tiles[i].x0 = i * PNG_RENDERER_TILE_SIZE;
+		band->tiles[i].width = MIN(PNG_RENDERER_TILE_SIZE, width - band->tiles[i].x0);
+	}
+
+	for (i = 0; i < tile_count; i++) {
+		if (!pool || !g_thread_pool_push(pool, &band->tiles[i], NULL))
+			png_render_tile(&band->tiles[i], NULL);
+	}
+}
+
+/**
+ * @brief Wait until all tiles of a band have been rendered
+ * @param band Band
+ * @return TRUE if the rendering of a tile has been cancelled
+ */
+static gboolean png_band_wait(struct png_band *band)
+{
+	gboolean cancelled;
+
+	g_mutex_lock(&band->lock);
+	while (band->pending)
+		g_cond_wait(&band->finished, &band->lock);
+	cancelled = band->cancelled;
+	g_mutex_unlock(&band->lock);
+
+	return cancelled;
+}
+
+/**
+ * @brief Convert the rows of a rendered band to PNG and compress them
+ *
+ * Cairo stores premultiplied native endian ARGB. PNG expects straight RGBA.
+ * All rows use filter type 0 (None).
+ *
+ * @param writer PNG writer
+ * @param band Band
+ * @param row Row buffer of 1 + 4 x \p width bytes
+ * @param width Image width in pixels
+ */
+static void png_band_encode(struct png_writer *writer, const struct png_band *band, guchar *row, guint width)
+{
+	const guint32 *pixels;
+	guint32 pixel;
+	guint alpha;
+	guint x, y;
+	guchar *out;
+
+	for (y = 0; y < band->height; y++) {
+		pixels = (const guint32 *)(band->data + (gsize)y * band->stride);
+		row[0] = 0;
+		out = &row[1];
+
+		for (x = 0; x < width; x++) {
+			pixel = pixels[x];
+			alpha = pixel >> 24;
+			if (alpha == 0) {
+				out[0] = out[1] = out[2] = out[3] = 0;
+			} else {
+				out[0] = (guchar)((((pixel >> 16) & 0xFF) * 255 + alpha / 2) / alpha);
+				out[1] = (guchar)((((pixel >> 8) & 0xFF) * 255 + alpha / 2) / alpha);
+				out[2] = (guchar)(((pixel & 0xFF) * 255 + alpha / 2) / alpha);
+				out[3] = (guchar)alpha;
+			}
+			out += 4;
+		}
+
+		png_writer_compress(writer, row, 1 + (gsize)width * 4, FALSE);
+	}
+}
+
+static int png_render_cell_to_file(PngRenderer *self, struct gds_cell *cell, LayerSettings *settings,
+				   FILE *png_file, double scale)
+{
+	GdsOutputRenderer *renderer = GDS_RENDER_OUTPUT_RENDERER(self);
+	struct png_render_context context;
+	struct png_writer writer;
+	struct png_band bands[2];
+	const union bounding_box *box;
+	GThreadPool *pool;
+	guchar *row = NULL;
+	double img_width, img_height;
+	guint width, height;
+	guint band_count;
+	guint threads;
+	guint i;
+	int ret = 0;
+
+	context.painter = layout_painter_new(cell, settings);
+	if (!context.painter)
+		return -1;
+
+	box = layout_painter_get_bounding_box(context.painter);
+	if (bounding_box_is_empty(box)) {
+		img_width = 1.0;
+		img_height = 1.0;
+		context.origin_x = 0.0;
+		context.origin_y = 0.0;
+	} else {
+		img_width = ceil((box->vectors.upper_right.x - box->vectors.lower_left.x) / scale);
+		img_height = ceil((box->vectors.upper_right.y - box->vectors.lower_left.y) / scale);
+		context.origin_x = box->vectors.lower_left.x;
+		context.origin_y = box->vectors.upper_right.y;
+	}
+
+	if (img_width > PNG_RENDERER_MAX_DIMENSION || img_height > PNG_RENDERER_MAX_DIMENSION) {
+		g_warning(_("PNG image of %.0f x %.0f pixels exceeds the maximum size. Increase the scale."),
+			  img_width, img_height);
+		layout_painter_unref(context.painter);
+		return -1;
+	}
+
+	width = MAX((guint)img_width, 1);
+	height = MAX((guint)img_height, 1);
+	context.scale = scale;
+	context.cancellable = gds_output_renderer_get_cancellable(renderer);
+
+	gds_output_renderer_update_async_progress(renderer, _("Rendering PNG image"));
+
+	memset(&writer, 0, sizeof(writer));
+	writer.file = png_file;
+	writer.compressor = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB,
+							      PNG_RENDERER_COMPRESSION_LEVEL));
+	writer.idat_buffer = (guchar *)g_malloc(PNG_RENDERER_IDAT_KB * 1024);
+	png_crc_table_init(writer.crc_table);
+
+	/* Two bands: The next band is rendered while the current one is encoded */
+	memset(bands, 0, sizeof(bands));
+	for (i = 0; i < 2; i++) {
+		bands[i].stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, (int)width);
+		bands[i].data = (guchar *)g_malloc((gsize)bands[i].stride * PNG_RENDERER_TILE_SIZE);
+		g_mutex_init(&bands[i].lock);
+		g_cond_init(&bands[i].finished);
+	}
+	row = (guchar *)g_malloc(1 + (gsize)width * 4);
+
+	threads = (self->threads ? self->threads : MAX(g_get_num_processors(), 1));
+	pool = g_thread_pool_new(png_render_tile, NULL, (gint)threads, FALSE, NULL);
+
+	png_writer_begin(&writer, width, height);
+
+	band_count = (height + PNG_RENDERER_TILE_SIZE - 1) / PNG_RENDERER_TILE_SIZE;
+	png_band_start(&bands[0], &context, pool, 0, width, height);
+
+	for (i = 0; i < band_count; i++) {
+		if (i + 1 < band_count)
+			png_band_start(&bands[(i + 1) % 2], &context, pool, (i + 1) * PNG_RENDERER_TILE_SIZE,
+				       width, height);
+
+		if (png_band_wait(&bands[i % 2]) || gds_output_renderer_is_cancelled(renderer)) {
+			ret = GDS_OUTPUT_RENDERER_CANCELLED;
+			break;
+		}
+
+		png_band_encode(&writer, &bands[i % 2], row, width);
+		if (writer.error) {
+			ret = -2;
+			break;
+		}
+
+		gds_output_renderer_update_async_fraction(renderer, (double)(i + 1) / (double)band_count,
+							  GDS_OUTPUT_RENDERER_PHASE_RENDERING);
+	}
+
+	/* Wait for tiles still in flight before freeing the bands */
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	if (!ret) {
+		gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_EXPORTING);
+		png_writer_finish(&writer);
+		if (writer.error)
+			ret = -2;
+		else
+			gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_FINISHED);
+	}
+
+	for (i = 0; i < 2; i++) {
+		g_free(bands[i].data);
+		g_free(bands[i].tiles);
+		g_mutex_clear(&bands[i].lock);
+		g_cond_clear(&bands[i].finished);
+	}
+	g_free(row);
+	g_free(writer.idat_buffer);
+	g_object_unref(writer.compressor);
+	layout_painter_unref(context.painter);
+
+	return ret;
+}
+
+static int png_renderer_render_output(GdsOutputRenderer *renderer,
+				      struct gds_cell *cell,
+				      double scale)
+{
+	FILE *png_file;
+	int ret = -2;
+	LayerSettings *settings;
+	const char *output_file;
+
+	output_file = gds_output_renderer_get_output_file(renderer);
+	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
+	if (!settings)
+		return GDS_OUTPUT_RENDERER_PARAM_ERR;
+
+	png_file = fopen(output_file, "wb");
+	if (png_file) {
+		ret = png_render_cell_to_file(GDS_RENDER_PNG_RENDERER(renderer), cell, settings, png_file, scale);
+		if (fclose(png_file) && !ret) {
+			g_warning(_("Error writing PNG output file"));
+			ret = -3;
+		}
+
+		/* Do not leave incomplete output behind */
+		if (ret == GDS_OUTPUT_RENDERER_CANCELLED)
+			g_unlink(output_file);
+	} else {
+		g_warning(_("Could not open PNG output file"));
+	}
+
+	g_object_unref(settings);
+
+	return ret;
+}
+
+static void png_renderer_init(PngRenderer *self)
+{
+	self->threads = 0;
+}
+
+static void png_renderer_get_property(GObject *obj, guint property_id, GValue *value, GParamSpec *pspec)
+{
+	PngRenderer *self = GDS_RENDER_PNG_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_THREADS:
+		g_value_set_uint(value, self->threads);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void png_renderer_set_property(GObject *obj, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+	PngRenderer *self = GDS_RENDER_PNG_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_THREADS:
+		self->threads = g_value_get_uint(value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void png_renderer_class_init(PngRendererClass *klass)
+{
+	GdsOutputRendererClass *render_class = GDS_RENDER_OUTPUT_RENDERER_CLASS(klass);
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+
+	/* Overwrite virtual function */
+	render_class->render_output = png_renderer_render_output;
+
+	/* Property stuff */
+	oclass->get_property = png_renderer_get_property;
+	oclass->set_property = png_renderer_set_property;
+
+	png_renderer_properties[PROP_THREADS] =
+			g_param_spec_uint("threads",
+					  N_("Rendering threads"),
+					  N_("Count of threads rendering the tiles. 0 uses one thread per processor"),
+					  0, 1024, 0,
+					  G_PARAM_READWRITE);
+
+	g_object_class_install_properties(oclass, N_PROPERTIES, png_renderer_properties);
+}
+
+PngRenderer *png_renderer_new()
+{
+	return GDS_RENDER_PNG_RENDERER(g_object_new(GDS_RENDER_TYPE_PNG_RENDERER, NULL));
+}
+
+PngRenderer *png_renderer_new_with_options(guint threads)
+{
+	GObject *obj;
+
+	obj = g_object_new(GDS_RENDER_TYPE_PNG_RENDERER, "threads", threads, NULL);
+	return GDS_RENDER_PNG_RENDERER(obj);
+}
+
+/** @} */
@@ -0,0 +1,614 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pyramid-renderer.c
+ * @brief XYZ tile pyramid output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/** @addtogroup Pyramid-Renderer
+ *  @{
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <cairo.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include <gds-render/output-renderers/pyramid-renderer.h>
+#include <gds-render/output-renderers/layout-painter.h>
+
+struct _PyramidRenderer {
+	GdsOutputRenderer parent;
+	gboolean overwrite; /**< @brief TRUE: Render existing tiles again */
+	guint threads; /**< @brief Count of rendering threads. 0: One per processor */
+};
+
+G_DEFINE_TYPE(PyramidRenderer, pyramid_renderer, GDS_RENDER_TYPE_OUTPUT_RENDERER)
+
+enum {
+	PROP_OVERWRITE = 1,
+	PROP_THREADS,
+	N_PROPERTIES
+};
+
+static GParamSpec *pyramid_renderer_properties[N_PROPERTIES] = {NULL};
+
+/**
+ * @brief State shared by all tile columns of a pyramid
+ */
+struct pyramid_context {
+	struct layout_painter *painter; /**< @brief Painter of the rendered cell */
+	GCancellable *cancellable; /**< @brief Cancellable of the rendering. May be NULL */
+	const char *directory; /**< @brief Output directory */
+	gboolean overwrite; /**< @brief Render existing tiles again */
+	double origin_x; /**< @brief x coordinate of the left edge of the pyramid in database units */
+	double origin_y; /**< @brief y coordinate of the top edge of the pyramid in database units */
+	double width; /**< @brief Width of the cell in database units */
+	double height; /**< @brief Height of the cell in database units */
+	double extent; /**< @brief Edge length of the single tile of zoom level 0 in database units */
+	GMutex lock; /**< @brief Lock protecting the following members */
+	GCond progress; /**< @brief Signalled when a column has been finished */
+	guint done_columns; /**< @brief Count of finished columns */
+	guint written_tiles; /**< @brief Count of rendered tiles */
+	guint skipped_tiles; /**< @brief Count of tiles that already existed */
+	gboolean failed; /**< @brief A tile could not be written */
+	gboolean cancelled; /**< @brief The rendering has been cancelled */
+};
+
+/**
+ * @brief A column of tiles of a single zoom level. Unit of work of the thread pool
+ */
+struct pyramid_column {
+	struct pyramid_context *context; /**< @brief Shared state */
+	guint zoom; /**< @brief Zoom level */
+	guint x; /**< @brief Column index */
+	guint rows; /**< @brief Count of tiles in the column covering the cell */
+};
+
+/**
+ * @brief Size of a pixel at a zoom level
+ * @param context Pyramid
+ * @param zoom Zoom level
+ * @return Pixel size in database units
+ */
+static double pyramid_pixel_size(const struct pyramid_context *context, guint zoom)
+{
+	return context->extent / ((double)PYRAMID_RENDERER_TILE_SIZE * (double)(1U << zoom));
+}
+
+/**
+ * @brief Render a single tile and write it to \p path
+ *
+ * The tile is written to a temporary file, which is renamed afterwards.
+ * Therefore, every existing tile is complete, even if a previous export has been aborted.
+ *
+ * @param context Pyramid
+ * @param zoom Zoom level
+ * @param x Column
+ * @param y Row
+ * @param path Output path
+ * @return 0 if successful, 1 if cancelled, -1 on error
+ */
+static int pyramid_render_tile(struct pyramid_context *context, guint zoom, guint x, guint y, const char *path)
+{
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	char *temp_path;
+	double pixel_size;
+	int ret = 0;
+
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, PYRAMID_RENDERER_TILE_SIZE, PYRAMID_RENDERER_TILE_SIZE);
+	cr = cairo_create(surface);
+
+	/* Database units to pixels of the tile. The y axis points down */
+	pixel_size = pyramid_pixel_size(context, zoom);
+	cairo_translate(cr, -(double)x * PYRAMID_RENDERER_TILE_SIZE, -(double)y * PYRAMID_RENDERER_TILE_SIZE);
+	cairo_scale(cr, 1.0 / pixel_size, -1.0 / pixel_size);
+	cairo_translate(cr, -context->origin_x, -context->origin_y);
+
+	/* Instances below the level of detail are skipped. Coarse levels do not descend into small cells */
+	if (layout_painter_paint(context->painter, cr, PYRAMID_RENDERER_TILE_SIZE, PYRAMID_RENDERER_TILE_SIZE,
+				 LAYOUT_PAINTER_DEFAULT_LOD_THRESHOLD, context->cancellable)) {
+		ret = 1;
+		goto ret_destroy;
+	}
+
+	cairo_destroy(cr);
+	cr = NULL;
+
+	temp_path = g_strdup_printf("%s.part", path);
+	if (cairo_surface_write_to_png(surface, temp_path) != CAIRO_STATUS_SUCCESS || g_rename(temp_path, path)) {
+		g_warning(_("Could not write tile %s"), path);
+		g_unlink(temp_path);
+		ret = -1;
+	}
+	g_free(temp_path);
+
+ret_destroy:
+	if (cr)
+		cairo_destroy(cr);
+	cairo_surface_destroy(surface);
+
+	return ret;
+}
+
+/**
+ * @brief Render all tiles of a column. Worker function of the thread pool
+ * @param data Column
+ * @param user_data Unused
+ */
+static void pyramid_render_column(gpointer data, gpointer user_data)
+{
+	struct pyramid_column *column = (struct pyramid_column *)data;
+	struct pyramid_context *context = column->context;
+	guint written = 0;
+	guint skipped = 0;
+	gboolean failed = FALSE;
+	gboolean cancelled = FALSE;
+	char *path;
+	guint y;
+	int ret;
+	(void)user_data;
+
+	for (y = 0; y < column->rows && !cancelled; y++) {
+		if (context->cancellable && g_cancellable_is_cancelled(context->cancellable)) {
+			cancelled = TRUE;
+			break;
+		}
+
+		path = g_strdup_printf("%s/%u/%u/%u.png", context->directory, column->zoom, column->x, y);
+
+		/* Resume an aborted or incremental export */
+		if (!context->overwrite && g_file_test(path, G_FILE_TEST_EXISTS)) {
+			skipped++;
+			g_free(path);
+			continue;
+		}
+
+		ret = pyramid_render_tile(context, column->zoom, column->x, y, path);
+		if (ret > 0)
+			cancelled = TRUE;
+		else if (ret < 0)
+			failed = TRUE;
+		else
+			written++;
+		g_free(path);
+	}
+
+	g_mutex_lock(&context->lock);
+	context->written_tiles += written;
+	context->skipped_tiles += skipped;
+	context->failed |= failed;
+	context->cancelled |= cancelled;
+	context->done_columns++;
+	g_cond_signal(&context->progress);
+	g_mutex_unlock(&context->lock);
+}
+
+/**
+ * @brief Hash the parts of the layer settings that affect the tiles
+ * @param settings Layer settings
+ * @return SHA-256 of the settings as hex string. Free with g_free()
+ */
+static char *pyramid_hash_layer_settings(LayerSettings *settings)
+{
+	GChecksum *checksum;
+	GList *info_iter;
+	const struct layer_info *info;
+	char *line;
+	char *hash;
+	char color[4][G_ASCII_DTOSTR_BUF_SIZE];
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	for (info_iter = layer_settings_get_layer_info_list(settings); info_iter; info_iter = g_list_next(info_iter)) {
+		info = (const struct layer_info *)info_iter->data;
+		/* Textual representation. Independent of the byte order */
+		g_ascii_dtostr(color[0], G_ASCII_DTOSTR_BUF_SIZE, info->color.red);
+		g_ascii_dtostr(color[1], G_ASCII_DTOSTR_BUF_SIZE, info->color.green);
+		g_ascii_dtostr(color[2], G_ASCII_DTOSTR_BUF_SIZE, info->color.blue);
+		g_ascii_dtostr(color[3], G_ASCII_DTOSTR_BUF_SIZE, info->color.alpha);
+		line = g_strdup_printf("%d,%d,%d,%s,%s,%s,%s\n", info->layer, info->datatype, info->render ? 1 : 0,
+				       color[0], color[1], color[2], color[3]);
+		g_checksum_update(checksum, (const guchar *)line, -1);
+		g_free(line);
+	}
+
+	hash = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+
+	return hash;
+}
+
+/**
+ * @brief Create the description of the pyramid used by viewers
+ *
+ * Besides the information needed by viewers, the description contains everything
+ * that affects the content of the tiles. It is used to check if existing tiles can be kept.
+ *
+ * @param context Pyramid
+ * @param max_zoom Highest zoom level
+ * @param box Bounding box of the cell in database units
+ * @param scale Pixel size of the highest zoom level requested by the user
+ * @param layer_hash Hash of the layer settings
+ * @param window Clip window of the output. NULL if the whole cell is rendered
+ * @return JSON document. Free with g_free()
+ */
+static char *pyramid_create_metadata(const struct pyramid_context *context, guint max_zoom,
+				     const union bounding_box *box, double scale, const char *layer_hash,
+				     const union bounding_box *window)
+{
+	char numbers[10][G_ASCII_DTOSTR_BUF_SIZE];
+	char *window_json;
+	char *json;
+
+	g_ascii_dtostr(numbers[0], G_ASCII_DTOSTR_BUF_SIZE, scale);
+	g_ascii_dtostr(numbers[1], G_ASCII_DTOSTR_BUF_SIZE, context->extent);
+	g_ascii_dtostr(numbers[2], G_ASCII_DTOSTR_BUF_SIZE, box->vectors.lower_left.x);
+	g_ascii_dtostr(numbers[3], G_ASCII_DTOSTR_BUF_SIZE, box->vectors.lower_left.y);
+	g_ascii_dtostr(numbers[4], G_ASCII_DTOSTR_BUF_SIZE, box->vectors.upper_right.x);
+	g_ascii_dtostr(numbers[5], G_ASCII_DTOSTR_BUF_SIZE, box->vectors.upper_right.y);
+
+	if (window) {
+		g_ascii_dtostr(numbers[6], G_ASCII_DTOSTR_BUF_SIZE, window->vectors.lower_left.x);
+		g_ascii_dtostr(numbers[7], G_ASCII_DTOSTR_BUF_SIZE, window->vectors.lower_left.y);
+		g_ascii_dtostr(numbers[8], G_ASCII_DTOSTR_BUF_SIZE, window->vectors.upper_right.x);
+		g_ascii_dtostr(numbers[9], G_ASCII_DTOSTR_BUF_SIZE, window->vectors.upper_right.y);
+		window_json = g_strdup_printf("[%s, %s, %s, %s]", numbers[6], numbers[7], numbers[8], numbers[9]);
+	} else {
+		window_json = g_strdup("null");
+	}
+
+	json = g_strdup_printf("{\n"
+			       "  \"format\": \"png\",\n"
+			       "  \"scheme\": \"xyz\",\n"
+			       "  \"tileSize\": %d,\n"
+			       "  \"minZoom\": 0,\n"
+			       "  \"maxZoom\": %u,\n"
+			       "  \"scale\": %s,\n"
+			       "  \"extent\": %s,\n"
+			       "  \"bounds\": [%s, %s, %s, %s],\n"
+			       "  \"window\": %s,\n"
+			       "  \"layerSettings\": \"%s\"\n"
+			       "}\n",
+			       PYRAMID_RENDERER_TILE_SIZE, max_zoom, numbers[0], numbers[1],
+			       numbers[2], numbers[3], numbers[4], numbers[5], window_json, layer_hash);
+
+	g_free(window_json);
+
+	return json;
+}
+
+/**
+ * @brief Check if the tiles in the output directory belong to the pyramid described by \p metadata
+ *
+ * The description is written before the first tile. Tiles of an aborted export
+ * are therefore always accompanied by the description of their pyramid.
+ *
+ * @param context Pyramid
+ * @param metadata Description of the pyramid to render
+ * @return 0 if existing tiles can be kept or are overwritten. -1 if the directory contains a different pyramid
+ */
+static int pyramid_check_existing(const struct pyramid_context *context, const char *metadata)
+{
+	char *path;
+	char *tile_path;
+	char *existing = NULL;
+	int ret = 0;
+
+	if (context->overwrite)
+		return 0;
+
+	path = g_build_filename(context->directory, "metadata.json", NULL);
+	if (g_file_get_contents(path, &existing, NULL, NULL)) {
+		if (strcmp(existing, metadata))
+			ret = -1;
+	} else {
+		/* Tiles of unknown origin */
+		tile_path = g_build_filename(context->directory, "0", "0", "0.png", NULL);
+		if (g_file_test(tile_path, G_FILE_TEST_EXISTS))
+			ret = -1;
+		g_free(tile_path);
+	}
+
+	if (ret)
+		g_warning(_("%s contains tiles rendered with different settings. Enable overwrite or use another directory"),
+			  context->directory);
+
+	g_free(existing);
+	g_free(path);
+
+	return ret;
+}
+
+/**
+ * @brief Write the description of the pyramid
+ * @param context Pyramid
+ * @param metadata Description created by pyramid_create_metadata()
+ * @return 0 if successful
+ */
+static int pyramid_write_metadata(const struct pyramid_context *context, const char *metadata)
+{
+	GError *error = NULL;
+	char *path;
+	int ret = 0;
+
+	path = g_build_filename(context->directory, "metadata.json", NULL);
+	if (!g_file_set_contents(path, metadata, -1, &error)) {
+		g_warning(_("Could not write pyramid metadata: %s"), error->message);
+		g_clear_error(&error);
+		ret = -1;
+	}
+
+	g_free(path);
+
+	return ret;
+}
+
+static int pyramid_render_cell(PyramidRenderer *self, struct gds_cell *cell, LayerSettings *settings,
+			       const char *directory, double scale)
+{
+	GdsOutputRenderer *renderer = GDS_RENDER_OUTPUT_RENDERER(self);
+	struct pyramid_context context;
+	struct pyramid_column *columns = NULL;
+	const union bounding_box *box;
+	union bounding_box window;
+	gboolean window_set;
+	char *layer_hash;
+	char *metadata = NULL;
+	GThreadPool *pool = NULL;
+	char *column_dir;
+	double tile_extent;
+	guint max_zoom = 0;
+	guint column_count = 0;
+	guint zoom, x, idx;
+	guint threads;
+	guint done;
+	int ret = 0;
+
+	if (g_mkdir_with_parents(directory, 0755)) {
+		g_warning(_("Could not create tile directory %s"), directory);
+		return -1;
+	}
+
+	memset(&context, 0, sizeof(context));
+	context.painter = layout_painter_new(cell, settings);
+	if (!context.painter)
+		return -1;
+
+	context.cancellable = gds_output_renderer_get_cancellable(renderer);
+	context.directory = directory;
+	context.overwrite = self->overwrite;
+	g_mutex_init(&context.lock);
+	g_cond_init(&context.progress);
+
+	box = layout_painter_get_bounding_box(context.painter);
+	if (bounding_box_is_empty(box)) {
+		g_warning(_("Cell %s does not contain any graphics. No tiles are generated"), cell->name);
+		goto ret_clear;
+	}
+
+	context.origin_x = box->vectors.lower_left.x;
+	context.origin_y = box->vectors.upper_right.y;
+	context.width = box->vectors.upper_right.x - box->vectors.lower_left.x;
+	context.height = box->vectors.upper_right.y - box->vectors.lower_left.y;
+
+	/* The highest level has a pixel size of at most scale. Level 0 shows the whole cell in a single tile */
+	while (max_zoom < PYRAMID_RENDERER_MAX_ZOOM &&
+	       MAX(context.width, context.height) / scale > (double)PYRAMID_RENDERER_TILE_SIZE * (double)(1U << max_zoom))
+		max_zoom++;
+	context.extent = scale * PYRAMID_RENDERER_TILE_SIZE * (double)(1U << max_zoom);
+	context.extent = MAX(context.extent, MAX(context.width, context.height));
+
+	/* Existing tiles are only kept if they belong to the same pyramid */
+	window_set = gds_output_renderer_get_window(renderer, &window);
+	layer_hash = pyramid_hash_layer_settings(settings);
+	metadata = pyramid_create_metadata(&context, max_zoom, box, scale, layer_hash, window_set ? &window : NULL);
+	g_free(layer_hash);
+	if (pyramid_check_existing(&context, metadata)) {
+		ret = -2;
+		goto ret_clear;
+	}
+
+	if (pyramid_write_metadata(&context, metadata)) {
+		ret = -2;
+		goto ret_clear;
+	}
+
+	for (zoom = 0; zoom <= max_zoom; zoom++) {
+		tile_extent = pyramid_pixel_size(&context, zoom) * PYRAMID_RENDERER_TILE_SIZE;
+		column_count += MAX((guint)ceil(context.width / tile_extent), 1);
+	}
+
+	gds_output_renderer_update_async_progress(renderer, _("Rendering tile pyramid"));
+
+	columns = g_new(struct pyramid_column, column_count);
+	threads = (self->threads ? self->threads : MAX(g_get_num_processors(), 1));
+	pool = g_thread_pool_new(pyramid_render_column, NULL, (gint)threads, FALSE, NULL);
+
+	/* All levels are rendered concurrently. Coarse levels are queued first */
+	idx = 0;
+	for (zoom = 0; zoom <= max_zoom; zoom++) {
+		tile_extent = pyramid_pixel_size(&context, zoom) * PYRAMID_RENDERER_TILE_SIZE;
+		for (x = 0; x < MAX((guint)ceil(context.width / tile_extent), 1); x++, idx++) {
+			columns[idx].context = &context;
+			columns[idx].zoom = zoom;
+			columns[idx].x = x;
+			columns[idx].rows = MAX((guint)ceil(context.height / tile_extent), 1);
+
+			column_dir = g_strdup_printf("%s/%u/%u", directory, zoom, x);
+			if (g_mkdir_with_parents(column_dir, 0755))
+				g_warning(_("Could not create tile directory %s"), column_dir);
+			g_free(column_dir);
+
+			if (!pool || !g_thread_pool_push(pool, &columns[idx], NULL))
+				pyramid_render_column(&columns[idx], NULL);
+		}
+	}
+
+	g_mutex_lock(&context.lock);
+	while (context.done_columns < column_count) {
+		g_cond_wait(&context.progress, &context.lock);
+		done = context.done_columns;
+		g_mutex_unlock(&context.lock);
+		gds_output_renderer_update_async_fraction(renderer, (double)done / (double)column_count,
+							  GDS_OUTPUT_RENDERER_PHASE_RENDERING);
+		g_mutex_lock(&context.lock);
+	}
+	g_mutex_unlock(&context.lock);
+
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	/* Finished tiles are kept. A cancelled export is resumed by running it again */
+	if (context.cancelled || gds_output_renderer_is_cancelled(renderer)) {
+		ret = GDS_OUTPUT_RENDERER_CANCELLED;
+		goto ret_clear;
+	}
+
+	if (context.failed) {
+		ret = -2;
+		g_warning(_("Tile pyramid %s is incomplete: Not all tiles could be written"), directory);
+		gds_output_renderer_update_async_progress(renderer, _("Tile pyramid incomplete: Not all tiles could be written"));
+		goto ret_clear;
+	}
+
+	gds_output_renderer_update_async_progress(renderer, _("Tile pyramid finished"));
+	gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_FINISHED);
+	g_message(_("Tile pyramid %s: %u tiles rendered, %u existing tiles skipped"), directory,
+		  context.written_tiles, context.skipped_tiles);
+
+ret_clear:
+	g_free(metadata);
+	g_free(columns);
+	g_mutex_clear(&context.lock);
+	g_cond_clear(&context.progress);
+	layout_painter_unref(context.painter);
+
+	return ret;
+}
+
+static int pyramid_renderer_render_output(GdsOutputRenderer *renderer,
+					  struct gds_cell *cell,
+					  double scale)
+{
+	int ret;
+	LayerSettings *settings;
+	const char *output_dir;
+
+	output_dir = gds_output_renderer_get_output_file(renderer);
+	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
+	if (!settings || !output_dir) {
+		if (settings)
+			g_object_unref(settings);
+		return GDS_OUTPUT_RENDERER_PARAM_ERR;
+	}
+
+	ret = pyramid_render_cell(GDS_RENDER_PYRAMID_RENDERER(renderer), cell, settings, output_dir, scale);
+
+	g_object_unref(settings);
+
+	return ret;
+}
+
+static void pyramid_renderer_init(PyramidRenderer *self)
+{
+	self->overwrite = FALSE;
+	self->threads = 0;
+}
+
+static void pyramid_renderer_get_property(GObject *obj, guint property_id, GValue *value, GParamSpec *pspec)
+{
+	PyramidRenderer *self = GDS_RENDER_PYRAMID_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_OVERWRITE:
+		g_value_set_boolean(value, self->overwrite);
+		break;
+	case PROP_THREADS:
+		g_value_set_uint(value, self->threads);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void pyramid_renderer_set_property(GObject *obj, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+	PyramidRenderer *self = GDS_RENDER_PYRAMID_RENDERER(obj);
+
+	switch (property_id) {
+	case PROP_OVERWRITE:
+		self->overwrite = g_value_get_boolean(value);
+		break;
+	case PROP_THREADS:
+		self->threads = g_value_get_uint(value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
+		break;
+	}
+}
+
+static void pyramid_renderer_class_init(PyramidRendererClass *klass)
+{
+	GdsOutputRendererClass *render_class = GDS_RENDER_OUTPUT_RENDERER_CLASS(klass);
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+
+	/* Overwrite virtual function */
+	render_class->render_output = pyramid_renderer_render_output;
+
+	/* Property stuff */
+	oclass->get_property = pyramid_renderer_get_property;
+	oclass->set_property = pyramid_renderer_set_property;
+
+	pyramid_renderer_properties[PROP_OVERWRITE] =
+			g_param_spec_boolean("overwrite",
+					     N_("Overwrite tiles"),
+					     N_("Render tiles that already exist in the output directory again"),
+					     FALSE,
+					     G_PARAM_READWRITE);
+	pyramid_renderer_properties[PROP_THREADS] =
+			g_param_spec_uint("threads",
+					  N_("Rendering threads"),
+					  N_("Count of threads rendering the tiles. 0 uses one thread per processor"),
+					  0, 1024, 0,
+					  G_PARAM_READWRITE);
+
+	g_object_class_install_properties(oclass, N_PROPERTIES, pyramid_renderer_properties);
+}
+
+PyramidRenderer *pyramid_renderer_new()
+{
+	return GDS_RENDER_PYRAMID_RENDERER(g_object_new(GDS_RENDER_TYPE_PYRAMID_RENDERER, NULL));
+}
+
+PyramidRenderer *pyramid_renderer_new_with_options(gboolean overwrite)
+{
+	GObject *obj;
+
+	obj = g_object_new(GDS_RENDER_TYPE_PYRAMID_RENDERER, "overwrite", overwrite, NULL);
+	return GDS_RENDER_PYRAMID_RENDERER(obj);
+}
+
+/** @} */
@@ -0,0 +1,761 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file svg-renderer.c
+ * @brief Hierarchy preserving SVG output renderer
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/** @addtogroup SVG-Renderer
+ *  @{
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#include <gds-render/output-renderers/svg-renderer.h>
+#include <gds-render/gds-utils/gds-layer-usage.h>
+#include <gds-render/geometric/bounding-box.h>
+
+struct _SvgRenderer {
+	GdsOutputRenderer parent;
+};
+
+G_DEFINE_TYPE(SvgRenderer, svg_renderer, GDS_RENDER_TYPE_OUTPUT_RENDERER)
+
+/**
+ * @brief Count of bytes reserved in the root element for the size attributes
+ *
+ * The size of the drawing is only known after all symbols have been written.
+ * The attributes are written into the reserved space at the end.
+ */
+#define SVG_SIZE_ATTRIBUTES_LEN (200)
+
+/**
+ * @brief Buffered output file
+ */
+struct svg_writer {
+	FILE *file; /**< @brief Output file */
+	GString *buffer; /**< @brief Data not yet written to the file */
+	guint64 offset; /**< @brief Count of bytes written to the file and the buffer */
+	guint32 next_id; /**< @brief Number of the next symbol */
+	gboolean error; /**< @brief A write error occured */
+};
+
+/**
+ * @brief Symbol of a cell on a single layer
+ */
+struct svg_symbol {
+	guint32 id; /**< @brief Symbol number. 0 if the cell has no content on the layer */
+	union bounding_box box; /**< @brief Bounding box in database units */
+	gboolean in_progress; /**< @brief The symbol is currently being written. Used to break reference loops */
+};
+
+/**
+ * @brief State of writing all symbols of a single layer
+ */
+struct svg_layer_pass {
+	GdsOutputRenderer *renderer; /**< @brief Renderer. Used for cancellation */
+	struct svg_writer *writer; /**< @brief Output */
+	LayerSettings *settings; /**< @brief Layer settings. Used to map the datatypes */
+	const struct layer_info *linfo; /**< @brief Layer that is written */
+	GHashTable *symbols; /**< @brief Maps a cell to its #svg_symbol on this layer */
+	double scale; /**< @brief Scale the output down by this factor */
+	gboolean cancelled; /**< @brief The rendering has been cancelled */
+};
+
+/**
+ * @brief Layer of the output drawing
+ */
+struct svg_drawing_layer {
+	const struct layer_info *linfo; /**< @brief Layer information */
+	guint32 symbol; /**< @brief Symbol of the top cell */
+};
+
+/**
+ * @brief Write the buffered data to the output file
+ * @param writer SVG writer
+ */
+static void svg_writer_flush(struct svg_writer *writer)
+{
+	if (!writer->error && writer->buffer->len &&
+	    fwrite(writer->buffer->str, 1, writer->buffer->len, writer->file) != writer->buffer->len)
+		writer->error = TRUE;
+
+	g_string_truncate(writer->buffer, 0);
+}
+
+/**
+ * @brief Flush the buffer if it is full
+ * @param writer SVG writer
+ */
+static inline void svg_writer_check_flush(struct svg_writer *writer)
+{
+	if (writer->buffer->len >= SVG_BUFFER_KB * 1024)
+		svg_writer_flush(writer);
+}
+
+/**
+ * @brief Append a string to the output
+ * @param writer SVG writer
+ * @param str String
+ */
+static void svg_writer_append(struct svg_writer *writer, const char *str)
+{
+	gsize len = strlen(str);
+
+	g_string_append_len(writer->buffer, str, len);
+	writer->offset += len;
+	svg_writer_check_flush(writer);
+}
+
+/**
+ * @brief Append formatted data to the output
+ * @param writer SVG writer
+ * @param format printf format string
+ */
+static void G_GNUC_PRINTF(2, 3) svg_writer_printf(struct svg_writer *writer, const char *format, ...)
+{
+	va_list args;
+	gsize before = writer->buffer->len;
+
+	va_start(args, format);
+	g_string_append_vprintf(writer->buffer, format, args);
+	va_end(args);
+
+	writer->offset += writer->buffer->len - before;
+	svg_writer_check_flush(writer);
+}
+
+/**
+ * @brief Append an integer followed by a separator to the output
+ *
+ * Coordinates are written in database units. This avoids the formatting of floating point numbers for every vertex.
+ *
+ * @param writer SVG writer
+ * @param value Value
+ * @param separator Character appended after the number
+ */
+static void svg_writer_int(struct svg_writer *writer, int value, char separator)
+{
+	char digits[16];
+	int pos = sizeof(digits);
+	unsigned int magnitude = (value < 0 ? -(unsigned int)value : (unsigned int)value);
+
+	digits[--pos] = separator;
+	do {
+		digits[--pos] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0)
+		digits[--pos] = '-';
+
+	g_string_append_len(writer->buffer, &digits[pos], sizeof(digits) - pos);
+	writer->offset += sizeof(digits) - pos;
+}
+
+/**
+ * @brief Format a number for SVG output
+ *
+ * The number is formatted independent of the locale and trailing zeros are removed.
+ *
+ * @param buffer Output buffer of size G_ASCII_DTOSTR_BUF_SIZE
+ * @param value Value
+ * @return \p buffer
+ */
+static char *svg_format_number(char *buffer, double value)
+{
+	char *end;
+
+	g_ascii_formatd(buffer, G_ASCII_DTOSTR_BUF_SIZE, "%.6f", value);
+
+	end = buffer + strlen(buffer) - 1;
+	while (end > buffer && *end == '0')
+		*end-- = '\0';
+	if (*end == '.')
+		*end = '\0';
+
+	if (!strcmp(buffer, "-0"))
+		strcpy(buffer, "0");
+
+	return buffer;
+}
+
+/**
+ * @brief Calculate the transformation matrix of a cell instance in database units
+ *
+ * The matrix is ordered like the parameters of the SVG `matrix()` transform. It is the same transformation the
+ * @ref Cairo-Renderer applies: Mirror at the x-axis, scale, rotate and translate.
+ *
+ * @param inst Cell instance
+ * @param[out] matrix Transformation matrix
+ */
+static void svg_instance_matrix(const struct gds_cell_instance *inst, double matrix[6])
+{
+	double angle = M_PI * inst->angle / 180.0;
+	double mag = inst->magnification;
+	double flip = (inst->flipped ? -1.0 : 1.0);
+
+	matrix[0] = mag * cos(angle);
+	matrix[1] = mag * sin(angle);
+	matrix[2] = -mag * flip * sin(angle);
+	matrix[3] = mag * flip * cos(angle);
+	matrix[4] = (double)inst->origin.x;
+	matrix[5] = (double)inst->origin.y;
+}
+
+/**
+ * @brief Add the transformed bounding box of a sub-cell to a bounding box
+ * @param box Box to update
+ * @param child_box Bounding box of the sub-cell
+ * @param matrix Transformation of the cell instance
+ */
+static void svg_box_add_transformed(union bounding_box *box, const union bounding_box *child_box,
+				    const double matrix[6])
+{
+	struct vector_2d corner;
+	struct vector_2d transformed;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		corner.x = (i & 1) ? child_box->vectors.upper_right.x : child_box->vectors.lower_left.x;
+		corner.y = (i & 2) ? child_box->vectors.upper_right.y : child_box->vectors.lower_left.y;
+		transformed.x = matrix[0] * corner.x + matrix[2] * corner.y + matrix[4];
+		transformed.y = matrix[1] * corner.x + matrix[3] * corner.y + matrix[5];
+		bounding_box_update_with_point(box, NULL, &transformed);
+	}
+}
+
+/**
+ * @brief Check if a graphics object is rendered on the layer of a pass
+ *
+ * The datatype specific entries of the layer settings are respected. See layer_settings_lookup().
+ *
+ * @param pass Layer pass
+ * @param gfx Graphics object
+ * @return TRUE if \p gfx belongs to the layer
+ */
+static gboolean svg_gfx_on_layer(const struct svg_layer_pass *pass, const struct gds_graphics *gfx)
+{
+	if (gfx->layer != pass->linfo->layer || !gfx->vertices)
+		return FALSE;
+
+	return layer_settings_lookup(pass->settings, gfx->layer, gfx->datatype) == pass->linfo;
+}
+
+/**
+ * @brief Width of a path in database units. Zero width paths are drawn 1 output unit wide like in the @ref Cairo-Renderer
+ * @param gfx Path
+ * @param scale Scale the output down by this factor
+ * @return Width
+ */
+static int svg_path_width(const struct gds_graphics *gfx, double scale)
+{
+	return (gfx->width_absolute ? gfx->width_absolute : (int)scale);
+}
+
+/**
+ * @brief Add a graphics object to a bounding box
+ *
+ * The vertices of paths are padded by the full path width. This covers the line caps and miter joins up to 60°.
+ *
+ * @param box Box to update
+ * @param gfx Graphics object
+ * @param scale Scale the output down by this factor
+ */
+static void svg_box_add_gfx(union bounding_box *box, const struct gds_graphics *gfx, double scale)
+{
+	GList *vertex_list;
+	const struct gds_point *vertex;
+	struct vector_2d point;
+	double pad = 0.0;
+
+	if (gfx->gfx_type == GRAPHIC_PATH)
+		pad = svg_path_width(gfx, scale);
+
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		point.x = vertex->x - pad;
+		point.y = vertex->y - pad;
+		bounding_box_update_with_point(box, NULL, &point);
+		point.x = vertex->x + pad;
+		point.y = vertex->y + pad;
+		bounding_box_update_with_point(box, NULL, &point);
+	}
+}
+
+/**
+ * @brief Add a polygon to the path data of the current path element
+ *
+ * All polygons are added counter clockwise. Therefore, overlapping polygons do not cancel out
+ * with the nonzero fill rule.
+ *
+ * @param writer SVG writer
+ * @param gfx Polygon or box
+ */
+static void svg_writer_add_polygon(struct svg_writer *writer, const struct gds_graphics *gfx)
+{
+	GList *vertex_list;
+	GList *first;
+	GList *last = NULL;
+	const struct gds_point *vertex;
+	const struct gds_point *next;
+	double area = 0.0;
+	gboolean reverse;
+
+	/* Shoelace formula. The sign gives the orientation */
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		next = (const struct gds_point *)(vertex_list->next ? vertex_list->next->data : gfx->vertices->data);
+		area += (double)vertex->x * (double)next->y - (double)next->x * (double)vertex->y;
+		last = vertex_list;
+	}
+
+	reverse = (area < 0.0);
+	first = (reverse ? last : gfx->vertices);
+	for (vertex_list = first; vertex_list != NULL; vertex_list = (reverse ? vertex_list->prev : vertex_list->next)) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		if (vertex_list == first)
+			svg_writer_append(writer, "M");
+		else if (vertex_list == (reverse ? first->prev : first->next))
+			svg_writer_append(writer, "L");
+		svg_writer_int(writer, vertex->x, ' ');
+		svg_writer_int(writer, vertex->y, ' ');
+		svg_writer_check_flush(writer);
+	}
+	svg_writer_append(writer, "Z");
+}
+
+/**
+ * @brief Write a path element for a GDS path
+ * @param writer SVG writer
+ * @param gfx Path
+ * @param scale Scale the output down by this factor
+ */
+static void svg_writer_add_path(struct svg_writer *writer, const struct gds_graphics *gfx, double scale)
+{
+	GList *vertex_list;
+	const struct gds_point *vertex;
+	const char *cap = "butt";
+
+	switch (gfx->path_render_type) {
+	case PATH_FLUSH:
+		cap = "butt";
+		break;
+	case PATH_ROUNDED:
+		cap = "round";
+		break;
+	case PATH_SQUARED:
+		cap = "square";
+		break;
+	}
+
+	svg_writer_printf(writer, "<path fill=\"none\" stroke-linecap=\"%s\" stroke-width=\"%d\" d=\"",
+			  cap, svg_path_width(gfx, scale));
+	for (vertex_list = gfx->vertices; vertex_list != NULL; vertex_list = vertex_list->next) {
+		vertex = (const struct gds_point *)vertex_list->data;
+		if (vertex_list->prev == NULL)
+			svg_writer_append(writer, "M");
+		else if (vertex_list->prev->prev == NULL)
+			svg_writer_append(writer, "L");
+		svg_writer_int(writer, vertex->x, ' ');
+		svg_writer_int(writer, vertex->y, ' ');
+		svg_writer_check_flush(writer);
+	}
+	svg_writer_append(writer, "\"/>\n");
+}
+
+/**
+ * @brief Look up the written symbol of a cell instance
+ * @param pass Layer pass
+ * @param inst Cell instance
+ * @return Symbol or NULL if the instance has no content on the layer
+ */
+static const struct svg_symbol *svg_instance_symbol(const struct svg_layer_pass *pass,
+						    const struct gds_cell_instance *inst)
+{
+	const struct svg_symbol *symbol;
+
+	if (!inst->cell_ref)
+		return NULL;
+
+	symbol = (const struct svg_symbol *)g_hash_table_lookup(pass->symbols, inst->cell_ref);
+	if (!symbol || symbol->in_progress || !symbol->id)
+		return NULL;
+
+	return symbol;
+}
+
+/**
+ * @brief Write the symbol of \p cell on the layer of \p pass
+ *
+ * The symbols of all sub-cells are written first. Every cell is only written once per layer.
+ * Instances of sub-cells are written as `use` elements with the instance's transformation.
+ * A cell without content on the layer is not written at all.
+ *
+ * @param pass Layer pass
+ * @param cell Cell
+ * @return Symbol of the cell. Owned by svg_layer_pass::symbols
+ */
+static struct svg_symbol *svg_write_cell_symbol(struct svg_layer_pass *pass, struct gds_cell *cell)
+{
+	struct svg_writer *writer = pass->writer;
+	struct svg_symbol *symbol;
+	const struct svg_symbol *child_symbol;
+	struct gds_cell_instance *inst;
+	struct gds_graphics *gfx;
+	GList *iter;
+	gboolean has_polygons = FALSE;
+	double matrix[6];
+	char num[G_ASCII_DTOSTR_BUF_SIZE];
+	int i;
+
+	symbol = (struct svg_symbol *)g_hash_table_lookup(pass->symbols, cell);
+	if (symbol)
+		return symbol;
+
+	/* Insert before descending. Guards against reference loops */
+	symbol = g_new0(struct svg_symbol, 1);
+	symbol->in_progress = TRUE;
+	bounding_box_prepare_empty(&symbol->box);
+	g_hash_table_insert(pass->symbols, cell, symbol);
+
+	if (pass->cancelled || gds_output_renderer_is_cancelled(pass->renderer)) {
+		pass->cancelled = TRUE;
+		return symbol;
+	}
+
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		if (!inst->cell_ref || !gds_layer_usage_contains(&inst->cell_ref->layer_usage, (int16_t)pass->linfo->layer))
+			continue;
+
+		svg_write_cell_symbol(pass, inst->cell_ref);
+		if (pass->cancelled)
+			goto ret_symbol;
+
+		child_symbol = svg_instance_symbol(pass, inst);
+		if (!child_symbol)
+			continue;
+
+		svg_instance_matrix(inst, matrix);
+		svg_box_add_transformed(&symbol->box, &child_symbol->box, matrix);
+	}
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (svg_gfx_on_layer(pass, gfx))
+			svg_box_add_gfx(&symbol->box, gfx, pass->scale);
+	}
+
+	if (bounding_box_is_empty(&symbol->box))
+		goto ret_symbol;
+
+	symbol->id = writer->next_id++;
+	svg_writer_printf(writer, "<symbol id=\"s%u\" overflow=\"visible\">\n", symbol->id);
+
+	for (iter = cell->child_cells; iter != NULL; iter = g_list_next(iter)) {
+		inst = (struct gds_cell_instance *)iter->data;
+		child_symbol = svg_instance_symbol(pass, inst);
+		if (!child_symbol)
+			continue;
+
+		svg_instance_matrix(inst, matrix);
+		svg_writer_printf(writer, "<use xlink:href=\"#s%u\" transform=\"matrix(", child_symbol->id);
+		for (i = 0; i < 6; i++) {
+			svg_writer_append(writer, svg_format_number(num, matrix[i]));
+			svg_writer_append(writer, (i < 5 ? " " : ")\"/>\n"));
+		}
+	}
+
+	/* All polygons of the cell are combined in a single path element */
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (gfx->gfx_type == GRAPHIC_PATH || !svg_gfx_on_layer(pass, gfx))
+			continue;
+
+		if (!has_polygons)
+			svg_writer_append(writer, "<path stroke=\"none\" d=\"");
+		svg_writer_add_polygon(writer, gfx);
+		has_polygons = TRUE;
+	}
+	if (has_polygons)
+		svg_writer_append(writer, "\"/>\n");
+
+	for (iter = cell->graphic_objs; iter != NULL; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (gfx->gfx_type == GRAPHIC_PATH && svg_gfx_on_layer(pass, gfx))
+			svg_writer_add_path(writer, gfx, pass->scale);
+	}
+
+	svg_writer_append(writer, "</symbol>\n");
+
+ret_symbol:
+	symbol->in_progress = FALSE;
+	return symbol;
+}
+
+/**
+ * @brief Write the size attributes into the space reserved in the root element
+ * @param writer SVG writer
+ * @param size_offset File offset of the reserved space
+ * @param box Bounding box of the drawing in database units
+ * @param scale Scale the output down by this factor
+ */
+static void svg_writer_write_size(struct svg_writer *writer, guint64 size_offset, const union bounding_box *box,
+				  double scale)
+{
+	char attributes[SVG_SIZE_ATTRIBUTES_LEN + 1];
+	char num[6][G_ASCII_DTOSTR_BUF_SIZE];
+	double width = (box->vectors.upper_right.x - box->vectors.lower_left.x) / scale;
+	double height = (box->vectors.upper_right.y - box->vectors.lower_left.y) / scale;
+	int len;
+
+	/* The drawing is mirrored at the x-axis. See the transformation of the layers group */
+	len = g_snprintf(attributes, sizeof(attributes), "width=\"%spt\" height=\"%spt\" viewBox=\"%s %s %s %s\"",
+			 svg_format_number(num[0], width),
+			 svg_format_number(num[1], height),
+			 svg_format_number(num[2], box->vectors.lower_left.x / scale),
+			 svg_format_number(num[3], -box->vectors.upper_right.y / scale),
+			 svg_format_number(num[4], width),
+			 svg_format_number(num[5], height));
+	if (len > SVG_SIZE_ATTRIBUTES_LEN) {
+		g_warning(_("SVG size attributes too long"));
+		writer->error = TRUE;
+		return;
+	}
+
+	svg_writer_flush(writer);
+	if (writer->error)
+		return;
+
+	if (fseek(writer->file, (long)size_offset, SEEK_SET) ||
+	    fwrite(attributes, 1, len, writer->file) != (size_t)len ||
+	    fseek(writer->file, 0, SEEK_END))
+		writer->error = TRUE;
+}
+
+/**
+ * @brief Render \p cell to an SVG file
+ *
+ * The layers are written one after another in the order of the layer settings. For every layer, the symbols of all
+ * cells with content on the layer are written bottom-up. Only the symbols of the current layer are held in memory.
+ *
+ * @param renderer Renderer. Used for progress reports and cancellation
+ * @param cell Toplevel cell
+ * @param settings Layer settings
+ * @param svg_file Output file
+ * @param scale Scale the output down by this factor
+ * @return 0 if successful
+ */
+static int svg_render_cell_to_file(GdsOutputRenderer *renderer, struct gds_cell *cell, LayerSettings *settings,
+				   FILE *svg_file, double scale)
+{
+	struct svg_writer writer;
+	struct svg_layer_pass pass;
+	struct svg_drawing_layer drawing_layer;
+	struct svg_drawing_layer *layer_ptr;
+	struct svg_symbol *top_symbol;
+	union bounding_box drawing_box;
+	GArray *drawing_layers;
+	GList *info_list;
+	const struct layer_info *linfo;
+	guint64 size_offset;
+	guint layer_count;
+	guint layer_idx;
+	char num[G_ASCII_DTOSTR_BUF_SIZE];
+	char *label;
+	char *color;
+	guint i;
+	int ret = 0;
+
+	writer.file = svg_file;
+	writer.buffer = g_string_sized_new(SVG_BUFFER_KB * 1024 + 1024);
+	writer.offset = 0;
+	writer.next_id = 1;
+	writer.error = FALSE;
+
+	drawing_layers = g_array_new(FALSE, FALSE, sizeof(struct svg_drawing_layer));
+	bounding_box_prepare_empty(&drawing_box);
+
+	svg_writer_append(&writer, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" "
+			  "xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\" version=\"1.1\" ");
+	size_offset = writer.offset;
+	for (i = 0; i < SVG_SIZE_ATTRIBUTES_LEN; i++)
+		g_string_append_c(writer.buffer, ' ');
+	writer.offset += SVG_SIZE_ATTRIBUTES_LEN;
+	svg_writer_append(&writer, ">\n<defs>\n");
+
+	gds_output_renderer_update_async_progress(renderer, _("Writing SVG symbols"));
+
+	memset(&pass, 0, sizeof(pass));
+	pass.renderer = renderer;
+	pass.writer = &writer;
+	pass.settings = settings;
+	pass.scale = scale;
+
+	info_list = layer_settings_get_layer_info_list(settings);
+	layer_count = g_list_length(info_list);
+	for (layer_idx = 0; info_list != NULL; info_list = g_list_next(info_list), layer_idx++) {
+		linfo = (const struct layer_info *)info_list->data;
+		gds_output_renderer_update_async_fraction(renderer, (double)layer_idx / (double)layer_count,
+							  GDS_OUTPUT_RENDERER_PHASE_RENDERING);
+
+		if (!linfo->render || !gds_layer_usage_contains(&cell->layer_usage, (int16_t)linfo->layer))
+			continue;
+
+		pass.linfo = linfo;
+		pass.symbols = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+		top_symbol = svg_write_cell_symbol(&pass, cell);
+		if (top_symbol->id) {
+			drawing_layer.linfo = linfo;
+			drawing_layer.symbol = top_symbol->id;
+			g_array_append_val(drawing_layers, drawing_layer);
+
+			bounding_box_update_with_point(&drawing_box, NULL, &top_symbol->box.vectors.lower_left);
+			bounding_box_update_with_point(&drawing_box, NULL, &top_symbol->box.vectors.upper_right);
+		}
+
+		g_hash_table_destroy(pass.symbols);
+		pass.symbols = NULL;
+
+		if (pass.cancelled) {
+			ret = GDS_OUTPUT_RENDERER_CANCELLED;
+			goto ret_free;
+		}
+
+		if (writer.error)
+			break;
+	}
+
+	gds_output_renderer_update_async_fraction(renderer, 0.0, GDS_OUTPUT_RENDERER_PHASE_EXPORTING);
+	svg_writer_append(&writer, "</defs>\n");
+
+	/* Database units to output units. SVG's y-axis points downwards */
+	svg_writer_printf(&writer, "<g transform=\"scale(%s,", svg_format_number(num, 1.0 / scale));
+	svg_writer_printf(&writer, "%s)\">\n", svg_format_number(num, -1.0 / scale));
+	for (i = 0; i < drawing_layers->len; i++) {
+		layer_ptr = &g_array_index(drawing_layers, struct svg_drawing_layer, i);
+		linfo = layer_ptr->linfo;
+
+		if (linfo->name && linfo->name[0])
+			label = g_markup_escape_text(linfo->name, -1);
+		else
+			label = g_strdup_printf(_("Layer %d"), linfo->layer);
+		color = g_strdup_printf("#%02x%02x%02x",
+					  (unsigned int)CLAMP(round(linfo->color.red * 255.0), 0, 255),
+					  (unsigned int)CLAMP(round(linfo->color.green * 255.0), 0, 255),
+					  (unsigned int)CLAMP(round(linfo->color.blue * 255.0), 0, 255));
+
+		svg_writer_printf(&writer, "<g inkscape:groupmode=\"layer\" inkscape:label=\"%s\" fill=\"%s\" stroke=\"%s\"",
+				  label, color, color);
+		if (linfo->color.alpha < 1.0)
+			svg_writer_printf(&writer, " opacity=\"%s\"", svg_format_number(num, linfo->color.alpha));
+		svg_writer_printf(&writer, "><use xlink:href=\"#s%u\"/></g>\n", layer_ptr->symbol);
+
+		g_free(label);
+		g_free(color);
+	}
+	svg_writer_append(&writer, "</g>\n</svg>\n");
+
+	/* Nothing rendered. Create an empty drawing */
+	if (bounding_box_is_empty(&drawing_box)) {
+		drawing_box.vectors.lower_left.x = 0.0;
+		drawing_box.vectors.lower_left.y = 0.0;
+		drawing_box.vectors.upper_right.x = scale;
+		drawing_box.vectors.upper_right.y = scale;
+	}
+
+	svg_writer_write_size(&writer, size_offset, &drawing_box, scale);
+
+	if (writer.error) {
+		g_warning(_("Error writing SVG output file"));
+		ret = -3;
+	}
+
+ret_free:
+	g_array_free(drawing_layers, TRUE);
+	g_string_free(writer.buffer, TRUE);
+
+	if (!ret)
+		gds_output_renderer_update_async_fraction(renderer, 1.0, GDS_OUTPUT_RENDERER_PHASE_FINISHED);
+
+	return ret;
+}
+
+static int svg_renderer_render_output(GdsOutputRenderer *renderer,
+				      struct gds_cell *cell,
+				      double scale)
+{
+	FILE *svg_file;
+	int ret = -2;
+	LayerSettings *settings;
+	const char *output_file;
+
+	output_file = gds_output_renderer_get_output_file(renderer);
+	settings = gds_output_renderer_get_and_ref_layer_settings(renderer);
+	if (!settings)
+		return GDS_OUTPUT_RENDERER_PARAM_ERR;
+
+	svg_file = fopen(output_file, "wb");
+	if (svg_file) {
+		ret = svg_render_cell_to_file(renderer, cell, settings, svg_file, scale);
+		if (fclose(svg_file) && !ret) {
+			g_warning(_("Error writing SVG output file"));
+			ret = -3;
+		}
+
+		/* Do not leave incomplete output behind */
+		if (ret == GDS_OUTPUT_RENDERER_CANCELLED)
+			g_unlink(output_file);
+	} else {
+		g_warning(_("Could not open SVG output file"));
+	}
+
+	g_object_unref(settings);
+
+	return ret;
+}
+
+static void svg_renderer_init(SvgRenderer *self)
+{
+	(void)self;
+}
+
+static void svg_renderer_class_init(SvgRendererClass *klass)
+{
+	GdsOutputRendererClass *render_class = GDS_RENDER_OUTPUT_RENDERER_CLASS(klass);
+
+	/* Overwrite virtual function */
+	render_class->render_output = svg_renderer_render_output;
+}
+
+SvgRenderer *svg_renderer_new()
+{
+	return GDS_RENDER_SVG_RENDERER(g_object_new(GDS_RENDER_TYPE_SVG_RENDERER, NULL));
+}
+
+/** @} */
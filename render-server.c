@@ -0,0 +1,789 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2018  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file render-server.c
+ * @brief Resident render server answering requests on a Unix domain socket
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup render-server
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include <gds-render/render-server.h>
+#include <gds-render/gds-utils/gds-parser.h>
+#include <gds-render/gds-utils/gds-tree-checker.h>
+
+/**
+ * @brief Field separator of the socket protocol
+ */
+#define SERVER_FIELD_SEPARATOR "\t"
+
+/**
+ * @brief Default scale of render requests without scale field
+ */
+#define SERVER_DEFAULT_SCALE (1000.0)
+
+/**
+ * @brief Parsed GDS file held in the library cache
+ */
+struct cached_library {
+	char *path; /**< @brief Canonical path of the GDS file */
+	GList *libs; /**< @brief Parsed libraries */
+	gint64 mtime; /**< @brief Modification time of the file when it was parsed */
+	gint64 size; /**< @brief Size of the file when it was parsed */
+	int refcount; /**< @brief References of the cache and of running requests. Protected by the server lock */
+	gboolean loading; /**< @brief The file is currently being parsed */
+	gboolean load_failed; /**< @brief Parsing the file failed */
+};
+
+/**
+ * @brief Layer mapping file held in the layer settings cache
+ */
+struct cached_mapping {
+	LayerSettings *settings; /**< @brief Loaded settings */
+	gint64 mtime; /**< @brief Modification time of the file when it was loaded */
+	gint64 size; /**< @brief Size of the file when it was loaded */
+};
+
+/**
+ * @brief State of the render server
+ */
+struct render_server {
+	GMutex lock; /**< @brief Lock protecting the caches */
+	GCond load_finished; /**< @brief Signalled when a library finished loading */
+	GHashTable *libraries; /**< @brief Canonical path -> @ref cached_library */
+	GQueue lru; /**< @brief Cached libraries. Most recently used first */
+	guint cache_size; /**< @brief Maximum count of cached GDS files */
+	GHashTable *mappings; /**< @brief Path -> @ref cached_mapping */
+	const struct command_line_render_options *options; /**< @brief Options of the renderers */
+	GMainLoop *loop; /**< @brief Main loop of the server */
+	GCancellable *shutdown; /**< @brief Cancelled when the server shuts down. Aborts waiting for the next request */
+	guint active_connections; /**< @brief Connections currently handled. Protected by the server lock */
+	GCond connections_finished; /**< @brief Signalled when @ref render_server::active_connections drops to zero */
+	gboolean service_alive; /**< @brief The socket service has not been finalized. Protected by the server lock */
+};
+
+static gboolean stat_file(const char *path, gint64 *mtime, gint64 *size)
+{
+	GStatBuf stat_buf;
+
+	if (g_stat(path, &stat_buf))
+		return FALSE;
+
+	*mtime = (gint64)stat_buf.st_mtime;
+	*size = (gint64)stat_buf.st_size;
+
+	return TRUE;
+}
+
+static void cached_library_free(struct cached_library *entry)
+{
+	clear_lib_list(&entry->libs);
+	g_free(entry->path);
+	g_free(entry);
+}
+
+static void cached_mapping_free(gpointer data)
+{
+	struct cached_mapping *mapping = (struct cached_mapping *)data;
+
+	g_object_unref(mapping->settings);
+	g_free(mapping);
+}
+
+/**
+ * @brief Drop a reference to a cached library. The server lock must be held.
+ * @param entry Library entry
+ * @param[out] free_list The entry is prepended to this list if it has to be freed.
+ *	       Freeing is done after the lock is released.
+ */
+static void cached_library_unref_locked(struct cached_library *entry, GList **free_list)
+{
+	if (--entry->refcount == 0)
+		*free_list = g_list_prepend(*free_list, entry);
+}
+
+/**
+ * @brief Remove an entry from the cache. The server lock must be held.
+ * @param server Server
+ * @param entry Entry to remove
+ * @param free_list List of entries to free after the lock is released
+ */
+static void render_server_drop_locked(struct render_server *server, struct cached_library *entry,
+				      GList **free_list)
+{
+	g_hash_table_remove(server->libraries, entry->path);
+	g_queue_remove(&server->lru, entry);
+	cached_library_unref_locked(entry, free_list);
+}
+
+/**
+ * @brief Evict least recently used libraries until the cache size is met. The server lock must be held.
+ * @param server Server
+ * @param free_list List of entries to free after the lock is released
+ */
+static void render_server_evict_locked(struct render_server *server, GList **free_list)
+{
+	GList *iter;
+	GList *prev;
+	struct cached_library *entry;
+
+	for (iter = server->lru.tail; iter && server->lru.length > server->cache_size; iter = prev) {
+		prev = iter->prev;
+		entry = (struct cached_library *)iter->data;
+
+		/* Libraries that are still being parsed cannot be evicted */
+		if (entry->loading)
+			continue;
+
+		render_server_drop_locked(server, entry, free_list);
+	}
+}
+
+/**
+ * @brief Parse a GDS file and run the checks needed for rendering
+ * @param entry Entry to fill
+ * @return 0 if successful
+ */
+static int render_server_parse(struct cached_library *entry)
+{
+	const struct gds_library_parsing_opts parsing_opts = {
+		.simplified_polygons = 1,
+	};
+	GList *lib_iter;
+	struct gds_library *lib;
+
+	if (parse_gds_from_file(entry->path, &entry->libs, &parsing_opts))
+		return -1;
+
+	/* The checks write into the cells. They are executed once before the library is shared */
+	for (lib_iter = entry->libs; lib_iter; lib_iter = g_list_next(lib_iter)) {
+		lib = (struct gds_library *)lib_iter->data;
+		if (gds_tree_check_cell_references(lib) < 0 || gds_tree_check_reference_loops(lib) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Get a parsed GDS file from the cache. Parse it if it is not cached or has been modified.
+ * @param server Server
+ * @param path Path of the GDS file
+ * @return Referenced entry or NULL on error. Release with render_server_release_library()
+ */
+static struct cached_library *render_server_acquire_library(struct render_server *server, const char *path)
+{
+	struct cached_library *entry;
+	char *canonical;
+	gint64 mtime;
+	gint64 size;
+	GList *free_list = NULL;
+	int res;
+
+	if (!stat_file(path, &mtime, &size))
+		return NULL;
+
+	canonical = g_canonicalize_filename(path, NULL);
+
+	g_mutex_lock(&server->lock);
+	entry = (struct cached_library *)g_hash_table_lookup(server->libraries, canonical);
+
+	/* Modified on disk. Running requests keep their reference to the old version */
+	if (entry && !entry->loading && (entry->mtime != mtime || entry->size != size)) {
+		render_server_drop_locked(server, entry, &free_list);
+		entry = NULL;
+	}
+
+	if (entry) {
+		entry->refcount++;
+		while (entry->loading)
+			g_cond_wait(&server->load_finished, &server->lock);
+
+		if (entry->load_failed) {
+			cached_library_unref_locked(entry, &free_list);
+			entry = NULL;
+		} else if (g_hash_table_lookup(server->libraries, entry->path) == entry) {
+			/* Still cached. It may have been unloaded while waiting */
+			g_queue_remove(&server->lru, entry);
+			g_queue_push_head(&server->lru, entry);
+		}
+		g_mutex_unlock(&server->lock);
+		g_free(canonical);
+		goto ret_free_list;
+	}
+
+	entry = (struct cached_library *)g_malloc0(sizeof(struct cached_library));
+	entry->path = canonical;
+	entry->mtime = mtime;
+	entry->size = size;
+	entry->loading = TRUE;
+	/* One reference for the cache, one for the caller */
+	entry->refcount = 2;
+	g_hash_table_insert(server->libraries, entry->path, entry);
+	g_queue_push_head(&server->lru, entry);
+	g_mutex_unlock(&server->lock);
+
+	/* Parse without holding the lock. Requests for other libraries are not blocked */
+	res = render_server_parse(entry);
+
+	g_mutex_lock(&server->lock);
+	entry->loading = FALSE;
+	if (res) {
+		entry->load_failed = TRUE;
+		render_server_drop_locked(server, entry, &free_list);
+		cached_library_unref_locked(entry, &free_list);
+		entry = NULL;
+	}
+	render_server_evict_locked(server, &free_list);
+	g_cond_broadcast(&server->load_finished);
+	g_mutex_unlock(&server->lock);
+
+ret_free_list:
+	g_list_free_full(free_list, (GDestroyNotify)cached_library_free);
+	return entry;
+}
+
+static void render_server_release_library(struct render_server *server, struct cached_library *entry)
+{
+	GList *free_list = NULL;
+
+	g_mutex_lock(&server->lock);
+	cached_library_unref_locked(entry, &free_list);
+	g_mutex_unlock(&server->lock);
+
+	g_list_free_full(free_list, (GDestroyNotify)cached_library_free);
+}
+
+/**
+ * @brief Remove a GDS file from the cache
+ * @param server Server
+ * @param path Path of the GDS file
+ * @return TRUE if the file was cached
+ */
+static gboolean render_server_unload_library(struct render_server *server, const char *path)
+{
+	struct cached_library *entry;
+	char *canonical;
+	GList *free_list = NULL;
+
+	canonical = g_canonicalize_filename(path, NULL);
+
+	g_mutex_lock(&server->lock);
+	entry = (struct cached_library *)g_hash_table_lookup(server->libraries, canonical);
+	if (entry && !entry->loading)
+		render_server_drop_locked(server, entry, &free_list);
+	else
+		entry = NULL;
+	g_mutex_unlock(&server->lock);
+
+	g_list_free_full(free_list, (GDestroyNotify)cached_library_free);
+	g_free(canonical);
+
+	return entry ? TRUE : FALSE;
+}
+
+/**
+ * @brief Get the layer settings of a mapping file. Reload them if the file has been modified.
+ * @param server Server
+ * @param path Path of the mapping file
+ * @return Referenced layer settings or NULL on error
+ */
+static LayerSettings *render_server_get_layer_settings(struct render_server *server, const char *path)
+{
+	struct cached_mapping *mapping;
+	LayerSettings *settings = NULL;
+	gint64 mtime;
+	gint64 size;
+
+	if (!stat_file(path, &mtime, &size))
+		return NULL;
+
+	g_mutex_lock(&server->lock);
+	mapping = (struct cached_mapping *)g_hash_table_lookup(server->mappings, path);
+	if (!mapping || mapping->mtime != mtime || mapping->size != size) {
+		settings = layer_settings_new();
+		if (layer_settings_load_from_csv(settings, path)) {
+			g_clear_object(&settings);
+			goto ret_unlock;
+		}
+		mapping = (struct cached_mapping *)g_malloc0(sizeof(struct cached_mapping));
+		mapping->settings = settings;
+		mapping->mtime = mtime;
+		mapping->size = size;
+		/* Renderers still using old settings hold their own reference */
+		g_hash_table_replace(server->mappings, g_strdup(path), mapping);
+	}
+	settings = GDS_RENDER_LAYER_SETTINGS(g_object_ref(mapping->settings));
+
+ret_unlock:
+	g_mutex_unlock(&server->lock);
+	return settings;
+}
+
+static void server_reply(GOutputStream *out, const char *format, ...)
+{
+	va_list args;
+	char *line;
+
+	va_start(args, format);
+	line = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	g_output_stream_write_all(out, line, strlen(line), NULL, NULL, NULL);
+	g_output_stream_write_all(out, "\n", 1, NULL, NULL, NULL);
+	g_free(line);
+}
+
+static struct gds_cell *find_cell(GList *libs, const char *cell_name)
+{
+	GList *lib_iter;
+	GList *cell_iter;
+	struct gds_cell *cell;
+
+	for (lib_iter = libs; lib_iter; lib_iter = g_list_next(lib_iter)) {
+		for (cell_iter = ((struct gds_library *)lib_iter->data)->cells; cell_iter;
+		     cell_iter = g_list_next(cell_iter)) {
+			cell = (struct gds_cell *)cell_iter->data;
+			if (!strncmp(cell->name, cell_name, CELL_NAME_MAX))
+				return cell;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Handle `RENDER <gds> <cell> <renderer> <output> <mapping> [<scale>]`
+ */
+static void server_cmd_render(struct render_server *server, char **args, guint argc, GOutputStream *out)
+{
+	struct cached_library *entry;
+	struct gds_cell *cell;
+	LayerSettings *settings;
+	GdsOutputRenderer *renderer;
+	double scale = SERVER_DEFAULT_SCALE;
+	gint64 start;
+	int res;
+
+	if (argc < 6) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "usage: RENDER gds cell renderer output mapping [scale]");
+		return;
+	}
+
+	if (argc > 6) {
+		scale = g_ascii_strtod(args[6], NULL);
+		if (scale < 1.0)
+			scale = 1.0;
+	}
+
+	start = g_get_monotonic_time();
+
+	entry = render_server_acquire_library(server, args[1]);
+	if (!entry) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "cannot load %s", args[1]);
+		return;
+	}
+
+	cell = find_cell(entry->libs, args[2]);
+	if (!cell) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "cell %s not found", args[2]);
+		goto ret_release_lib;
+	}
+
+	if (cell->checks.affected_by_reference_loop) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "cell %s is affected by reference loop", args[2]);
+		goto ret_release_lib;
+	}
+
+	settings = render_server_get_layer_settings(server, args[5]);
+	if (!settings) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "cannot load mapping %s", args[5]);
+		goto ret_release_lib;
+	}
+
+	renderer = command_line_create_renderer(args[3], args[4], server->options, settings);
+	if (!renderer) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "invalid renderer %s", args[3]);
+		goto ret_unref_settings;
+	}
+
+	res = gds_output_renderer_render_output(renderer, cell, scale);
+	if (res)
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "rendering failed: %d", res);
+	else
+		server_reply(out, "OK" SERVER_FIELD_SEPARATOR "%s" SERVER_FIELD_SEPARATOR "%" G_GINT64_FORMAT "us",
+			     args[4], g_get_monotonic_time() - start);
+
+	g_object_unref(renderer);
+ret_unref_settings:
+	g_object_unref(settings);
+ret_release_lib:
+	render_server_release_library(server, entry);
+}
+
+/**
+ * @brief Handle `ANALYZE <gds>`. Replies one `CELL` line per cell.
+ */
+static void server_cmd_analyze(struct render_server *server, char **args, guint argc, GOutputStream *out)
+{
+	struct cached_library *entry;
+	struct gds_library *lib;
+	struct gds_cell *cell;
+	GList *lib_iter;
+	GList *cell_iter;
+	unsigned int count = 0;
+
+	if (argc < 2) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "usage: ANALYZE gds");
+		return;
+	}
+
+	entry = render_server_acquire_library(server, args[1]);
+	if (!entry) {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "cannot load %s", args[1]);
+		return;
+	}
+
+	for (lib_iter = entry->libs; lib_iter; lib_iter = g_list_next(lib_iter)) {
+		lib = (struct gds_library *)lib_iter->data;
+		for (cell_iter = lib->cells; cell_iter; cell_iter = g_list_next(cell_iter)) {
+			cell = (struct gds_cell *)cell_iter->data;
+			server_reply(out, "CELL\t%s\t%s\t%zu\t%zu\t%zu\t%zu\t%zu\t%d\t%s",
+				     lib->name, cell->name,
+				     cell->stats.gfx_count, cell->stats.total_gfx_count,
+				     cell->stats.vertex_count, cell->stats.total_vertex_count,
+				     cell->stats.reference_count, cell->checks.unresolved_child_count,
+				     cell->checks.affected_by_reference_loop ? "yes" : "no");
+			count++;
+		}
+	}
+
+	server_reply(out, "OK" SERVER_FIELD_SEPARATOR "%u", count);
+	render_server_release_library(server, entry);
+}
+
+/**
+ * @brief Handle `LIST`. Replies one `LIB` line per cached GDS file.
+ */
+static void server_cmd_list(struct render_server *server, GOutputStream *out)
+{
+	GList *iter;
+	GString *reply;
+	struct cached_library *entry;
+
+	reply = g_string_new(NULL);
+
+	/* Build the reply under the lock, write it without */
+	g_mutex_lock(&server->lock);
+	for (iter = server->lru.head; iter; iter = g_list_next(iter)) {
+		entry = (struct cached_library *)iter->data;
+		g_string_append_printf(reply, "LIB\t%s\t%s\n", entry->path, entry->loading ? "loading" : "loaded");
+	}
+	g_mutex_unlock(&server->lock);
+
+	g_output_stream_write_all(out, reply->str, reply->len, NULL, NULL, NULL);
+	g_string_free(reply, TRUE);
+	server_reply(out, "OK");
+}
+
+/**
+ * @brief Execute a single request line
+ * @param server Server
+ * @param line Request
+ * @param out Stream to write the reply to
+ * @return FALSE if the connection shall be closed
+ */
+static gboolean render_server_handle_request(struct render_server *server, const char *line, GOutputStream *out)
+{
+	char **args;
+	guint argc;
+	struct cached_library *entry;
+	gboolean keep_open = TRUE;
+
+	args = g_strsplit(line, SERVER_FIELD_SEPARATOR, 0);
+	argc = g_strv_length(args);
+	if (!argc)
+		goto ret_free_args;
+
+	if (!strcmp(args[0], "RENDER")) {
+		server_cmd_render(server, args, argc, out);
+	} else if (!strcmp(args[0], "ANALYZE")) {
+		server_cmd_analyze(server, args, argc, out);
+	} else if (!strcmp(args[0], "LOAD") && argc >= 2) {
+		entry = render_server_acquire_library(server, args[1]);
+		if (entry) {
+			server_reply(out, "OK" SERVER_FIELD_SEPARATOR "%u", g_list_length(entry->libs));
+			render_server_release_library(server, entry);
+		} else {
+			server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "cannot load %s", args[1]);
+		}
+	} else if (!strcmp(args[0], "UNLOAD") && argc >= 2) {
+		if (render_server_unload_library(server, args[1]))
+			server_reply(out, "OK");
+		else
+			server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "%s not loaded", args[1]);
+	} else if (!strcmp(args[0], "LIST")) {
+		server_cmd_list(server, out);
+	} else if (!strcmp(args[0], "PING")) {
+		server_reply(out, "OK");
+	} else if (!strcmp(args[0], "QUIT")) {
+		keep_open = FALSE;
+	} else {
+		server_reply(out, "ERR" SERVER_FIELD_SEPARATOR "unknown command %s", args[0]);
+	}
+
+ret_free_args:
+	g_strfreev(args);
+	return keep_open;
+}
+
+/**
+ * @brief Handle a client connection. Executed in a thread of the socket service.
+ */
+static gboolean render_server_connection_run(GThreadedSocketService *service, GSocketConnection *connection,
+					     GObject *source_object, gpointer user_data)
+{
+	struct render_server *server = (struct render_server *)user_data;
+	GDataInputStream *in;
+	GOutputStream *out;
+	char *line;
+	gsize len;
+	gboolean keep_open = TRUE;
+	(void)service;
+	(void)source_object;
+
+	/* Connections accepted right before the shutdown are closed without touching the caches */
+	g_mutex_lock(&server->lock);
+	if (g_cancellable_is_cancelled(server->shutdown)) {
+		g_mutex_unlock(&server->lock);
+		return TRUE;
+	}
+	server->active_connections++;
+	g_mutex_unlock(&server->lock);
+
+	in = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+	out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+
+	/* A running request is finished on shutdown. Waiting for the next one is aborted */
+	while (keep_open && (line = g_data_input_stream_read_line(in, &len, server->shutdown, NULL))) {
+		g_strchomp(line);
+		if (line[0])
+			keep_open = render_server_handle_request(server, line, out);
+		g_free(line);
+	}
+
+	g_object_unref(in);
+
+	/* The server may be freed as soon as the lock is released */
+	g_mutex_lock(&server->lock);
+	if (--server->active_connections == 0)
+		g_cond_broadcast(&server->connections_finished);
+	g_mutex_unlock(&server->lock);
+
+	return TRUE;
+}
+
+/**
+ * @brief Called when the socket service is finalized
+ *
+ * Each connection queued in the service holds a reference to it. After this function has been called,
+ * no connection thread can access the server anymore.
+ */
+static void render_server_service_finalized(gpointer user_data, GObject *service)
+{
+	struct render_server *server = (struct render_server *)user_data;
+	(void)service;
+
+	g_mutex_lock(&server->lock);
+	server->service_alive = FALSE;
+	g_mutex_unlock(&server->lock);
+
+	g_main_context_wakeup(NULL);
+}
+
+/**
+ * @brief Remove a stale socket of a previous instance
+ *
+ * Only sockets nobody is listening on are removed. Any other file is left untouched.
+ *
+ * @param socket_path Path of the socket
+ * @return 0 if \p socket_path does not exist (anymore), -1 if it cannot be used
+ */
+static int render_server_remove_stale_socket(const char *socket_path)
+{
+	GStatBuf stat_buf;
+	GSocketClient *client;
+	GSocketAddress *address;
+	GSocketConnection *connection;
+
+	if (g_lstat(socket_path, &stat_buf))
+		return 0;
+
+	if (!S_ISSOCK(stat_buf.st_mode)) {
+		fprintf(stderr, _("%s exists and is not a socket\n"), socket_path);
+		return -1;
+	}
+
+	client = g_socket_client_new();
+	address = g_unix_socket_address_new(socket_path);
+	connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
+	g_object_unref(address);
+	g_object_unref(client);
+
+	if (connection) {
+		g_object_unref(connection);
+		fprintf(stderr, _("Another server is listening on %s\n"), socket_path);
+		return -1;
+	}
+
+	if (g_unlink(socket_path)) {
+		fprintf(stderr, _("Could not remove stale socket %s\n"), socket_path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static gboolean render_server_quit(gpointer user_data)
+{
+	struct render_server *server = (struct render_server *)user_data;
+
+	g_main_loop_quit(server->loop);
+
+	return G_SOURCE_CONTINUE;
+}
+
+int render_server_run(const char *socket_path, int max_clients, int cache_size,
+		      const struct command_line_render_options *options)
+{
+	struct render_server server;
+	GSocketService *service;
+	GSocketAddress *address;
+	GError *error = NULL;
+	GList *free_list = NULL;
+	guint sigint_source;
+	guint sigterm_source;
+	int ret = 0;
+
+	g_return_val_if_fail(socket_path, -1);
+
+	if (render_server_remove_stale_socket(socket_path))
+		return -1;
+
+	if (max_clients < 1)
+		max_clients = (int)g_get_num_processors();
+	/* Forking and external renderers are not safe with parallel requests */
+	if (max_clients > 1 && options && (options->cairo_fork || (options->ext_params && options->ext_params->so_path))) {
+		printf(_("Cairo fork isolation or an external renderer is used. Handling one request at a time\n"));
+		max_clients = 1;
+	}
+	if (cache_size < 1)
+		cache_size = 1;
+
+	g_mutex_init(&server.lock);
+	g_cond_init(&server.load_finished);
+	g_cond_init(&server.connections_finished);
+	g_queue_init(&server.lru);
+	server.libraries = g_hash_table_new(g_str_hash, g_str_equal);
+	server.mappings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, cached_mapping_free);
+	server.cache_size = (guint)cache_size;
+	server.options = options;
+	server.loop = g_main_loop_new(NULL, FALSE);
+	server.shutdown = g_cancellable_new();
+	server.active_connections = 0;
+	server.service_alive = TRUE;
+
+	service = g_threaded_socket_service_new(max_clients);
+	g_object_weak_ref(G_OBJECT(service), render_server_service_finalized, &server);
+	address = g_unix_socket_address_new(socket_path);
+	if (!g_socket_listener_add_address(G_SOCKET_LISTENER(service), address, G_SOCKET_TYPE_STREAM,
+					   G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error)) {
+		fprintf(stderr, _("Could not listen on %s: %s\n"), socket_path, error->message);
+		g_error_free(error);
+		ret = -1;
+		goto ret_free_service;
+	}
+
+	g_signal_connect(service, "run", G_CALLBACK(render_server_connection_run), &server);
+	sigint_source = g_unix_signal_add(SIGINT, render_server_quit, &server);
+	sigterm_source = g_unix_signal_add(SIGTERM, render_server_quit, &server);
+
+	g_socket_service_start(service);
+	printf(_("Listening on %s\n"), socket_path);
+	g_main_loop_run(server.loop);
+
+	g_source_remove(sigint_source);
+	g_source_remove(sigterm_source);
+
+	/* Stop accepting connections and abort connections waiting for their next request */
+	g_socket_service_stop(service);
+	g_socket_listener_close(G_SOCKET_LISTENER(service));
+	g_cancellable_cancel(server.shutdown);
+	g_unlink(socket_path);
+
+ret_free_service:
+	g_object_unref(address);
+	g_object_unref(service);
+
+	/* Wait for the running requests */
+	g_mutex_lock(&server.lock);
+	while (server.active_connections)
+		g_cond_wait(&server.connections_finished, &server.lock);
+
+	/* Connections still queued in the service and its cancelled accept operation keep the service alive.
+	 * The accept operation is completed in the main context
+	 */
+	while (server.service_alive) {
+		g_mutex_unlock(&server.lock);
+		g_main_context_iteration(NULL, TRUE);
+		g_mutex_lock(&server.lock);
+	}
+	g_mutex_unlock(&server.lock);
+
+	/* Drop the cache references. Libraries still used by a request are freed when it finishes */
+	while (server.lru.head)
+		render_server_drop_locked(&server, (struct cached_library *)server.lru.head->data, &free_list);
+	g_list_free_full(free_list, (GDestroyNotify)cached_library_free);
+
+	g_hash_table_destroy(server.libraries);
+	g_hash_table_destroy(server.mappings);
+	g_main_loop_unref(server.loop);
+	g_object_unref(server.shutdown);
+	g_cond_clear(&server.connections_finished);
+	g_cond_clear(&server.load_finished);
+	g_mutex_clear(&server.lock);
+
+	return ret;
+}
+
+/** @} */
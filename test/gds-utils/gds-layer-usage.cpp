@@ -0,0 +1,201 @@
+#include <catch.hpp>
+
+extern "C" {
+#include <gds-render/gds-utils/gds-layer-usage.h>
+}
+
+static struct gds_cell *add_cell(struct gds_library *lib, int layer)
+{
+	struct gds_cell *cell;
+	struct gds_graphics *gfx;
+
+	cell = g_new0(struct gds_cell, 1);
+	if (layer >= 0) {
+		gfx = g_new0(struct gds_graphics, 1);
+		gfx->gfx_type = GRAPHIC_POLYGON;
+		gfx->layer = (int16_t)layer;
+		cell->graphic_objs = g_list_append(cell->graphic_objs, gfx);
+	}
+	lib->cells = g_list_append(lib->cells, cell);
+
+	return cell;
+}
+
+static void add_instance(struct gds_cell *parent, struct gds_cell *child)
+{
+	struct gds_cell_instance *inst;
+
+	inst = g_new0(struct gds_cell_instance, 1);
+	inst->cell_ref = child;
+	inst->magnification = 1.0;
+	parent->child_cells = g_list_append(parent->child_cells, inst);
+}
+
+static void free_library(struct gds_library *lib)
+{
+	GList *iter;
+	struct gds_cell *cell;
+
+	for (iter = lib->cells; iter; iter = g_list_next(iter)) {
+		cell = (struct gds_cell *)iter->data;
+		gds_layer_usage_clear(&cell->layer_usage);
+		g_list_free_full(cell->graphic_objs, g_free);
+		g_list_free_full(cell->child_cells, g_free);
+		g_free(cell);
+	}
+	g_list_free(lib->cells);
+}
+
+TEST_CASE("gds-utils/gds-layer-usage/add_contains", "[GDS-UTILS]")
+{
+	struct gds_layer_usage usage;
+
+	gds_layer_usage_init(&usage);
+	REQUIRE_FALSE(gds_layer_usage_contains(&usage, 0));
+
+	/* Bitmask and sorted array of high layers. Added out of order and twice */
+	gds_layer_usage_add(&usage, 1000);
+	gds_layer_usage_add(&usage, 3);
+	gds_layer_usage_add(&usage, 255);
+	gds_layer_usage_add(&usage, 256);
+	gds_layer_usage_add(&usage, -5);
+	gds_layer_usage_add(&usage, 1000);
+
+	REQUIRE(gds_layer_usage_contains(&usage, 3));
+	REQUIRE(gds_layer_usage_contains(&usage, 255));
+	REQUIRE(gds_layer_usage_contains(&usage, 256));
+	REQUIRE(gds_layer_usage_contains(&usage, 1000));
+	REQUIRE(gds_layer_usage_contains(&usage, -5));
+
+	REQUIRE_FALSE(gds_layer_usage_contains(&usage, 4));
+	REQUIRE_FALSE(gds_layer_usage_contains(&usage, 254));
+	REQUIRE_FALSE(gds_layer_usage_contains(&usage, 257));
+	REQUIRE_FALSE(gds_layer_usage_contains(&usage, 999));
+	REQUIRE_FALSE(gds_layer_usage_contains(&usage, -4));
+	REQUIRE(usage.high_layers->len == 3);
+
+	/* A cleared set is not calculated. Every layer may be used */
+	gds_layer_usage_clear(&usage);
+	REQUIRE(usage.state == GDS_LAYER_USAGE_NOT_CALCULATED);
+	REQUIRE(gds_layer_usage_contains(&usage, 4));
+}
+
+TEST_CASE("gds-utils/gds-layer-usage/intersects", "[GDS-UTILS]")
+{
+	struct gds_layer_usage a;
+	struct gds_layer_usage b;
+
+	gds_layer_usage_init(&a);
+	gds_layer_usage_init(&b);
+
+	gds_layer_usage_add(&a, 1);
+	gds_layer_usage_add(&a, 300);
+	gds_layer_usage_add(&b, 2);
+	gds_layer_usage_add(&b, 301);
+	REQUIRE_FALSE(gds_layer_usage_intersects(&a, &b));
+
+	SECTION("Common low layer") {
+		gds_layer_usage_add(&b, 1);
+		REQUIRE(gds_layer_usage_intersects(&a, &b));
+	}
+
+	SECTION("Common high layer") {
+		gds_layer_usage_add(&b, 300);
+		REQUIRE(gds_layer_usage_intersects(&a, &b));
+		REQUIRE(gds_layer_usage_intersects(&b, &a));
+	}
+
+	SECTION("Set that is not calculated") {
+		gds_layer_usage_clear(&b);
+		REQUIRE(gds_layer_usage_intersects(&a, &b));
+	}
+
+	gds_layer_usage_clear(&a);
+	gds_layer_usage_clear(&b);
+}
+
+TEST_CASE("gds-utils/gds-layer-usage/calc_in_lib_merge", "[GDS-UTILS]")
+{
+	struct gds_library lib = {};
+	struct gds_cell *top;
+	struct gds_cell *middle;
+	struct gds_cell *bottom;
+	struct gds_cell *empty;
+	struct gds_layer_usage rendered;
+
+	top = add_cell(&lib, 1);
+	middle = add_cell(&lib, 300);
+	bottom = add_cell(&lib, 2);
+	empty = add_cell(&lib, -1);
+	add_instance(top, middle);
+	add_instance(middle, bottom);
+	/* Shared sub-cell */
+	add_instance(top, bottom);
+
+	gds_layer_usage_calc_in_lib(&lib);
+
+	REQUIRE(top->layer_usage.state == GDS_LAYER_USAGE_VALID);
+	REQUIRE(gds_layer_usage_contains(&top->layer_usage, 1));
+	REQUIRE(gds_layer_usage_contains(&top->layer_usage, 2));
+	REQUIRE(gds_layer_usage_contains(&top->layer_usage, 300));
+	REQUIRE_FALSE(gds_layer_usage_contains(&top->layer_usage, 3));
+
+	REQUIRE_FALSE(gds_layer_usage_contains(&middle->layer_usage, 1));
+	REQUIRE(gds_layer_usage_contains(&middle->layer_usage, 2));
+	REQUIRE(gds_layer_usage_contains(&middle->layer_usage, 300));
+
+	REQUIRE(gds_layer_usage_contains(&bottom->layer_usage, 2));
+	REQUIRE_FALSE(gds_layer_usage_contains(&bottom->layer_usage, 300));
+
+	REQUIRE(empty->layer_usage.state == GDS_LAYER_USAGE_VALID);
+	REQUIRE_FALSE(gds_layer_usage_contains(&empty->layer_usage, 1));
+
+	gds_layer_usage_init(&rendered);
+	gds_layer_usage_add(&rendered, 300);
+	REQUIRE(gds_layer_usage_cell_uses_layers(top, &rendered));
+	REQUIRE(gds_layer_usage_cell_uses_layers(middle, &rendered));
+	REQUIRE_FALSE(gds_layer_usage_cell_uses_layers(bottom, &rendered));
+	REQUIRE_FALSE(gds_layer_usage_cell_uses_layers(empty, &rendered));
+	gds_layer_usage_clear(&rendered);
+
+	free_library(&lib);
+}
+
+TEST_CASE("gds-utils/gds-layer-usage/calc_in_lib_reference_loop", "[GDS-UTILS]")
+{
+	struct gds_library lib = {};
+	struct gds_cell *top;
+	struct gds_cell *loop_a;
+	struct gds_cell *loop_b;
+	struct gds_cell *independent;
+	struct gds_layer_usage rendered;
+
+	top = add_cell(&lib, 1);
+	loop_a = add_cell(&lib, 2);
+	loop_b = add_cell(&lib, 3);
+	independent = add_cell(&lib, 4);
+	add_instance(top, loop_a);
+	add_instance(top, independent);
+	add_instance(loop_a, loop_b);
+	add_instance(loop_b, loop_a);
+
+	gds_layer_usage_calc_in_lib(&lib);
+
+	/* Cells in and above the loop may use every layer */
+	REQUIRE(loop_a->layer_usage.state == GDS_LAYER_USAGE_ALL);
+	REQUIRE(loop_b->layer_usage.state == GDS_LAYER_USAGE_ALL);
+	REQUIRE(top->layer_usage.state == GDS_LAYER_USAGE_ALL);
+	REQUIRE(gds_layer_usage_contains(&loop_b->layer_usage, 100));
+	REQUIRE(gds_layer_usage_contains(&top->layer_usage, 100));
+
+	REQUIRE(independent->layer_usage.state == GDS_LAYER_USAGE_VALID);
+	REQUIRE_FALSE(gds_layer_usage_contains(&independent->layer_usage, 100));
+
+	gds_layer_usage_init(&rendered);
+	gds_layer_usage_add(&rendered, 100);
+	REQUIRE(gds_layer_usage_cell_uses_layers(top, &rendered));
+	REQUIRE_FALSE(gds_layer_usage_cell_uses_layers(independent, &rendered));
+	gds_layer_usage_clear(&rendered);
+
+	free_library(&lib);
+}
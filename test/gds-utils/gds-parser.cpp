@@ -0,0 +1,172 @@
+#include <catch.hpp>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <gds-render/gds-utils/gds-parser.h>
+}
+
+/* GDS record types */
+enum {
+	REC_HEADER = 0x0002,
+	REC_BGNLIB = 0x0102,
+	REC_LIBNAME = 0x0206,
+	REC_ENDLIB = 0x0400,
+	REC_BGNSTR = 0x0502,
+	REC_STRNAME = 0x0606,
+	REC_ENDSTR = 0x0700,
+	REC_BOUNDARY = 0x0800,
+	REC_PATH = 0x0900,
+	REC_XY = 0x1003,
+	REC_ENDEL = 0x1100,
+	REC_LAYER = 0x0D02,
+	REC_DATATYPE = 0x0E02,
+	REC_BOX = 0x2D00,
+};
+
+static void write_record(FILE *file, unsigned int type, const unsigned char *data, size_t len)
+{
+	unsigned char header[4];
+
+	header[0] = (unsigned char)((len + 4) >> 8);
+	header[1] = (unsigned char)(len + 4);
+	header[2] = (unsigned char)(type >> 8);
+	header[3] = (unsigned char)type;
+	fwrite(header, 1, sizeof(header), file);
+	if (len)
+		fwrite(data, 1, len, file);
+}
+
+static void write_int16_record(FILE *file, unsigned int type, int value)
+{
+	unsigned char data[2];
+
+	data[0] = (unsigned char)(value >> 8);
+	data[1] = (unsigned char)value;
+	write_record(file, type, data, sizeof(data));
+}
+
+static void write_string_record(FILE *file, unsigned int type, const char *string)
+{
+	unsigned char data[CELL_NAME_MAX + 1] = {0};
+	size_t len = strlen(string);
+
+	memcpy(data, string, len);
+	/* Strings are padded to an even length */
+	write_record(file, type, data, len + (len & 1));
+}
+
+/* Write a graphics element. The layer number identifies the element in the parsed cell */
+static void write_element(FILE *file, unsigned int type, int layer, const int (*points)[2], int count)
+{
+	unsigned char data[64 * 8];
+	unsigned int value;
+	int i, j;
+
+	write_record(file, type, NULL, 0);
+	write_int16_record(file, REC_LAYER, layer);
+	write_int16_record(file, REC_DATATYPE, 0);
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < 2; j++) {
+			value = (unsigned int)points[i][j];
+			data[i * 8 + j * 4 + 0] = (unsigned char)(value >> 24);
+			data[i * 8 + j * 4 + 1] = (unsigned char)(value >> 16);
+			data[i * 8 + j * 4 + 2] = (unsigned char)(value >> 8);
+			data[i * 8 + j * 4 + 3] = (unsigned char)value;
+		}
+	}
+	write_record(file, REC_XY, data, (size_t)count * 8);
+	write_record(file, REC_ENDEL, NULL, 0);
+}
+
+#define WRITE_ELEMENT(file, type, layer, points) write_element((file), (type), (layer), (points), G_N_ELEMENTS(points))
+
+static struct gds_graphics *find_gfx(struct gds_cell *cell, int layer)
+{
+	GList *iter;
+	struct gds_graphics *gfx;
+
+	for (iter = cell->graphic_objs; iter; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+		if (gfx->layer == layer)
+			return gfx;
+	}
+
+	return NULL;
+}
+
+TEST_CASE("gds-utils/gds-parser/detect_rectangle", "[GDS-UTILS]")
+{
+	/* Rectangles */
+	const int horizontal_first[4][2] = {{0, 0}, {10, 0}, {10, 5}, {0, 5}};
+	const int vertical_first[4][2] = {{0, 0}, {0, 5}, {10, 5}, {10, 0}};
+	const int closed[5][2] = {{-5, -5}, {5, -5}, {5, 5}, {-5, 5}, {-5, -5}};
+	const int start_in_corner[4][2] = {{10, 5}, {0, 5}, {0, 0}, {10, 0}};
+	/* Not rectangles */
+	const int trapezoid[4][2] = {{0, 0}, {10, 0}, {8, 5}, {2, 5}};
+	const int crossed[4][2] = {{0, 0}, {10, 5}, {10, 0}, {0, 5}};
+	const int repeated_vertex[4][2] = {{0, 0}, {10, 0}, {10, 0}, {0, 5}};
+	const int l_shape[6][2] = {{0, 0}, {10, 0}, {10, 5}, {5, 5}, {5, 10}, {0, 10}};
+	const int open_pentagon[5][2] = {{0, 0}, {10, 0}, {10, 5}, {0, 5}, {0, 2}};
+	const int path[4][2] = {{0, 0}, {10, 0}, {10, 5}, {0, 5}};
+	struct gds_library_parsing_opts parsing_opts;
+	struct gds_library *lib;
+	struct gds_cell *cell;
+	GList *libs = NULL;
+	gchar *path_name = NULL;
+	FILE *file;
+	gint fd;
+
+	/* Detection must not depend on the removal of the closing vertex */
+	parsing_opts.simplified_polygons = GENERATE(0, 1);
+
+	fd = g_file_open_tmp("gds-render-test-XXXXXX.gds", &path_name, NULL);
+	REQUIRE(fd >= 0);
+	file = fdopen(fd, "wb");
+	REQUIRE(file != NULL);
+
+	write_int16_record(file, REC_HEADER, 600);
+	write_record(file, REC_BGNLIB, NULL, 0);
+	write_string_record(file, REC_LIBNAME, "LIB");
+	write_record(file, REC_BGNSTR, NULL, 0);
+	write_string_record(file, REC_STRNAME, "TOP");
+	WRITE_ELEMENT(file, REC_BOUNDARY, 1, horizontal_first);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 2, vertical_first);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 3, closed);
+	WRITE_ELEMENT(file, REC_BOX, 4, start_in_corner);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 10, trapezoid);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 11, crossed);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 12, repeated_vertex);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 13, l_shape);
+	WRITE_ELEMENT(file, REC_BOUNDARY, 14, open_pentagon);
+	WRITE_ELEMENT(file, REC_PATH, 15, path);
+	write_record(file, REC_ENDSTR, NULL, 0);
+	write_record(file, REC_ENDLIB, NULL, 0);
+	fclose(file);
+
+	REQUIRE(parse_gds_from_file(path_name, &libs, &parsing_opts) == 0);
+	remove(path_name);
+	g_free(path_name);
+
+	REQUIRE(g_list_length(libs) == 1);
+	lib = (struct gds_library *)libs->data;
+	REQUIRE(g_list_length(lib->cells) == 1);
+	cell = (struct gds_cell *)lib->cells->data;
+	REQUIRE(g_list_length(cell->graphic_objs) == 10);
+
+	REQUIRE(find_gfx(cell, 1)->rectangle == 1);
+	REQUIRE(find_gfx(cell, 2)->rectangle == 1);
+	REQUIRE(find_gfx(cell, 3)->rectangle == 1);
+	REQUIRE(find_gfx(cell, 4)->rectangle == 1);
+
+	REQUIRE(find_gfx(cell, 10)->rectangle == 0);
+	REQUIRE(find_gfx(cell, 11)->rectangle == 0);
+	REQUIRE(find_gfx(cell, 12)->rectangle == 0);
+	REQUIRE(find_gfx(cell, 13)->rectangle == 0);
+	REQUIRE(find_gfx(cell, 14)->rectangle == 0);
+	/* Only polygons and boxes are rectangles */
+	REQUIRE(find_gfx(cell, 15)->rectangle == 0);
+
+	clear_lib_list(&libs);
+}
@@ -0,0 +1,300 @@
+#include <catch.hpp>
+#include <cstring>
+
+extern "C" {
+#include <gds-render/gds-utils/gds-window.h>
+}
+
+static struct gds_graphics *create_gfx(enum graphics_type type, const int (*points)[2], int count)
+{
+	struct gds_graphics *gfx;
+	struct gds_point *pt;
+	int i;
+
+	gfx = g_new0(struct gds_graphics, 1);
+	gfx->gfx_type = type;
+	gfx->layer = 1;
+	for (i = 0; i < count; i++) {
+		pt = g_new(struct gds_point, 1);
+		pt->x = points[i][0];
+		pt->y = points[i][1];
+		gfx->vertices = g_list_append(gfx->vertices, pt);
+	}
+
+	return gfx;
+}
+
+static struct gds_graphics *create_square(int x0, int y0, int size)
+{
+	const int points[4][2] = {{x0, y0}, {x0 + size, y0}, {x0 + size, y0 + size}, {x0, y0 + size}};
+
+	return create_gfx(GRAPHIC_POLYGON, points, 4);
+}
+
+static struct gds_cell *create_cell(const char *name)
+{
+	struct gds_cell *cell;
+
+	cell = g_new0(struct gds_cell, 1);
+	g_strlcpy(cell->name, name, sizeof(cell->name));
+
+	return cell;
+}
+
+static struct gds_cell_instance *add_instance(struct gds_cell *parent, struct gds_cell *child, int x, int y, double angle)
+{
+	struct gds_cell_instance *inst;
+
+	inst = g_new0(struct gds_cell_instance, 1);
+	inst->cell_ref = child;
+	inst->origin.x = x;
+	inst->origin.y = y;
+	inst->angle = angle;
+	inst->magnification = 1.0;
+	parent->child_cells = g_list_append(parent->child_cells, inst);
+
+	return inst;
+}
+
+static void free_gfx(gpointer data)
+{
+	struct gds_graphics *gfx = (struct gds_graphics *)data;
+
+	g_list_free_full(gfx->vertices, g_free);
+	g_free(gfx);
+}
+
+static void free_cell(struct gds_cell *cell)
+{
+	g_list_free_full(cell->graphic_objs, free_gfx);
+	g_list_free_full(cell->child_cells, g_free);
+	g_free(cell);
+}
+
+static void set_window(union bounding_box *window, double x0, double y0, double x1, double y1)
+{
+	window->vectors.lower_left.x = x0;
+	window->vectors.lower_left.y = y0;
+	window->vectors.upper_right.x = x1;
+	window->vectors.upper_right.y = y1;
+}
+
+static void gfx_extent(const struct gds_graphics *gfx, int *min_x, int *min_y, int *max_x, int *max_y)
+{
+	GList *iter;
+	const struct gds_point *pt;
+
+	*min_x = *min_y = G_MAXINT;
+	*max_x = *max_y = G_MININT;
+	for (iter = gfx->vertices; iter; iter = g_list_next(iter)) {
+		pt = (const struct gds_point *)iter->data;
+		*min_x = MIN(*min_x, pt->x);
+		*min_y = MIN(*min_y, pt->y);
+		*max_x = MAX(*max_x, pt->x);
+		*max_y = MAX(*max_y, pt->y);
+	}
+}
+
+TEST_CASE("gds-utils/gds-window/gds_window_parse", "[GDS-UTILS]")
+{
+	union bounding_box window;
+
+	REQUIRE(gds_window_parse("0,0,10,20", &window));
+	REQUIRE(window.vectors.lower_left.x == Approx(0.0));
+	REQUIRE(window.vectors.lower_left.y == Approx(0.0));
+	REQUIRE(window.vectors.upper_right.x == Approx(10.0));
+	REQUIRE(window.vectors.upper_right.y == Approx(20.0));
+
+	/* Corners in any order */
+	REQUIRE(gds_window_parse("10,-2.5,-1.5,4", &window));
+	REQUIRE(window.vectors.lower_left.x == Approx(-1.5));
+	REQUIRE(window.vectors.lower_left.y == Approx(-2.5));
+	REQUIRE(window.vectors.upper_right.x == Approx(10.0));
+	REQUIRE(window.vectors.upper_right.y == Approx(4.0));
+}
+
+TEST_CASE("gds-utils/gds-window/gds_window_parse_invalid", "[GDS-UTILS]")
+{
+	union bounding_box window;
+
+	REQUIRE_FALSE(gds_window_parse(NULL, &window));
+	REQUIRE_FALSE(gds_window_parse("", &window));
+	REQUIRE_FALSE(gds_window_parse("0,0,10", &window));
+	REQUIRE_FALSE(gds_window_parse("0,0,10,20,30", &window));
+	REQUIRE_FALSE(gds_window_parse("0,0,10,", &window));
+	REQUIRE_FALSE(gds_window_parse("0,0,a,20", &window));
+	REQUIRE_FALSE(gds_window_parse("0,0,10,20x", &window));
+
+	/* Zero area */
+	REQUIRE_FALSE(gds_window_parse("0,0,0,20", &window));
+	REQUIRE_FALSE(gds_window_parse("0,5,10,5", &window));
+}
+
+TEST_CASE("gds-utils/gds-window/clip_polygon_across_edge", "[GDS-UTILS]")
+{
+	const int path_points[2][2] = {{-50, 50}, {150, 50}};
+	struct gds_cell *cell;
+	struct gds_cell *clipped_cell;
+	struct gds_graphics *square;
+	struct gds_graphics *inner;
+	struct gds_graphics *path;
+	struct gds_graphics *gfx;
+	struct gds_window *window;
+	union bounding_box window_box;
+	GList *iter;
+	int min_x, min_y, max_x, max_y;
+	bool square_found = false;
+
+	cell = create_cell("TOP");
+	square = create_square(0, 0, 100);
+	square->rectangle = 1;
+	inner = create_square(60, 10, 10);
+	path = create_gfx(GRAPHIC_PATH, path_points, 2);
+	path->width_absolute = 10;
+	cell->graphic_objs = g_list_append(cell->graphic_objs, square);
+	cell->graphic_objs = g_list_append(cell->graphic_objs, inner);
+	cell->graphic_objs = g_list_append(cell->graphic_objs, path);
+
+	set_window(&window_box, 50, -10, 200, 200);
+	window = gds_window_new(cell, &window_box);
+	clipped_cell = gds_window_get_cell(window);
+
+	REQUIRE(clipped_cell != NULL);
+	REQUIRE(clipped_cell != cell);
+	REQUIRE(!strcmp(clipped_cell->name, "TOP"));
+	REQUIRE(g_list_length(clipped_cell->graphic_objs) == 3);
+
+	for (iter = clipped_cell->graphic_objs; iter; iter = g_list_next(iter)) {
+		gfx = (struct gds_graphics *)iter->data;
+
+		/* Objects inside of the window and paths are referenced as they are */
+		if (gfx == inner || gfx == path)
+			continue;
+
+		REQUIRE(gfx != square);
+		REQUIRE(gfx->gfx_type == GRAPHIC_POLYGON);
+		REQUIRE(gfx->rectangle == 0);
+		REQUIRE(g_list_length(gfx->vertices) == 4);
+		gfx_extent(gfx, &min_x, &min_y, &max_x, &max_y);
+		REQUIRE(min_x == 50);
+		REQUIRE(max_x == 100);
+		REQUIRE(min_y == 0);
+		REQUIRE(max_y == 100);
+		square_found = true;
+	}
+	REQUIRE(square_found);
+
+	/* The original cell is not modified */
+	REQUIRE(g_list_length(cell->graphic_objs) == 3);
+	REQUIRE(g_list_length(square->vertices) == 4);
+	gfx_extent(square, &min_x, &min_y, &max_x, &max_y);
+	REQUIRE(min_x == 0);
+
+	gds_window_free(window);
+	free_cell(cell);
+}
+
+TEST_CASE("gds-utils/gds-window/clip_instances", "[GDS-UTILS]")
+{
+	struct gds_cell *top;
+	struct gds_cell *child;
+	struct gds_cell *clipped_top;
+	struct gds_cell_instance *inst;
+	struct gds_graphics *gfx;
+	struct gds_window *window;
+	union bounding_box window_box;
+	int min_x, min_y, max_x, max_y;
+
+	top = create_cell("TOP");
+	child = create_cell("CHILD");
+	child->graphic_objs = g_list_append(child->graphic_objs, create_square(0, 0, 100));
+
+	SECTION("Translated instance") {
+		add_instance(top, child, 200, 0, 0.0);
+		set_window(&window_box, 0, 0, 250, 100);
+		window = gds_window_new(top, &window_box);
+		clipped_top = gds_window_get_cell(window);
+
+		REQUIRE(clipped_top != top);
+		REQUIRE(g_list_length(clipped_top->child_cells) == 1);
+		inst = (struct gds_cell_instance *)clipped_top->child_cells->data;
+		REQUIRE(inst->cell_ref != child);
+		REQUIRE(inst->origin.x == 200);
+		REQUIRE(g_list_length(inst->cell_ref->graphic_objs) == 1);
+
+		/* Clipped in the coordinate system of the child */
+		gfx = (struct gds_graphics *)inst->cell_ref->graphic_objs->data;
+		gfx_extent(gfx, &min_x, &min_y, &max_x, &max_y);
+		REQUIRE(min_x == 0);
+		REQUIRE(max_x == 50);
+		REQUIRE(min_y == 0);
+		REQUIRE(max_y == 100);
+
+		gds_window_free(window);
+	}
+
+	SECTION("Rotated instance") {
+		/* The child covers x = -100..0 and y = 0..100 in the top cell */
+		add_instance(top, child, 0, 0, 90.0);
+		set_window(&window_box, -30, -10, 10, 200);
+		window = gds_window_new(top, &window_box);
+		clipped_top = gds_window_get_cell(window);
+
+		REQUIRE(g_list_length(clipped_top->child_cells) == 1);
+		inst = (struct gds_cell_instance *)clipped_top->child_cells->data;
+		REQUIRE(inst->angle == Approx(90.0));
+
+		gfx = (struct gds_graphics *)inst->cell_ref->graphic_objs->data;
+		gfx_extent(gfx, &min_x, &min_y, &max_x, &max_y);
+		REQUIRE(min_x == 0);
+		REQUIRE(max_x == 100);
+		REQUIRE(min_y == 0);
+		REQUIRE(max_y == 30);
+
+		gds_window_free(window);
+	}
+
+	SECTION("Instance inside of the window") {
+		add_instance(top, child, 200, 0, 0.0);
+		set_window(&window_box, 0, 0, 300, 100);
+		window = gds_window_new(top, &window_box);
+
+		/* Completely inside. Nothing is copied */
+		REQUIRE(gds_window_get_cell(window) == top);
+
+		gds_window_free(window);
+	}
+
+	free_cell(top);
+	free_cell(child);
+}
+
+TEST_CASE("gds-utils/gds-window/window_outside", "[GDS-UTILS]")
+{
+	struct gds_cell *top;
+	struct gds_cell *child;
+	struct gds_cell *clipped_top;
+	struct gds_window *window;
+	union bounding_box window_box;
+
+	top = create_cell("TOP");
+	child = create_cell("CHILD");
+	child->graphic_objs = g_list_append(child->graphic_objs, create_square(0, 0, 100));
+	top->graphic_objs = g_list_append(top->graphic_objs, create_square(-100, -100, 50));
+	add_instance(top, child, 200, 0, 0.0);
+
+	set_window(&window_box, 1000, 1000, 2000, 2000);
+	window = gds_window_new(top, &window_box);
+	clipped_top = gds_window_get_cell(window);
+
+	/* An empty cell with the same name is rendered */
+	REQUIRE(clipped_top != NULL);
+	REQUIRE(clipped_top != top);
+	REQUIRE(!strcmp(clipped_top->name, "TOP"));
+	REQUIRE(clipped_top->graphic_objs == NULL);
+	REQUIRE(clipped_top->child_cells == NULL);
+
+	gds_window_free(window);
+	free_cell(top);
+	free_cell(child);
+}
@@ -0,0 +1,178 @@
+#include <catch.hpp>
+#include <cstring>
+
+extern "C" {
+#include <gds-render/layer/layer-settings.h>
+}
+
+static void append_layer(LayerSettings *settings, int layer, int datatype, const char *name)
+{
+	struct layer_info info;
+
+	memset(&info, 0, sizeof(info));
+	info.layer = layer;
+	info.datatype = datatype;
+	info.name = (char *)name;
+	info.render = 1;
+	REQUIRE(layer_settings_append_layer_info(settings, &info) == 0);
+}
+
+static const char *lookup_name(LayerSettings *settings, int layer, int datatype)
+{
+	const struct layer_info *info;
+
+	info = layer_settings_lookup(settings, layer, datatype);
+
+	return info ? info->name : NULL;
+}
+
+TEST_CASE("layer/layer-settings/lookup_datatype_precedence", "[LAYER]")
+{
+	LayerSettings *settings;
+	int layer;
+
+	/* Low layers are indexed in a dense array, high layers in a hash table */
+	layer = GENERATE(5, 300);
+
+	settings = layer_settings_new();
+
+	SECTION("Whole layer first") {
+		append_layer(settings, layer, LAYER_INFO_ANY_DATATYPE, "all");
+		append_layer(settings, layer, 2, "dt2");
+	}
+
+	SECTION("Datatype first") {
+		append_layer(settings, layer, 2, "dt2");
+		append_layer(settings, layer, LAYER_INFO_ANY_DATATYPE, "all");
+	}
+
+	/* The exact datatype takes precedence */
+	REQUIRE(!strcmp(lookup_name(settings, layer, 2), "dt2"));
+	/* Other datatypes fall back to the whole layer */
+	REQUIRE(!strcmp(lookup_name(settings, layer, 0), "all"));
+	REQUIRE(!strcmp(lookup_name(settings, layer, 3), "all"));
+	REQUIRE(!strcmp(lookup_name(settings, layer, LAYER_INFO_ANY_DATATYPE), "all"));
+
+	REQUIRE(lookup_name(settings, layer + 1, 2) == NULL);
+	REQUIRE(lookup_name(settings, layer + 1, LAYER_INFO_ANY_DATATYPE) == NULL);
+
+	g_object_unref(settings);
+}
+
+TEST_CASE("layer/layer-settings/lookup_datatype_only", "[LAYER]")
+{
+	LayerSettings *settings;
+
+	settings = layer_settings_new();
+	append_layer(settings, 7, 1, "dt1");
+
+	REQUIRE(!strcmp(lookup_name(settings, 7, 1), "dt1"));
+	REQUIRE(lookup_name(settings, 7, 0) == NULL);
+	REQUIRE(lookup_name(settings, 7, LAYER_INFO_ANY_DATATYPE) == NULL);
+	REQUIRE(layer_settings_is_rendered(settings, 7, 1));
+	REQUIRE_FALSE(layer_settings_is_rendered(settings, 7, 0));
+
+	g_object_unref(settings);
+}
+
+TEST_CASE("layer/layer-settings/remove_layer", "[LAYER]")
+{
+	LayerSettings *settings;
+	GList *list;
+	int layer;
+
+	layer = GENERATE(5, 300);
+
+	settings = layer_settings_new();
+	append_layer(settings, layer, LAYER_INFO_ANY_DATATYPE, "first");
+	append_layer(settings, layer, 2, "dt2");
+	append_layer(settings, layer, LAYER_INFO_ANY_DATATYPE, "second");
+
+	/* The first entry of a combination is found */
+	REQUIRE(!strcmp(lookup_name(settings, layer, 0), "first"));
+
+	/* The last entry for the whole layer is removed */
+	REQUIRE(layer_settings_remove_layer(settings, layer) == 0);
+	REQUIRE(!strcmp(lookup_name(settings, layer, 0), "first"));
+	REQUIRE(!strcmp(lookup_name(settings, layer, 2), "dt2"));
+
+	/* Datatype specific entries are kept */
+	REQUIRE(layer_settings_remove_layer(settings, layer) == 0);
+	REQUIRE(lookup_name(settings, layer, 0) == NULL);
+	REQUIRE(!strcmp(lookup_name(settings, layer, 2), "dt2"));
+
+	REQUIRE(layer_settings_remove_layer(settings, layer) != 0);
+
+	/* The removed tail does not break appending */
+	append_layer(settings, layer + 1, LAYER_INFO_ANY_DATATYPE, "new");
+	list = layer_settings_get_layer_info_list(settings);
+	REQUIRE(g_list_length(list) == 2);
+	REQUIRE(!strcmp(((struct layer_info *)list->data)->name, "dt2"));
+	REQUIRE(!strcmp(((struct layer_info *)g_list_last(list)->data)->name, "new"));
+	REQUIRE(!strcmp(lookup_name(settings, layer + 1, 0), "new"));
+
+	g_object_unref(settings);
+}
+
+TEST_CASE("layer/layer-settings/remove_layer_indexed_entry", "[LAYER]")
+{
+	LayerSettings *settings;
+
+	settings = layer_settings_new();
+	append_layer(settings, 5, LAYER_INFO_ANY_DATATYPE, "first");
+	append_layer(settings, 6, LAYER_INFO_ANY_DATATYPE, "other");
+
+	REQUIRE(layer_settings_remove_layer(settings, 5) == 0);
+	REQUIRE(lookup_name(settings, 5, 0) == NULL);
+	REQUIRE(!strcmp(lookup_name(settings, 6, 0), "other"));
+
+	/* Appending after the last entry has been removed */
+	REQUIRE(layer_settings_remove_layer(settings, 6) == 0);
+	REQUIRE(layer_settings_get_layer_info_list(settings) == NULL);
+	append_layer(settings, 5, LAYER_INFO_ANY_DATATYPE, "again");
+	REQUIRE(!strcmp(lookup_name(settings, 5, 0), "again"));
+
+	g_object_unref(settings);
+}
+
+TEST_CASE("layer/layer-settings/whole_layer_list", "[LAYER]")
+{
+	LayerSettings *settings;
+	GList *list;
+
+	settings = layer_settings_new();
+	append_layer(settings, 12, 3, "dt3");
+	append_layer(settings, 12, LAYER_INFO_ANY_DATATYPE, "all");
+	append_layer(settings, 300, LAYER_INFO_ANY_DATATYPE, "high");
+	append_layer(settings, 12, LAYER_INFO_ANY_DATATYPE, "hidden");
+	append_layer(settings, 7, 1, "only datatype");
+
+	/* Only the first entry of each whole layer in stacking order */
+	list = layer_settings_get_whole_layer_list(settings);
+	REQUIRE(g_list_length(list) == 2);
+	REQUIRE(!strcmp(((struct layer_info *)list->data)->name, "all"));
+	REQUIRE(!strcmp(((struct layer_info *)list->next->data)->name, "high"));
+	g_list_free(list);
+
+	g_object_unref(settings);
+}
+
+TEST_CASE("layer/layer-settings/clear", "[LAYER]")
+{
+	LayerSettings *settings;
+
+	settings = layer_settings_new();
+	append_layer(settings, 5, LAYER_INFO_ANY_DATATYPE, "low");
+	append_layer(settings, 300, 1, "high");
+
+	layer_settings_clear(settings);
+	REQUIRE(layer_settings_get_layer_info_list(settings) == NULL);
+	REQUIRE(lookup_name(settings, 5, 0) == NULL);
+	REQUIRE(lookup_name(settings, 300, 1) == NULL);
+
+	/* The index is rebuilt after clearing */
+	append_layer(settings, 5, 1, "again");
+	REQUIRE(!strcmp(lookup_name(settings, 5, 1), "again"));
+
+	g_object_unref(settings);
+}
@@ -45,6 +45,9 @@ struct _ActivityBar {
 	/* Private stuff */
 	GtkWidget *spinner;
 	GtkWidget *label;
+	GtkWidget *progress_bar;
+	GtkWidget *cancel_button;
+	GCancellable *cancellable;
 };
 
 G_DEFINE_TYPE(ActivityBar, activity_bar, GTK_TYPE_BOX)
@@ -58,6 +61,9 @@ static void activity_bar_dispose(GObject *obj)
 	/* Clear references on owned objects */
 	g_clear_object(&bar->label);
 	g_clear_object(&bar->spinner);
+	g_clear_object(&bar->progress_bar);
+	g_clear_object(&bar->cancel_button);
+	g_clear_object(&bar->cancellable);
 
 	/* Chain up */
 	G_OBJECT_CLASS(activity_bar_parent_class)->dispose(obj);
@@ -70,6 +76,18 @@ static void activity_bar_class_init(ActivityBarClass *klass)
 	oclass->dispose = activity_bar_dispose;
 }
 
+static void activity_bar_cancel_clicked(GtkButton *button, gpointer user_data)
+{
+	ActivityBar *bar = ACTIVITY_BAR(user_data);
+	(void)button;
+
+	if (bar->cancellable)
+		g_cancellable_cancel(bar->cancellable);
+
+	/* Prevent multiple clicks. The owner of the activity resets the bar */
+	gtk_widget_set_sensitive(bar->cancel_button, FALSE);
+}
+
 static void activity_bar_init(ActivityBar *self)
 {
 	GtkContainer *box = GTK_CONTAINER(self);
@@ -77,15 +95,26 @@ static void activity_bar_init(ActivityBar *self)
 	/* Create Widgets */
 	self->label = gtk_label_new("");
 	self->spinner = gtk_spinner_new();
+	self->progress_bar = gtk_progress_bar_new();
+	gtk_widget_set_valign(self->progress_bar, GTK_ALIGN_CENTER);
+	self->cancel_button = gtk_button_new_with_label(_("Cancel"));
+	self->cancellable = NULL;
+	g_signal_connect(self->cancel_button, "clicked", G_CALLBACK(activity_bar_cancel_clicked), self);
 
 	/* Add to this widget and show */
 	gtk_container_add(box, self->spinner);
 	gtk_container_add(box, self->label);
+	gtk_box_pack_end(GTK_BOX(self), self->cancel_button, FALSE, FALSE, 0);
+	gtk_box_pack_end(GTK_BOX(self), self->progress_bar, FALSE, FALSE, 0);
 	gtk_widget_show(self->label);
 	gtk_widget_show(self->spinner);
+	gtk_widget_set_no_show_all(self->cancel_button, TRUE);
+	gtk_widget_set_no_show_all(self->progress_bar, TRUE);
 
 	g_object_ref(self->spinner);
 	g_object_ref(self->label);
+	g_object_ref(self->progress_bar);
+	g_object_ref(self->cancel_button);
 }
 
 ActivityBar *activity_bar_new()
@@ -103,6 +132,8 @@ void activity_bar_set_ready(ActivityBar *bar)
 {
 	gtk_label_set_text(GTK_LABEL(bar->label), _("Ready"));
 	gtk_spinner_stop(GTK_SPINNER(bar->spinner));
+	activity_bar_set_fraction(bar, -1.0);
+	activity_bar_set_cancellable(bar, NULL);
 }
 
 void activity_bar_set_busy(ActivityBar *bar, const char *text)
@@ -112,4 +143,26 @@ void activity_bar_set_busy(ActivityBar *bar, const char *text)
 }
 
 
+void activity_bar_set_fraction(ActivityBar *bar, double fraction)
+{
+	if (fraction < 0.0) {
+		gtk_widget_hide(bar->progress_bar);
+		return;
+	}
+
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(bar->progress_bar), CLAMP(fraction, 0.0, 1.0));
+	gtk_widget_show(bar->progress_bar);
+}
+
+void activity_bar_set_cancellable(ActivityBar *bar, GCancellable *cancellable)
+{
+	if (cancellable)
+		g_object_ref(cancellable);
+	g_clear_object(&bar->cancellable);
+	bar->cancellable = cancellable;
+
+	gtk_widget_set_sensitive(bar->cancel_button, TRUE);
+	gtk_widget_set_visible(bar->cancel_button, (cancellable ? TRUE : FALSE));
+}
+
 /** @} */
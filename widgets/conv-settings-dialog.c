@@ -38,6 +38,9 @@ struct  _RendererSettingsDialog {
 		GtkWidget *radio_latex;
 		GtkWidget *radio_cairo_pdf;
 		GtkWidget *radio_cairo_svg;
+		GtkWidget *radio_native_pdf;
+		GtkWidget *radio_native_svg;
+		GtkWidget *radio_png;
 		GtkWidget *scale;
 		GtkWidget *layer_check;
 		GtkWidget *standalone_check;
@@ -132,6 +135,21 @@ static void latex_render_callback(GtkToggleButton *radio, RendererSettingsDialog
 		hide_tex_options(dialog);
 }
 
+static void show_native_pdf_options(RendererSettingsDialog *self)
+{
+	/* The native PDF renderer supports layers (OCG), but no standalone option */
+	gtk_widget_show(self->layer_check);
+	gtk_widget_hide(self->standalone_check);
+}
+
+static void native_pdf_render_callback(GtkToggleButton *radio, RendererSettingsDialog *dialog)
+{
+	if (gtk_toggle_button_get_active(radio))
+		show_native_pdf_options(dialog);
+	else
+		hide_tex_options(dialog);
+}
+
 static gboolean shape_drawer_drawing_callback(GtkWidget *widget, cairo_t *cr, gpointer data)
 {
 	int width;
@@ -279,6 +297,9 @@ static void renderer_settings_dialog_init(RendererSettingsDialog *self)
 	self->radio_latex = GTK_WIDGET(gtk_builder_get_object(builder, "latex-radio"));
 	self->radio_cairo_pdf = GTK_WIDGET(gtk_builder_get_object(builder, "cairo-pdf-radio"));
 	self->radio_cairo_svg = GTK_WIDGET(gtk_builder_get_object(builder, "cairo-svg-radio"));
+	self->radio_native_pdf = GTK_WIDGET(gtk_builder_get_object(builder, "native-pdf-radio"));
+	self->radio_native_svg = GTK_WIDGET(gtk_builder_get_object(builder, "native-svg-radio"));
+	self->radio_png = GTK_WIDGET(gtk_builder_get_object(builder, "png-radio"));
 	self->scale = GTK_WIDGET(gtk_builder_get_object(builder, "dialog-scale"));
 	self->standalone_check = GTK_WIDGET(gtk_builder_get_object(builder, "standalone-check"));
 	self->layer_check = GTK_WIDGET(gtk_builder_get_object(builder, "layer-check"));
@@ -293,6 +314,7 @@ static void renderer_settings_dialog_init(RendererSettingsDialog *self)
 	gtk_window_set_title(GTK_WINDOW(self), _("Renderer Settings"));
 
 	g_signal_connect(self->radio_latex, "toggled", G_CALLBACK(latex_render_callback), (gpointer)self);
+	g_signal_connect(self->radio_native_pdf, "toggled", G_CALLBACK(native_pdf_render_callback), (gpointer)self);
 	g_signal_connect(G_OBJECT(self->shape_drawing),
 				"draw", G_CALLBACK(shape_drawer_drawing_callback), (gpointer)self);
 
@@ -332,6 +354,12 @@ void renderer_settings_dialog_get_settings(RendererSettingsDialog *dialog, struc
 		settings->renderer = RENDERER_CAIROGRAPHICS_PDF;
 	else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialog->radio_cairo_svg)) == TRUE)
 		settings->renderer = RENDERER_CAIROGRAPHICS_SVG;
+	else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialog->radio_native_pdf)) == TRUE)
+		settings->renderer = RENDERER_NATIVE_PDF;
+	else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialog->radio_native_svg)) == TRUE)
+		settings->renderer = RENDERER_NATIVE_SVG;
+	else if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialog->radio_png)) == TRUE)
+		settings->renderer = RENDERER_PNG;
 
 	settings->tex_pdf_layers = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialog->layer_check));
 	settings->tex_standalone = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(dialog->standalone_check));
@@ -359,6 +387,18 @@ void renderer_settings_dialog_set_settings(RendererSettingsDialog *dialog, struc
 		hide_tex_options(dialog);
 		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dialog->radio_cairo_svg), TRUE);
 		break;
+	case RENDERER_NATIVE_PDF:
+		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dialog->radio_native_pdf), TRUE);
+		show_native_pdf_options(dialog);
+		break;
+	case RENDERER_NATIVE_SVG:
+		hide_tex_options(dialog);
+		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dialog->radio_native_svg), TRUE);
+		break;
+	case RENDERER_PNG:
+		hide_tex_options(dialog);
+		gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(dialog->radio_png), TRUE);
+		break;
 	}
 }
 
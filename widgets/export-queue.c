@@ -0,0 +1,417 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file export-queue.c
+ * @brief Panel running and displaying concurrent export jobs
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup ExportQueue
+ * @ingroup Widgets
+ * @{
+ */
+
+#include <gds-render/widgets/export-queue.h>
+#include <glib/gi18n.h>
+
+/**
+ * @brief Height of the job list in pixels
+ */
+#define EXPORT_QUEUE_LIST_HEIGHT (120)
+
+/**
+ * @brief State of an export job
+ */
+enum export_job_state {
+	EXPORT_JOB_QUEUED = 0, /**< @brief Waiting for a free slot */
+	EXPORT_JOB_RUNNING, /**< @brief Rendering */
+	EXPORT_JOB_FINISHED, /**< @brief Rendering successful */
+	EXPORT_JOB_CANCELLED, /**< @brief Cancelled by the user */
+	EXPORT_JOB_FAILED, /**< @brief Renderer returned an error */
+};
+
+/**
+ * @brief A single export job and its row in the job list
+ */
+struct export_job {
+	ExportQueue *queue; /**< @brief Queue owning this job. Referenced while the job is running */
+	GdsOutputRenderer *renderer; /**< @brief Renderer. Referenced */
+	struct gds_cell *cell; /**< @brief Cell to render */
+	double scale; /**< @brief Output scale */
+	enum export_job_state state; /**< @brief Current state */
+	GtkWidget *row; /**< @brief Row in the job list */
+	GtkWidget *progress_bar; /**< @brief Progress of the rendering */
+	GtkWidget *status_label; /**< @brief Status message of the renderer */
+	GtkWidget *button; /**< @brief Cancel / remove button */
+	gboolean orphaned; /**< @brief The queue has been disposed while the job was running. The row is gone */
+};
+
+/** @brief Opaque ExportQueue object. Not viewable outside this source file. */
+struct _ExportQueue {
+	GtkBox super;
+	/* Private stuff */
+	GtkWidget *list_box;
+	GList *jobs; /**< @brief All jobs shown in the list */
+	GQueue *pending; /**< @brief Jobs waiting for a free slot */
+	guint running;
+	guint max_jobs;
+};
+
+G_DEFINE_TYPE(ExportQueue, export_queue, GTK_TYPE_BOX)
+
+enum export_queue_signal_ids {ACTIVE_JOBS_CHANGED = 0, EXPORT_QUEUE_SIGNAL_COUNT};
+static guint export_queue_signals[EXPORT_QUEUE_SIGNAL_COUNT];
+
+static void export_queue_start_pending_jobs(ExportQueue *queue);
+
+static void export_job_free(struct export_job *job)
+{
+	g_signal_handlers_disconnect_by_data(job->renderer, job);
+	g_object_unref(job->renderer);
+	g_free(job);
+}
+
+static void export_queue_dispose(GObject *obj)
+{
+	ExportQueue *queue;
+	GList *iter;
+	struct export_job *job;
+
+	queue = EXPORT_QUEUE(obj);
+
+	/* Running renderers finish in the background. Their jobs stay connected and free themselves
+	 * in export_job_finished(). This keeps the count of running jobs valid.
+	 */
+	for (iter = queue->jobs; iter != NULL; iter = iter->next) {
+		job = (struct export_job *)iter->data;
+		if (job->state == EXPORT_JOB_RUNNING) {
+			job->orphaned = TRUE;
+			gds_output_renderer_cancel_async(job->renderer);
+			continue;
+		}
+		export_job_free(job);
+	}
+	g_list_free(queue->jobs);
+	queue->jobs = NULL;
+
+	if (queue->pending) {
+		g_queue_free(queue->pending);
+		queue->pending = NULL;
+	}
+
+	g_clear_object(&queue->list_box);
+
+	/* Chain up */
+	G_OBJECT_CLASS(export_queue_parent_class)->dispose(obj);
+}
+
+static void export_queue_class_init(ExportQueueClass *klass)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+
+	oclass->dispose = export_queue_dispose;
+
+	export_queue_signals[ACTIVE_JOBS_CHANGED] =
+			g_signal_newv("active-jobs-changed", TYPE_EXPORT_QUEUE,
+				      G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE,
+				      NULL,
+				      NULL,
+				      NULL,
+				      NULL,
+				      G_TYPE_NONE,
+				      0,
+				      NULL);
+}
+
+static void export_queue_init(ExportQueue *self)
+{
+	GtkWidget *scrolled_window;
+
+	self->jobs = NULL;
+	self->pending = g_queue_new();
+	self->running = 0;
+	self->max_jobs = MAX(g_get_num_processors(), 1);
+
+	scrolled_window = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled_window), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+	gtk_widget_set_size_request(scrolled_window, -1, EXPORT_QUEUE_LIST_HEIGHT);
+
+	self->list_box = gtk_list_box_new();
+	gtk_list_box_set_selection_mode(GTK_LIST_BOX(self->list_box), GTK_SELECTION_NONE);
+	gtk_container_add(GTK_CONTAINER(scrolled_window), self->list_box);
+	gtk_container_add(GTK_CONTAINER(self), scrolled_window);
+	gtk_widget_show_all(scrolled_window);
+
+	g_object_ref(self->list_box);
+
+	/* Only shown while jobs are listed */
+	gtk_widget_set_no_show_all(GTK_WIDGET(self), TRUE);
+}
+
+ExportQueue *export_queue_new()
+{
+	return EXPORT_QUEUE(g_object_new(TYPE_EXPORT_QUEUE, "orientation", GTK_ORIENTATION_VERTICAL, NULL));
+}
+
+void export_queue_set_max_concurrent_jobs(ExportQueue *queue, guint max_jobs)
+{
+	queue->max_jobs = MAX(max_jobs, 1);
+	export_queue_start_pending_jobs(queue);
+}
+
+guint export_queue_get_active_job_count(ExportQueue *queue)
+{
+	/* Jobs still running after the queue has been disposed are counted as well */
+	return queue->running + (queue->pending ? g_queue_get_length(queue->pending) : 0);
+}
+
+/**
+ * @brief Update the row of \p job after its state changed
+ * @param job Export job
+ * @param state New state
+ * @param message Status message to display. If NULL, a default message for the state is displayed
+ */
+static void export_job_set_state(struct export_job *job, enum export_job_state state, const char *message)
+{
+	const char *default_message = NULL;
+
+	job->state = state;
+
+	switch (state) {
+	case EXPORT_JOB_QUEUED:
+		default_message = _("Queued");
+		break;
+	case EXPORT_JOB_RUNNING:
+		default_message = _("Starting...");
+		break;
+	case EXPORT_JOB_FINISHED:
+		default_message = _("Finished");
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(job->progress_bar), 1.0);
+		break;
+	case EXPORT_JOB_CANCELLED:
+		default_message = _("Cancelled");
+		break;
+	case EXPORT_JOB_FAILED:
+		default_message = _("Failed");
+		break;
+	}
+
+	gtk_label_set_text(GTK_LABEL(job->status_label), (message ? message : default_message));
+
+	/* Finished jobs can be removed from the list */
+	gtk_widget_set_sensitive(job->button, TRUE);
+	gtk_button_set_label(GTK_BUTTON(job->button),
+			     (state == EXPORT_JOB_QUEUED || state == EXPORT_JOB_RUNNING ? _("Cancel") : _("Remove")));
+}
+
+static void export_job_progress_changed(GdsOutputRenderer *renderer, const char *message, gpointer user_data)
+{
+	struct export_job *job = (struct export_job *)user_data;
+	(void)renderer;
+
+	if (message && !job->orphaned)
+		gtk_label_set_text(GTK_LABEL(job->status_label), message);
+}
+
+static void export_job_fraction_changed(GdsOutputRenderer *renderer, double fraction, int phase, gpointer user_data)
+{
+	struct export_job *job = (struct export_job *)user_data;
+	(void)renderer;
+	(void)phase;
+
+	if (!job->orphaned)
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(job->progress_bar), fraction);
+}
+
+static void export_job_finished(GdsOutputRenderer *renderer, gpointer user_data)
+{
+	struct export_job *job = (struct export_job *)user_data;
+	ExportQueue *queue = job->queue;
+	char *message;
+	int result;
+
+	if (job->orphaned) {
+		queue->running--;
+		export_job_free(job);
+		g_object_unref(queue);
+		return;
+	}
+
+	result = gds_output_renderer_get_async_result(renderer);
+	if (result == GDS_OUTPUT_RENDERER_CANCELLED) {
+		export_job_set_state(job, EXPORT_JOB_CANCELLED, NULL);
+	} else if (result) {
+		message = g_strdup_printf(_("Failed (error %d)"), result);
+		export_job_set_state(job, EXPORT_JOB_FAILED, message);
+		g_free(message);
+	} else {
+		export_job_set_state(job, EXPORT_JOB_FINISHED, NULL);
+	}
+
+	queue->running--;
+	export_queue_start_pending_jobs(queue);
+	g_signal_emit(queue, export_queue_signals[ACTIVE_JOBS_CHANGED], 0);
+	g_object_unref(queue);
+}
+
+/**
+ * @brief Start queued jobs until the maximum count of running jobs is reached
+ * @param queue Export queue
+ */
+static void export_queue_start_pending_jobs(ExportQueue *queue)
+{
+	struct export_job *job;
+
+	while (queue->running < queue->max_jobs && !g_queue_is_empty(queue->pending)) {
+		job = (struct export_job *)g_queue_pop_head(queue->pending);
+
+		/* Released in export_job_finished() */
+		g_object_ref(queue);
+		queue->running++;
+		export_job_set_state(job, EXPORT_JOB_RUNNING, NULL);
+		gds_output_renderer_render_output_async(job->renderer, job->cell, job->scale);
+	}
+}
+
+static void export_job_remove(struct export_job *job)
+{
+	ExportQueue *queue = job->queue;
+
+	queue->jobs = g_list_remove(queue->jobs, job);
+	gtk_widget_destroy(job->row);
+	export_job_free(job);
+
+	if (!queue->jobs)
+		gtk_widget_hide(GTK_WIDGET(queue));
+}
+
+static void export_job_button_clicked(GtkButton *button, gpointer user_data)
+{
+	struct export_job *job = (struct export_job *)user_data;
+	ExportQueue *queue = job->queue;
+	(void)button;
+
+	switch (job->state) {
+	case EXPORT_JOB_QUEUED:
+		g_queue_remove(queue->pending, job);
+		export_job_set_state(job, EXPORT_JOB_CANCELLED, NULL);
+		g_signal_emit(queue, export_queue_signals[ACTIVE_JOBS_CHANGED], 0);
+		break;
+	case EXPORT_JOB_RUNNING:
+		gds_output_renderer_cancel_async(job->renderer);
+		gtk_label_set_text(GTK_LABEL(job->status_label), _("Cancelling..."));
+		gtk_widget_set_sensitive(job->button, FALSE);
+		break;
+	default:
+		export_job_remove(job);
+		break;
+	}
+}
+
+void export_queue_add_job(ExportQueue *queue, GdsOutputRenderer *renderer, struct gds_cell *cell, double scale)
+{
+	struct export_job *job;
+	GtkWidget *name_label;
+	char *output_file = NULL;
+	char *basename;
+	char *name;
+
+	g_return_if_fail(EXPORT_IS_QUEUE(queue));
+	g_return_if_fail(GDS_RENDER_IS_OUTPUT_RENDERER(renderer));
+
+	job = g_new0(struct export_job, 1);
+	job->queue = queue;
+	job->renderer = GDS_RENDER_OUTPUT_RENDERER(g_object_ref(renderer));
+	job->cell = cell;
+	job->scale = scale;
+
+	g_signal_connect(renderer, "async-finished", G_CALLBACK(export_job_finished), job);
+	g_signal_connect(renderer, "progress-changed", G_CALLBACK(export_job_progress_changed), job);
+	g_signal_connect(renderer, "progress-fraction-changed", G_CALLBACK(export_job_fraction_changed), job);
+
+	/* Create row */
+	g_object_get(renderer, "output-file", &output_file, NULL);
+	basename = g_path_get_basename(output_file ? output_file : "");
+	name = g_strdup_printf("%s: %s", cell->name, basename);
+	name_label = gtk_label_new(name);
+	gtk_label_set_ellipsize(GTK_LABEL(name_label), PANGO_ELLIPSIZE_MIDDLE);
+	gtk_label_set_xalign(GTK_LABEL(name_label), 0.0);
+	g_free(name);
+	g_free(basename);
+	g_free(output_file);
+
+	job->progress_bar = gtk_progress_bar_new();
+	gtk_widget_set_valign(job->progress_bar, GTK_ALIGN_CENTER);
+	job->status_label = gtk_label_new("");
+	gtk_label_set_ellipsize(GTK_LABEL(job->status_label), PANGO_ELLIPSIZE_END);
+	gtk_label_set_xalign(GTK_LABEL(job->status_label), 0.0);
+	job->button = gtk_button_new_with_label(_("Cancel"));
+	g_signal_connect(job->button, "clicked", G_CALLBACK(export_job_button_clicked), job);
+
+	job->row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+	gtk_box_pack_start(GTK_BOX(job->row), name_label, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(job->row), job->status_label, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(job->row), job->progress_bar, FALSE, FALSE, 0);
+	gtk_box_pack_end(GTK_BOX(job->row), job->button, FALSE, FALSE, 0);
+	gtk_widget_show_all(job->row);
+	gtk_list_box_insert(GTK_LIST_BOX(queue->list_box), job->row, -1);
+	gtk_widget_show(GTK_WIDGET(queue));
+
+	export_job_set_state(job, EXPORT_JOB_QUEUED, NULL);
+	queue->jobs = g_list_append(queue->jobs, job);
+	g_queue_push_tail(queue->pending, job);
+
+	export_queue_start_pending_jobs(queue);
+	g_signal_emit(queue, export_queue_signals[ACTIVE_JOBS_CHANGED], 0);
+}
+
+void export_queue_cancel_all(ExportQueue *queue)
+{
+	struct export_job *job;
+	GList *iter;
+
+	if (!queue->pending)
+		return;
+
+	while (!g_queue_is_empty(queue->pending)) {
+		job = (struct export_job *)g_queue_pop_head(queue->pending);
+		export_job_set_state(job, EXPORT_JOB_CANCELLED, NULL);
+	}
+
+	for (iter = queue->jobs; iter != NULL; iter = iter->next) {
+		job = (struct export_job *)iter->data;
+		if (job->state == EXPORT_JOB_RUNNING)
+			gds_output_renderer_cancel_async(job->renderer);
+	}
+
+	g_signal_emit(queue, export_queue_signals[ACTIVE_JOBS_CHANGED], 0);
+}
+
+void export_queue_wait_for_running_jobs(ExportQueue *queue)
+{
+	g_return_if_fail(EXPORT_IS_QUEUE(queue));
+
+	/* The renderers report their completion in the main context */
+	while (queue->running)
+		g_main_context_iteration(NULL, TRUE);
+}
+
+/** @} */
@@ -75,6 +75,8 @@ static void layer_element_init(LayerElement *self)
 	self->priv.layer = GTK_LABEL(gtk_builder_get_object(builder, "layer"));
 	self->priv.name = GTK_ENTRY(gtk_builder_get_object(builder, "entry"));
 	self->priv.event_handle = GTK_EVENT_BOX(gtk_builder_get_object(builder, "event-box"));
+	self->priv.count = GTK_LABEL(gtk_builder_get_object(builder, "count"));
+	self->priv.object_count = 0;
 
 	g_object_unref(builder);
 }
@@ -110,6 +112,36 @@ int layer_element_get_layer(LayerElement *elem)
 	return elem->priv.layer_num;
 }
 
+void layer_element_add_object_count(LayerElement *elem, size_t count, const char *details)
+{
+	gchar *text;
+	gchar *old_details;
+
+	elem->priv.object_count += count;
+	text = g_strdup_printf(ngettext("%zu object", "%zu objects", elem->priv.object_count),
+			       elem->priv.object_count);
+	gtk_label_set_text(elem->priv.count, text);
+	g_free(text);
+
+	if (!details)
+		return;
+
+	old_details = gtk_widget_get_tooltip_text(GTK_WIDGET(elem->priv.count));
+	if (old_details) {
+		text = g_strconcat(old_details, "\n", details, NULL);
+		gtk_widget_set_tooltip_text(GTK_WIDGET(elem->priv.count), text);
+		g_free(text);
+		g_free(old_details);
+	} else {
+		gtk_widget_set_tooltip_text(GTK_WIDGET(elem->priv.count), details);
+	}
+}
+
+size_t layer_element_get_object_count(LayerElement *elem)
+{
+	return elem->priv.object_count;
+}
+
 void layer_element_set_export(LayerElement *elem, gboolean export)
 {
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(elem->priv.export), export);
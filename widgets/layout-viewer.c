@@ -0,0 +1,750 @@
+/*
+ * GDSII-Converter
+ * Copyright (C) 2019  Mario Hüttel <mario.huettel@gmx.net>
+ *
+ * This file is part of GDSII-Converter.
+ *
+ * GDSII-Converter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * GDSII-Converter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GDSII-Converter.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file layout-viewer.c
+ * @brief Zoomable layout viewer rendering tiles in the background
+ * @author Mario Hüttel <mario.huettel@gmx.net>
+ */
+
+/**
+ * @addtogroup LayoutViewer
+ * @ingroup Widgets
+ * @{
+ */
+
+#include <math.h>
+#include <gds-render/widgets/layout-viewer.h>
+#include <gds-render/output-renderers/layout-painter.h>
+
+/** @brief Width and height of a tile in pixels */
+#define LAYOUT_VIEWER_TILE_SIZE (256)
+
+/** @brief Maximum count of tiles kept in memory. Tiles of all zoom levels share this limit */
+#define LAYOUT_VIEWER_MAX_TILES (256)
+
+/** @brief Size of the cell's bounding box in pixels at zoom level 0 */
+#define LAYOUT_VIEWER_BASE_EXTENT (1024.0)
+
+/** @brief Zoom levels per factor of 2 */
+#define LAYOUT_VIEWER_LEVELS_PER_OCTAVE (2)
+
+/** @brief Lowest zoom level */
+#define LAYOUT_VIEWER_MIN_LEVEL (-16)
+
+/** @brief Highest zoom level */
+#define LAYOUT_VIEWER_MAX_LEVEL (48)
+
+/** @brief Coarser zoom levels drawn while tiles of the current level are rendered */
+#define LAYOUT_VIEWER_FALLBACK_LEVELS (6)
+
+/**
+ * @brief Position of a tile
+ *
+ * At zoom level l, tile (x, y) covers the pixels [x * T, (x + 1) * T) x [y * T, (y + 1) * T)
+ * of the layout scaled by layout_viewer_level_scale(). The y axis points down.
+ */
+struct layout_viewer_tile_key {
+	gint level; /**< @brief Zoom level */
+	gint64 x; /**< @brief Column */
+	gint64 y; /**< @brief Row */
+};
+
+/**
+ * @brief A tile rendered in the background
+ *
+ * The job is always passed back to the main context. The reference to the viewer is therefore dropped there.
+ */
+struct layout_viewer_job {
+	LayoutViewer *viewer; /**< @brief Viewer. Referenced */
+	struct layout_painter *painter; /**< @brief Painter of the shown cell. Referenced */
+	struct layout_viewer_tile_key key; /**< @brief Tile to render */
+	double scale; /**< @brief Pixels per database unit */
+	guint generation; /**< @brief Generation of the viewer when the job was created */
+	guint64 sequence; /**< @brief Creation order. Newer jobs are processed first */
+	GCancellable *cancellable; /**< @brief Cancelled when the zoom level changes. Referenced */
+	cairo_surface_t *surface; /**< @brief Rendered tile. Set by the worker */
+};
+
+/** @brief Opaque LayoutViewer object. Not viewable outside this source file. */
+struct _LayoutViewer {
+	GtkDrawingArea super;
+	/* Private stuff */
+	struct layout_painter *painter; /**< @brief Painter of the shown cell or NULL */
+	double base_scale; /**< @brief Pixels per database unit at zoom level 0 */
+	int level; /**< @brief Current zoom level */
+	double center_x; /**< @brief Center of the view in database units */
+	double center_y; /**< @brief Center of the view in database units */
+	gboolean fit_pending; /**< @brief Zoom to fit once the widget has a size */
+	GHashTable *tiles; /**< @brief Rendered tiles. Maps @ref layout_viewer_tile_key to cairo_surface_t */
+	GQueue *tile_order; /**< @brief Keys of @ref _LayoutViewer::tiles. Least recently used first */
+	GHashTable *pending; /**< @brief Set of @ref layout_viewer_tile_key currently rendered */
+	GThreadPool *pool; /**< @brief Worker threads */
+	GCancellable *cancellable; /**< @brief Cancellable of the jobs of the current zoom level */
+	guint64 sequence; /**< @brief Sequence number of the next job */
+	gboolean dragging; /**< @brief The view is being panned with the mouse */
+	double drag_x; /**< @brief Last pointer position while dragging */
+	double drag_y; /**< @brief Last pointer position while dragging */
+	double scroll_delta; /**< @brief Accumulated smooth scroll delta */
+	struct gds_cell *cell; /**< @brief Shown cell or NULL */
+	gboolean selecting; /**< @brief A window is being selected with the mouse */
+	double select_x; /**< @brief Start of the selection in database units */
+	double select_y; /**< @brief Start of the selection in database units */
+	gboolean window_valid; /**< @brief @ref _LayoutViewer::window is selected */
+	union bounding_box window; /**< @brief Selected window in database units */
+
+	/* Shared with the worker threads */
+	GMutex lock; /**< @brief Protects the fields below */
+	GCond idle_cond; /**< @brief Signalled when @ref _LayoutViewer::active_jobs drops to zero */
+	guint generation; /**< @brief Incremented when the shown cell changes */
+	guint active_jobs; /**< @brief Jobs currently painting */
+};
+
+G_DEFINE_TYPE(LayoutViewer, layout_viewer, GTK_TYPE_DRAWING_AREA)
+
+static guint layout_viewer_tile_key_hash(gconstpointer key)
+{
+	const struct layout_viewer_tile_key *k = (const struct layout_viewer_tile_key *)key;
+
+	return (guint)k->x * 73856093U ^ (guint)k->y * 19349663U ^ (guint)k->level * 83492791U;
+}
+
+static gboolean layout_viewer_tile_key_equal(gconstpointer a, gconstpointer b)
+{
+	const struct layout_viewer_tile_key *ka = (const struct layout_viewer_tile_key *)a;
+	const struct layout_viewer_tile_key *kb = (const struct layout_viewer_tile_key *)b;
+
+	return ka->level == kb->level && ka->x == kb->x && ka->y == kb->y;
+}
+
+static double layout_viewer_level_scale(LayoutViewer *viewer, int level)
+{
+	return viewer->base_scale * pow(2.0, (double)level / LAYOUT_VIEWER_LEVELS_PER_OCTAVE);
+}
+
+/**
+ * @brief Convert a widget position to database units
+ * @param viewer Layout viewer
+ * @param px Widget position in pixels
+ * @param py Widget position in pixels
+ * @param[out] x Layout position
+ * @param[out] y Layout position
+ */
+static void layout_viewer_widget_to_layout(LayoutViewer *viewer, double px, double py, double *x, double *y)
+{
+	double scale = layout_viewer_level_scale(viewer, viewer->level);
+
+	*x = viewer->center_x + (px - gtk_widget_get_allocated_width(GTK_WIDGET(viewer)) / 2.0) / scale;
+	*y = viewer->center_y - (py - gtk_widget_get_allocated_height(GTK_WIDGET(viewer)) / 2.0) / scale;
+}
+
+/**
+ * @brief Update the selected window from its start and a widget position
+ * @param viewer Layout viewer
+ * @param px Widget position in pixels
+ * @param py Widget position in pixels
+ */
+static void layout_viewer_update_window(LayoutViewer *viewer, double px, double py)
+{
+	double x;
+	double y;
+
+	layout_viewer_widget_to_layout(viewer, px, py, &x, &y);
+	viewer->window.vectors.lower_left.x = MIN(x, viewer->select_x);
+	viewer->window.vectors.lower_left.y = MIN(y, viewer->select_y);
+	viewer->window.vectors.upper_right.x = MAX(x, viewer->select_x);
+	viewer->window.vectors.upper_right.y = MAX(y, viewer->select_y);
+}
+
+/**
+ * @brief Draw the selected window on top of the layout
+ * @param viewer Layout viewer
+ * @param cr Cairo context of the widget
+ */
+static void layout_viewer_draw_window(LayoutViewer *viewer, cairo_t *cr)
+{
+	const double dashes[] = {4.0, 4.0};
+	double scale = layout_viewer_level_scale(viewer, viewer->level);
+	double x;
+	double y;
+
+	x = (viewer->window.vectors.lower_left.x - viewer->center_x) * scale +
+		gtk_widget_get_allocated_width(GTK_WIDGET(viewer)) / 2.0;
+	y = (viewer->center_y - viewer->window.vectors.upper_right.y) * scale +
+		gtk_widget_get_allocated_height(GTK_WIDGET(viewer)) / 2.0;
+
+	cairo_save(cr);
+	cairo_rectangle(cr, floor(x) + 0.5, floor(y) + 0.5,
+			floor((viewer->window.vectors.upper_right.x - viewer->window.vectors.lower_left.x) * scale),
+			floor((viewer->window.vectors.upper_right.y - viewer->window.vectors.lower_left.y) * scale));
+	cairo_set_source_rgba(cr, 0.2, 0.4, 1.0, 0.15);
+	cairo_fill_preserve(cr);
+	cairo_set_source_rgb(cr, 0.2, 0.4, 1.0);
+	cairo_set_line_width(cr, 1.0);
+	cairo_set_dash(cr, dashes, 2, 0.0);
+	cairo_stroke(cr);
+	cairo_restore(cr);
+}
+
+static void layout_viewer_job_free(gpointer data)
+{
+	struct layout_viewer_job *job = (struct layout_viewer_job *)data;
+
+	if (job->surface)
+		cairo_surface_destroy(job->surface);
+	layout_painter_unref(job->painter);
+	g_object_unref(job->cancellable);
+	g_object_unref(job->viewer);
+	g_free(job);
+}
+
+static gboolean layout_viewer_job_dispatch(gpointer data)
+{
+	struct layout_viewer_job *job = (struct layout_viewer_job *)data;
+	LayoutViewer *viewer = job->viewer;
+	struct layout_viewer_tile_key *key;
+
+	/* Shown cell has changed in the meantime */
+	if (job->generation != viewer->generation)
+		return G_SOURCE_REMOVE;
+
+	g_hash_table_remove(viewer->pending, &job->key);
+
+	/* Cancelled. A redraw skipped the tile while it was pending. Request it again if it is still needed */
+	if (!job->surface) {
+		gtk_widget_queue_draw(GTK_WIDGET(viewer));
+		return G_SOURCE_REMOVE;
+	}
+
+	if (!g_hash_table_contains(viewer->tiles, &job->key)) {
+		key = g_memdup(&job->key, sizeof(job->key));
+		g_hash_table_insert(viewer->tiles, key, job->surface);
+		job->surface = NULL;
+		g_queue_push_tail(viewer->tile_order, key);
+
+		while (g_queue_get_length(viewer->tile_order) > LAYOUT_VIEWER_MAX_TILES)
+			g_hash_table_remove(viewer->tiles, g_queue_pop_head(viewer->tile_order));
+	}
+
+	gtk_widget_queue_draw(GTK_WIDGET(viewer));
+
+	return G_SOURCE_REMOVE;
+}
+
+static void layout_viewer_job_run(gpointer data, gpointer user_data)
+{
+	struct layout_viewer_job *job = (struct layout_viewer_job *)data;
+	LayoutViewer *viewer = LAYOUT_VIEWER(user_data);
+	cairo_t *cr;
+	gboolean skip;
+	int ret;
+
+	g_mutex_lock(&viewer->lock);
+	skip = (job->generation != viewer->generation) || g_cancellable_is_cancelled(job->cancellable);
+	if (!skip)
+		viewer->active_jobs++;
+	g_mutex_unlock(&viewer->lock);
+
+	if (skip)
+		goto post;
+
+	job->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, LAYOUT_VIEWER_TILE_SIZE, LAYOUT_VIEWER_TILE_SIZE);
+	cr = cairo_create(job->surface);
+	cairo_translate(cr, -(double)job->key.x * LAYOUT_VIEWER_TILE_SIZE, -(double)job->key.y * LAYOUT_VIEWER_TILE_SIZE);
+	cairo_scale(cr, job->scale, -job->scale);
+	ret = layout_painter_paint(job->painter, cr, LAYOUT_VIEWER_TILE_SIZE, LAYOUT_VIEWER_TILE_SIZE,
+				   LAYOUT_PAINTER_DEFAULT_LOD_THRESHOLD, job->cancellable);
+	cairo_destroy(cr);
+
+	if (ret) {
+		cairo_surface_destroy(job->surface);
+		job->surface = NULL;
+	}
+
+	g_mutex_lock(&viewer->lock);
+	if (--viewer->active_jobs == 0)
+		g_cond_broadcast(&viewer->idle_cond);
+	g_mutex_unlock(&viewer->lock);
+
+post:
+	g_main_context_invoke_full(NULL, G_PRIORITY_DEFAULT_IDLE, layout_viewer_job_dispatch,
+				   job, layout_viewer_job_free);
+}
+
+/**
+ * @brief Process the newest jobs first. These belong to the current view
+ */
+static gint layout_viewer_job_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const struct layout_viewer_job *job_a = (const struct layout_viewer_job *)a;
+	const struct layout_viewer_job *job_b = (const struct layout_viewer_job *)b;
+	(void)user_data;
+
+	if (job_a->sequence == job_b->sequence)
+		return 0;
+
+	return job_a->sequence > job_b->sequence ? -1 : 1;
+}
+
+static void layout_viewer_request_tile(LayoutViewer *viewer, const struct layout_viewer_tile_key *key)
+{
+	struct layout_viewer_job *job;
+
+	if (g_hash_table_contains(viewer->pending, key))
+		return;
+
+	g_hash_table_add(viewer->pending, g_memdup(key, sizeof(*key)));
+
+	job = g_new0(struct layout_viewer_job, 1);
+	job->viewer = g_object_ref(viewer);
+	job->painter = layout_painter_ref(viewer->painter);
+	job->key = *key;
+	job->scale = layout_viewer_level_scale(viewer, key->level);
+	job->generation = viewer->generation;
+	job->sequence = viewer->sequence++;
+	job->cancellable = g_object_ref(viewer->cancellable);
+
+	g_thread_pool_push(viewer->pool, job, NULL);
+}
+
+/**
+ * @brief Move a tile to the end of the least recently used list
+ */
+static void layout_viewer_touch_tile(LayoutViewer *viewer, struct layout_viewer_tile_key *stored_key)
+{
+	g_queue_remove(viewer->tile_order, stored_key);
+	g_queue_push_tail(viewer->tile_order, stored_key);
+}
+
+/**
+ * @brief Draw all available tiles of a zoom level into the current view
+ * @param viewer Layout viewer
+ * @param cr Cairo context of the widget
+ * @param level Zoom level of the tiles
+ * @param current TRUE if \p level is the current zoom level. Missing tiles are requested
+ */
+static void layout_viewer_draw_level(LayoutViewer *viewer, cairo_t *cr, int level, gboolean current)
+{
+	struct layout_viewer_tile_key key;
+	gpointer stored_key;
+	gpointer surface;
+	double scale;
+	double factor;
+	double width;
+	double height;
+	double origin_x;
+	double origin_y;
+	gint64 first_x;
+	gint64 first_y;
+	gint64 last_x;
+	gint64 last_y;
+
+	scale = layout_viewer_level_scale(viewer, level);
+	factor = layout_viewer_level_scale(viewer, viewer->level) / scale;
+
+	/* Visible area in pixels of the tile level */
+	width = gtk_widget_get_allocated_width(GTK_WIDGET(viewer)) / factor;
+	height = gtk_widget_get_allocated_height(GTK_WIDGET(viewer)) / factor;
+	origin_x = floor(viewer->center_x * scale - width / 2.0);
+	origin_y = floor(-viewer->center_y * scale - height / 2.0);
+
+	first_x = (gint64)floor(origin_x / LAYOUT_VIEWER_TILE_SIZE);
+	first_y = (gint64)floor(origin_y / LAYOUT_VIEWER_TILE_SIZE);
+	last_x = (gint64)floor((origin_x + width) / LAYOUT_VIEWER_TILE_SIZE);
+	last_y = (gint64)floor((origin_y + height) / LAYOUT_VIEWER_TILE_SIZE);
+
+	key.level = level;
+	for (key.y = first_y; key.y <= last_y; key.y++) {
+		for (key.x = first_x; key.x <= last_x; key.x++) {
+			if (!g_hash_table_lookup_extended(viewer->tiles, &key, &stored_key, &surface)) {
+				if (current)
+					layout_viewer_request_tile(viewer, &key);
+				continue;
+			}
+
+			if (current)
+				layout_viewer_touch_tile(viewer, (struct layout_viewer_tile_key *)stored_key);
+
+			cairo_save(cr);
+			cairo_scale(cr, factor, factor);
+			cairo_set_source_surface(cr, (cairo_surface_t *)surface,
+						 (double)key.x * LAYOUT_VIEWER_TILE_SIZE - origin_x,
+						 (double)key.y * LAYOUT_VIEWER_TILE_SIZE - origin_y);
+			cairo_paint(cr);
+			cairo_restore(cr);
+		}
+	}
+}
+
+static gboolean layout_viewer_draw(GtkWidget *widget, cairo_t *cr)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(widget);
+	int level;
+
+	gtk_render_background(gtk_widget_get_style_context(widget), cr, 0, 0,
+			      gtk_widget_get_allocated_width(widget), gtk_widget_get_allocated_height(widget));
+
+	if (!viewer->painter)
+		return FALSE;
+
+	if (viewer->fit_pending)
+		layout_viewer_zoom_to_fit(viewer);
+
+	/* Coarser levels fill the gaps until the tiles of the current level are rendered */
+	for (level = MAX(viewer->level - LAYOUT_VIEWER_FALLBACK_LEVELS, LAYOUT_VIEWER_MIN_LEVEL);
+	     level < viewer->level; level++)
+		layout_viewer_draw_level(viewer, cr, level, FALSE);
+
+	layout_viewer_draw_level(viewer, cr, viewer->level, TRUE);
+
+	if (viewer->window_valid || viewer->selecting)
+		layout_viewer_draw_window(viewer, cr);
+
+	return FALSE;
+}
+
+/**
+ * @brief Change the zoom level and keep the layout position under a widget position
+ * @param viewer Layout viewer
+ * @param level New zoom level
+ * @param anchor_x Widget position in pixels
+ * @param anchor_y Widget position in pixels
+ */
+static void layout_viewer_set_level(LayoutViewer *viewer, int level, double anchor_x, double anchor_y)
+{
+	double old_scale;
+	double new_scale;
+	double offset_x;
+	double offset_y;
+
+	level = CLAMP(level, LAYOUT_VIEWER_MIN_LEVEL, LAYOUT_VIEWER_MAX_LEVEL);
+	if (level == viewer->level)
+		return;
+
+	old_scale = layout_viewer_level_scale(viewer, viewer->level);
+	new_scale = layout_viewer_level_scale(viewer, level);
+	offset_x = anchor_x - gtk_widget_get_allocated_width(GTK_WIDGET(viewer)) / 2.0;
+	offset_y = anchor_y - gtk_widget_get_allocated_height(GTK_WIDGET(viewer)) / 2.0;
+
+	viewer->center_x += offset_x / old_scale - offset_x / new_scale;
+	viewer->center_y -= offset_y / old_scale - offset_y / new_scale;
+	viewer->level = level;
+
+	/* Tiles of the previous level are not needed anymore. Rendered tiles stay in the cache */
+	g_cancellable_cancel(viewer->cancellable);
+	g_object_unref(viewer->cancellable);
+	viewer->cancellable = g_cancellable_new();
+
+	gtk_widget_queue_draw(GTK_WIDGET(viewer));
+}
+
+static gboolean layout_viewer_scroll_event(GtkWidget *widget, GdkEventScroll *event)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(widget);
+	int steps = 0;
+
+	switch (event->direction) {
+	case GDK_SCROLL_UP:
+		steps = 1;
+		break;
+	case GDK_SCROLL_DOWN:
+		steps = -1;
+		break;
+	case GDK_SCROLL_SMOOTH:
+		viewer->scroll_delta -= event->delta_y;
+		steps = (int)viewer->scroll_delta;
+		viewer->scroll_delta -= steps;
+		break;
+	default:
+		break;
+	}
+
+	if (steps && viewer->painter)
+		layout_viewer_set_level(viewer, viewer->level + steps, event->x, event->y);
+
+	return TRUE;
+}
+
+static gboolean layout_viewer_button_press_event(GtkWidget *widget, GdkEventButton *event)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(widget);
+
+	if (event->button == GDK_BUTTON_SECONDARY && event->type == GDK_BUTTON_PRESS) {
+		layout_viewer_clear_window(viewer);
+		return TRUE;
+	}
+
+	if (event->button != GDK_BUTTON_PRIMARY)
+		return FALSE;
+
+	if (event->type == GDK_2BUTTON_PRESS) {
+		layout_viewer_zoom_to_fit(viewer);
+		return TRUE;
+	}
+
+	/* Shift + drag selects the window to render */
+	if ((event->state & GDK_SHIFT_MASK) && viewer->painter) {
+		viewer->selecting = TRUE;
+		viewer->window_valid = FALSE;
+		layout_viewer_widget_to_layout(viewer, event->x, event->y, &viewer->select_x, &viewer->select_y);
+		layout_viewer_update_window(viewer, event->x, event->y);
+		gtk_widget_queue_draw(widget);
+		return TRUE;
+	}
+
+	viewer->dragging = TRUE;
+	viewer->drag_x = event->x;
+	viewer->drag_y = event->y;
+
+	return TRUE;
+}
+
+static gboolean layout_viewer_button_release_event(GtkWidget *widget, GdkEventButton *event)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(widget);
+
+	if (event->button != GDK_BUTTON_PRIMARY)
+		return FALSE;
+
+	if (viewer->selecting) {
+		viewer->selecting = FALSE;
+		layout_viewer_update_window(viewer, event->x, event->y);
+		viewer->window_valid =
+			viewer->window.vectors.lower_left.x < viewer->window.vectors.upper_right.x &&
+			viewer->window.vectors.lower_left.y < viewer->window.vectors.upper_right.y;
+		gtk_widget_queue_draw(widget);
+	}
+
+	viewer->dragging = FALSE;
+
+	return TRUE;
+}
+
+static gboolean layout_viewer_motion_notify_event(GtkWidget *widget, GdkEventMotion *event)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(widget);
+	double scale;
+
+	if (viewer->selecting) {
+		layout_viewer_update_window(viewer, event->x, event->y);
+		gtk_widget_queue_draw(widget);
+		return TRUE;
+	}
+
+	if (!viewer->dragging || !viewer->painter)
+		return FALSE;
+
+	scale = layout_viewer_level_scale(viewer, viewer->level);
+	viewer->center_x -= (event->x - viewer->drag_x) / scale;
+	viewer->center_y += (event->y - viewer->drag_y) / scale;
+	viewer->drag_x = event->x;
+	viewer->drag_y = event->y;
+
+	gtk_widget_queue_draw(widget);
+
+	return TRUE;
+}
+
+/**
+ * @brief Discard the shown cell and all its tiles
+ *
+ * Waits until no worker accesses the cell anymore.
+ *
+ * @param viewer Layout viewer
+ */
+static void layout_viewer_invalidate(LayoutViewer *viewer)
+{
+	g_mutex_lock(&viewer->lock);
+	viewer->generation++;
+	g_mutex_unlock(&viewer->lock);
+
+	g_cancellable_cancel(viewer->cancellable);
+	g_object_unref(viewer->cancellable);
+	viewer->cancellable = g_cancellable_new();
+
+	g_mutex_lock(&viewer->lock);
+	while (viewer->active_jobs)
+		g_cond_wait(&viewer->idle_cond, &viewer->lock);
+	g_mutex_unlock(&viewer->lock);
+
+	g_queue_clear(viewer->tile_order);
+	g_hash_table_remove_all(viewer->tiles);
+	g_hash_table_remove_all(viewer->pending);
+
+	if (viewer->painter) {
+		layout_painter_unref(viewer->painter);
+		viewer->painter = NULL;
+	}
+}
+
+static void layout_viewer_dispose(GObject *obj)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(obj);
+
+	/* Queued jobs hold a reference to the viewer. They are skipped from now on */
+	if (viewer->cancellable)
+		layout_viewer_invalidate(viewer);
+
+	G_OBJECT_CLASS(layout_viewer_parent_class)->dispose(obj);
+}
+
+static void layout_viewer_finalize(GObject *obj)
+{
+	LayoutViewer *viewer = LAYOUT_VIEWER(obj);
+
+	/* All jobs have been dispatched. Otherwise, the viewer would still be referenced */
+	g_thread_pool_free(viewer->pool, FALSE, TRUE);
+	g_queue_free(viewer->tile_order);
+	g_hash_table_destroy(viewer->tiles);
+	g_hash_table_destroy(viewer->pending);
+	g_clear_object(&viewer->cancellable);
+	g_mutex_clear(&viewer->lock);
+	g_cond_clear(&viewer->idle_cond);
+
+	G_OBJECT_CLASS(layout_viewer_parent_class)->finalize(obj);
+}
+
+static void layout_viewer_class_init(LayoutViewerClass *klass)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS(klass);
+	GtkWidgetClass *widget_class = GTK_WIDGET_CLASS(klass);
+
+	oclass->dispose = layout_viewer_dispose;
+	oclass->finalize = layout_viewer_finalize;
+
+	widget_class->draw = layout_viewer_draw;
+	widget_class->scroll_event = layout_viewer_scroll_event;
+	widget_class->button_press_event = layout_viewer_button_press_event;
+	widget_class->button_release_event = layout_viewer_button_release_event;
+	widget_class->motion_notify_event = layout_viewer_motion_notify_event;
+}
+
+static void layout_viewer_init(LayoutViewer *self)
+{
+	g_mutex_init(&self->lock);
+	g_cond_init(&self->idle_cond);
+
+	self->painter = NULL;
+	self->base_scale = 1.0;
+	self->level = 0;
+	self->tiles = g_hash_table_new_full(layout_viewer_tile_key_hash, layout_viewer_tile_key_equal, g_free,
+					    (GDestroyNotify)cairo_surface_destroy);
+	self->tile_order = g_queue_new();
+	self->pending = g_hash_table_new_full(layout_viewer_tile_key_hash, layout_viewer_tile_key_equal, g_free, NULL);
+	self->cancellable = g_cancellable_new();
+	self->pool = g_thread_pool_new(layout_viewer_job_run, self, MAX(g_get_num_processors(), 1), FALSE, NULL);
+	g_thread_pool_set_sort_function(self->pool, layout_viewer_job_compare, NULL);
+
+	gtk_widget_add_events(GTK_WIDGET(self), GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK | GDK_BUTTON_PRESS_MASK |
+			      GDK_BUTTON_RELEASE_MASK | GDK_BUTTON1_MOTION_MASK);
+	gtk_widget_set_size_request(GTK_WIDGET(self), 200, 200);
+}
+
+LayoutViewer *layout_viewer_new()
+{
+	return LAYOUT_VIEWER(g_object_new(TYPE_LAYOUT_VIEWER, NULL));
+}
+
+void layout_viewer_set_cell(LayoutViewer *viewer, struct gds_cell *cell, LayerSettings *settings)
+{
+	const union bounding_box *box;
+	double extent;
+
+	g_return_if_fail(LAYOUT_IS_VIEWER(viewer));
+
+	layout_viewer_invalidate(viewer);
+
+	/* The window belongs to the cell. Keep it if only the layers change */
+	if (cell != viewer->cell) {
+		viewer->selecting = FALSE;
+		viewer->window_valid = FALSE;
+	}
+	viewer->cell = cell;
+
+	if (cell && settings) {
+		viewer->painter = layout_painter_new(cell, settings);
+		box = layout_painter_get_bounding_box(viewer->painter);
+		if (!bounding_box_is_empty(box)) {
+			/* Keep the tile grid independent of the widget size */
+			extent = MAX(box->vectors.upper_right.x - box->vectors.lower_left.x,
+				     box->vectors.upper_right.y - box->vectors.lower_left.y);
+			viewer->base_scale = extent > 0.0 ? LAYOUT_VIEWER_BASE_EXTENT / extent : 1.0;
+		}
+		viewer->fit_pending = TRUE;
+	}
+
+	gtk_widget_queue_draw(GTK_WIDGET(viewer));
+}
+
+void layout_viewer_zoom_to_fit(LayoutViewer *viewer)
+{
+	const union bounding_box *box;
+	double width;
+	double height;
+	double fit_scale;
+	int level;
+
+	g_return_if_fail(LAYOUT_IS_VIEWER(viewer));
+
+	if (!viewer->painter)
+		return;
+
+	width = gtk_widget_get_allocated_width(GTK_WIDGET(viewer));
+	height = gtk_widget_get_allocated_height(GTK_WIDGET(viewer));
+	box = layout_painter_get_bounding_box(viewer->painter);
+	if (bounding_box_is_empty(box) || width <= 1 || height <= 1)
+		return;
+
+	viewer->fit_pending = FALSE;
+
+	fit_scale = MIN(width / MAX(box->vectors.upper_right.x - box->vectors.lower_left.x, 1.0),
+			height / MAX(box->vectors.upper_right.y - box->vectors.lower_left.y, 1.0));
+	level = (int)floor(LAYOUT_VIEWER_LEVELS_PER_OCTAVE * log2(fit_scale / viewer->base_scale));
+
+	/* Center the cell. Changing the level cancels the tiles of the old level */
+	layout_viewer_set_level(viewer, level, width / 2.0, height / 2.0);
+	viewer->center_x = (box->vectors.lower_left.x + box->vectors.upper_right.x) / 2.0;
+	viewer->center_y = (box->vectors.lower_left.y + box->vectors.upper_right.y) / 2.0;
+
+	gtk_widget_queue_draw(GTK_WIDGET(viewer));
+}
+
+gboolean layout_viewer_get_window(LayoutViewer *viewer, union bounding_box *window)
+{
+	g_return_val_if_fail(LAYOUT_IS_VIEWER(viewer), FALSE);
+
+	if (!viewer->window_valid)
+		return FALSE;
+
+	if (window)
+		*window = viewer->window;
+
+	return TRUE;
+}
+
+void layout_viewer_clear_window(LayoutViewer *viewer)
+{
+	g_return_if_fail(LAYOUT_IS_VIEWER(viewer));
+
+	viewer->selecting = FALSE;
+	viewer->window_valid = FALSE;
+	gtk_widget_queue_draw(GTK_WIDGET(viewer));
+}
+
+/** @} */